@@ -0,0 +1,213 @@
+#include "AppxBlockMap.h"
+#include <cstring>
+#include <string_view>
+#include <winrt/base.h>
+
+namespace {
+    std::string EscapeXml(const std::string& value)
+    {
+        std::string escaped;
+        escaped.reserve(value.size());
+
+        for (char c : value) {
+            switch (c) {
+                case '&':  escaped += "&amp;"; break;
+                case '<':  escaped += "&lt;"; break;
+                case '>':  escaped += "&gt;"; break;
+                case '"':  escaped += "&quot;"; break;
+                case '\'': escaped += "&apos;"; break;
+                default:   escaped += c; break;
+            }
+        }
+
+        return escaped;
+    }
+
+    std::string UnescapeXml(const std::string& value)
+    {
+        static const std::pair<const char*, char> entities[] = {
+            { "&amp;", '&' }, { "&lt;", '<' }, { "&gt;", '>' }, { "&quot;", '"' }, { "&apos;", '\'' }
+        };
+
+        std::string unescaped;
+        unescaped.reserve(value.size());
+
+        for (size_t i = 0; i < value.size(); i++) {
+            bool replaced = false;
+            if (value[i] == '&') {
+                for (const auto& [entity, character] : entities) {
+                    if (value.compare(i, strlen(entity), entity) == 0) {
+                        unescaped += character;
+                        i += strlen(entity) - 1;
+                        replaced = true;
+                        break;
+                    }
+                }
+            }
+
+            if (!replaced) {
+                unescaped += value[i];
+            }
+        }
+
+        return unescaped;
+    }
+
+    // Value of an attribute within a start tag, or false if the tag doesn't have it
+    bool FindAttribute(std::string_view tag, std::string_view name, std::string& value)
+    {
+        size_t position = 0;
+        while ((position = tag.find(name, position)) != std::string_view::npos) {
+            size_t valueStart = position + name.size();
+            bool atNameStart = position > 0 && isspace(static_cast<unsigned char>(tag[position - 1]));
+
+            if (atNameStart && valueStart + 1 < tag.size() && tag[valueStart] == '=' && tag[valueStart + 1] == '"') {
+                size_t valueEnd = tag.find('"', valueStart + 2);
+                if (valueEnd == std::string_view::npos) {
+                    return false;
+                }
+                value.assign(tag.substr(valueStart + 2, valueEnd - valueStart - 2));
+                return true;
+            }
+
+            position = valueStart;
+        }
+
+        return false;
+    }
+
+    bool ParseUInt64(const std::string& text, uint64_t& value)
+    {
+        if (text.empty() || text.find_first_not_of("0123456789") != std::string::npos) {
+            return false;
+        }
+
+        value = std::stoull(text);
+        return true;
+    }
+}
+
+void AppxBlockMap::AddFile(BlockMapFile file)
+{
+    m_fileIndex[file.name] = m_files.size();
+    m_files.push_back(std::move(file));
+}
+
+const std::vector<BlockMapFile>& AppxBlockMap::Files() const
+{
+    return m_files;
+}
+
+const BlockMapFile* AppxBlockMap::Find(const std::wstring& name) const
+{
+    auto match = m_fileIndex.find(name);
+    return match != m_fileIndex.end() ? &m_files[match->second] : nullptr;
+}
+
+std::string AppxBlockMap::ToXml() const
+{
+    std::string xml;
+    xml.reserve(256 + m_files.size() * 128);
+    
+    xml += "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\"?>\r\n";
+    xml += "<BlockMap xmlns=\"http://schemas.microsoft.com/appx/2010/blockmap\" "
+           "HashMethod=\"http://www.w3.org/2001/04/xmlenc#sha256\">";
+    
+    for (const auto& file : m_files) {
+        xml += "<File Name=\"" + EscapeXml(winrt::to_string(file.name)) + "\"";
+        xml += " Size=\"" + std::to_string(file.size) + "\"";
+        xml += " LfhSize=\"" + std::to_string(file.localHeaderSize) + "\"";
+        
+        if (file.blocks.empty()) {
+            xml += "/>";
+            continue;
+        }
+        
+        xml += ">";
+        for (const auto& block : file.blocks) {
+            xml += "<Block Hash=\"" + HashUtils::ToBase64(block.hash.data(), block.hash.size()) + "\"";
+            
+            // Stored files omit the size; every block but the last is exactly BlockSize bytes
+            if (file.compressed) {
+                xml += " Size=\"" + std::to_string(block.compressedSize) + "\"";
+            }
+            xml += "/>";
+        }
+        xml += "</File>";
+    }
+    
+    xml += "</BlockMap>";
+    return xml;
+}
+
+bool AppxBlockMap::Parse(const std::string& xml)
+{
+    m_files.clear();
+    m_fileIndex.clear();
+    
+    // The block map has a fixed shape (File elements holding Block elements), so a scan over the
+    // tags is enough and stays fast for packages with hundreds of thousands of blocks
+    size_t position = 0;
+    while ((position = xml.find("<File", position)) != std::string::npos) {
+        size_t tagEnd = xml.find('>', position);
+        if (tagEnd == std::string::npos) {
+            return false;
+        }
+        
+        std::string_view tag(xml.data() + position, tagEnd - position);
+        bool selfClosing = xml[tagEnd - 1] == '/';
+        std::string name;
+        std::string size;
+        std::string localHeaderSize;
+        uint64_t value = 0;
+        
+        BlockMapFile file;
+        if (!FindAttribute(tag, "Name", name) || !FindAttribute(tag, "Size", size) || !ParseUInt64(size, file.size)) {
+            return false;
+        }
+        
+        file.name = winrt::to_hstring(UnescapeXml(name));
+        if (FindAttribute(tag, "LfhSize", localHeaderSize) && ParseUInt64(localHeaderSize, value)) {
+            file.localHeaderSize = static_cast<uint32_t>(value);
+        }
+        
+        position = tagEnd + 1;
+        
+        if (!selfClosing) {
+            size_t fileEnd = xml.find("</File>", position);
+            if (fileEnd == std::string::npos) {
+                return false;
+            }
+            
+            size_t blockStart = 0;
+            while ((blockStart = xml.find("<Block", position)) < fileEnd) {
+                size_t blockEnd = xml.find('>', blockStart);
+                std::string_view blockTag(xml.data() + blockStart, blockEnd - blockStart);
+                std::string hash;
+                std::string blockSize;
+                std::vector<uint8_t> digest;
+                
+                BlockMapBlock block;
+                if (!FindAttribute(blockTag, "Hash", hash) || !HashUtils::FromBase64(hash, digest) || digest.size() != block.hash.size()) {
+                    return false;
+                }
+                std::copy(digest.begin(), digest.end(), block.hash.begin());
+                
+                // Only compressed files record a size per block
+                if (FindAttribute(blockTag, "Size", blockSize) && ParseUInt64(blockSize, value)) {
+                    block.compressedSize = static_cast<uint32_t>(value);
+                    file.compressed = true;
+                }
+                
+                file.blocks.push_back(block);
+                position = blockEnd + 1;
+            }
+            
+            position = fileEnd + strlen("</File>");
+        }
+        
+        AddFile(std::move(file));
+    }
+    
+    return true;
+}
\ No newline at end of file
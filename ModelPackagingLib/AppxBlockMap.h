@@ -0,0 +1,53 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+#include "HashUtils.h"
+
+// One 64 KB block of a package file
+struct BlockMapBlock
+{
+    HashUtils::Sha256Digest hash{}; // SHA-256 of the uncompressed block
+    uint32_t compressedSize = 0;    // Size of the block's deflate segment, 0 for stored files
+};
+
+// One payload file of a package as described by AppxBlockMap.xml
+struct BlockMapFile
+{
+    std::wstring name;              // Relative path with backslash separators
+    uint64_t size = 0;              // Uncompressed size
+    uint32_t localHeaderSize = 0;   // Size of the file's ZIP local file header
+    bool compressed = false;
+    std::vector<BlockMapBlock> blocks;
+};
+
+// Builds the AppxBlockMap.xml footprint file that lists the hash of every 64 KB block of every payload file
+class AppxBlockMap
+{
+public:
+    static constexpr size_t BlockSize = 64 * 1024;
+
+    AppxBlockMap() = default;
+    ~AppxBlockMap() = default;
+
+    // Add a payload file, in package order
+    void AddFile(BlockMapFile file);
+
+    // Files in package order
+    const std::vector<BlockMapFile>& Files() const;
+
+    // Find a file by name (backslash separators), or nullptr
+    const BlockMapFile* Find(const std::wstring& name) const;
+
+    // Serialize to UTF-8 XML
+    std::string ToXml() const;
+
+    // Parse the AppxBlockMap.xml of an existing package, replacing the current files
+    bool Parse(const std::string& xml);
+
+private:
+    std::vector<BlockMapFile> m_files;
+    std::unordered_map<std::wstring, size_t> m_fileIndex;
+};
\ No newline at end of file
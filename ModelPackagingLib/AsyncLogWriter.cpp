@@ -0,0 +1,149 @@
+#include "AsyncLogWriter.h"
+#include <map>
+#include <algorithm>
+
+namespace {
+    // Distinguishes writers so a thread never reuses a queue of a destroyed writer at the same address
+    std::atomic<uint64_t> g_nextWriterId = 1;
+}
+
+AsyncLogWriter::AsyncLogWriter(
+    LogSink sink,
+    std::function<void()> batchCallback,
+    std::chrono::milliseconds flushInterval)
+    : m_sink(std::move(sink)),
+      m_batchCallback(std::move(batchCallback)),
+      m_flushInterval(flushInterval),
+      m_writerId(g_nextWriterId++),
+      m_nextSequence(0),
+      m_stopRequested(false),
+      m_urgent(false)
+{
+    m_flusher = std::thread([this]() { FlushLoop(); });
+}
+
+AsyncLogWriter::~AsyncLogWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_stopRequested = true;
+    }
+    m_wakeCondition.notify_one();
+    
+    if (m_flusher.joinable()) {
+        m_flusher.join();
+    }
+    
+    // Pick up anything queued after the flusher's last pass
+    Flush();
+}
+
+LogSink AsyncLogWriter::Sink()
+{
+    return [this](LogLevel level, const std::wstring& message) {
+        Enqueue(level, message);
+    };
+}
+
+AsyncLogWriter::ThreadQueue& AsyncLogWriter::GetThreadQueue()
+{
+    thread_local std::map<uint64_t, std::shared_ptr<ThreadQueue>> threadQueues;
+    
+    auto& queue = threadQueues[m_writerId];
+    if (!queue) {
+        queue = std::make_shared<ThreadQueue>();
+        queue->slots.resize(DefaultQueueCapacity);
+        
+        std::lock_guard<std::mutex> lock(m_queuesMutex);
+        m_queues.push_back(queue);
+    }
+    
+    return *queue;
+}
+
+void AsyncLogWriter::Enqueue(LogLevel level, const std::wstring& message)
+{
+    ThreadQueue& queue = GetThreadQueue();
+    size_t tail = queue.tail.load(std::memory_order_relaxed);
+    
+    // A full queue means the flusher is behind; wake it and wait for room rather than drop the message
+    while (tail - queue.head.load(std::memory_order_acquire) >= queue.slots.size()) {
+        m_urgent = true;
+        m_wakeCondition.notify_one();
+        std::this_thread::yield();
+    }
+    
+    Record& record = queue.slots[tail % queue.slots.size()];
+    record.sequence = m_nextSequence.fetch_add(1, std::memory_order_relaxed);
+    record.level = level;
+    record.message = message;
+    queue.tail.store(tail + 1, std::memory_order_release);
+    
+    // Errors are shown right away
+    if (level == LogLevel::Error) {
+        m_urgent = true;
+        m_wakeCondition.notify_one();
+    }
+}
+
+void AsyncLogWriter::Flush()
+{
+    Drain();
+}
+
+void AsyncLogWriter::Drain()
+{
+    std::lock_guard<std::mutex> drainLock(m_drainMutex);
+    
+    std::vector<std::shared_ptr<ThreadQueue>> queues;
+    {
+        std::lock_guard<std::mutex> lock(m_queuesMutex);
+        queues = m_queues;
+    }
+    
+    m_batch.clear();
+    for (auto& queue : queues) {
+        size_t head = queue->head.load(std::memory_order_relaxed);
+        size_t tail = queue->tail.load(std::memory_order_acquire);
+        
+        for (size_t i = head; i < tail; i++) {
+            m_batch.push_back(std::move(queue->slots[i % queue->slots.size()]));
+        }
+        
+        queue->head.store(tail, std::memory_order_release);
+    }
+    
+    // Interleave the threads' messages in the order they were logged
+    std::sort(m_batch.begin(), m_batch.end(), [](const Record& a, const Record& b) {
+        return a.sequence < b.sequence;
+    });
+    
+    if (m_sink) {
+        for (const auto& record : m_batch) {
+            m_sink(record.level, record.message);
+        }
+    }
+    
+    if (m_batchCallback) {
+        m_batchCallback();
+    }
+}
+
+void AsyncLogWriter::FlushLoop()
+{
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(m_wakeMutex);
+            m_wakeCondition.wait_for(lock, m_flushInterval, [this]() {
+                return m_stopRequested.load() || m_urgent.load();
+            });
+        }
+        
+        m_urgent = false;
+        Drain();
+        
+        if (m_stopRequested) {
+            break;
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <condition_variable>
+#include "Logger.h"
+
+// Moves log output off the calling threads. Each thread appends to its own lock-free
+// single-producer queue; a background thread drains all queues at a fixed interval,
+// hands the messages to the real sink in order and then calls the batch callback
+// once, so the sink can flush its stream once per batch instead of once per line.
+class AsyncLogWriter
+{
+public:
+    static constexpr size_t DefaultQueueCapacity = 1024;
+
+    AsyncLogWriter(
+        LogSink sink,
+        std::function<void()> batchCallback = nullptr,
+        std::chrono::milliseconds flushInterval = std::chrono::milliseconds(50));
+
+    // Delivers everything still queued before returning
+    ~AsyncLogWriter();
+
+    AsyncLogWriter(const AsyncLogWriter&) = delete;
+    AsyncLogWriter& operator=(const AsyncLogWriter&) = delete;
+
+    // Sink for a Logger that queues messages on this writer; the writer must outlive the logger
+    LogSink Sink();
+
+    // Queue a message; only waits if the calling thread's queue is full
+    void Enqueue(LogLevel level, const std::wstring& message);
+
+    // Deliver everything queued so far
+    void Flush();
+
+private:
+    struct Record
+    {
+        uint64_t sequence = 0;
+        LogLevel level = LogLevel::Info;
+        std::wstring message;
+    };
+
+    // Written only by its owning thread and read only by the draining thread
+    struct ThreadQueue
+    {
+        std::vector<Record> slots;
+        std::atomic<size_t> head = 0;
+        std::atomic<size_t> tail = 0;
+    };
+
+    // Queue of the calling thread, created on its first message
+    ThreadQueue& GetThreadQueue();
+
+    // Move every queued record to the sink
+    void Drain();
+
+    // Background thread body
+    void FlushLoop();
+
+    LogSink m_sink;
+    std::function<void()> m_batchCallback;
+    std::chrono::milliseconds m_flushInterval;
+    uint64_t m_writerId;
+
+    std::atomic<uint64_t> m_nextSequence;
+    std::atomic<bool> m_stopRequested;
+    std::atomic<bool> m_urgent;
+
+    std::mutex m_queuesMutex;
+    std::vector<std::shared_ptr<ThreadQueue>> m_queues;
+
+    // Serializes draining between the flusher thread and Flush()
+    std::mutex m_drainMutex;
+    std::vector<Record> m_batch;
+
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wakeCondition;
+    std::thread m_flusher;
+};
\ No newline at end of file
@@ -0,0 +1,134 @@
+#include "BandwidthLimiter.h"
+#include <algorithm>
+
+namespace {
+    // A share's bucket holds this much of its rate, so short gaps between reads don't waste
+    // bandwidth and the pauses stay short enough to keep the transfer smooth
+    constexpr double BurstSeconds = 0.25;
+
+    // But at least two read chunks, so a low limit still lets a chunk through without a pause
+    constexpr double MinBurstBytes = 2 * 64 * 1024;
+
+    int64_t ToMicroseconds(std::chrono::steady_clock::duration duration)
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+    }
+}
+
+double BandwidthStats::UnthrottledBytesPerSecond(double wallSeconds) const
+{
+    double activeSeconds = transferSeconds - throttledSeconds;
+    if (activeSeconds <= 0 || wallSeconds <= 0) {
+        return 0;
+    }
+    
+    double concurrency = transferSeconds / wallSeconds;
+    return bytes / activeSeconds * concurrency;
+}
+
+BandwidthShare::BandwidthShare(BandwidthLimiter& limiter, double weight)
+    : m_limiter(limiter),
+      m_weight(weight),
+      m_tokens(MinBurstBytes),
+      m_lastRefill(std::chrono::steady_clock::now()),
+      m_bytes(0),
+      m_transferMicroseconds(0),
+      m_throttledMicroseconds(0)
+{
+}
+
+BandwidthShare::~BandwidthShare()
+{
+    m_limiter.Leave(*this);
+}
+
+std::chrono::microseconds BandwidthShare::Consume(uint32_t bytes)
+{
+    m_bytes.fetch_add(bytes, std::memory_order_relaxed);
+    
+    auto pause = m_limiter.Consume(*this, bytes);
+    if (pause.count() > 0) {
+        m_throttledMicroseconds.fetch_add(pause.count(), std::memory_order_relaxed);
+    }
+    return pause;
+}
+
+void BandwidthShare::AddTransferTime(std::chrono::steady_clock::duration time)
+{
+    m_transferMicroseconds.fetch_add(ToMicroseconds(time), std::memory_order_relaxed);
+}
+
+BandwidthStats BandwidthShare::Stats() const
+{
+    BandwidthStats stats;
+    stats.bytes = m_bytes.load(std::memory_order_relaxed);
+    stats.transferSeconds = m_transferMicroseconds.load(std::memory_order_relaxed) / 1e6;
+    stats.throttledSeconds = m_throttledMicroseconds.load(std::memory_order_relaxed) / 1e6;
+    return stats;
+}
+
+BandwidthLimiter& BandwidthLimiter::Instance()
+{
+    static BandwidthLimiter limiter;
+    return limiter;
+}
+
+BandwidthLimiter::BandwidthLimiter()
+    : m_limit(0),
+      m_totalWeight(0)
+{
+}
+
+void BandwidthLimiter::SetLimit(uint64_t bytesPerSecond)
+{
+    m_limit = bytesPerSecond;
+}
+
+uint64_t BandwidthLimiter::Limit() const
+{
+    return m_limit;
+}
+
+std::shared_ptr<BandwidthShare> BandwidthLimiter::Join(double weight)
+{
+    auto share = std::make_shared<BandwidthShare>(*this, weight > 0 ? weight : 1.0);
+    
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_totalWeight += share->m_weight;
+    return share;
+}
+
+void BandwidthLimiter::Leave(const BandwidthShare& share)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_totalWeight = (std::max)(0.0, m_totalWeight - share.m_weight);
+}
+
+std::chrono::microseconds BandwidthLimiter::Consume(BandwidthShare& share, uint32_t bytes)
+{
+    uint64_t limit = m_limit;
+    if (limit == 0) {
+        return std::chrono::microseconds(0);
+    }
+    
+    std::lock_guard<std::mutex> lock(m_mutex);
+    
+    // The share's rate follows the jobs downloading right now, so a job that finishes leaves its
+    // bandwidth to the others
+    double rate = limit * (share.m_weight / (std::max)(share.m_weight, m_totalWeight));
+    double burst = (std::max)(MinBurstBytes, rate * BurstSeconds);
+    
+    auto now = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration<double>(now - share.m_lastRefill).count();
+    share.m_lastRefill = now;
+    share.m_tokens = (std::min)(burst, share.m_tokens + elapsed * rate);
+    share.m_tokens -= bytes;
+    
+    if (share.m_tokens >= 0) {
+        return std::chrono::microseconds(0);
+    }
+    
+    // Pause until the refill pays off the debt; lanes of the same job that consume meanwhile
+    // see the larger debt and pause longer
+    return std::chrono::microseconds(static_cast<int64_t>(-share.m_tokens / rate * 1e6));
+}
\ No newline at end of file
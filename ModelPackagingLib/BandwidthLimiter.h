@@ -0,0 +1,91 @@
+#pragma once
+
+#include <mutex>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+class BandwidthLimiter;
+
+// Bytes a job downloaded and how much the bandwidth limit held it back
+struct BandwidthStats
+{
+    uint64_t bytes = 0;
+    double transferSeconds = 0;     // Summed over the transfers, which overlap
+    double throttledSeconds = 0;    // Part of transferSeconds spent paused by the limit
+
+    // Throughput the job would have had without the limit: what the transfers achieved while they
+    // weren't paused, scaled by how many ran at once over wallSeconds
+    double UnthrottledBytesPerSecond(double wallSeconds) const;
+};
+
+// A job's part of the process-wide limit. The job's transfers share one token bucket, filled at
+// the limit times the job's weight over the summed weights of the jobs downloading at the time.
+class BandwidthShare
+{
+public:
+    BandwidthShare(BandwidthLimiter& limiter, double weight);
+    ~BandwidthShare();
+
+    BandwidthShare(const BandwidthShare&) = delete;
+    BandwidthShare& operator=(const BandwidthShare&) = delete;
+
+    // Take bytes that were just received from the bucket, returning how long the transfer should
+    // pause before reading more; zero while there is no limit or the bucket still holds tokens
+    std::chrono::microseconds Consume(uint32_t bytes);
+
+    // Count the duration of a finished transfer, pauses included
+    void AddTransferTime(std::chrono::steady_clock::duration time);
+
+    BandwidthStats Stats() const;
+
+private:
+    friend class BandwidthLimiter;
+
+    BandwidthLimiter& m_limiter;
+    double m_weight;
+
+    // Bucket state, guarded by the limiter's mutex
+    double m_tokens;
+    std::chrono::steady_clock::time_point m_lastRefill;
+
+    std::atomic<uint64_t> m_bytes;
+    std::atomic<int64_t> m_transferMicroseconds;
+    std::atomic<int64_t> m_throttledMicroseconds;
+};
+
+// Limits the download bandwidth of the whole process, so a large download on a shared build agent
+// leaves room for other jobs. Transfers don't wait for tokens before reading: they take the bytes
+// of each chunk they receive and, when the bucket runs into debt, pause on a thread pool timer
+// before the next read, which lets TCP flow control slow the sender. Nothing spins and no data is
+// buffered or copied for the limiter.
+class BandwidthLimiter
+{
+public:
+    // The limiter shared by every download in the process
+    static BandwidthLimiter& Instance();
+
+    // Limit the process to bytesPerSecond in total; 0 removes the limit
+    void SetLimit(uint64_t bytesPerSecond);
+
+    uint64_t Limit() const;
+
+    // Start a job's downloads with a weight relative to the other jobs downloading at the same time.
+    // The job leaves when the last reference to its share is released.
+    std::shared_ptr<BandwidthShare> Join(double weight = 1.0);
+
+private:
+    friend class BandwidthShare;
+
+    BandwidthLimiter();
+    ~BandwidthLimiter() = default;
+
+    void Leave(const BandwidthShare& share);
+    std::chrono::microseconds Consume(BandwidthShare& share, uint32_t bytes);
+
+    std::atomic<uint64_t> m_limit;
+
+    std::mutex m_mutex;
+    double m_totalWeight;
+};
\ No newline at end of file
@@ -0,0 +1,75 @@
+#include "CancellationToken.h"
+
+CancellationToken::CancellationToken() : m_state(std::make_shared<State>())
+{
+}
+
+void CancellationToken::Cancel() const
+{
+    std::unique_lock<std::mutex> lock(m_state->mutex);
+    if (m_state->cancelled.exchange(true)) {
+        return;
+    }
+
+    // Run the callbacks one at a time outside the lock so that they may touch the token themselves.
+    // Nothing registers once the token is cancelled, and a callback unregistered before its turn
+    // doesn't run.
+    while (!m_state->callbacks.empty()) {
+        auto entry = m_state->callbacks.begin();
+        std::function<void()> callback = std::move(entry->second);
+        m_state->runningId = entry->first;
+        m_state->runningThread = std::this_thread::get_id();
+        m_state->callbacks.erase(entry);
+        lock.unlock();
+
+        callback();
+        callback = nullptr;
+
+        lock.lock();
+        m_state->runningId = 0;
+        m_state->callbackDone.notify_all();
+    }
+}
+
+bool CancellationToken::IsCancelled() const
+{
+    return m_state->cancelled;
+}
+
+uint64_t CancellationToken::Register(std::function<void()> callback) const
+{
+    {
+        std::lock_guard<std::mutex> lock(m_state->mutex);
+        if (!m_state->cancelled) {
+            uint64_t registrationId = m_state->nextRegistrationId++;
+            m_state->callbacks.emplace(registrationId, std::move(callback));
+            return registrationId;
+        }
+    }
+
+    callback();
+    return 0;
+}
+
+void CancellationToken::Unregister(uint64_t registrationId) const
+{
+    std::unique_lock<std::mutex> lock(m_state->mutex);
+    m_state->callbacks.erase(registrationId);
+
+    m_state->callbackDone.wait(lock, [&]() {
+        return registrationId == 0 ||
+            m_state->runningId != registrationId ||
+            m_state->runningThread == std::this_thread::get_id();
+    });
+}
+
+CancellationRegistration::CancellationRegistration(const CancellationToken& token, std::function<void()> callback)
+    : m_token(token),
+      m_registrationId(token.Register(std::move(callback)))
+{
+}
+
+CancellationRegistration::~CancellationRegistration()
+{
+    m_token.Unregister(m_registrationId);
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <functional>
+#include <condition_variable>
+
+// Shared cancellation flag; copies of a token observe and signal the same state
+class CancellationToken
+{
+public:
+    CancellationToken();
+
+    // Request cancellation and run the registered callbacks
+    void Cancel() const;
+
+    // Whether cancellation has been requested
+    bool IsCancelled() const;
+
+    // Run a callback when cancellation is requested (immediately if it already was).
+    // Returns an id that can be passed to Unregister.
+    uint64_t Register(std::function<void()> callback) const;
+
+    // Remove a callback added with Register. If the callback is running on another thread, waits for
+    // it to return, so that what it uses can be destroyed afterwards; a callback may unregister itself.
+    void Unregister(uint64_t registrationId) const;
+
+private:
+    struct State
+    {
+        std::mutex mutex;
+        std::atomic<bool> cancelled = false;
+        uint64_t nextRegistrationId = 1;
+        std::map<uint64_t, std::function<void()>> callbacks;
+
+        // Callback Cancel() is running, and the thread it runs on
+        uint64_t runningId = 0;
+        std::thread::id runningThread;
+        std::condition_variable callbackDone;
+    };
+
+    std::shared_ptr<State> m_state;
+};
+
+// Keeps a callback registered with a token for the lifetime of the object
+class CancellationRegistration
+{
+public:
+    CancellationRegistration(const CancellationToken& token, std::function<void()> callback);
+    ~CancellationRegistration();
+
+    CancellationRegistration(const CancellationRegistration&) = delete;
+    CancellationRegistration& operator=(const CancellationRegistration&) = delete;
+
+private:
+    CancellationToken m_token;
+    uint64_t m_registrationId;
+};
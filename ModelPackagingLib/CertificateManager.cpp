@@ -1,5 +1,5 @@
 #include "CertificateManager.h"
-#include <iostream>
+#include "ProcessRunner.h"
 #include <Windows.h>
 #include <sstream>
 #include <regex>
@@ -9,6 +9,12 @@
 // Include WIL for RAII resource management
 #include <wil/resource.h>
 
+CertificateManager::CertificateManager(Logger logger, CancellationToken cancellationToken)
+    : m_logger(std::move(logger)),
+      m_cancellationToken(std::move(cancellationToken))
+{
+}
+
 bool CertificateManager::SignPackage(
     const fs::path& msixPath,
     const fs::path& certPath,
@@ -17,63 +23,62 @@ bool CertificateManager::SignPackage(
     // Find SignTool.exe
     fs::path signToolPath = FindSignToolPath();
     if (signToolPath.empty() || !fs::exists(signToolPath)) {
-        std::wcerr << L"SignTool.exe not found in Windows SDK" << std::endl;
+        m_logger.Error() << L"SignTool.exe not found in Windows SDK";
         return false;
     }
     
-    // Build the SignTool command
+    // Build the SignTool command, and a copy for the log without the password
     std::wstringstream cmdStream;
+    std::wstringstream displayStream;
     cmdStream << L"\"" << signToolPath.wstring() << L"\" sign /fd SHA256";
+    displayStream << cmdStream.str();
     
     // Add password if provided
     if (!password.empty()) {
         cmdStream << L" /p " << password;
+        displayStream << L" /p ********";
     }
     
     // Add certificate path and MSIX path
-    cmdStream << L" /f \"" << certPath.wstring() << L"\" \"" << msixPath.wstring() << L"\"";
+    std::wstring fileArguments = L" /f \"" + certPath.wstring() + L"\" \"" + msixPath.wstring() + L"\"";
+    cmdStream << fileArguments;
+    displayStream << fileArguments;
     
     std::wstring cmdLine = cmdStream.str();
     
-    std::wcout << L"Signing MSIX package..." << std::endl;
-    std::wcout << L"Executing: " << cmdLine << std::endl;
+    m_logger.Info() << L"Signing MSIX package...";
+    m_logger.Info() << L"Executing: " << displayStream.str();
     
-    // Execute the command using WIL's RAII wrappers
-    STARTUPINFOW si = { sizeof(si) };
-    PROCESS_INFORMATION pi = { 0 };
+    // Execute the command, forwarding its output to the logger
+    ProcessResult result = ProcessRunner::Run(cmdLine, m_logger, m_cancellationToken);
     
-    // Use wil::unique_process_information for PROCESS_INFORMATION cleanup
-    wil::unique_process_information processInfo;
-    
-    // Use wil::make_cotaskmem_string for command line management
-    auto cmdLineCopy = wil::make_cotaskmem_string(cmdLine.c_str());
-    if (!cmdLineCopy) {
-        std::wcerr << L"Failed to allocate memory for command line" << std::endl;
+    if (!result.started) {
+        m_logger.Error() << L"Failed to execute SignTool.exe, error code: " << result.error;
         return false;
     }
     
-    if (!CreateProcessW(NULL, cmdLineCopy.get(), NULL, NULL, FALSE, 0, NULL, NULL, &si, &processInfo)) {
-        std::wcerr << L"Failed to execute SignTool.exe, error code: " << GetLastError() << std::endl;
+    if (result.cancelled) {
+        m_logger.Warning() << L"SignTool.exe was cancelled";
         return false;
     }
     
-    // Wait for the process to complete
-    WaitForSingleObject(processInfo.hProcess, INFINITE);
-    
-    // Get the exit code
-    DWORD exitCode = 0;
-    GetExitCodeProcess(processInfo.hProcess, &exitCode);
-    
-    if (exitCode != 0) {
-        std::wcerr << L"SignTool.exe failed with exit code: " << exitCode << std::endl;
+    if (result.exitCode != 0) {
+        m_logger.Error() << L"SignTool.exe failed with exit code: " << result.exitCode;
         return false;
     }
     
-    std::wcout << L"MSIX package signed successfully: " << msixPath.wstring() << std::endl;
+    m_logger.Info() << L"MSIX package signed successfully: " << msixPath.wstring();
     return true;
 }
 
 fs::path CertificateManager::FindSignToolPath()
+{
+    // Cache the result so that repeated signing in one process doesn't rescan the SDK
+    static const fs::path signToolPath = LocateSignToolPath(m_logger);
+    return signToolPath;
+}
+
+fs::path CertificateManager::LocateSignToolPath(const Logger& logger)
 {
     // Try to locate Windows SDK bin path from registry using WIL's unique_hkey
     wil::unique_hkey regKey;
@@ -85,7 +90,7 @@ fs::path CertificateManager::FindSignToolPath()
         &regKey);
     
     if (result != ERROR_SUCCESS) {
-        std::wcerr << L"Failed to open Windows Kits registry key, error: " << result << std::endl;
+        logger.Error() << L"Failed to open Windows Kits registry key, error: " << result;
         return fs::path();
     }
     
@@ -103,7 +108,7 @@ fs::path CertificateManager::FindSignToolPath()
         &bufferSize);
     
     if (result != ERROR_SUCCESS || dataType != REG_SZ) {
-        std::wcerr << L"Failed to read KitsRoot10 registry value, error: " << result << std::endl;
+        logger.Error() << L"Failed to read KitsRoot10 registry value, error: " << result;
         return fs::path();
     }
     
@@ -113,7 +118,7 @@ fs::path CertificateManager::FindSignToolPath()
     
     // Check if bin directory exists
     if (!fs::exists(baseBinPath)) {
-        std::wcerr << L"Windows SDK bin directory not found at: " << baseBinPath.wstring() << std::endl;
+        logger.Error() << L"Windows SDK bin directory not found at: " << baseBinPath.wstring();
         return fs::path();
     }
     
@@ -127,7 +132,7 @@ fs::path CertificateManager::FindSignToolPath()
         }
     }
     catch (const std::exception& ex) {
-        std::wcerr << L"Error enumerating SDK bin directories: " << ex.what() << std::endl;
+        logger.Error() << L"Error enumerating SDK bin directories: " << ex.what();
         return fs::path();
     }
     
@@ -139,19 +144,19 @@ fs::path CertificateManager::FindSignToolPath()
         // Try x64 first
         fs::path x64Path = versionPath / L"x64" / L"signtool.exe";
         if (fs::exists(x64Path)) {
-            std::wcout << L"Found SignTool.exe at: " << x64Path.wstring() << std::endl;
+            logger.Info() << L"Found SignTool.exe at: " << x64Path.wstring();
             return x64Path;
         }
         
         // Then try x86
         fs::path x86Path = versionPath / L"x86" / L"signtool.exe";
         if (fs::exists(x86Path)) {
-            std::wcout << L"Found SignTool.exe at: " << x86Path.wstring() << std::endl;
+            logger.Info() << L"Found SignTool.exe at: " << x86Path.wstring();
             return x86Path;
         }
     }
     
     // If we got here, we couldn't find SignTool.exe
-    std::wcerr << L"SignTool.exe not found in any Windows SDK version" << std::endl;
+    logger.Error() << L"SignTool.exe not found in any Windows SDK version";
     return fs::path();
 }
\ No newline at end of file
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+#include <filesystem>
+#include "Logger.h"
+#include "CancellationToken.h"
+
+namespace fs = std::filesystem;
+
+class CertificateManager
+{
+public:
+    CertificateManager(Logger logger = Logger(), CancellationToken cancellationToken = CancellationToken());
+    ~CertificateManager() = default;
+
+    // Sign an MSIX package with a certificate
+    bool SignPackage(
+        const fs::path& msixPath,
+        const fs::path& certPath,
+        const std::wstring& password = L"");
+
+private:
+    // Find the SignTool.exe in the Windows SDK (looked up once per process)
+    fs::path FindSignToolPath();
+
+    // Search the installed Windows SDK versions for SignTool.exe
+    static fs::path LocateSignToolPath(const Logger& logger);
+
+    Logger m_logger;
+    CancellationToken m_cancellationToken;
+};
\ No newline at end of file
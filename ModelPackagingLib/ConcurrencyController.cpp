@@ -0,0 +1,129 @@
+#include "ConcurrencyController.h"
+#include <algorithm>
+
+namespace {
+    // Length of a throughput sample; long enough to span many chunks on every running transfer
+    constexpr auto SampleWindow = std::chrono::seconds(2);
+
+    // A window counts as an improvement when it is this much faster than the one before
+    constexpr double ImprovementRatio = 1.05;
+
+    // After a decrease, the limit stays put for this long; congestion reported within it is
+    // treated as part of the same episode and doesn't halve the limit again
+    constexpr auto RecoveryTime = std::chrono::seconds(6);
+}
+
+ConcurrencyController::ConcurrencyController(unsigned initial, unsigned minimum, unsigned maximum, Logger logger)
+    : m_logger(std::move(logger)),
+      m_bytes(0),
+      m_limit((std::clamp)(initial, (std::max)(1u, minimum), (std::max)(1u, maximum))),
+      m_minimum((std::max)(1u, minimum)),
+      m_maximum((std::max)(1u, maximum)),
+      m_peakLimit(m_limit),
+      m_lanes(0),
+      m_windowStart(Clock::now()),
+      m_windowBytes(0),
+      m_lastThroughput(0),
+      m_holdUntil(Clock::time_point::min()),
+      m_lastDecrease(Clock::time_point::min())
+{
+}
+
+void ConcurrencyController::AddBytes(uint64_t bytes)
+{
+    m_bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void ConcurrencyController::OnCongestion()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    
+    auto now = Clock::now();
+    m_holdUntil = now + RecoveryTime;
+    if (now < m_lastDecrease + RecoveryTime) {
+        return;
+    }
+    
+    m_lastDecrease = now;
+    unsigned limit = (std::max)(m_minimum, m_limit / 2);
+    if (limit != m_limit) {
+        m_logger.Info() << L"The server is pushing back; lowering concurrent downloads from " << m_limit << L" to " << limit;
+        m_limit = limit;
+    }
+    
+    // The next window measures the lower limit from scratch
+    m_windowStart = now;
+    m_windowBytes = m_bytes.load(std::memory_order_relaxed);
+    m_lastThroughput = 0;
+}
+
+void ConcurrencyController::Update()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    
+    auto now = Clock::now();
+    if (now - m_windowStart < SampleWindow) {
+        return;
+    }
+    
+    uint64_t bytes = m_bytes.load(std::memory_order_relaxed);
+    double seconds = std::chrono::duration<double>(now - m_windowStart).count();
+    double throughput = static_cast<double>(bytes - m_windowBytes) / seconds;
+    
+    m_windowStart = now;
+    m_windowBytes = bytes;
+    
+    // Only a window in which every allowed lane was busy says anything about the limit
+    bool saturated = m_lanes >= m_limit;
+    bool improved = m_lastThroughput == 0 || throughput > m_lastThroughput * ImprovementRatio;
+    m_lastThroughput = throughput;
+    
+    if (saturated && improved && now >= m_holdUntil && m_limit < m_maximum) {
+        m_limit++;
+        m_peakLimit = (std::max)(m_peakLimit, m_limit);
+        m_logger.Verbose() << L"Raising concurrent downloads to " << m_limit << L" at "
+                           << static_cast<uint64_t>(throughput / (1024 * 1024)) << L" MB/s";
+    }
+}
+
+unsigned ConcurrencyController::Limit() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_limit;
+}
+
+unsigned ConcurrencyController::PeakLimit() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_peakLimit;
+}
+
+bool ConcurrencyController::TryAddLane()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_lanes >= m_limit) {
+        return false;
+    }
+    
+    m_lanes++;
+    return true;
+}
+
+bool ConcurrencyController::ShouldRemoveLane()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_lanes <= m_limit) {
+        return false;
+    }
+    
+    m_lanes--;
+    return true;
+}
+
+void ConcurrencyController::RemoveLane()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_lanes > 0) {
+        m_lanes--;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include "Logger.h"
+
+// Decides how many transfers run at once, by additive increase and multiplicative decrease.
+//
+// Transfers count the bytes they receive. Once per sampling window the aggregate throughput is
+// compared with the previous window: while adding a transfer keeps making the download faster,
+// one more is allowed. When the server answers 429 or 503, or a request times out, the limit is
+// halved, and it isn't raised again until the server has had a few windows to recover.
+//
+// The limit is applied as lanes: a lane starts only while fewer lanes than the limit are running,
+// and a lane stops after its current file when the limit has dropped below the running count.
+class ConcurrencyController
+{
+public:
+    ConcurrencyController(unsigned initial, unsigned minimum, unsigned maximum, Logger logger = Logger());
+    ~ConcurrencyController() = default;
+
+    // Count bytes received by any transfer (transfer threads, lock free)
+    void AddBytes(uint64_t bytes);
+
+    // Report that the server pushed back or a request timed out
+    void OnCongestion();
+
+    // Close the sampling window if it has run its length, adjusting the limit
+    void Update();
+
+    // Current number of transfers allowed at once
+    unsigned Limit() const;
+
+    // Highest limit reached
+    unsigned PeakLimit() const;
+
+    // Claim a slot for a new lane, returning false when the running lanes already reach the limit
+    bool TryAddLane();
+
+    // Whether a running lane should stop because the limit dropped below the running count. A lane
+    // told to stop has already given up its slot.
+    bool ShouldRemoveLane();
+
+    // Give up the slot of a lane that ran out of work
+    void RemoveLane();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    Logger m_logger;
+    std::atomic<uint64_t> m_bytes;
+
+    mutable std::mutex m_mutex;
+    unsigned m_limit;
+    unsigned m_minimum;
+    unsigned m_maximum;
+    unsigned m_peakLimit;
+    unsigned m_lanes;
+    Clock::time_point m_windowStart;
+    uint64_t m_windowBytes;         // m_bytes when the window started
+    double m_lastThroughput;        // Bytes per second of the last window, 0 before the first
+    Clock::time_point m_holdUntil;  // No increases before this, after a decrease
+    Clock::time_point m_lastDecrease;
+};
\ No newline at end of file
@@ -0,0 +1,69 @@
+#include "DownloadFilter.h"
+#include "SourceScanner.h"
+#include <algorithm>
+
+namespace {
+    struct DownloadProfile
+    {
+        const wchar_t* name;
+        const wchar_t* allowPatterns;
+    };
+
+    const DownloadProfile Profiles[] = {
+        // ONNX models with their external weights and the small files that describe them, leaving out
+        // PyTorch, TensorFlow and other copies of the weights
+        { L"onnx-only", L"*.onnx;*.onnx.data;*.onnx_data;*.ort;*.json;*.txt;*.model;*.tiktoken;*.jinja;*.md;LICENSE*" },
+
+        // What onnxruntime-genai loads: its configuration, the ONNX models and the tokenizer
+        { L"genai", L"genai_config.json;*.onnx;*.onnx.data;*.onnx_data;config.json;generation_config.json;"
+                    L"tokenizer*;vocab*;merges.txt;special_tokens_map.json;added_tokens.json;*processor_config.json;"
+                    L"chat_template*;*.tiktoken;LICENSE*" },
+    };
+}
+
+bool DownloadFilter::IsEmpty() const
+{
+    return allowPatterns.empty() && ignorePatterns.empty();
+}
+
+bool DownloadFilter::Allows(const std::wstring& relativePath) const
+{
+    auto matches = [&](const std::wstring& pattern) {
+        return SourceScanner::MatchesPattern(pattern, relativePath);
+    };
+    
+    if (std::any_of(ignorePatterns.begin(), ignorePatterns.end(), matches)) {
+        return false;
+    }
+    
+    return allowPatterns.empty() || std::any_of(allowPatterns.begin(), allowPatterns.end(), matches);
+}
+
+bool DownloadFilter::AddProfile(const std::wstring& profile)
+{
+    for (const auto& candidate : Profiles) {
+        if (profile == candidate.name) {
+            SourceScanOptions::AddPatterns(candidate.allowPatterns, allowPatterns);
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+bool DownloadFilter::IsProfile(const std::wstring& profile)
+{
+    return std::any_of(std::begin(Profiles), std::end(Profiles), [&](const DownloadProfile& candidate) {
+        return profile == candidate.name;
+    });
+}
+
+std::wstring DownloadFilter::ProfileNames()
+{
+    std::wstring names;
+    for (const auto& profile : Profiles) {
+        names += names.empty() ? L"" : L", ";
+        names += profile.name;
+    }
+    return names;
+}
\ No newline at end of file
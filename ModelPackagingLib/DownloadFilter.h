@@ -0,0 +1,28 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Which files of a repository folder are downloaded, decided from the folder listing before any
+// transfer starts. Patterns are matched against a file's path relative to the folder being
+// downloaded, with the syntax of SourceScanOptions (*.onnx, onnx/**, tokenizer*).
+struct DownloadFilter
+{
+    std::vector<std::wstring> allowPatterns;    // Only files matching one of these are downloaded; every file when empty
+    std::vector<std::wstring> ignorePatterns;   // Files matching any of these are skipped, even if allowed
+
+    // Whether the filter lets every file through
+    bool IsEmpty() const;
+
+    // Whether a file passes the filter
+    bool Allows(const std::wstring& relativePath) const;
+
+    // Add the allow patterns of a built-in profile, returning false for an unknown name
+    bool AddProfile(const std::wstring& profile);
+
+    // Whether a built-in profile has this name
+    static bool IsProfile(const std::wstring& profile);
+
+    // Names of the built-in profiles, separated by commas, for help and error messages
+    static std::wstring ProfileNames();
+};
\ No newline at end of file
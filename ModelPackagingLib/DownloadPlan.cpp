@@ -0,0 +1,262 @@
+#include "DownloadPlan.h"
+#include "FormatUtils.h"
+#include <Windows.h>
+#include <algorithm>
+#include <numeric>
+
+namespace {
+    // Time to request a file and receive the first byte, charged to every file in the estimate
+    constexpr double RequestSeconds = 0.25;
+
+    // Throughput of one connection the logged estimate assumes
+    constexpr double EstimatedConnectionBytesPerSecond = 20.0 * 1024 * 1024;
+
+    // A package holds every block deflated or, when that doesn't help, stored, plus local headers, the
+    // central directory and the block map. Room for the stored size and this much more is required.
+    constexpr uint64_t PackageOverheadDivisor = 64;
+    constexpr uint64_t PackageOverheadBytes = 16 * 1024 * 1024;
+
+    constexpr size_t LargestFilesReported = 10;
+
+    // Find the volume a path is on and its free space. The path doesn't need to exist yet; the
+    // nearest folder above it that does is asked instead.
+    bool QueryVolume(const fs::path& path, std::wstring& volume, uint64_t& availableBytes)
+    {
+        std::error_code ec;
+        fs::path existing = fs::absolute(path, ec);
+        while (!existing.empty() && !fs::exists(existing, ec)) {
+            fs::path parent = existing.parent_path();
+            if (parent == existing) {
+                break;
+            }
+            existing = parent;
+        }
+
+        wchar_t volumePath[MAX_PATH + 1] = {};
+        if (!GetVolumePathNameW(existing.c_str(), volumePath, static_cast<DWORD>(std::size(volumePath)))) {
+            return false;
+        }
+
+        ULARGE_INTEGER available = {};
+        if (!GetDiskFreeSpaceExW(volumePath, &available, nullptr, nullptr)) {
+            return false;
+        }
+
+        volume = volumePath;
+        availableBytes = available.QuadPart;
+        return true;
+    }
+}
+
+const std::wstring& DownloadPlan::Revision() const
+{
+    return commit.empty() ? branch : commit;
+}
+
+void DownloadPlan::Schedule()
+{
+    for (auto& file : files) {
+        file.priority = file.sizeKnown && file.size <= PriorityFileLimit;
+    }
+    
+    std::stable_sort(files.begin(), files.end(), [](const PlannedFile& a, const PlannedFile& b) {
+        if (a.priority != b.priority) {
+            return a.priority;
+        }
+        if (a.priority) {
+            return a.size < b.size;
+        }
+        
+        // Unknown sizes go first among the large files, since they may well be the largest
+        if (a.sizeKnown != b.sizeKnown) {
+            return !a.sizeKnown;
+        }
+        return a.size > b.size;
+    });
+}
+
+uint64_t DownloadPlan::TotalBytes() const
+{
+    uint64_t total = 0;
+    for (const auto& file : files) {
+        total += file.size;
+    }
+    return total;
+}
+
+size_t DownloadPlan::UnknownSizes() const
+{
+    return std::count_if(files.begin(), files.end(), [](const PlannedFile& file) {
+        return !file.sizeKnown;
+    });
+}
+
+double DownloadPlan::EstimateSeconds(double bytesPerSecond) const
+{
+    if (files.empty() || bytesPerSecond <= 0) {
+        return 0;
+    }
+    
+    // Give the next file to whichever lane frees up first, as the transfers will
+    DownloadSchedule schedule(*this);
+    std::vector<double> laneTimes((std::max)(1u, (std::min)(connections, static_cast<unsigned>(files.size()))), 0.0);
+    std::vector<bool> laneDone(laneTimes.size(), false);
+    double finish = 0;
+    
+    for (size_t remaining = laneTimes.size(); remaining > 0;) {
+        unsigned lane = 0;
+        for (unsigned i = 0; i < laneTimes.size(); i++) {
+            if (!laneDone[i] && (laneDone[lane] || laneTimes[i] < laneTimes[lane])) {
+                lane = i;
+            }
+        }
+        
+        size_t index = 0;
+        if (!schedule.Next(lane, index)) {
+            laneDone[lane] = true;
+            remaining--;
+            continue;
+        }
+        
+        laneTimes[lane] += RequestSeconds + static_cast<double>(files[index].size) / bytesPerSecond;
+        finish = (std::max)(finish, laneTimes[lane]);
+    }
+    
+    return finish;
+}
+
+bool DownloadPlan::CheckFreeSpace(const fs::path& stagingFolder, const fs::path& outputPath, const Logger& logger) const
+{
+    struct VolumeNeed
+    {
+        std::wstring volume;
+        uint64_t availableBytes = 0;
+        uint64_t requiredBytes = 0;
+        std::wstring purpose;
+    };
+    
+    uint64_t downloadBytes = TotalBytes();
+    uint64_t packageBytes = downloadBytes + downloadBytes / PackageOverheadDivisor + PackageOverheadBytes;
+    
+    std::vector<VolumeNeed> volumes;
+    auto addNeed = [&](const fs::path& path, uint64_t bytes, const wchar_t* purpose) {
+        std::wstring volume;
+        uint64_t availableBytes = 0;
+        if (!QueryVolume(path, volume, availableBytes)) {
+            logger.Warning() << L"Could not read the free space of the volume holding " << path.wstring()
+                             << L" (error " << GetLastError() << L")";
+            return;
+        }
+        
+        for (auto& need : volumes) {
+            if (_wcsicmp(need.volume.c_str(), volume.c_str()) == 0) {
+                need.requiredBytes += bytes;
+                need.purpose += std::wstring(L" and the ") + purpose;
+                return;
+            }
+        }
+        
+        volumes.push_back({ volume, availableBytes, bytes, std::wstring(L"the ") + purpose });
+    };
+    
+    addNeed(stagingFolder, downloadBytes, L"download");
+    if (!outputPath.empty()) {
+        addNeed(outputPath, packageBytes, L"package");
+    }
+    
+    bool enough = true;
+    for (const auto& need : volumes) {
+        if (need.availableBytes < need.requiredBytes) {
+            logger.Error() << L"Not enough free space on " << need.volume << L" for " << need.purpose << L": "
+                           << FormatUtils::FormatSize(need.requiredBytes) << L" needed, " << FormatUtils::FormatSize(need.availableBytes) << L" free";
+            enough = false;
+        }
+        else {
+            logger.Verbose() << FormatUtils::FormatSize(need.availableBytes) << L" free on " << need.volume << L", "
+                             << FormatUtils::FormatSize(need.requiredBytes) << L" needed for " << need.purpose;
+        }
+    }
+    
+    size_t unknownSizes = UnknownSizes();
+    if (unknownSizes > 0) {
+        logger.Warning() << unknownSizes << L" files have no known size and aren't counted in the free space check";
+    }
+    
+    return enough;
+}
+
+void DownloadPlan::Log(const Logger& logger) const
+{
+    size_t priorityFiles = std::count_if(files.begin(), files.end(), [](const PlannedFile& file) {
+        return file.priority;
+    });
+    
+    logger.Info() << L"Download plan: " << files.size() << L" files (" << FormatUtils::FormatSize(TotalBytes()) << L") over "
+                  << (std::min)(connections, static_cast<unsigned>(files.size())) << L" connections, "
+                  << priorityFiles << L" small files on the priority lane";
+    
+    if (!commit.empty() && commit != branch) {
+        logger.Info() << L"Branch " << branch << L" is pinned to commit " << commit;
+    }
+    
+    if (files.empty()) {
+        return;
+    }
+    
+    // Every file in the order it will be fetched at verbose level, otherwise just the largest
+    if (logger.IsEnabled(LogLevel::Verbose)) {
+        logger.Verbose() << L"Download order:";
+        for (const auto& file : files) {
+            logger.Verbose() << L"  " << (file.sizeKnown ? FormatUtils::FormatSize(file.size) : std::wstring(L"unknown size"))
+                             << (file.priority ? L"  priority  " : L"  ") << file.path;
+        }
+    }
+    else {
+        logger.Info() << L"Largest files:";
+        for (size_t i = priorityFiles; i < files.size() && i < priorityFiles + LargestFilesReported; i++) {
+            logger.Info() << L"  " << (files[i].sizeKnown ? FormatUtils::FormatSize(files[i].size) : std::wstring(L"unknown size"))
+                          << L"  " << files[i].path;
+        }
+    }
+    
+    logger.Info() << L"Estimated download time: " << FormatUtils::FormatDuration(EstimateSeconds(EstimatedConnectionBytesPerSecond))
+                  << L" at " << FormatUtils::FormatSize(static_cast<uint64_t>(EstimatedConnectionBytesPerSecond)) << L"/s per connection";
+}
+
+DownloadSchedule::DownloadSchedule(const DownloadPlan& plan)
+    : m_nextPriority(0),
+      m_priorityEnd(0),
+      m_nextLarge(0),
+      m_end(plan.files.size())
+{
+    while (m_priorityEnd < m_end && plan.files[m_priorityEnd].priority) {
+        m_priorityEnd++;
+    }
+    m_nextLarge = m_priorityEnd;
+}
+
+bool DownloadSchedule::Next(unsigned lane, size_t& index)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    
+    bool priorityFirst = lane == 0;
+    for (int pass = 0; pass < 2; pass++) {
+        if (priorityFirst && m_nextPriority < m_priorityEnd) {
+            index = m_nextPriority++;
+            return true;
+        }
+        if (!priorityFirst && m_nextLarge < m_end) {
+            index = m_nextLarge++;
+            return true;
+        }
+        priorityFirst = !priorityFirst;
+    }
+    
+    return false;
+}
+
+size_t DownloadSchedule::Remaining()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return (m_priorityEnd - m_nextPriority) + (m_end - m_nextLarge);
+}
\ No newline at end of file
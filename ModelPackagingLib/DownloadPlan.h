@@ -0,0 +1,89 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <cstdint>
+#include <filesystem>
+#include "Logger.h"
+
+namespace fs = std::filesystem;
+
+// A file a download will fetch
+struct PlannedFile
+{
+    std::wstring path;          // Path in the repository, with / separators
+    fs::path destination;       // Where the file is written
+    uint64_t size = 0;
+    bool sizeKnown = false;     // The listing or a HEAD request reported the size
+    bool priority = false;      // Small enough for the priority lane
+};
+
+// What a download will fetch, worked out from the repository listing before any transfer starts.
+//
+// Transfers run on several lanes at once. Small files such as configurations and tokenizers go to
+// a priority lane so they never wait behind multi-gigabyte weights, and the other lanes take the
+// remaining files largest first, which keeps the slowest lane from finishing long after the rest.
+struct DownloadPlan
+{
+    std::wstring repoOwner;
+    std::wstring repoName;
+    std::wstring branch;
+    std::wstring commit;            // Commit the branch resolved to, empty if it couldn't be resolved
+    fs::path destinationFolder;     // Folder the files are written to
+    std::vector<PlannedFile> files; // In the order Schedule puts them
+    unsigned connections = 4;       // Transfers running at once
+    double bandwidthWeight = 1.0;   // Share of the bandwidth limit relative to other jobs downloading
+    bool storeWeights = false;      // The package will store model weights, so their digests are taken while they download
+
+    // Files up to this size go to the priority lane
+    static constexpr uint64_t PriorityFileLimit = 4 * 1024 * 1024;
+
+    // Revision the files are fetched from: the commit when the branch was resolved, so every file
+    // comes from the same commit even if the branch moves during the download
+    const std::wstring& Revision() const;
+
+    // Order the files once their sizes are known: priority files smallest first, then the rest
+    // largest first. Files of unknown size are treated as large.
+    void Schedule();
+
+    // Sum of the known file sizes
+    uint64_t TotalBytes() const;
+
+    // Number of files whose size neither the listing nor a HEAD request reported
+    size_t UnknownSizes() const;
+
+    // Estimated wall time of the download if every connection transfers bytesPerSecond, found by
+    // running the lane schedule against the file sizes
+    double EstimateSeconds(double bytesPerSecond) const;
+
+    // Check that the staging volume can hold the download and the output volume the package,
+    // counting both against one volume when they share it
+    bool CheckFreeSpace(const fs::path& stagingFolder, const fs::path& outputPath, const Logger& logger) const;
+
+    // Log the totals, the largest files and the time estimate, and every file at verbose level
+    void Log(const Logger& logger) const;
+};
+
+// Hands the files of a scheduled plan out to transfer lanes. Lane 0 is the priority lane: it takes
+// small files first and then helps with the large ones. The other lanes take large files first and
+// then help with the small ones.
+class DownloadSchedule
+{
+public:
+    explicit DownloadSchedule(const DownloadPlan& plan);
+    ~DownloadSchedule() = default;
+
+    // Index in plan.files of the next file for a lane, or false when every file has been handed out
+    bool Next(unsigned lane, size_t& index);
+
+    // Number of files not handed out yet
+    size_t Remaining();
+
+private:
+    std::mutex m_mutex;
+    size_t m_nextPriority;
+    size_t m_priorityEnd;
+    size_t m_nextLarge;
+    size_t m_end;
+};
\ No newline at end of file
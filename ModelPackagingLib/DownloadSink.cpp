@@ -0,0 +1,324 @@
+#include "DownloadSink.h"
+#include "MsixWriter.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+    // Unbuffered writes must start and end on sector boundaries; 4 KB covers disks with 512-byte
+    // and 4 KB sectors
+    constexpr uint64_t SectorAlignment = 4096;
+
+    std::atomic<DownloadWriteMode> g_defaultMode = DownloadWriteMode::WriteBehind;
+
+    bool WriteAt(HANDLE file, uint64_t offset, const void* data, size_t size)
+    {
+        OVERLAPPED overlapped = {};
+        overlapped.Offset = static_cast<DWORD>(offset);
+        overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+        DWORD written = 0;
+        return WriteFile(file, data, static_cast<DWORD>(size), &written, &overlapped) && written == size;
+    }
+
+    bool SetFileSize(HANDLE file, uint64_t size)
+    {
+        FILE_END_OF_FILE_INFO endOfFile = {};
+        endOfFile.EndOfFile.QuadPart = static_cast<LONGLONG>(size);
+        return SetFileInformationByHandle(file, FileEndOfFileInfo, &endOfFile, sizeof(endOfFile)) != FALSE;
+    }
+}
+
+DownloadSink::DownloadSink(Logger logger)
+    : m_logger(std::move(logger)),
+      m_mode(DownloadWriteMode::WriteBehind),
+      m_unbuffered(false),
+      m_storeWeights(false),
+      m_digesting(false),
+      m_fillIndex(0),
+      m_filled(0),
+      m_fillOffset(0),
+      m_size(0),
+      m_error(0),
+      m_pendingData(nullptr),
+      m_pendingSize(0),
+      m_pendingOffset(0),
+      m_stopRequested(false)
+{
+}
+
+DownloadSink::~DownloadSink()
+{
+    Close();
+}
+
+void DownloadSink::SetDefaultMode(DownloadWriteMode mode)
+{
+    g_defaultMode = mode;
+}
+
+DownloadWriteMode DownloadSink::DefaultMode()
+{
+    return g_defaultMode;
+}
+
+bool DownloadSink::ParseMode(const std::wstring& text, DownloadWriteMode& mode)
+{
+    if (_wcsicmp(text.c_str(), L"inline") == 0) {
+        mode = DownloadWriteMode::Inline;
+    }
+    else if (_wcsicmp(text.c_str(), L"write-behind") == 0) {
+        mode = DownloadWriteMode::WriteBehind;
+    }
+    else if (_wcsicmp(text.c_str(), L"unbuffered") == 0) {
+        mode = DownloadWriteMode::Unbuffered;
+    }
+    else {
+        return false;
+    }
+    return true;
+}
+
+void DownloadSink::SetStoreWeights(bool storeWeights)
+{
+    m_storeWeights = storeWeights;
+}
+
+bool DownloadSink::Open(const fs::path& path, uint64_t offset, uint64_t expectedSize, DownloadWriteMode mode)
+{
+    Close();
+    
+    m_path = path;
+    m_mode = mode;
+    m_fillIndex = 0;
+    m_filled = 0;
+    m_fillOffset = offset;
+    m_size = offset;
+    m_error = 0;
+    m_stopRequested = false;
+    
+    // A continued file is missing the start of its digest, and only stored files are packaged from one
+    m_digesting = offset == 0 && !MsixWriter::ShouldCompress(path, m_storeWeights);
+    m_digest = FileDigestBuilder();
+    
+    // Unbuffered blocks are written at multiples of the block size from the start, so a file can only
+    // be continued that way at a sector boundary; other offsets go through the cache
+    m_unbuffered = mode == DownloadWriteMode::Unbuffered && offset % SectorAlignment == 0;
+    if (mode == DownloadWriteMode::Unbuffered && !m_unbuffered) {
+        m_logger.Verbose() << L"Continuing " << path.filename().wstring() << L" through the file system cache, byte "
+            << offset << L" is not on a sector boundary";
+    }
+    
+    DWORD flags = FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN;
+    if (m_unbuffered) {
+        flags |= FILE_FLAG_NO_BUFFERING;
+    }
+    
+    m_file.reset(CreateFileW(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, offset > 0 ? OPEN_EXISTING : CREATE_ALWAYS,
+        flags, nullptr));
+    if (!m_file) {
+        m_error = GetLastError();
+        return false;
+    }
+    
+    if (offset > 0 && !SetFileSize(m_file.get(), offset)) {
+        m_error = GetLastError();
+        m_file.reset();
+        return false;
+    }
+    
+    // The inline mode is the plain write loop and keeps its growing file, to compare the others against
+    if (mode == DownloadWriteMode::Inline) {
+        return true;
+    }
+    
+    // Only the allocation is set; the end of file moves as blocks are written, so a file cut short
+    // by a failed transfer ends where its data ends
+    if (expectedSize > offset) {
+        FILE_ALLOCATION_INFO allocation = {};
+        allocation.AllocationSize.QuadPart = static_cast<LONGLONG>(expectedSize);
+        if (!SetFileInformationByHandle(m_file.get(), FileAllocationInfo, &allocation, sizeof(allocation)) &&
+            GetLastError() == ERROR_DISK_FULL) {
+            m_error = ERROR_DISK_FULL;
+            m_file.reset();
+            return false;
+        }
+    }
+    
+    // Pages are committed but only backed by memory once touched, so a small file costs one page
+    m_blocks.reset(static_cast<uint8_t*>(VirtualAlloc(nullptr, 2 * BlockSize, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE)));
+    if (!m_blocks) {
+        m_error = GetLastError();
+        m_file.reset();
+        return false;
+    }
+    
+    return true;
+}
+
+bool DownloadSink::Write(const uint8_t* data, size_t size)
+{
+    if (!m_file || m_error != 0) {
+        return false;
+    }
+    
+    if (m_mode == DownloadWriteMode::Inline) {
+        if (!WriteBlock(data, size, m_size)) {
+            return false;
+        }
+        if (m_digesting) {
+            m_digest.Add(data, size);
+        }
+        m_size += size;
+        return true;
+    }
+    
+    while (size > 0) {
+        size_t copied = (std::min)(size, BlockSize - m_filled);
+        memcpy(FillBlock() + m_filled, data, copied);
+        m_filled += copied;
+        m_size += copied;
+        data += copied;
+        size -= copied;
+        
+        if (m_filled == BlockSize && !SubmitBlock()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool DownloadSink::Close()
+{
+    if (!m_file) {
+        return m_error == 0;
+    }
+    
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        WaitForWriter(lock);
+        m_stopRequested = true;
+    }
+    m_wake.notify_one();
+    if (m_writer.joinable()) {
+        m_writer.join();
+    }
+    
+    if (m_mode != DownloadWriteMode::Inline) {
+        // The last block is written whole sectors at a time, padded with zeros the end of file then cuts off
+        if (m_filled > 0 && m_error == 0) {
+            size_t size = m_filled;
+            if (m_unbuffered) {
+                size = static_cast<size_t>((m_filled + SectorAlignment - 1) / SectorAlignment * SectorAlignment);
+                memset(FillBlock() + m_filled, 0, size - m_filled);
+            }
+            WriteBlock(FillBlock(), size, m_fillOffset);
+            if (m_digesting) {
+                m_digest.Add(FillBlock(), m_filled);
+            }
+        }
+        m_filled = 0;
+        
+        // Also gives back the allocation beyond a transfer that stopped early
+        if (!SetFileSize(m_file.get(), m_size) && m_error == 0) {
+            m_error = GetLastError();
+        }
+    }
+    
+    m_file.reset();
+    m_blocks.reset();
+    
+    // The last write time is only final once the handle is closed
+    if (m_digesting && m_error == 0) {
+        FileDigest digest = m_digest.Finish();
+        std::error_code error;
+        digest.lastWriteTime = fs::last_write_time(m_path, error);
+        if (!error && digest.size == m_size) {
+            FileDigests::Instance().Record(m_path, std::move(digest));
+        }
+    }
+    m_digesting = false;
+    return m_error == 0;
+}
+
+uint64_t DownloadSink::Size() const
+{
+    return m_size;
+}
+
+DWORD DownloadSink::LastError() const
+{
+    return m_error;
+}
+
+bool DownloadSink::WriteBlock(const uint8_t* data, size_t size, uint64_t offset)
+{
+    if (WriteAt(m_file.get(), offset, data, size)) {
+        return true;
+    }
+    
+    DWORD error = GetLastError();
+    DWORD expected = 0;
+    m_error.compare_exchange_strong(expected, error != 0 ? error : ERROR_WRITE_FAULT);
+    return false;
+}
+
+void DownloadSink::WaitForWriter(std::unique_lock<std::mutex>& lock)
+{
+    m_idle.wait(lock, [this]() { return m_pendingData == nullptr; });
+}
+
+bool DownloadSink::SubmitBlock()
+{
+    if (!m_writer.joinable()) {
+        m_writer = std::thread([this]() { WriterLoop(); });
+    }
+    
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        WaitForWriter(lock);
+        if (m_error != 0) {
+            return false;
+        }
+        
+        m_pendingData = FillBlock();
+        m_pendingSize = m_filled;
+        m_pendingOffset = m_fillOffset;
+    }
+    m_wake.notify_one();
+    
+    // The other block was written before this one could be handed over
+    m_fillIndex ^= 1;
+    m_fillOffset += m_filled;
+    m_filled = 0;
+    return true;
+}
+
+void DownloadSink::WriterLoop()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_wake.wait(lock, [this]() { return m_pendingData != nullptr || m_stopRequested; });
+        if (m_pendingData == nullptr) {
+            return;
+        }
+        
+        const uint8_t* data = m_pendingData;
+        size_t size = m_pendingSize;
+        uint64_t offset = m_pendingOffset;
+        
+        lock.unlock();
+        WriteBlock(data, size, offset);
+        if (m_digesting) {
+            m_digest.Add(data, size);
+        }
+        lock.lock();
+        
+        m_pendingData = nullptr;
+        m_idle.notify_all();
+    }
+}
+
+uint8_t* DownloadSink::FillBlock() const
+{
+    return m_blocks.get() + m_fillIndex * BlockSize;
+}
\ No newline at end of file
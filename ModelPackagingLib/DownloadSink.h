@@ -0,0 +1,125 @@
+#pragma once
+
+#include <string>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <cstdint>
+#include <filesystem>
+#include <condition_variable>
+#include <Windows.h>
+#include <wil/resource.h>
+#include "Logger.h"
+#include "FileDigests.h"
+
+namespace fs = std::filesystem;
+
+// How a download sink gets received data onto the disk
+enum class DownloadWriteMode
+{
+    Inline,         // Write each chunk as it arrives, on the receiving thread, into a file that grows as it goes
+    WriteBehind,    // Preallocate the file and hand large blocks to a writer thread (the default)
+    Unbuffered      // As WriteBehind, with the blocks written past the file system cache
+};
+
+// Destination of a file download.
+//
+// The file is given its expected size up front, so it is laid out in one piece instead of growing
+// by small extensions, and a full volume fails the download before it starts. Received data is
+// copied into one of two aligned 4 MB blocks; a full block goes to a writer thread while the
+// receiver fills the other, so the network only waits on the disk when the disk can't keep up
+// with it. Unbuffered mode writes with FILE_FLAG_NO_BUFFERING, which keeps model files that are
+// only packaged once from pushing everything else out of the cache.
+//
+// Small files never fill a block and are written on the calling thread when the sink closes,
+// without starting the writer thread.
+//
+// A file written from its start that the package writer will store is also hashed as it goes, once
+// each block is on its way to the disk, and its digest is recorded in FileDigests when the sink
+// closes, so the writer can store the file without reading it back only to hash it.
+class DownloadSink
+{
+public:
+    static constexpr size_t BlockSize = 4 * 1024 * 1024;
+
+    explicit DownloadSink(Logger logger = Logger());
+
+    // Closes the file, so it holds everything written to the sink
+    ~DownloadSink();
+
+    DownloadSink(const DownloadSink&) = delete;
+    DownloadSink& operator=(const DownloadSink&) = delete;
+
+    // Mode of sinks opened without one; set once for the process from the command line
+    static void SetDefaultMode(DownloadWriteMode mode);
+    static DownloadWriteMode DefaultMode();
+
+    // Parse inline, write-behind or unbuffered
+    static bool ParseMode(const std::wstring& text, DownloadWriteMode& mode);
+
+    // Whether the package the files are for stores model weights, as MsixPackagerOptions::storeWeights
+    // says, so that weights are hashed too; applies to the files opened after it
+    void SetStoreWeights(bool storeWeights);
+
+    // Create the file, or continue one at offset, which must be its current size. expectedSize is the
+    // size the file will have when complete, 0 when unknown.
+    bool Open(const fs::path& path, uint64_t offset, uint64_t expectedSize, DownloadWriteMode mode = DefaultMode());
+
+    // Queue data to be written after what was written before; only waits while both blocks are
+    // being written
+    bool Write(const uint8_t* data, size_t size);
+
+    // Write what is still queued, cut the file to the bytes written and close it
+    bool Close();
+
+    // Size of the file once everything written to the sink is on disk
+    uint64_t Size() const;
+
+    // Windows error of the first failed operation, 0 when none failed
+    DWORD LastError() const;
+
+private:
+    // Write a block at its offset, recording a failure
+    bool WriteBlock(const uint8_t* data, size_t size, uint64_t offset);
+
+    // Wait until the writer thread is done with the block it was given
+    void WaitForWriter(std::unique_lock<std::mutex>& lock);
+
+    // Give the block being filled to the writer thread and start filling the other one
+    bool SubmitBlock();
+
+    // Writer thread body
+    void WriterLoop();
+
+    uint8_t* FillBlock() const;
+
+    Logger m_logger;
+    fs::path m_path;
+    wil::unique_hfile m_file;
+    DownloadWriteMode m_mode;
+    bool m_unbuffered;
+    
+    // Fed on the receiving thread in inline mode and on the writer thread otherwise
+    bool m_storeWeights;
+    bool m_digesting;           // The file is written from its start and will be stored
+    FileDigestBuilder m_digest;
+
+    // Both blocks, one after the other
+    wil::unique_virtualalloc_ptr<uint8_t> m_blocks;
+    unsigned m_fillIndex;
+    size_t m_filled;            // Bytes in the block being filled
+    uint64_t m_fillOffset;      // Position in the file of the block being filled
+    uint64_t m_size;
+
+    std::atomic<DWORD> m_error;
+
+    // Hand-off to the writer thread, started with the first full block
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_idle;
+    const uint8_t* m_pendingData;
+    size_t m_pendingSize;
+    uint64_t m_pendingOffset;
+    bool m_stopRequested;
+    std::thread m_writer;
+};
\ No newline at end of file
@@ -0,0 +1,220 @@
+#include "EndpointList.h"
+#include "TraceRecorder.h"
+#include <Windows.h>
+#include <algorithm>
+#include <numeric>
+#include <tuple>
+#include <winrt/Windows.System.Threading.h>
+
+using namespace winrt;
+using namespace Windows::Foundation;
+using namespace Windows::Web::Http;
+using namespace Windows::System::Threading;
+
+namespace {
+    // A probe that gets no answer in this time counts the endpoint as unreachable
+    constexpr auto ProbeTimeout = std::chrono::seconds(3);
+
+    // Probes are repeated after this long, so a long-running server follows changing links
+    constexpr auto ProbeInterval = std::chrono::minutes(10);
+
+    // Latencies within the same step count as equal
+    constexpr auto LatencyStep = std::chrono::milliseconds(10);
+
+    // Suspension after the first failure in a row, and its upper bound
+    constexpr auto BaseSuspension = std::chrono::seconds(10);
+    constexpr auto MaxSuspension = std::chrono::minutes(5);
+
+    // Time until the endpoint answers, throwing when it doesn't within the probe timeout
+    IAsyncOperation<TimeSpan> ProbeEndpointAsync(HttpClient client, std::wstring url)
+    {
+        auto started = std::chrono::steady_clock::now();
+        HttpRequestMessage request(HttpMethod::Head(), Uri(url + L"/"));
+        auto send = client.SendRequestAsync(request, HttpCompletionOption::ResponseHeadersRead);
+        auto timer = ThreadPoolTimer::CreateTimer([send](const ThreadPoolTimer&) {
+            send.Cancel();
+        }, ProbeTimeout);
+
+        auto response = co_await send;
+        timer.Cancel();
+        response.Close();
+        co_return std::chrono::duration_cast<TimeSpan>(std::chrono::steady_clock::now() - started);
+    }
+}
+
+EndpointList::EndpointList(std::vector<std::wstring> urls, Logger logger)
+    : m_logger(std::move(logger))
+{
+    Set(std::move(urls));
+}
+
+std::vector<std::wstring> EndpointList::Parse(const std::wstring& text)
+{
+    std::vector<std::wstring> urls;
+    size_t start = 0;
+    while (start < text.size()) {
+        size_t end = text.find_first_of(L";, \t", start);
+        if (end == std::wstring::npos) {
+            end = text.size();
+        }
+        
+        std::wstring url = text.substr(start, end - start);
+        while (!url.empty() && url.back() == L'/') {
+            url.pop_back();
+        }
+        if (!url.empty()) {
+            urls.push_back(std::move(url));
+        }
+        start = end + 1;
+    }
+    return urls;
+}
+
+std::vector<std::wstring> EndpointList::FromEnvironment(const wchar_t* variable, const std::wstring& fallback)
+{
+    wchar_t value[4096] = {};
+    DWORD length = GetEnvironmentVariableW(variable, value, static_cast<DWORD>(std::size(value)));
+    std::vector<std::wstring> urls;
+    if (length > 0 && length < std::size(value)) {
+        urls = Parse(value);
+    }
+    if (urls.empty()) {
+        urls.push_back(fallback);
+    }
+    return urls;
+}
+
+void EndpointList::Set(std::vector<std::wstring> urls)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_endpoints.clear();
+    for (auto& url : urls) {
+        Endpoint endpoint;
+        endpoint.url = std::move(url);
+        m_endpoints.push_back(std::move(endpoint));
+    }
+    m_probedAt.reset();
+}
+
+size_t EndpointList::Count() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_endpoints.size();
+}
+
+std::wstring EndpointList::Url(size_t index) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return index < m_endpoints.size() ? m_endpoints[index].url : std::wstring();
+}
+
+std::vector<size_t> EndpointList::Order() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto now = std::chrono::steady_clock::now();
+    
+    // Sort keys: suspended, didn't answer the probe, latency in steps; stable_sort keeps the
+    // configured order between equal keys
+    auto key = [&](size_t index) {
+        const Endpoint& endpoint = m_endpoints[index];
+        bool unreachable = endpoint.probed && !endpoint.latency;
+        int64_t steps = endpoint.latency ? endpoint.latency->count() / LatencyStep.count() : 0;
+        return std::make_tuple(endpoint.suspendedUntil > now, unreachable, steps);
+    };
+    
+    std::vector<size_t> order(m_endpoints.size());
+    std::iota(order.begin(), order.end(), size_t(0));
+    std::stable_sort(order.begin(), order.end(), [&](size_t left, size_t right) {
+        return key(left) < key(right);
+    });
+    return order;
+}
+
+IAsyncAction EndpointList::ProbeAsync(HttpClient client)
+{
+    std::vector<std::wstring> urls;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto now = std::chrono::steady_clock::now();
+        if (m_endpoints.size() < 2 || (m_probedAt && now - *m_probedAt < ProbeInterval)) {
+            co_return;
+        }
+        
+        // Taken before the probe, so downloads that start meanwhile don't probe again
+        m_probedAt = now;
+        for (const auto& endpoint : m_endpoints) {
+            urls.push_back(endpoint.url);
+        }
+    }
+    
+    TraceSpan probeSpan("listing", L"Probe " + std::to_wstring(urls.size()) + L" endpoints");
+    
+    std::vector<IAsyncOperation<TimeSpan>> probes;
+    for (const auto& url : urls) {
+        probes.push_back(ProbeEndpointAsync(client, url));
+    }
+    
+    std::vector<std::optional<std::chrono::milliseconds>> latencies(urls.size());
+    for (size_t i = 0; i < probes.size(); i++) {
+        try {
+            latencies[i] = std::chrono::duration_cast<std::chrono::milliseconds>(co_await probes[i]);
+            m_logger.Verbose() << L"Endpoint " << urls[i] << L" answered in " << latencies[i]->count() << L" ms";
+        }
+        catch (const winrt::hresult_error& ex) {
+            m_logger.Warning() << L"Endpoint " << urls[i] << L" did not answer: " << ex.message().c_str();
+        }
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        
+        // The list may have been replaced while the probes ran
+        for (size_t i = 0; i < urls.size() && i < m_endpoints.size(); i++) {
+            if (m_endpoints[i].url == urls[i]) {
+                m_endpoints[i].latency = latencies[i];
+                m_endpoints[i].probed = true;
+            }
+        }
+    }
+    
+    std::vector<size_t> order = Order();
+    if (!order.empty() && latencies[order.front()]) {
+        m_logger.Info() << L"Downloading from " << urls[order.front()] << L", the fastest of " << urls.size() << L" endpoints ("
+            << latencies[order.front()]->count() << L" ms)";
+    }
+}
+
+void EndpointList::ReportFailure(size_t index)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (index >= m_endpoints.size() || m_endpoints.size() < 2) {
+        return;
+    }
+    
+    Endpoint& endpoint = m_endpoints[index];
+    endpoint.failures++;
+    
+    auto suspension = BaseSuspension;
+    for (unsigned i = 1; i < endpoint.failures && suspension < MaxSuspension; i++) {
+        suspension *= 2;
+    }
+    suspension = (std::min)(suspension, std::chrono::duration_cast<std::chrono::seconds>(MaxSuspension));
+    endpoint.suspendedUntil = std::chrono::steady_clock::now() + suspension;
+    
+    m_logger.Verbose() << L"Suspending endpoint " << endpoint.url << L" for " << suspension.count() << L" s (failure "
+        << endpoint.failures << L" in a row)";
+}
+
+void EndpointList::ReportSuccess(size_t index)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (index < m_endpoints.size()) {
+        m_endpoints[index].failures = 0;
+        m_endpoints[index].suspendedUntil = {};
+    }
+}
+
+void EndpointList::SetLogger(Logger logger)
+{
+    m_logger = std::move(logger);
+}
\ No newline at end of file
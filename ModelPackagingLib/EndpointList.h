@@ -0,0 +1,67 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include <optional>
+#include <winrt/Windows.Foundation.h>
+#include <winrt/Windows.Web.Http.h>
+#include "Logger.h"
+
+// Base URLs a repository can be downloaded from, such as a local mirror and the public endpoint
+// behind it.
+//
+// Requests go to the endpoint that answered the last probe fastest; latencies are compared in steps,
+// so the configured order decides between endpoints that are about as fast, and before the first
+// probe. An endpoint that fails is suspended, for twice as long after each failure in a row, so
+// requests move on to the next one and come back once the suspension ends.
+class EndpointList
+{
+public:
+    explicit EndpointList(std::vector<std::wstring> urls = {}, Logger logger = Logger());
+    ~EndpointList() = default;
+
+    // Split a list of URLs separated by semicolons, commas or spaces, dropping trailing slashes
+    static std::vector<std::wstring> Parse(const std::wstring& text);
+
+    // The list an environment variable holds, or the fallback when it isn't set
+    static std::vector<std::wstring> FromEnvironment(const wchar_t* variable, const std::wstring& fallback);
+
+    // Replace the URLs, forgetting probes and failures
+    void Set(std::vector<std::wstring> urls);
+
+    size_t Count() const;
+    std::wstring Url(size_t index) const;
+
+    // Indexes of the endpoints in the order to try them. Suspended endpoints and those that didn't
+    // answer the last probe come last.
+    std::vector<size_t> Order() const;
+
+    // Time a HEAD request to the root of every endpoint at once; any response counts as an answer.
+    // Does nothing for a single endpoint or while the last probe is recent.
+    winrt::Windows::Foundation::IAsyncAction ProbeAsync(winrt::Windows::Web::Http::HttpClient client);
+
+    // A request got no response or one that a retry might not get, such as 5xx or 429
+    void ReportFailure(size_t index);
+
+    // A request succeeded, ending the endpoint's suspension
+    void ReportSuccess(size_t index);
+
+    void SetLogger(Logger logger);
+
+private:
+    struct Endpoint
+    {
+        std::wstring url;
+        std::optional<std::chrono::milliseconds> latency;   // From the last probe, empty if it didn't answer
+        bool probed = false;
+        unsigned failures = 0;                              // Failures in a row
+        std::chrono::steady_clock::time_point suspendedUntil;
+    };
+
+    mutable std::mutex m_mutex;
+    std::vector<Endpoint> m_endpoints;
+    std::optional<std::chrono::steady_clock::time_point> m_probedAt;
+    Logger m_logger;
+};
\ No newline at end of file
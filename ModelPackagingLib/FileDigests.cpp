@@ -0,0 +1,135 @@
+#include "FileDigests.h"
+#include "AppxBlockMap.h"
+#include <algorithm>
+#include <wil/resource.h>
+#include <zlib.h>
+
+namespace {
+    // Most digests held at once, and the most memory they may take
+    constexpr size_t MaxDigests = 4096;
+    constexpr size_t MaxFootprint = 64 * 1024 * 1024;
+}
+
+FileDigestBuilder::FileDigestBuilder()
+{
+    m_digest.crc32 = static_cast<uint32_t>(crc32(0L, Z_NULL, 0));
+    m_partialBlock.reserve(AppxBlockMap::BlockSize);
+}
+
+void FileDigestBuilder::Add(const uint8_t* data, size_t size)
+{
+    m_digest.crc32 = static_cast<uint32_t>(crc32(m_digest.crc32, data, static_cast<uInt>(size)));
+    m_digest.size += size;
+    
+    // Finish a block started by an earlier piece
+    if (!m_partialBlock.empty()) {
+        size_t copied = (std::min)(size, AppxBlockMap::BlockSize - m_partialBlock.size());
+        m_partialBlock.insert(m_partialBlock.end(), data, data + copied);
+        data += copied;
+        size -= copied;
+        
+        if (m_partialBlock.size() < AppxBlockMap::BlockSize) {
+            return;
+        }
+        m_digest.blockHashes.push_back(HashUtils::Sha256(m_partialBlock.data(), m_partialBlock.size()));
+        m_partialBlock.clear();
+    }
+    
+    // Whole blocks are hashed where they are
+    while (size >= AppxBlockMap::BlockSize) {
+        m_digest.blockHashes.push_back(HashUtils::Sha256(data, AppxBlockMap::BlockSize));
+        data += AppxBlockMap::BlockSize;
+        size -= AppxBlockMap::BlockSize;
+    }
+    
+    m_partialBlock.assign(data, data + size);
+}
+
+FileDigest FileDigestBuilder::Finish()
+{
+    if (!m_partialBlock.empty()) {
+        m_digest.blockHashes.push_back(HashUtils::Sha256(m_partialBlock.data(), m_partialBlock.size()));
+        m_partialBlock.clear();
+    }
+    return std::move(m_digest);
+}
+
+FileDigests& FileDigests::Instance()
+{
+    static FileDigests digests;
+    return digests;
+}
+
+void FileDigests::Record(const fs::path& path, FileDigest digest)
+{
+    std::string key;
+    if (!Key(path, key)) {
+        return;
+    }
+    
+    std::lock_guard<std::mutex> lock(m_mutex);
+    RecordedDigest& recorded = m_digests[key];
+    m_footprint -= recorded.sequence != 0 ? FootprintOf(recorded.digest) : 0;
+    recorded.sequence = ++m_nextSequence;
+    recorded.digest = std::move(digest);
+    m_footprint += FootprintOf(recorded.digest);
+    
+    // Evictions are rare, only when files are downloaded and not packaged, so a scan for the oldest will do
+    while (m_digests.size() > MaxDigests || m_footprint > MaxFootprint) {
+        auto oldest = std::min_element(m_digests.begin(), m_digests.end(), [](const auto& a, const auto& b) {
+            return a.second.sequence < b.second.sequence;
+        });
+        m_footprint -= FootprintOf(oldest->second.digest);
+        m_digests.erase(oldest);
+    }
+}
+
+bool FileDigests::Take(const fs::path& path, FileDigest& digest)
+{
+    std::error_code error;
+    uint64_t size = fs::file_size(path, error);
+    if (error) {
+        return false;
+    }
+    fs::file_time_type lastWriteTime = fs::last_write_time(path, error);
+    std::string key;
+    if (error || !Key(path, key)) {
+        return false;
+    }
+    
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto match = m_digests.find(key);
+    if (match == m_digests.end()) {
+        return false;
+    }
+    
+    FileDigest recorded = std::move(match->second.digest);
+    m_footprint -= FootprintOf(recorded);
+    m_digests.erase(match);
+    if (recorded.size != size || recorded.lastWriteTime != lastWriteTime) {
+        return false;
+    }
+    
+    digest = std::move(recorded);
+    return true;
+}
+
+bool FileDigests::Key(const fs::path& path, std::string& key)
+{
+    // Opening for attributes only doesn't get in the way of readers or writers
+    wil::unique_hfile file(CreateFileW(path.c_str(), FILE_READ_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr));
+    FILE_ID_INFO id = {};
+    if (!file || !GetFileInformationByHandleEx(file.get(), FileIdInfo, &id, sizeof(id))) {
+        return false;
+    }
+    
+    key = HashUtils::ToHex(reinterpret_cast<const uint8_t*>(&id.VolumeSerialNumber), sizeof(id.VolumeSerialNumber)) +
+        HashUtils::ToHex(id.FileId.Identifier, sizeof(id.FileId.Identifier));
+    return true;
+}
+
+size_t FileDigests::FootprintOf(const FileDigest& digest)
+{
+    return sizeof(RecordedDigest) + digest.blockHashes.capacity() * sizeof(HashUtils::Sha256Digest);
+}
\ No newline at end of file
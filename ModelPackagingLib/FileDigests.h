@@ -0,0 +1,77 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <filesystem>
+#include "HashUtils.h"
+
+namespace fs = std::filesystem;
+
+// CRC-32 and 64 KB block hashes of a file, as the package writer needs them for a stored entry
+struct FileDigest
+{
+    uint64_t size = 0;
+    fs::file_time_type lastWriteTime;       // Of the file the digest was taken from, to tell when it changed since
+    uint32_t crc32 = 0;
+    std::vector<HashUtils::Sha256Digest> blockHashes;
+};
+
+// Builds a FileDigest from a file's data fed front to back in pieces of any size
+class FileDigestBuilder
+{
+public:
+    FileDigestBuilder();
+
+    void Add(const uint8_t* data, size_t size);
+
+    // Hash the last, partial block and return the digest; size and lastWriteTime are left to the caller
+    FileDigest Finish();
+
+private:
+    FileDigest m_digest;
+    std::vector<uint8_t> m_partialBlock;    // Start of a block that hasn't been completed yet
+};
+
+// Digests of files taken while they were downloaded, so packaging them right after can skip reading
+// them only to hash them. A digest is handed out once, and only while the file still has the size and
+// last write time it was recorded with. Files are told apart by volume and file id rather than by path,
+// so a hard link to a downloaded file finds its digest too. Digests of files that are never packaged
+// are dropped, oldest first, once the digests held take more than a few thousand files or 64 MB.
+class FileDigests
+{
+public:
+    static FileDigests& Instance();
+
+    FileDigests(const FileDigests&) = delete;
+    FileDigests& operator=(const FileDigests&) = delete;
+
+    // Record the digest of a file just written
+    void Record(const fs::path& path, FileDigest digest);
+
+    // Digest of a file, if one was recorded and the file hasn't changed since; either way the
+    // recorded digest is forgotten
+    bool Take(const fs::path& path, FileDigest& digest);
+
+private:
+    FileDigests() = default;
+
+    struct RecordedDigest
+    {
+        uint64_t sequence = 0;      // Order of recording, to drop the oldest first
+        FileDigest digest;
+    };
+
+    // Volume serial number and file id of a file, as hexadecimal
+    static bool Key(const fs::path& path, std::string& key);
+
+    // Memory a digest holds on to
+    static size_t FootprintOf(const FileDigest& digest);
+
+    std::mutex m_mutex;
+    std::map<std::string, RecordedDigest> m_digests;
+    uint64_t m_nextSequence = 0;
+    size_t m_footprint = 0;
+};
\ No newline at end of file
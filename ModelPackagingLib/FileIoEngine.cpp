@@ -0,0 +1,545 @@
+#include "FileIoEngine.h"
+#include <atomic>
+#include <winioctl.h>
+
+namespace {
+    std::atomic<IoBackend> g_defaultBackend = IoBackend::Auto;
+
+    // The ring functions of KernelBase.dll, or nulls on systems that don't have them
+    struct IoRingFunctions
+    {
+        decltype(&::QueryIoRingCapabilities) queryCapabilities = nullptr;
+        decltype(&::IsIoRingOpSupported) isOpSupported = nullptr;
+        decltype(&::CreateIoRing) create = nullptr;
+        decltype(&::CloseIoRing) close = nullptr;
+        decltype(&::SubmitIoRing) submit = nullptr;
+        decltype(&::PopIoRingCompletion) popCompletion = nullptr;
+        decltype(&::BuildIoRingReadFile) buildRead = nullptr;
+        decltype(&::BuildIoRingWriteFile) buildWrite = nullptr;
+        decltype(&::BuildIoRingRegisterBuffers) buildRegisterBuffers = nullptr;
+
+        bool Loaded() const
+        {
+            return queryCapabilities && isOpSupported && create && close && submit && popCompletion &&
+                buildRead && buildWrite && buildRegisterBuffers;
+        }
+    };
+
+    template <typename Function>
+    void LoadFunction(HMODULE module, const char* name, Function& function)
+    {
+        function = reinterpret_cast<Function>(GetProcAddress(module, name));
+    }
+
+    const IoRingFunctions& IoRing()
+    {
+        static const IoRingFunctions functions = []() {
+            IoRingFunctions loaded;
+            HMODULE module = GetModuleHandleW(L"kernelbase.dll");
+            if (module) {
+                LoadFunction(module, "QueryIoRingCapabilities", loaded.queryCapabilities);
+                LoadFunction(module, "IsIoRingOpSupported", loaded.isOpSupported);
+                LoadFunction(module, "CreateIoRing", loaded.create);
+                LoadFunction(module, "CloseIoRing", loaded.close);
+                LoadFunction(module, "SubmitIoRing", loaded.submit);
+                LoadFunction(module, "PopIoRingCompletion", loaded.popCompletion);
+                LoadFunction(module, "BuildIoRingReadFile", loaded.buildRead);
+                LoadFunction(module, "BuildIoRingWriteFile", loaded.buildWrite);
+                LoadFunction(module, "BuildIoRingRegisterBuffers", loaded.buildRegisterBuffers);
+            }
+            return loaded;
+        }();
+        return functions;
+    }
+
+    DWORD ErrorFromResult(HRESULT result)
+    {
+        return HRESULT_FACILITY(result) == FACILITY_WIN32 ? HRESULT_CODE(result) : ERROR_GEN_FAILURE;
+    }
+
+    // Send a control code to a file that may be open for overlapped I/O and wait for it. The low bit
+    // of the event handle keeps the completion away from a thread pool the file is bound to.
+    bool ControlFile(HANDLE file, DWORD code, void* input, DWORD inputSize, void* output, DWORD outputSize)
+    {
+        wil::unique_handle event(CreateEventW(nullptr, TRUE, FALSE, nullptr));
+        if (!event) {
+            return false;
+        }
+
+        OVERLAPPED overlapped = {};
+        overlapped.hEvent = reinterpret_cast<HANDLE>(reinterpret_cast<ULONG_PTR>(event.get()) | 1);
+        DWORD returned = 0;
+        if (DeviceIoControl(file, code, input, inputSize, output, outputSize, &returned, &overlapped)) {
+            return true;
+        }
+        return GetLastError() == ERROR_IO_PENDING && GetOverlappedResult(file, &overlapped, &returned, TRUE);
+    }
+}
+
+FileIoEngine::FileIoEngine(Logger logger)
+    : m_logger(std::move(logger)),
+      m_backend(IoBackend::ThreadPool),
+      m_ring(nullptr),
+      m_buffer(nullptr),
+      m_bufferSize(0),
+      m_nextTicket(1),
+      m_queued(0),
+      m_lastError(0)
+{
+}
+
+FileIoEngine::~FileIoEngine()
+{
+    // Requests still in flight point into buffers their owner is about to free
+    for (auto& slot : m_slots) {
+        uint32_t transferred = 0;
+        if (slot.state != SlotState::Free) {
+            Wait(slot.ticket, transferred);
+        }
+    }
+    
+    for (size_t i = 0; i < m_files.size(); i++) {
+        CloseFile(i);
+    }
+    
+    if (m_ring) {
+        IoRing().close(m_ring);
+    }
+}
+
+void FileIoEngine::SetDefaultBackend(IoBackend backend)
+{
+    g_defaultBackend = backend;
+}
+
+IoBackend FileIoEngine::DefaultBackend()
+{
+    return g_defaultBackend;
+}
+
+bool FileIoEngine::ParseBackend(const std::wstring& text, IoBackend& backend)
+{
+    if (_wcsicmp(text.c_str(), L"auto") == 0) {
+        backend = IoBackend::Auto;
+    }
+    else if (_wcsicmp(text.c_str(), L"ioring") == 0) {
+        backend = IoBackend::IoRing;
+    }
+    else if (_wcsicmp(text.c_str(), L"threadpool") == 0) {
+        backend = IoBackend::ThreadPool;
+    }
+    else {
+        return false;
+    }
+    return true;
+}
+
+const wchar_t* FileIoEngine::BackendName(IoBackend backend)
+{
+    switch (backend) {
+        case IoBackend::IoRing:
+            return L"ioring";
+        case IoBackend::ThreadPool:
+            return L"threadpool";
+        default:
+            return L"auto";
+    }
+}
+
+bool FileIoEngine::IoRingAvailable()
+{
+    const IoRingFunctions& ring = IoRing();
+    if (!ring.Loaded()) {
+        return false;
+    }
+    
+    // Writes arrived with version 3
+    IORING_CAPABILITIES capabilities = {};
+    return SUCCEEDED(ring.queryCapabilities(&capabilities)) && capabilities.MaxVersion >= IORING_VERSION_3;
+}
+
+bool FileIoEngine::Start(IoBackend backend, uint32_t queueDepth, void* buffer, size_t bufferSize)
+{
+    m_slots.assign(queueDepth, Slot());
+    m_buffer = static_cast<uint8_t*>(buffer);
+    m_bufferSize = bufferSize;
+    m_backend = IoBackend::ThreadPool;
+    
+    if (backend == IoBackend::ThreadPool) {
+        return true;
+    }
+    
+    const IoRingFunctions& ring = IoRing();
+    if (IoRingAvailable()) {
+        IORING_CREATE_FLAGS flags = {};
+        flags.Required = IORING_CREATE_REQUIRED_FLAGS_NONE;
+        flags.Advisory = IORING_CREATE_ADVISORY_FLAGS_NONE;
+        
+        HRESULT result = ring.create(IORING_VERSION_3, flags, queueDepth, queueDepth * 2, &m_ring);
+        if (SUCCEEDED(result) && (!ring.isOpSupported(m_ring, IORING_OP_READ) || !ring.isOpSupported(m_ring, IORING_OP_WRITE))) {
+            result = E_NOTIMPL;
+        }
+        
+        // The buffer is registered as buffer 0 before any request refers to it
+        if (SUCCEEDED(result) && m_buffer && m_bufferSize > 0 && m_bufferSize <= UINT32_MAX) {
+            IORING_BUFFER_INFO info = {};
+            info.Address = m_buffer;
+            info.Length = static_cast<UINT32>(m_bufferSize);
+            result = ring.buildRegisterBuffers(m_ring, 1, &info, 0);
+            
+            IORING_CQE completion = {};
+            if (SUCCEEDED(result)) {
+                result = ring.submit(m_ring, 1, INFINITE, nullptr);
+            }
+            if (SUCCEEDED(result)) {
+                result = ring.popCompletion(m_ring, &completion) == S_OK ? completion.ResultCode : E_UNEXPECTED;
+            }
+        }
+        else {
+            m_bufferSize = 0;
+        }
+        
+        if (SUCCEEDED(result)) {
+            m_backend = IoBackend::IoRing;
+            return true;
+        }
+        
+        if (m_ring) {
+            ring.close(m_ring);
+            m_ring = nullptr;
+        }
+        m_logger.Verbose() << L"Could not set up an I/O ring (error " << ErrorFromResult(result) << L"); using the thread pool";
+    }
+    
+    if (backend == IoBackend::IoRing) {
+        m_logger.Warning() << L"I/O rings are not available on this system; using the thread pool for file I/O";
+    }
+    return true;
+}
+
+IoBackend FileIoEngine::Backend() const
+{
+    return m_backend;
+}
+
+size_t FileIoEngine::OpenFile(const fs::path& path, bool write, uint64_t* size)
+{
+    DWORD flags = FILE_ATTRIBUTE_NORMAL;
+    if (!write) {
+        flags |= FILE_FLAG_SEQUENTIAL_SCAN;
+    }
+    if (m_backend == IoBackend::ThreadPool) {
+        flags |= FILE_FLAG_OVERLAPPED;
+    }
+    
+    File file;
+    file.handle.reset(CreateFileW(path.c_str(), write ? GENERIC_WRITE : GENERIC_READ, write ? FILE_SHARE_READ : FILE_SHARE_READ | FILE_SHARE_WRITE,
+        nullptr, write ? CREATE_ALWAYS : OPEN_EXISTING, flags, nullptr));
+    if (!file.handle) {
+        m_lastError = GetLastError();
+        return static_cast<size_t>(-1);
+    }
+    
+    if (size) {
+        LARGE_INTEGER fileSize = {};
+        if (!GetFileSizeEx(file.handle.get(), &fileSize)) {
+            m_lastError = GetLastError();
+            return static_cast<size_t>(-1);
+        }
+        *size = static_cast<uint64_t>(fileSize.QuadPart);
+    }
+    
+    if (m_backend == IoBackend::ThreadPool) {
+        file.io = CreateThreadpoolIo(file.handle.get(), ThreadPoolCompletion, this, nullptr);
+        if (!file.io) {
+            m_lastError = GetLastError();
+            return static_cast<size_t>(-1);
+        }
+    }
+    file.open = true;
+    
+    for (size_t i = 0; i < m_files.size(); i++) {
+        if (!m_files[i].open) {
+            m_files[i] = std::move(file);
+            return i;
+        }
+    }
+    m_files.push_back(std::move(file));
+    return m_files.size() - 1;
+}
+
+void FileIoEngine::CloseFile(size_t index)
+{
+    if (index >= m_files.size() || !m_files[index].open) {
+        return;
+    }
+    
+    File& file = m_files[index];
+    if (file.io) {
+        WaitForThreadpoolIoCallbacks(file.io, FALSE);
+        CloseThreadpoolIo(file.io);
+        file.io = nullptr;
+    }
+    file.handle.reset();
+    file.open = false;
+}
+
+uint64_t FileIoEngine::Read(size_t file, uint64_t offset, void* buffer, uint32_t size)
+{
+    return Queue(false, file, offset, buffer, size);
+}
+
+uint64_t FileIoEngine::Write(size_t file, uint64_t offset, const void* buffer, uint32_t size)
+{
+    return Queue(true, file, offset, const_cast<void*>(buffer), size);
+}
+
+uint32_t FileIoEngine::CloneAlignment(size_t file, HANDLE source)
+{
+    if (file >= m_files.size() || !m_files[file].open) {
+        m_lastError = ERROR_INVALID_HANDLE;
+        return 0;
+    }
+    
+    // Blocks are only shared within a volume
+    DWORD sourceSerial = 0;
+    DWORD targetSerial = 0;
+    DWORD flags = 0;
+    if (!GetVolumeInformationByHandleW(source, nullptr, 0, &sourceSerial, nullptr, nullptr, nullptr, 0) ||
+        !GetVolumeInformationByHandleW(m_files[file].handle.get(), nullptr, 0, &targetSerial, nullptr, &flags, nullptr, 0)) {
+        m_lastError = GetLastError();
+        return 0;
+    }
+    if (sourceSerial != targetSerial || (flags & FILE_SUPPORTS_BLOCK_REFCOUNTING) == 0) {
+        return 0;
+    }
+    
+    // The source is open for reading, which the query needs, and has the volume's cluster size
+    FSCTL_GET_INTEGRITY_INFORMATION_BUFFER integrity = {};
+    if (!ControlFile(source, FSCTL_GET_INTEGRITY_INFORMATION, nullptr, 0, &integrity, sizeof(integrity))) {
+        m_lastError = GetLastError();
+        return 0;
+    }
+    return integrity.ClusterSizeInBytes;
+}
+
+bool FileIoEngine::CloneFrom(size_t file, uint64_t offset, HANDLE source, uint64_t sourceOffset, uint64_t size)
+{
+    if (file >= m_files.size() || !m_files[file].open) {
+        m_lastError = ERROR_INVALID_HANDLE;
+        return false;
+    }
+    HANDLE handle = m_files[file].handle.get();
+    
+    // Blocks can only be cloned into a range that is already part of the file
+    LARGE_INTEGER fileSize = {};
+    if (!GetFileSizeEx(handle, &fileSize)) {
+        m_lastError = GetLastError();
+        return false;
+    }
+    if (static_cast<uint64_t>(fileSize.QuadPart) < offset + size) {
+        FILE_END_OF_FILE_INFO endOfFile = {};
+        endOfFile.EndOfFile.QuadPart = static_cast<LONGLONG>(offset + size);
+        if (!SetFileInformationByHandle(handle, FileEndOfFileInfo, &endOfFile, sizeof(endOfFile))) {
+            m_lastError = GetLastError();
+            return false;
+        }
+    }
+    
+    DUPLICATE_EXTENTS_DATA extents = {};
+    extents.FileHandle = source;
+    extents.SourceFileOffset.QuadPart = static_cast<LONGLONG>(sourceOffset);
+    extents.TargetFileOffset.QuadPart = static_cast<LONGLONG>(offset);
+    extents.ByteCount.QuadPart = static_cast<LONGLONG>(size);
+    if (!ControlFile(handle, FSCTL_DUPLICATE_EXTENTS_TO_FILE, &extents, sizeof(extents), nullptr, 0)) {
+        m_lastError = GetLastError();
+        return false;
+    }
+    return true;
+}
+
+void FileIoEngine::Submit()
+{
+    if (m_ring && m_queued > 0) {
+        UINT32 submitted = 0;
+        IoRing().submit(m_ring, 0, 0, &submitted);
+        m_queued = 0;
+    }
+}
+
+bool FileIoEngine::Wait(uint64_t ticket, uint32_t& transferred)
+{
+    transferred = 0;
+    
+    Slot* slot = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto& candidate : m_slots) {
+            if (candidate.state != SlotState::Free && candidate.ticket == ticket) {
+                slot = &candidate;
+                break;
+            }
+        }
+    }
+    if (!slot) {
+        m_lastError = ERROR_INVALID_PARAMETER;
+        return false;
+    }
+    
+    if (m_ring) {
+        Submit();
+        while (ReapRing(false) && slot->state != SlotState::Done) {
+            if (!ReapRing(true)) {
+                Complete(*slot, m_lastError, 0);
+            }
+        }
+    }
+    
+    DWORD error = 0;
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_completed.wait(lock, [slot]() { return slot->state == SlotState::Done; });
+        transferred = slot->transferred;
+        error = slot->error;
+        slot->state = SlotState::Free;
+        slot->ticket = 0;
+    }
+    
+    if (error != 0) {
+        m_lastError = error;
+        return false;
+    }
+    return true;
+}
+
+DWORD FileIoEngine::LastError() const
+{
+    return m_lastError;
+}
+
+uint64_t FileIoEngine::Queue(bool write, size_t file, uint64_t offset, void* buffer, uint32_t size)
+{
+    if (file >= m_files.size() || !m_files[file].open) {
+        m_lastError = ERROR_INVALID_HANDLE;
+        return 0;
+    }
+    
+    Slot* slot = nullptr;
+    uint64_t ticket = m_nextTicket++;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto& candidate : m_slots) {
+            if (candidate.state == SlotState::Free) {
+                slot = &candidate;
+                slot->ticket = ticket;
+                slot->state = SlotState::Busy;
+                slot->error = 0;
+                slot->transferred = 0;
+                break;
+            }
+        }
+    }
+    if (!slot) {
+        m_lastError = ERROR_BUSY;
+        return 0;
+    }
+    
+    slot->overlapped = {};
+    slot->overlapped.Offset = static_cast<DWORD>(offset);
+    slot->overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+    
+    bool queued = m_ring ? QueueOnRing(write, m_files[file], offset, buffer, size, ticket) :
+        QueueOnThreadPool(write, m_files[file], *slot, buffer, size);
+    
+    // A request the system refused fails when it is waited for
+    if (!queued) {
+        Complete(*slot, m_lastError, 0);
+    }
+    return ticket;
+}
+
+bool FileIoEngine::QueueOnRing(bool write, const File& file, uint64_t offset, void* buffer, uint32_t size, uint64_t ticket)
+{
+    const IoRingFunctions& ring = IoRing();
+    uint8_t* data = static_cast<uint8_t*>(buffer);
+    IORING_HANDLE_REF handleRef = IoRingHandleRefFromHandle(file.handle.get());
+    IORING_BUFFER_REF bufferRef = m_bufferSize > 0 && data >= m_buffer && data + size <= m_buffer + m_bufferSize ?
+        IoRingBufferRefFromIndexAndOffset(0, static_cast<UINT32>(data - m_buffer)) : IoRingBufferRefFromPointer(buffer);
+    
+    // A full submission queue is handed to the kernel and the request built again
+    for (int attempt = 0; attempt < 2; attempt++) {
+        HRESULT result = write ?
+            ring.buildWrite(m_ring, handleRef, bufferRef, size, offset, FILE_WRITE_FLAGS_NONE, static_cast<UINT_PTR>(ticket), IOSQE_FLAGS_NONE) :
+            ring.buildRead(m_ring, handleRef, bufferRef, size, offset, static_cast<UINT_PTR>(ticket), IOSQE_FLAGS_NONE);
+        if (SUCCEEDED(result)) {
+            m_queued++;
+            return true;
+        }
+        
+        if (result != IORING_E_SUBMISSION_QUEUE_FULL) {
+            m_lastError = ErrorFromResult(result);
+            return false;
+        }
+        Submit();
+    }
+    
+    m_lastError = ERROR_BUSY;
+    return false;
+}
+
+bool FileIoEngine::QueueOnThreadPool(bool write, File& file, Slot& slot, void* buffer, uint32_t size)
+{
+    StartThreadpoolIo(file.io);
+    BOOL started = write ? WriteFile(file.handle.get(), buffer, size, nullptr, &slot.overlapped) :
+        ReadFile(file.handle.get(), buffer, size, nullptr, &slot.overlapped);
+    if (!started && GetLastError() != ERROR_IO_PENDING) {
+        // No completion will be queued for a request that failed to start
+        m_lastError = GetLastError();
+        CancelThreadpoolIo(file.io);
+        return false;
+    }
+    return true;
+}
+
+void FileIoEngine::Complete(Slot& slot, DWORD error, uint32_t transferred)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        slot.error = error;
+        slot.transferred = transferred;
+        slot.state = SlotState::Done;
+    }
+    m_completed.notify_all();
+}
+
+bool FileIoEngine::ReapRing(bool wait)
+{
+    const IoRingFunctions& ring = IoRing();
+    if (wait) {
+        HRESULT result = ring.submit(m_ring, 1, INFINITE, nullptr);
+        m_queued = 0;
+        if (FAILED(result)) {
+            m_lastError = ErrorFromResult(result);
+            return false;
+        }
+    }
+    
+    IORING_CQE completion = {};
+    while (ring.popCompletion(m_ring, &completion) == S_OK) {
+        for (auto& slot : m_slots) {
+            if (slot.state == SlotState::Busy && slot.ticket == static_cast<uint64_t>(completion.UserData)) {
+                Complete(slot, SUCCEEDED(completion.ResultCode) ? 0 : ErrorFromResult(completion.ResultCode),
+                    static_cast<uint32_t>(completion.Information));
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+void CALLBACK FileIoEngine::ThreadPoolCompletion(PTP_CALLBACK_INSTANCE, PVOID context, PVOID overlapped,
+                                                 ULONG result, ULONG_PTR transferred, PTP_IO)
+{
+    auto engine = static_cast<FileIoEngine*>(context);
+    engine->Complete(*reinterpret_cast<Slot*>(overlapped), result, static_cast<uint32_t>(transferred));
+}
\ No newline at end of file
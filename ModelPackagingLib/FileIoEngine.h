@@ -0,0 +1,142 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <cstdint>
+#include <filesystem>
+#include <condition_variable>
+#include <Windows.h>
+#include <ioringapi.h>
+#include <wil/resource.h>
+#include "Logger.h"
+
+namespace fs = std::filesystem;
+
+// How a FileIoEngine queues its requests
+enum class IoBackend
+{
+    Auto,           // IoRing where the system supports it, the thread pool elsewhere
+    IoRing,         // An I/O ring (Windows 11), with the engine's buffer registered and requests submitted in batches
+    ThreadPool      // Overlapped ReadFile and WriteFile, completing on the Windows thread pool
+};
+
+// Keeps many reads and writes at fixed file offsets in flight at once, so the disk works at a queue
+// depth above one while the calling thread does other work.
+//
+// Requests are queued and waited for on one thread, and each is identified by a ticket. With an I/O
+// ring, requests are built into the submission queue and handed to the kernel together by Submit or
+// the next wait, and requests into the engine's own buffer use it as a registered buffer, which is
+// locked in memory once instead of for every request. The ring functions are looked up at run time,
+// so the tool still starts on systems without them and uses the thread pool there.
+class FileIoEngine
+{
+public:
+    explicit FileIoEngine(Logger logger = Logger());
+
+    // Waits for every request in flight and closes the files
+    ~FileIoEngine();
+
+    FileIoEngine(const FileIoEngine&) = delete;
+    FileIoEngine& operator=(const FileIoEngine&) = delete;
+
+    // Backend of engines started without one; set once for the process from the command line
+    static void SetDefaultBackend(IoBackend backend);
+    static IoBackend DefaultBackend();
+
+    // Parse auto, ioring or threadpool
+    static bool ParseBackend(const std::wstring& text, IoBackend& backend);
+    static const wchar_t* BackendName(IoBackend backend);
+
+    // Whether the system has I/O rings that can read and write files
+    static bool IoRingAvailable();
+
+    // Set up for queueDepth requests in flight. Requests into buffer, when given, use it as a
+    // registered buffer on an I/O ring; it must outlive the engine.
+    bool Start(IoBackend backend, uint32_t queueDepth, void* buffer = nullptr, size_t bufferSize = 0);
+
+    // Backend in use once started; never Auto
+    IoBackend Backend() const;
+
+    // Open a file for reading, or create one for writing, returning its index or npos. Files read
+    // are marked for sequential access, which lets the cache manager read further ahead.
+    size_t OpenFile(const fs::path& path, bool write, uint64_t* size = nullptr);
+
+    // Close a file that has no requests in flight
+    void CloseFile(size_t file);
+
+    // Queue a read or write, returning its ticket, or 0 when every request slot is taken
+    uint64_t Read(size_t file, uint64_t offset, void* buffer, uint32_t size);
+    uint64_t Write(size_t file, uint64_t offset, const void* buffer, uint32_t size);
+
+    // Cluster size in which CloneFrom can share the blocks of source with a file, or 0 when the two
+    // are on different volumes or the file system can't share blocks between files (only ReFS can)
+    uint32_t CloneAlignment(size_t file, HANDLE source);
+
+    // Make size bytes at offset in a file share the blocks of source at sourceOffset instead of
+    // copying them, extending the file to cover them. Both offsets and size must be multiples of the
+    // clone alignment. Runs on the calling thread, beside any requests in flight.
+    bool CloneFrom(size_t file, uint64_t offset, HANDLE source, uint64_t sourceOffset, uint64_t size);
+
+    // Hand queued requests to the kernel
+    void Submit();
+
+    // Wait for a request, returning whether it succeeded and how many bytes it moved
+    bool Wait(uint64_t ticket, uint32_t& transferred);
+
+    // Windows error of the last failed request or call
+    DWORD LastError() const;
+
+private:
+    enum class SlotState
+    {
+        Free,
+        Busy,
+        Done
+    };
+
+    // A request in flight; the OVERLAPPED comes first so a thread pool completion finds its slot
+    struct Slot
+    {
+        OVERLAPPED overlapped = {};
+        uint64_t ticket = 0;
+        SlotState state = SlotState::Free;
+        DWORD error = 0;
+        uint32_t transferred = 0;
+    };
+
+    struct File
+    {
+        wil::unique_hfile handle;
+        PTP_IO io = nullptr;
+        bool open = false;
+    };
+
+    uint64_t Queue(bool write, size_t file, uint64_t offset, void* buffer, uint32_t size);
+    bool QueueOnRing(bool write, const File& file, uint64_t offset, void* buffer, uint32_t size, uint64_t ticket);
+    bool QueueOnThreadPool(bool write, File& file, Slot& slot, void* buffer, uint32_t size);
+
+    // Record the result of a request
+    void Complete(Slot& slot, DWORD error, uint32_t transferred);
+
+    // Move finished ring requests to their slots, waiting for at least one when wait is set
+    bool ReapRing(bool wait);
+
+    static void CALLBACK ThreadPoolCompletion(PTP_CALLBACK_INSTANCE instance, PVOID context, PVOID overlapped,
+                                              ULONG result, ULONG_PTR transferred, PTP_IO io);
+
+    Logger m_logger;
+    IoBackend m_backend;
+    HIORING m_ring;
+    uint8_t* m_buffer;
+    size_t m_bufferSize;
+    uint64_t m_nextTicket;
+    uint32_t m_queued;          // Built into the ring's submission queue but not yet submitted
+    DWORD m_lastError;
+    std::vector<File> m_files;
+
+    // Slots are changed by thread pool completions under the mutex
+    std::mutex m_mutex;
+    std::condition_variable m_completed;
+    std::vector<Slot> m_slots;
+};
\ No newline at end of file
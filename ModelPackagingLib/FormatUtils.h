@@ -0,0 +1,41 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <cwchar>
+#include <sstream>
+
+namespace FormatUtils {
+
+    // Format a byte count for display, in binary units: 512 B, 1.5 KB, 2.0 GB
+    inline std::wstring FormatSize(uint64_t bytes)
+    {
+        const wchar_t* units[] = { L"B", L"KB", L"MB", L"GB", L"TB" };
+        double size = static_cast<double>(bytes);
+        size_t unit = 0;
+        while (size >= 1024 && unit + 1 < std::size(units)) {
+            size /= 1024;
+            unit++;
+        }
+
+        std::wostringstream text;
+        text.setf(std::ios::fixed);
+        text.precision(unit == 0 ? 0 : 1);
+        text << size << L" " << units[unit];
+        return text.str();
+    }
+
+    // Format a duration in seconds as h:mm:ss or m:ss
+    inline std::wstring FormatDuration(double seconds)
+    {
+        uint64_t total = static_cast<uint64_t>(seconds + 0.5);
+        wchar_t buffer[32];
+        if (total >= 3600) {
+            swprintf_s(buffer, L"%llu:%02llu:%02llu", total / 3600, (total / 60) % 60, total % 60);
+        }
+        else {
+            swprintf_s(buffer, L"%llu:%02llu", total / 60, total % 60);
+        }
+        return buffer;
+    }
+}
\ No newline at end of file
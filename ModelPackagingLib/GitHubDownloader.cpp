@@ -1,6 +1,8 @@
 #include "GitHubDownloader.h"
-#include <iostream>
-#include <fstream>
+#include "TraceRecorder.h"
+#include "BandwidthLimiter.h"
+#include "DownloadSink.h"
+#include <wil/resource.h>
 #include <winerror.h> // For E_FAIL
 #include <winrt/base.h>
 #include <winrt/Windows.Foundation.Collections.h>
@@ -12,7 +14,17 @@ using namespace Windows::Web::Http;
 using namespace Windows::Web::Http::Headers;
 using namespace Windows::Storage::Streams;
 
-GitHubDownloader::GitHubDownloader() : m_cancelRequested(false)
+namespace {
+    // Raw file content comes from raw.githubusercontent.com unless GITHUB_RAW_ENDPOINT lists other
+    // endpoints, separated by semicolons
+    std::vector<std::wstring> EndpointsFromEnvironment()
+    {
+        return EndpointList::FromEnvironment(L"GITHUB_RAW_ENDPOINT", L"https://raw.githubusercontent.com");
+    }
+}
+
+GitHubDownloader::GitHubDownloader()
+    : m_endpoints(EndpointsFromEnvironment())
 {
     // Set default headers
     m_httpClient.DefaultRequestHeaders().UserAgent().Append(
@@ -25,24 +37,60 @@ winrt::Windows::Foundation::IAsyncAction GitHubDownloader::DownloadFileAsync(
     const std::wstring& branch,
     const std::wstring& filePath,
     const fs::path& destinationPath,
-    ProgressCallback progressCallback)
+    ProgressTracker* progressTracker)
 {
-    m_cancelRequested = false;
+    if (m_cancellationToken.IsCancelled()) {
+        co_return;
+    }
+    co_await m_endpoints.ProbeAsync(m_httpClient);
     
-    // Construct the download URL
-    std::wstring downloadUrl = BuildDownloadUrl(repoOwner, repoName, branch, filePath);
+    // One entry for the file however many endpoints it takes, finished when the last attempt ends
+    std::shared_ptr<TransferProgress> transfer = progressTracker ? progressTracker->BeginTransfer(GetFileName(filePath)) : nullptr;
+    auto completeTransfer = wil::scope_exit([&]() {
+        if (transfer) {
+            transfer->Complete();
+        }
+    });
     
+    std::vector<size_t> order = m_endpoints.Order();
+    for (size_t i = 0; i < order.size(); i++) {
+        std::wstring endpoint = m_endpoints.Url(order[i]);
+        try {
+            co_await TransferFileAsync(BuildDownloadUrl(endpoint, repoOwner, repoName, branch, filePath), filePath,
+                destinationPath, transfer.get());
+            m_endpoints.ReportSuccess(order[i]);
+            co_return;
+        }
+        catch (const winrt::hresult_error& ex) {
+            if (m_cancellationToken.IsCancelled() || i + 1 == order.size()) {
+                throw;
+            }
+            m_endpoints.ReportFailure(order[i]);
+            m_logger.Warning() << L"Downloading " << filePath << L" from " << endpoint << L" failed ("
+                << ex.message().c_str() << L"); trying " << m_endpoints.Url(order[i + 1]);
+        }
+    }
+}
+
+winrt::Windows::Foundation::IAsyncAction GitHubDownloader::TransferFileAsync(
+    const std::wstring& downloadUrl,
+    const std::wstring& filePath,
+    const fs::path& destinationPath,
+    TransferProgress* transfer)
+{
     // Create URI from the URL
     Uri uri(downloadUrl);
     
     // Ensure the directory exists
     EnsureDirectoryExists(destinationPath);
     
-    // Start the download
-    auto fileName = GetFileName(filePath);
+    // The download counts against the process-wide bandwidth limit
+    auto bandwidth = BandwidthLimiter::Instance().Join();
     
     try
     {
+        TraceSpan transferSpan("download", filePath);
+        
         // Use GetAsync for streaming downloads
         auto response = co_await m_httpClient.GetAsync(
             uri, 
@@ -59,13 +107,19 @@ winrt::Windows::Foundation::IAsyncAction GitHubDownloader::DownloadFileAsync(
             totalBytes = contentLengthHeader.Value();
         }
         
+        // Every attempt starts the file over
+        if (transfer) {
+            transfer->SetBytesReceived(0);
+            transfer->SetTotalBytes(totalBytes);
+        }
+        
         // Get the input stream from the response
         auto inputStream = co_await response.Content().ReadAsInputStreamAsync();
         
-        // Create a file stream for writing
-        std::ofstream fileStream(destinationPath.string(), std::ios::binary | std::ios::trunc);
-        if (!fileStream.is_open()) {
-            throw winrt::hresult_error(E_FAIL, L"Failed to open file for writing");
+        // Preallocate the file and write it behind the transfer
+        DownloadSink sink(m_logger);
+        if (!sink.Open(destinationPath, 0, totalBytes)) {
+            throw winrt::hresult_error(HRESULT_FROM_WIN32(sink.LastError()), L"Failed to open file for writing");
         }
         
         // Read data in chunks for better performance and to provide progress updates
@@ -75,7 +129,7 @@ winrt::Windows::Foundation::IAsyncAction GitHubDownloader::DownloadFileAsync(
         
         while (true)
         {
-            if (m_cancelRequested) {
+            if (m_cancellationToken.IsCancelled()) {
                 co_return;
             }
             
@@ -91,23 +145,34 @@ winrt::Windows::Foundation::IAsyncAction GitHubDownloader::DownloadFileAsync(
             auto data = ibuffer.data();
             auto dataSize = ibuffer.Length();
             
-            // Write to file
-            fileStream.write(reinterpret_cast<const char*>(data), dataSize);
+            // Hand the data to the sink
+            if (!sink.Write(data, dataSize)) {
+                throw winrt::hresult_error(HRESULT_FROM_WIN32(sink.LastError()), L"Failed to write file");
+            }
             
             // Update progress
             bytesReceived += dataSize;
-            if (progressCallback) {
-                progressCallback(fileName, bytesReceived, totalBytes);
+            if (transfer) {
+                transfer->AddBytes(dataSize);
+            }
+            
+            // Hold the next read back while the bandwidth limit is in debt
+            auto pause = bandwidth->Consume(dataSize);
+            if (pause.count() > 0) {
+                co_await winrt::resume_after(pause);
             }
         }
         
-        // Close the file
-        fileStream.close();
+        // Write what is still buffered and close the file
+        if (!sink.Close()) {
+            throw winrt::hresult_error(HRESULT_FROM_WIN32(sink.LastError()), L"Failed to write file");
+        }
+        transferSpan.SetBytes(bytesReceived);
     }
     catch (const winrt::hresult_error& ex)
     {
         // If we've manually cancelled, just return
-        if (m_cancelRequested) {
+        if (m_cancellationToken.IsCancelled()) {
             co_return;
         }
         
@@ -122,10 +187,8 @@ winrt::Windows::Foundation::IAsyncAction GitHubDownloader::DownloadFolderAsync(
     const std::wstring& branch,
     const std::wstring& folderPath,
     const fs::path& destinationFolder,
-    ProgressCallback progressCallback)
+    ProgressTracker* progressTracker)
 {
-    m_cancelRequested = false;
-    
     // Ensure the destination folder exists
     if (!fs::exists(destinationFolder)) {
         fs::create_directories(destinationFolder);
@@ -140,17 +203,23 @@ winrt::Windows::Foundation::IAsyncAction GitHubDownloader::DownloadFolderAsync(
 
 void GitHubDownloader::CancelDownloads()
 {
-    m_cancelRequested = true;
+    m_cancellationToken.Cancel();
+}
+
+void GitHubDownloader::SetCancellationToken(CancellationToken cancellationToken)
+{
+    m_cancellationToken = std::move(cancellationToken);
 }
 
 std::wstring GitHubDownloader::BuildDownloadUrl(
+    const std::wstring& endpoint,
     const std::wstring& repoOwner,
     const std::wstring& repoName,
     const std::wstring& branch,
     const std::wstring& filePath)
 {
     // Format: https://raw.githubusercontent.com/{owner}/{repo}/{branch}/{path}
-    std::wstring url = L"https://raw.githubusercontent.com/";
+    std::wstring url = endpoint + L"/";
     url += repoOwner + L"/" + repoName + L"/" + branch + L"/";
     
     // Remove leading slash if present
@@ -178,4 +247,15 @@ std::wstring GitHubDownloader::GetFileName(const std::wstring& filePath)
         return filePath.substr(pos + 1);
     }
     return filePath;
+}
+
+void GitHubDownloader::SetLogger(Logger logger)
+{
+    m_endpoints.SetLogger(logger);
+    m_logger = std::move(logger);
+}
+
+void GitHubDownloader::SetEndpoints(std::vector<std::wstring> endpoints)
+{
+    m_endpoints.Set(endpoints.empty() ? EndpointsFromEnvironment() : std::move(endpoints));
 }
\ No newline at end of file
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <atomic>
+#include <winrt/base.h>
+#include <winrt/Windows.Foundation.h>
+#include <winrt/Windows.Web.Http.h>
+#include <winrt/Windows.Storage.Streams.h>
+#include "Logger.h"
+#include "CancellationToken.h"
+#include "ProgressTracker.h"
+#include "EndpointList.h"
+
+namespace fs = std::filesystem;
+
+class GitHubDownloader
+{
+public:
+    GitHubDownloader();
+    ~GitHubDownloader() = default;
+
+    // Download a single file from GitHub, trying the endpoints in turn until one delivers it
+    winrt::Windows::Foundation::IAsyncAction DownloadFileAsync(
+        const std::wstring& repoOwner,
+        const std::wstring& repoName,
+        const std::wstring& branch,
+        const std::wstring& filePath,
+        const fs::path& destinationPath,
+        ProgressTracker* progressTracker = nullptr);
+
+    // Download all files from a GitHub folder
+    winrt::Windows::Foundation::IAsyncAction DownloadFolderAsync(
+        const std::wstring& repoOwner,
+        const std::wstring& repoName,
+        const std::wstring& branch,
+        const std::wstring& folderPath,
+        const fs::path& destinationFolder,
+        ProgressTracker* progressTracker = nullptr);
+
+    // Cancel the downloads of the current cancellation token, running or yet to start; a new token is
+    // needed to download again
+    void CancelDownloads();
+
+    // Stop downloads when this token is cancelled, including ones started after it was
+    void SetCancellationToken(CancellationToken cancellationToken);
+
+    // Route status and error messages to the given logger
+    void SetLogger(Logger logger);
+
+    // Base URLs of raw file content, in order of preference; an empty list restores the ones
+    // GITHUB_RAW_ENDPOINT names, or https://raw.githubusercontent.com
+    void SetEndpoints(std::vector<std::wstring> endpoints);
+
+private:
+    // Download a file from one URL
+    winrt::Windows::Foundation::IAsyncAction TransferFileAsync(
+        const std::wstring& downloadUrl,
+        const std::wstring& filePath,
+        const fs::path& destinationPath,
+        TransferProgress* transfer);
+
+    // Build a download URL for a file in a GitHub repo at an endpoint
+    std::wstring BuildDownloadUrl(
+        const std::wstring& endpoint,
+        const std::wstring& repoOwner,
+        const std::wstring& repoName,
+        const std::wstring& branch,
+        const std::wstring& filePath);
+
+    // Create necessary directories for a file path
+    void EnsureDirectoryExists(const fs::path& filePath);
+
+    // Extract file name from path
+    std::wstring GetFileName(const std::wstring& filePath);
+
+    // Http client for making requests
+    winrt::Windows::Web::Http::HttpClient m_httpClient;
+    
+    // Cancelled from other threads
+    CancellationToken m_cancellationToken;
+
+    // Destination for status and error messages
+    Logger m_logger;
+
+    // Base URLs of raw file content
+    EndpointList m_endpoints;
+};
\ No newline at end of file
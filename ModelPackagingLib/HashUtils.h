@@ -0,0 +1,126 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <Windows.h>
+#include <bcrypt.h>
+
+#pragma comment(lib, "bcrypt.lib")
+
+namespace HashUtils {
+
+    using Sha256Digest = std::array<uint8_t, 32>;
+
+    // SHA-256 of a buffer. The algorithm pseudo-handle is safe to use from any thread without setup.
+    inline Sha256Digest Sha256(const void* data, size_t size)
+    {
+        Sha256Digest digest{};
+        BCryptHash(BCRYPT_SHA256_ALG_HANDLE, nullptr, 0,
+            static_cast<PUCHAR>(const_cast<void*>(data)), static_cast<ULONG>(size),
+            digest.data(), static_cast<ULONG>(digest.size()));
+        return digest;
+    }
+
+    // Standard base64 with padding, as used for block hashes in AppxBlockMap.xml
+    inline std::string ToBase64(const uint8_t* data, size_t size)
+    {
+        static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+        std::string encoded;
+        encoded.reserve((size + 2) / 3 * 4);
+
+        for (size_t i = 0; i < size; i += 3) {
+            uint32_t group = static_cast<uint32_t>(data[i]) << 16;
+            if (i + 1 < size) group |= static_cast<uint32_t>(data[i + 1]) << 8;
+            if (i + 2 < size) group |= data[i + 2];
+
+            encoded += alphabet[(group >> 18) & 0x3F];
+            encoded += alphabet[(group >> 12) & 0x3F];
+            encoded += i + 1 < size ? alphabet[(group >> 6) & 0x3F] : '=';
+            encoded += i + 2 < size ? alphabet[group & 0x3F] : '=';
+        }
+
+        return encoded;
+    }
+
+    // Decode standard base64, returning false on malformed input
+    inline bool FromBase64(const std::string& encoded, std::vector<uint8_t>& data)
+    {
+        auto value = [](char c) -> int {
+            if (c >= 'A' && c <= 'Z') return c - 'A';
+            if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+            if (c >= '0' && c <= '9') return c - '0' + 52;
+            if (c == '+') return 62;
+            if (c == '/') return 63;
+            return -1;
+        };
+
+        if (encoded.size() % 4 != 0) {
+            return false;
+        }
+
+        data.clear();
+        data.reserve(encoded.size() / 4 * 3);
+
+        for (size_t i = 0; i < encoded.size(); i += 4) {
+            int a = value(encoded[i]);
+            int b = value(encoded[i + 1]);
+            int c = encoded[i + 2] == '=' ? 0 : value(encoded[i + 2]);
+            int d = encoded[i + 3] == '=' ? 0 : value(encoded[i + 3]);
+            if (a < 0 || b < 0 || c < 0 || d < 0) {
+                return false;
+            }
+
+            uint32_t group = (a << 18) | (b << 12) | (c << 6) | d;
+            data.push_back(static_cast<uint8_t>(group >> 16));
+            if (encoded[i + 2] != '=') data.push_back(static_cast<uint8_t>(group >> 8));
+            if (encoded[i + 3] != '=') data.push_back(static_cast<uint8_t>(group));
+        }
+
+        return true;
+    }
+
+    // Lower-case hexadecimal
+    inline std::string ToHex(const uint8_t* data, size_t size)
+    {
+        static const char digits[] = "0123456789abcdef";
+
+        std::string hex;
+        hex.reserve(size * 2);
+
+        for (size_t i = 0; i < size; i++) {
+            hex += digits[data[i] >> 4];
+            hex += digits[data[i] & 0x0F];
+        }
+
+        return hex;
+    }
+
+    // Parse exactly size bytes of hexadecimal, returning false on malformed input
+    inline bool FromHex(const std::string& hex, uint8_t* data, size_t size)
+    {
+        if (hex.size() != size * 2) {
+            return false;
+        }
+
+        auto nibble = [](char c) -> int {
+            if (c >= '0' && c <= '9') return c - '0';
+            if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+            if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+            return -1;
+        };
+
+        for (size_t i = 0; i < size; i++) {
+            int high = nibble(hex[i * 2]);
+            int low = nibble(hex[i * 2 + 1]);
+            if (high < 0 || low < 0) {
+                return false;
+            }
+            data[i] = static_cast<uint8_t>((high << 4) | low);
+        }
+
+        return true;
+    }
+}
\ No newline at end of file
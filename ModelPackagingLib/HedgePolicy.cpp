@@ -0,0 +1,104 @@
+#include "HedgePolicy.h"
+#include <algorithm>
+
+namespace {
+    // First-byte times the percentile is taken over
+    constexpr size_t SampleCount = 64;
+
+    // Below this many samples the percentile means little, and the default deadline is used
+    constexpr size_t MinSamples = 8;
+    constexpr std::chrono::milliseconds DefaultDeadline = std::chrono::milliseconds(1000);
+
+    // Bounds of the deadline: below the lower one hedges would duplicate healthy requests on a
+    // fast link, and beyond the upper one the stall timeout is close enough to handle it
+    constexpr std::chrono::milliseconds MinDeadline = std::chrono::milliseconds(100);
+    constexpr std::chrono::milliseconds MaxDeadline = std::chrono::milliseconds(10000);
+
+    // Hedges the budget starts with and can save up, so the first requests of a run, the listing
+    // among them, can be hedged before any have been counted
+    constexpr double InitialBudget = 2.0;
+    constexpr double MaxBudget = 5.0;
+}
+
+HedgePolicy::HedgePolicy(double percentile, double budgetRatio)
+    : m_percentile((std::clamp)(percentile, 0.0, 1.0)),
+      m_budgetRatio((std::max)(0.0, budgetRatio)),
+      m_budget(InitialBudget),
+      m_nextSample(0),
+      m_requests(0),
+      m_hedges(0),
+      m_hedgesWon(0)
+{
+    m_samples.reserve(SampleCount);
+}
+
+void HedgePolicy::RecordFirstByte(std::chrono::milliseconds latency)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_samples.size() < SampleCount) {
+        m_samples.push_back(latency);
+    }
+    else {
+        m_samples[m_nextSample] = latency;
+    }
+    m_nextSample = (m_nextSample + 1) % SampleCount;
+}
+
+std::chrono::milliseconds HedgePolicy::Deadline() const
+{
+    std::vector<std::chrono::milliseconds> samples;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_samples.size() < MinSamples) {
+            return DefaultDeadline;
+        }
+        samples = m_samples;
+    }
+    
+    size_t rank = (std::min)(samples.size() - 1, static_cast<size_t>(m_percentile * samples.size()));
+    std::nth_element(samples.begin(), samples.begin() + rank, samples.end());
+    return (std::clamp)(samples[rank], MinDeadline, MaxDeadline);
+}
+
+void HedgePolicy::RecordRequest()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_requests++;
+    m_budget = (std::min)(MaxBudget, m_budget + m_budgetRatio);
+}
+
+bool HedgePolicy::TryHedge()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_budget < 1.0) {
+        return false;
+    }
+    
+    m_budget -= 1.0;
+    m_hedges++;
+    return true;
+}
+
+void HedgePolicy::RecordHedgeWon()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_hedgesWon++;
+}
+
+uint64_t HedgePolicy::Requests() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_requests;
+}
+
+uint64_t HedgePolicy::Hedges() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_hedges;
+}
+
+uint64_t HedgePolicy::HedgesWon() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_hedgesWon;
+}
\ No newline at end of file
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <mutex>
+#include <chrono>
+#include <vector>
+#include <cstdint>
+
+// Decides when a request is hedged: sent a second time because the first hasn't answered yet.
+//
+// A few requests for tiny files stall for seconds while the rest answer in milliseconds. When a
+// hedgeable request has no response by the deadline, which is a high percentile of the recent
+// first-byte times, a duplicate is sent and whichever answers first is used.
+//
+// Hedges are paid for from a budget shared by every request: each request earns a fraction of a
+// hedge, up to a small burst, so hedging can't add more than that fraction to the load on a server
+// that is slow for everyone.
+class HedgePolicy
+{
+public:
+    HedgePolicy(double percentile = 0.95, double budgetRatio = 0.1);
+    ~HedgePolicy() = default;
+
+    // Record how long a request took to its response headers
+    void RecordFirstByte(std::chrono::milliseconds latency);
+
+    // How long to wait for the response headers before hedging
+    std::chrono::milliseconds Deadline() const;
+
+    // Count a hedgeable request, adding its share to the budget
+    void RecordRequest();
+
+    // Take a hedge from the budget, returning false when the budget is spent
+    bool TryHedge();
+
+    // Count a hedge that answered before the request it duplicated
+    void RecordHedgeWon();
+
+    uint64_t Requests() const;
+    uint64_t Hedges() const;
+    uint64_t HedgesWon() const;
+
+private:
+    mutable std::mutex m_mutex;
+    double m_percentile;
+    double m_budgetRatio;
+    double m_budget;                                    // Hedges that may be sent now
+    std::vector<std::chrono::milliseconds> m_samples;   // Ring of recent first-byte times
+    size_t m_nextSample;
+    uint64_t m_requests;
+    uint64_t m_hedges;
+    uint64_t m_hedgesWon;
+};
\ No newline at end of file
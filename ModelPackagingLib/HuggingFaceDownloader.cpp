@@ -0,0 +1,1313 @@
+#include "HuggingFaceDownloader.h"
+#include "TraceRecorder.h"
+#include "HedgePolicy.h"
+#include "BandwidthLimiter.h"
+#include "DownloadSink.h"
+#include <wil/resource.h>
+#include <winerror.h> // For E_FAIL
+#include <winrt/Windows.Foundation.Collections.h>
+#include <winrt/Windows.Web.Http.Headers.h>
+#include <winrt/Windows.Storage.h>
+#include <winrt/Windows.Storage.FileProperties.h>
+#include <winrt/Windows.Data.Json.h>
+#include <winrt/Windows.System.Threading.h>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include <algorithm>
+#include <sstream>
+
+using namespace winrt;
+using namespace Windows::Foundation;
+using namespace Windows::Data::Json;
+using namespace Windows::Web::Http;
+using namespace Windows::Web::Http::Headers;
+using namespace Windows::Storage;
+using namespace Windows::Storage::Streams;
+using namespace Windows::System::Threading;
+
+namespace {
+    // HEAD requests in flight at once while planning
+    constexpr size_t ConcurrentSizeRequests = 8;
+
+    // A request or read that receives nothing for this long is cancelled and counted as a timeout
+    constexpr auto StallTimeout = std::chrono::seconds(30);
+    constexpr auto WatchdogPeriod = std::chrono::seconds(1);
+
+    // Bounds of the number of concurrent downloads the controller picks
+    constexpr unsigned MinConnections = 1;
+    constexpr unsigned MaxConnections = 16;
+
+    // Longest sleep between checks for cancellation while waiting to retry
+    constexpr auto RetryWaitSlice = std::chrono::seconds(1);
+
+    // Requests for files up to this size are hedged: the configurations and tokenizers of the
+    // priority lane, which packaging waits for and which stall as often as large files do
+    constexpr uint64_t HedgeFileLimit = DownloadPlan::PriorityFileLimit;
+
+    // Longest sleep of a bandwidth pause between watchdog and cancellation checks
+    constexpr auto BandwidthPauseSlice = std::chrono::milliseconds(1000);
+
+    std::wstring FormatRate(double bytesPerSecond)
+    {
+        std::wostringstream text;
+        text.setf(std::ios::fixed);
+        text.precision(1);
+        text << bytesPerSecond / (1024 * 1024) << L" MB/s";
+        return text.str();
+    }
+
+    // Where requests go: HF_ENDPOINT, which the Hugging Face libraries read too, lets a mirror or a
+    // local stand-in server take the place of huggingface.co. It may list several endpoints,
+    // separated by semicolons, to choose from and fail over between.
+    std::vector<std::wstring> EndpointsFromEnvironment()
+    {
+        return EndpointList::FromEnvironment(L"HF_ENDPOINT", L"https://huggingface.co");
+    }
+
+    // How long a response asks us to wait before trying again, zero if it doesn't say
+    std::chrono::milliseconds RetryAfter(const HttpResponseMessage& response)
+    {
+        auto retryAfter = response.Headers().RetryAfter();
+        if (!retryAfter) {
+            return std::chrono::milliseconds(0);
+        }
+        if (auto delta = retryAfter.Delta()) {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(delta.Value());
+        }
+        if (auto date = retryAfter.Date()) {
+            auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(date.Value() - winrt::clock::now());
+            return (std::max)(wait, std::chrono::milliseconds(0));
+        }
+        return std::chrono::milliseconds(0);
+    }
+
+    // Cancels the request or read in progress when nothing has arrived for the stall timeout. The
+    // timer runs on the thread pool, so a stalled connection doesn't need a thread of its own.
+    class TransferWatchdog
+    {
+    public:
+        TransferWatchdog() : m_state(std::make_shared<State>())
+        {
+            m_state->lastProgress = Now();
+            std::weak_ptr<State> weakState = m_state;
+            m_timer = ThreadPoolTimer::CreatePeriodicTimer([weakState](const ThreadPoolTimer&) {
+                if (auto state = weakState.lock()) {
+                    state->Check();
+                }
+            }, WatchdogPeriod);
+        }
+
+        ~TransferWatchdog()
+        {
+            m_timer.Cancel();
+        }
+
+        // Watch a pending request or read, restarting the stall clock
+        void Watch(const IAsyncInfo& operation)
+        {
+            std::lock_guard<std::mutex> lock(m_state->mutex);
+            m_state->operation = operation;
+            m_state->lastProgress = Now();
+        }
+
+        // Note that data arrived
+        void Progress()
+        {
+            m_state->lastProgress = Now();
+        }
+
+        bool TimedOut() const
+        {
+            return m_state->timedOut;
+        }
+
+    private:
+        static int64_t Now()
+        {
+            return std::chrono::steady_clock::now().time_since_epoch().count();
+        }
+
+        struct State
+        {
+            std::mutex mutex;
+            IAsyncInfo operation{ nullptr };
+            std::atomic<int64_t> lastProgress = 0;
+            std::atomic<bool> timedOut = false;
+
+            void Check()
+            {
+                auto idle = std::chrono::steady_clock::duration(Now() - lastProgress);
+                if (idle < StallTimeout || timedOut) {
+                    return;
+                }
+
+                std::lock_guard<std::mutex> lock(mutex);
+                timedOut = true;
+                if (operation) {
+                    operation.Cancel();
+                }
+            }
+        };
+
+        std::shared_ptr<State> m_state;
+        ThreadPoolTimer m_timer{ nullptr };
+    };
+
+    // Process-wide, so the hedge budget covers every download running in the process
+    HedgePolicy g_hedgePolicy;
+
+    // Copies of one request. The first copy to get a response wins and the others are
+    // cancelled; when every copy fails, the error of the first failure is reported.
+    class HedgedRequest : public std::enable_shared_from_this<HedgedRequest>
+    {
+    public:
+        HedgedRequest() : m_done(wil::EventOptions::ManualReset)
+        {
+        }
+
+        // Send a copy, unless an earlier one has already got a response or every one has failed
+        bool Send(const HttpClient& client, const HttpMethod& method, const Uri& uri)
+        {
+            // A request message can only be sent once, so each copy gets its own
+            auto started = std::chrono::steady_clock::now();
+            auto request = client.SendRequestAsync(HttpRequestMessage(method, uri), HttpCompletionOption::ResponseHeadersRead);
+
+            size_t index = 0;
+            bool sent = false;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                sent = !m_winner && (m_requests.empty() || m_pending > 0);
+                if (sent) {
+                    index = m_requests.size();
+                    m_requests.push_back(request);
+                    m_started.push_back(started);
+                    m_pending++;
+                }
+            }
+
+            if (!sent) {
+                request.Cancel();
+                return false;
+            }
+
+            // The handler may run right away if the request has already completed, so it is
+            // attached outside the lock
+            request.Completed([self = shared_from_this(), index](
+                const IAsyncOperationWithProgress<HttpResponseMessage, HttpProgress>& operation, AsyncStatus status) {
+                self->OnCompleted(index, operation, status);
+            });
+            return true;
+        }
+
+        // Resume when a copy has won or every copy has failed, or after the timeout if one is
+        // given; true when the wait ended before the timeout
+        auto WaitAsync(TimeSpan timeout = TimeSpan{ 0 })
+        {
+            return winrt::resume_on_signal(m_done.get(), timeout);
+        }
+
+        // Cancel every copy still pending
+        void Cancel()
+        {
+            std::vector<IAsyncOperationWithProgress<HttpResponseMessage, HttpProgress>> requests;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                requests = m_requests;
+            }
+
+            for (auto& request : requests) {
+                request.Cancel();
+            }
+        }
+
+        // The winning response with the copy it came from and the time from the first copy's send to
+        // the response headers, throwing when no copy got one
+        HttpResponseMessage Result(size_t& winner, std::chrono::milliseconds& firstByte)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_winner) {
+                if (m_error == S_OK) {
+                    throw winrt::hresult_canceled();
+                }
+                throw winrt::hresult_error(m_error);
+            }
+
+            winner = m_winnerIndex;
+            firstByte = m_firstByte;
+            return m_winner;
+        }
+
+    private:
+        void OnCompleted(size_t index, const IAsyncOperationWithProgress<HttpResponseMessage, HttpProgress>& operation, AsyncStatus status)
+        {
+            HttpResponseMessage late{ nullptr };
+            bool won = false;
+            bool finished = false;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_pending--;
+                if (status == AsyncStatus::Completed) {
+                    if (!m_winner) {
+                        m_winner = operation.GetResults();
+                        m_winnerIndex = index;
+                        
+                        // Timed from the first copy, so a hedge that wins doesn't leave out the
+                        // deadline already waited, which would pull the next deadline down
+                        m_firstByte = std::chrono::duration_cast<std::chrono::milliseconds>(
+                            std::chrono::steady_clock::now() - m_started.front());
+                        won = true;
+                    }
+                    else {
+                        late = operation.GetResults();
+                    }
+                }
+                else if (status == AsyncStatus::Error && m_error == S_OK) {
+                    m_error = operation.ErrorCode();
+                }
+                finished = m_winner || m_pending == 0;
+            }
+
+            // A loser that got its response anyway releases its connection
+            if (late) {
+                late.Close();
+            }
+            if (won) {
+                Cancel();
+            }
+            if (finished) {
+                m_done.SetEvent();
+            }
+        }
+
+        std::mutex m_mutex;
+        wil::unique_event m_done;
+        std::vector<IAsyncOperationWithProgress<HttpResponseMessage, HttpProgress>> m_requests;
+        std::vector<std::chrono::steady_clock::time_point> m_started;
+        size_t m_pending = 0;
+        HttpResponseMessage m_winner{ nullptr };
+        size_t m_winnerIndex = 0;
+        std::chrono::milliseconds m_firstByte{ 0 };
+        winrt::hresult m_error = S_OK;
+    };
+
+    // GET a small file or a listing, or HEAD a file for its size, sending a second copy of the
+    // request when the response headers haven't arrived by the hedge deadline and the hedge budget
+    // allows it. Cancelling the operation cancels every copy.
+    IAsyncOperation<HttpResponseMessage> HedgedSendAsync(HttpClient client, HttpMethod method, Uri uri, std::wstring name, Logger logger)
+    {
+        g_hedgePolicy.RecordRequest();
+        auto deadline = g_hedgePolicy.Deadline();
+        auto hedged = std::make_shared<HedgedRequest>();
+
+        auto cancellation = co_await winrt::get_cancellation_token();
+        cancellation.callback([hedged]() {
+            hedged->Cancel();
+        });
+
+        hedged->Send(client, method, uri);
+        if (!co_await hedged->WaitAsync(deadline) && g_hedgePolicy.TryHedge() && hedged->Send(client, method, uri)) {
+            logger.Verbose() << L"No response for " << name << L" after " << deadline.count() << L" ms; sending a hedged request";
+        }
+        co_await hedged->WaitAsync();
+
+        size_t winner = 0;
+        std::chrono::milliseconds firstByte{ 0 };
+        HttpResponseMessage response = hedged->Result(winner, firstByte);
+
+        g_hedgePolicy.RecordFirstByte(firstByte);
+        if (winner > 0) {
+            g_hedgePolicy.RecordHedgeWon();
+            logger.Verbose() << L"The hedged request for " << name << L" answered first, after " << firstByte.count() << L" ms";
+        }
+        co_return response;
+    }
+}
+
+// State shared by the lanes of one DownloadPlanAsync call
+struct HuggingFaceDownloader::DownloadRun
+{
+    DownloadRun(const DownloadPlan& plan, ProgressTracker* progressTracker, const Logger& logger)
+        : plan(plan),
+          schedule(plan),
+          controller(plan.connections, MinConnections, MaxConnections, logger),
+          progressTracker(progressTracker),
+          bandwidth(BandwidthLimiter::Instance().Join(plan.bandwidthWeight)),
+          started(std::chrono::steady_clock::now())
+    {
+    }
+
+    const DownloadPlan& plan;
+    DownloadSchedule schedule;
+    ConcurrencyController controller;
+    RetryPolicy retryPolicy;
+    ProgressTracker* progressTracker;
+
+    // The job's part of the process-wide bandwidth limit
+    std::shared_ptr<BandwidthShare> bandwidth;
+    std::chrono::steady_clock::time_point started;
+
+    // Every lane started, in order; DownloadPlanAsync awaits them all
+    std::mutex lanesMutex;
+    std::vector<IAsyncAction> lanes;
+    unsigned nextLane = 0;
+
+    // Files given up on, with their last error; one is enough for the run to fail, so no lane
+    // starts another file after it
+    std::mutex failuresMutex;
+    std::vector<std::wstring> failures;
+    std::atomic<bool> failed = false;
+};
+
+HuggingFaceDownloader::HuggingFaceDownloader()
+    : m_endpoints(EndpointsFromEnvironment()),
+      m_listingCache(ListingCache::DefaultFolder())
+{
+    // Set default headers
+    m_httpClient.DefaultRequestHeaders().UserAgent().Append(
+        HttpProductInfoHeaderValue(L"ModelPackagingTool", L"1.0"));
+}
+
+winrt::Windows::Foundation::IAsyncAction HuggingFaceDownloader::DownloadFileAsync(
+    const std::wstring& repoOwner,
+    const std::wstring& repoName,
+    const std::wstring& branch,
+    const std::wstring& filePath,
+    const fs::path& destinationPath,
+    ProgressTracker* progressTracker)
+{
+    if (m_cancellationToken.IsCancelled()) {
+        co_return;
+    }
+    co_await m_endpoints.ProbeAsync(m_httpClient);
+    
+    auto bandwidth = BandwidthLimiter::Instance().Join();
+    TransferOptions options;
+    options.bandwidth = bandwidth.get();
+    
+    // One entry for the file however many attempts it takes, finished when the last one ends
+    std::shared_ptr<TransferProgress> transfer = progressTracker ? progressTracker->BeginTransfer(GetFileName(filePath)) : nullptr;
+    auto completeTransfer = wil::scope_exit([&]() {
+        if (transfer) {
+            transfer->Complete();
+        }
+    });
+    options.progress = transfer.get();
+    
+    // Each endpoint gets one attempt, continuing the file where the one before stopped
+    std::vector<size_t> order = m_endpoints.Order();
+    for (size_t i = 0; i < order.size(); i++) {
+        TransferFailure failure;
+        options.endpoint = m_endpoints.Url(order[i]);
+        options.failure = &failure;
+        
+        try {
+            co_await TransferFileAsync(repoOwner, repoName, branch, filePath, destinationPath, options);
+            m_endpoints.ReportSuccess(order[i]);
+            co_return;
+        }
+        catch (const winrt::hresult_error& ex) {
+            if (failure.IsRetryable()) {
+                m_endpoints.ReportFailure(order[i]);
+            }
+            if (m_cancellationToken.IsCancelled() || failure.permanent || i + 1 == order.size()) {
+                throw;
+            }
+            m_logger.Warning() << L"Downloading " << filePath << L" from " << options.endpoint << L" failed ("
+                << ex.message().c_str() << L"); trying " << m_endpoints.Url(order[i + 1]);
+        }
+        
+        options.resumeFrom = failure.received;
+    }
+}
+
+winrt::Windows::Foundation::IAsyncAction HuggingFaceDownloader::TransferFileAsync(
+    const std::wstring& repoOwner,
+    const std::wstring& repoName,
+    const std::wstring& branch,
+    const std::wstring& filePath,
+    const fs::path& destinationPath,
+    const TransferOptions& options)
+{
+    TransferFailure* failure = options.failure;
+    TransferProgress* transfer = options.progress;
+    ConcurrencyController* controller = options.controller;
+    BandwidthShare* bandwidth = options.bandwidth;
+    
+    // Construct the download URL
+    std::wstring downloadUrl = BuildDownloadUrl(options.endpoint, repoOwner, repoName, branch, filePath);
+    
+    // Create URI from the URL
+    Uri uri(downloadUrl);
+    
+    // Ensure the directory exists
+    EnsureDirectoryExists(destinationPath);
+    
+    // Cancels the request or a read when the connection stalls
+    TransferWatchdog watchdog;
+    
+    // The transfer's time counts toward the throughput reported with and without the bandwidth limit
+    auto started = std::chrono::steady_clock::now();
+    auto countTransferTime = wil::scope_exit([&]() {
+        if (bandwidth) {
+            bandwidth->AddTransferTime(std::chrono::steady_clock::now() - started);
+        }
+    });
+    
+    // Continue the file an earlier attempt left, as long as it is on disk as that attempt left it
+    uint64_t resumeFrom = 0;
+    if (options.resumeFrom > 0) {
+        std::error_code error;
+        uint64_t existing = fs::file_size(destinationPath, error);
+        if (!error && existing == options.resumeFrom) {
+            resumeFrom = existing;
+        }
+    }
+    
+    // Set once this attempt has opened the file, so a file it never touched isn't taken for a partial one
+    bool opened = false;
+    
+    try
+    {
+        TraceSpan transferSpan("download", filePath);
+        
+        // Stream the response instead of buffering whole model files in memory
+        HttpResponseMessage response{ nullptr };
+        if (options.hedge && resumeFrom == 0) {
+            auto request = HedgedSendAsync(m_httpClient, HttpMethod::Get(), uri, filePath, m_logger);
+            watchdog.Watch(request);
+            response = co_await request;
+        }
+        else {
+            HttpRequestMessage request(HttpMethod::Get(), uri);
+            if (resumeFrom > 0) {
+                request.Headers().TryAppendWithoutValidation(L"Range", L"bytes=" + std::to_wstring(resumeFrom) + L"-");
+            }
+            
+            auto send = m_httpClient.SendRequestAsync(
+                request,
+                HttpCompletionOption::ResponseHeadersRead
+            );
+            watchdog.Watch(send);
+            response = co_await send;
+        }
+        
+        // Check if the request was successful, keeping what a retry needs to know
+        if (!response.IsSuccessStatusCode()) {
+            uint32_t status = static_cast<uint32_t>(response.StatusCode());
+            if (failure) {
+                failure->status = status;
+                failure->retryAfter = RetryAfter(response);
+            }
+            throw winrt::hresult_error(E_FAIL, L"HTTP " + std::to_wstring(status) + L" " + std::wstring(response.ReasonPhrase()));
+        }
+        
+        // 206 continues the file; a server that ignores the range sends all of it again with 200
+        bool appending = false;
+        if (resumeFrom > 0 && response.StatusCode() == HttpStatusCode::PartialContent) {
+            auto range = response.Content().Headers().ContentRange();
+            if (!range || !range.FirstBytePosition() || range.FirstBytePosition().Value() != resumeFrom) {
+                throw winrt::hresult_error(E_FAIL, L"The server answered with another range than the one asked for");
+            }
+            appending = true;
+            m_logger.Verbose() << L"Continuing " << filePath << L" from byte " << resumeFrom << L" at " << options.endpoint;
+        }
+        
+        // Get content length for progress reporting
+        uint64_t totalBytes = 0;
+        auto contentLengthHeader = response.Content().Headers().ContentLength();
+        if (contentLengthHeader) {
+            totalBytes = contentLengthHeader.Value();
+        }
+        
+        // The count starts from what is on disk, which is nothing unless the file is continued
+        uint64_t offset = appending ? resumeFrom : 0;
+        if (transfer) {
+            transfer->SetBytesReceived(offset);
+            if (totalBytes > 0) {
+                transfer->SetTotalBytes(offset + totalBytes);
+            }
+        }
+        
+        // Get the input stream from the response
+        auto inputStream = co_await response.Content().ReadAsInputStreamAsync();
+        
+        // The file gets its full size up front and the disk writes run behind the transfer
+        DownloadSink sink(m_logger);
+        sink.SetStoreWeights(options.storeWeights);
+        if (!sink.Open(destinationPath, offset, totalBytes > 0 ? offset + totalBytes : 0)) {
+            if (failure) {
+                failure->permanent = true;
+            }
+            throw winrt::hresult_error(HRESULT_FROM_WIN32(sink.LastError()), L"Failed to open file for writing");
+        }
+        opened = true;
+        
+        // Read data in chunks, counting each one for the progress sampler
+        const uint32_t bufferSize = 64 * 1024; // 64 KB buffer
+        Buffer buffer(bufferSize);
+        uint64_t bytesReceived = 0;
+        
+        while (true)
+        {
+            if (m_cancellationToken.IsCancelled()) {
+                co_return;
+            }
+            
+            auto read = inputStream.ReadAsync(buffer, bufferSize, InputStreamOptions::Partial);
+            watchdog.Watch(read);
+            auto chunk = co_await read;
+            if (chunk.Length() == 0) {
+                break;
+            }
+            
+            if (!sink.Write(chunk.data(), chunk.Length())) {
+                if (failure) {
+                    failure->permanent = true;
+                }
+                throw winrt::hresult_error(HRESULT_FROM_WIN32(sink.LastError()), L"Failed to write file");
+            }
+            
+            bytesReceived += chunk.Length();
+            watchdog.Progress();
+            if (transfer) {
+                transfer->AddBytes(chunk.Length());
+            }
+            if (controller) {
+                controller->AddBytes(chunk.Length());
+            }
+            
+            // Hold the next read back while the bandwidth limit is in debt; the chunk is already in
+            // the sink, and the unread data waits in the socket, so TCP slows the sender down
+            std::chrono::microseconds pause = bandwidth ? bandwidth->Consume(chunk.Length()) : std::chrono::microseconds(0);
+            while (pause.count() > 0 && !m_cancellationToken.IsCancelled()) {
+                auto slice = (std::min)(pause, std::chrono::duration_cast<std::chrono::microseconds>(BandwidthPauseSlice));
+                co_await winrt::resume_after(slice);
+                watchdog.Progress();
+                pause -= slice;
+            }
+        }
+        
+        if (!sink.Close()) {
+            if (failure) {
+                failure->permanent = true;
+            }
+            throw winrt::hresult_error(HRESULT_FROM_WIN32(sink.LastError()), L"Failed to write file");
+        }
+        
+        transferSpan.SetBytes(bytesReceived);
+    }
+    catch (const winrt::hresult_error& ex)
+    {
+        // If we've manually cancelled, just return
+        if (m_cancellationToken.IsCancelled()) {
+            co_return;
+        }
+        
+        // The sink was closed when the try block was left, so the file holds what arrived,
+        // or still holds what an earlier attempt left if this one failed before writing
+        if (failure && !failure->permanent && (opened || resumeFrom > 0)) {
+            std::error_code error;
+            uint64_t onDisk = fs::file_size(destinationPath, error);
+            failure->received = error ? 0 : onDisk;
+        }
+        
+        // A cancellation we didn't ask for is the watchdog giving up on a stalled connection
+        if (watchdog.TimedOut()) {
+            if (failure) {
+                failure->timedOut = true;
+            }
+            throw winrt::hresult_error(HRESULT_FROM_WIN32(ERROR_TIMEOUT), L"No data received for " +
+                std::to_wstring(std::chrono::seconds(StallTimeout).count()) + L" seconds");
+        }
+        
+        // Re-throw any other errors
+        throw ex;
+    }
+}
+
+// The tree listing is an array of entries such as
+// {"type":"file","oid":"...","size":1234,"path":"onnx/model.onnx","lfs":{...}}
+std::vector<HuggingFaceDownloader::RemoteFile> HuggingFaceDownloader::ParseJsonFilesResponse(
+    const std::string& jsonStr)
+{
+    std::vector<RemoteFile> files;
+    
+    JsonArray entries = JsonArray::Parse(winrt::to_hstring(jsonStr));
+    for (const auto& value : entries) {
+        if (value.ValueType() != JsonValueType::Object) {
+            continue;
+        }
+        
+        JsonObject entry = value.GetObject();
+        if (entry.GetNamedString(L"type", L"file") != L"file") {
+            continue;
+        }
+        
+        RemoteFile file;
+        file.path = entry.GetNamedString(L"path", L"");
+        file.sizeKnown = entry.HasKey(L"size");
+        file.size = static_cast<uint64_t>(entry.GetNamedNumber(L"size", 0));
+        if (!file.path.empty()) {
+            files.push_back(std::move(file));
+        }
+    }
+    
+    return files;
+}
+
+winrt::Windows::Foundation::IAsyncAction HuggingFaceDownloader::DownloadFolderAsync(
+    const std::wstring& repoOwner,
+    const std::wstring& repoName,
+    const std::wstring& branch,
+    const std::wstring& folderPath,
+    const fs::path& destinationFolder,
+    ProgressTracker* progressTracker,
+    DownloadFilter filter)
+{
+    DownloadPlan plan;
+    co_await PlanFolderAsync(repoOwner, repoName, branch, folderPath, destinationFolder, std::move(filter), plan);
+    co_await DownloadPlanAsync(plan, progressTracker);
+}
+
+winrt::Windows::Foundation::IAsyncAction HuggingFaceDownloader::PlanFolderAsync(
+    const std::wstring& repoOwner,
+    const std::wstring& repoName,
+    const std::wstring& branch,
+    const std::wstring& folderPath,
+    const fs::path& destinationFolder,
+    DownloadFilter filter,
+    DownloadPlan& plan)
+{
+    // Files go to a subfolder with the repository name
+    plan = DownloadPlan();
+    plan.repoOwner = repoOwner;
+    plan.repoName = repoName;
+    plan.branch = branch;
+    plan.destinationFolder = destinationFolder / repoName;
+    if (m_cancellationToken.IsCancelled()) {
+        co_return;
+    }
+    
+    // Clean up the folder path
+    std::wstring cleanFolderPath = folderPath;
+    
+    // Remove leading slash if present
+    if (!cleanFolderPath.empty() && cleanFolderPath[0] == L'/') {
+        cleanFolderPath = cleanFolderPath.substr(1);
+    }
+    
+    // Remove trailing slash if present
+    if (!cleanFolderPath.empty() && cleanFolderPath.back() == L'/') {
+        cleanFolderPath = cleanFolderPath.substr(0, cleanFolderPath.length() - 1);
+    }
+    
+    // Find the fastest endpoint before the first request
+    co_await m_endpoints.ProbeAsync(m_httpClient);
+    
+    // Pin the branch to a commit, so the listing can come from the disk cache and every file is
+    // fetched from the same commit
+    co_await ResolveCommitAsync(repoOwner, repoName, branch, plan.commit);
+    
+    // Create the API path to get the file list; every endpoint serves the same listing
+    // Format: https://huggingface.co/api/models/{owner}/{repo}/tree/{revision}/{path}
+    std::wstring apiPath = L"/api/models/";
+    apiPath += repoOwner + L"/" + repoName + L"/tree/" + plan.Revision();
+    
+    // Add folder path if it's not empty
+    if (!cleanFolderPath.empty()) {
+        apiPath += L"/" + cleanFolderPath;
+    }
+    
+    std::vector<RemoteFile> files;
+    
+    try {
+        std::string jsonStr;
+        
+        // A commit's listing never changes, so one stored by this or an earlier run is as good as a new
+        // one; a branch that couldn't be resolved is listed every time, since it may have moved
+        if (!plan.commit.empty() && m_listingCache.LoadListing(repoOwner, repoName, plan.commit, cleanFolderPath, jsonStr)) {
+            m_logger.Verbose() << L"Using the cached file list of commit " << plan.commit;
+        }
+        else {
+            TraceSpan listingSpan("listing", apiPath);
+            
+            // Make the HTTP request to get the file list
+            co_await GetListingAsync(apiPath, jsonStr);
+            listingSpan.SetBytes(jsonStr.size());
+            
+            if (!plan.commit.empty()) {
+                m_listingCache.StoreListing(repoOwner, repoName, plan.commit, cleanFolderPath, jsonStr);
+            }
+        }
+        
+        // Parse the JSON response to extract all files
+        files = ParseJsonFilesResponse(jsonStr);
+        
+        // Filter files to only include those directly in the specified folder
+        if (!cleanFolderPath.empty()) {
+            // This filtering logic ensures we only download files that are directly 
+            // in the specified folder, not in subfolders.
+            // For example, if folderPath is "onnx", we want files like "onnx/file.txt"
+            // but not files like "onnx/subfolder/file.txt"
+            std::wstring prefix = cleanFolderPath + L"/";
+            
+            std::vector<RemoteFile> filteredFiles;
+            for (auto& file : files) {
+                // Check if the path starts with the folder prefix
+                if (file.path.find(prefix) == 0) {
+                    // Extract the part after the prefix
+                    std::wstring relativePath = file.path.substr(prefix.length());
+                    
+                    // Only include files directly in this folder (no additional slashes)
+                    if (relativePath.find(L'/') == std::wstring::npos) {
+                        filteredFiles.push_back(std::move(file));
+                    }
+                }
+            }
+            
+            files = std::move(filteredFiles);
+        }
+    }
+    catch (const winrt::hresult_error& ex) {
+        m_logger.Error() << L"Error fetching file list: " << ex.message().c_str();
+        throw;
+    }
+    
+    if (files.empty()) {
+        m_logger.Info() << L"No files found in the specified folder path.";
+        co_return;
+    }
+    
+    // Apply the allow and ignore patterns to the paths relative to the folder, before anything
+    // is downloaded
+    if (!filter.IsEmpty()) {
+        std::vector<RemoteFile> keptFiles;
+        uint64_t keptBytes = 0;
+        uint64_t skippedFiles = 0;
+        uint64_t skippedBytes = 0;
+        
+        for (auto& file : files) {
+            std::wstring relativePath = cleanFolderPath.empty() ? file.path : file.path.substr(cleanFolderPath.length() + 1);
+            if (filter.Allows(relativePath)) {
+                keptBytes += file.size;
+                keptFiles.push_back(std::move(file));
+            }
+            else {
+                m_logger.Verbose() << L"Skipping: " << file.path << L" (" << file.size << L" bytes)";
+                skippedFiles++;
+                skippedBytes += file.size;
+            }
+        }
+        
+        m_logger.Info() << L"The download filter keeps " << keptFiles.size() << L" of " << files.size() << L" files ("
+            << keptBytes << L" bytes), skipping " << skippedFiles << L" (" << skippedBytes << L" bytes)";
+        
+        files = std::move(keptFiles);
+        if (files.empty()) {
+            m_logger.Info() << L"No files in the specified folder path pass the download filter.";
+            co_return;
+        }
+    }
+    
+    for (auto& file : files) {
+        PlannedFile planned;
+        planned.destination = plan.destinationFolder / fs::path(file.path).filename();
+        planned.path = std::move(file.path);
+        planned.size = file.size;
+        planned.sizeKnown = file.sizeKnown;
+        plan.files.push_back(std::move(planned));
+    }
+    
+    co_await FetchSizesAsync(plan);
+    plan.Schedule();
+}
+
+winrt::Windows::Foundation::IAsyncAction HuggingFaceDownloader::ResolveCommitAsync(
+    const std::wstring& repoOwner,
+    const std::wstring& repoName,
+    const std::wstring& branch,
+    std::wstring& commit)
+{
+    commit.clear();
+    
+    // A commit needs no resolving
+    if (ListingCache::IsCommit(branch)) {
+        commit = branch;
+        co_return;
+    }
+    
+    CachedRef cachedRef;
+    bool haveCachedRef = m_listingCache.LoadRef(repoOwner, repoName, branch, cachedRef);
+    
+    // Format: https://huggingface.co/api/models/{owner}/{repo}/revision/{branch}?expand=sha
+    // Only the commit is asked for, which keeps the response small
+    std::wstring path = L"/api/models/" + repoOwner + L"/" + repoName + L"/revision/" +
+        std::wstring(Uri::EscapeComponent(branch)) + L"?expand=sha";
+    
+    TraceSpan resolveSpan("listing", L"Resolve " + branch);
+    
+    // A mirror may not resolve branches, so each endpoint is asked in turn until one does
+    std::wstring error;
+    for (size_t endpoint : m_endpoints.Order()) {
+        HttpRequestMessage request(HttpMethod::Get(), Uri(m_endpoints.Url(endpoint) + path));
+        if (haveCachedRef && !cachedRef.etag.empty()) {
+            request.Headers().TryAppendWithoutValidation(L"If-None-Match", cachedRef.etag);
+        }
+        
+        TransferWatchdog watchdog;
+        TransferFailure failure;
+        
+        try {
+            auto send = m_httpClient.SendRequestAsync(request);
+            watchdog.Watch(send);
+            auto response = co_await send;
+            
+            // The branch hasn't moved since the last run
+            if (response.StatusCode() == HttpStatusCode::NotModified && haveCachedRef) {
+                commit = cachedRef.commit;
+                m_endpoints.ReportSuccess(endpoint);
+                m_logger.Verbose() << L"Branch " << branch << L" is still at commit " << commit;
+                co_return;
+            }
+            
+            if (!response.IsSuccessStatusCode()) {
+                failure.status = static_cast<uint32_t>(response.StatusCode());
+                throw winrt::hresult_error(E_FAIL, L"HTTP " + std::to_wstring(failure.status) + L" " + std::wstring(response.ReasonPhrase()));
+            }
+            
+            auto read = response.Content().ReadAsStringAsync();
+            watchdog.Watch(read);
+            JsonObject info = JsonObject::Parse(co_await read);
+            
+            std::wstring sha(info.GetNamedString(L"sha", L""));
+            if (!ListingCache::IsCommit(sha)) {
+                throw winrt::hresult_error(E_FAIL, L"The response names no commit");
+            }
+            
+            CachedRef resolved;
+            resolved.commit = sha;
+            if (response.Headers().HasKey(L"ETag")) {
+                resolved.etag = response.Headers().Lookup(L"ETag");
+            }
+            m_listingCache.StoreRef(repoOwner, repoName, branch, resolved);
+            m_endpoints.ReportSuccess(endpoint);
+            
+            commit = sha;
+            m_logger.Verbose() << L"Branch " << branch << L" is at commit " << commit;
+            co_return;
+        }
+        catch (const winrt::hresult_error& ex) {
+            error = ex.message().c_str();
+            failure.timedOut = watchdog.TimedOut();
+        }
+        
+        if (m_cancellationToken.IsCancelled()) {
+            co_return;
+        }
+        if (failure.IsRetryable()) {
+            m_endpoints.ReportFailure(endpoint);
+        }
+    }
+    
+    // Offline or behind mirrors that can't resolve branches: the last known commit keeps the run
+    // reproducible, and without one the branch is listed as before
+    if (haveCachedRef) {
+        commit = cachedRef.commit;
+        m_logger.Warning() << L"Could not resolve branch " << branch << L" (" << error << L"); using commit "
+            << commit << L" from the last run";
+    }
+    else {
+        m_logger.Verbose() << L"Could not resolve branch " << branch << L" to a commit (" << error << L"); listing the branch";
+    }
+}
+
+winrt::Windows::Foundation::IAsyncAction HuggingFaceDownloader::FetchSizesAsync(DownloadPlan& plan)
+{
+    std::vector<size_t> unknown;
+    for (size_t i = 0; i < plan.files.size(); i++) {
+        if (!plan.files[i].sizeKnown) {
+            unknown.push_back(i);
+        }
+    }
+    
+    if (unknown.empty()) {
+        co_return;
+    }
+    
+    m_logger.Verbose() << L"Requesting the sizes of " << unknown.size() << L" files the listing didn't report";
+    
+    // A size that can't be had is only a gap in the plan, so the sizes are asked of one endpoint
+    std::wstring endpoint = m_endpoints.Url(m_endpoints.Order().front());
+    
+    // A batch of HEAD requests is in flight at a time, so a folder of thousands of files doesn't
+    // open thousands of connections. They are hedged like the other small requests, and each has a
+    // watchdog, so a server that never answers one doesn't hold up the plan.
+    for (size_t start = 0; start < unknown.size() && !m_cancellationToken.IsCancelled(); start += ConcurrentSizeRequests) {
+        size_t end = (std::min)(unknown.size(), start + ConcurrentSizeRequests);
+        TraceSpan sizeSpan("listing", L"Sizes of " + std::to_wstring(end - start) + L" files");
+        
+        std::vector<IAsyncOperation<HttpResponseMessage>> requests;
+        std::vector<std::unique_ptr<TransferWatchdog>> watchdogs;
+        for (size_t i = start; i < end; i++) {
+            const PlannedFile& file = plan.files[unknown[i]];
+            Uri uri(BuildDownloadUrl(endpoint, plan.repoOwner, plan.repoName, plan.Revision(), file.path));
+            requests.push_back(HedgedSendAsync(m_httpClient, HttpMethod::Head(), uri, L"the size of " + file.path, m_logger));
+            watchdogs.push_back(std::make_unique<TransferWatchdog>());
+            watchdogs.back()->Watch(requests.back());
+        }
+        
+        for (size_t i = start; i < end; i++) {
+            PlannedFile& file = plan.files[unknown[i]];
+            try {
+                auto response = co_await requests[i - start];
+                auto contentLength = response.Content().Headers().ContentLength();
+                if (response.IsSuccessStatusCode() && contentLength) {
+                    file.size = contentLength.Value();
+                    file.sizeKnown = true;
+                }
+            }
+            catch (const winrt::hresult_error& ex) {
+                if (watchdogs[i - start]->TimedOut()) {
+                    m_logger.Warning() << L"Could not get the size of " << file.path << L": no response for "
+                                       << std::chrono::seconds(StallTimeout).count() << L" seconds";
+                }
+                else {
+                    m_logger.Warning() << L"Could not get the size of " << file.path << L": " << ex.message().c_str();
+                }
+            }
+        }
+    }
+}
+
+winrt::Windows::Foundation::IAsyncAction HuggingFaceDownloader::DownloadPlanAsync(
+    const DownloadPlan& plan,
+    ProgressTracker* progressTracker)
+{
+    if (plan.files.empty() || m_cancellationToken.IsCancelled()) {
+        co_return;
+    }
+    
+    // Ensure the destination folder exists
+    if (!fs::exists(plan.destinationFolder)) {
+        fs::create_directories(plan.destinationFolder);
+    }
+    
+    DownloadRun run(plan, progressTracker, m_logger);
+    StartLanes(run);
+    
+    // Lanes start more lanes while the controller allows it, but always before they finish, so
+    // every lane is in the list by the time the ones before it have been awaited
+    for (size_t i = 0;; i++) {
+        IAsyncAction lane{ nullptr };
+        {
+            std::lock_guard<std::mutex> lock(run.lanesMutex);
+            if (i >= run.lanes.size()) {
+                break;
+            }
+            lane = run.lanes[i];
+        }
+        
+        co_await lane;
+    }
+    
+    // A missing file would only make a package without it, so the run fails instead
+    if (run.failed && !m_cancellationToken.IsCancelled()) {
+        std::lock_guard<std::mutex> lock(run.failuresMutex);
+        throw winrt::hresult_error(E_FAIL, L"Failed to download " + std::to_wstring(run.failures.size()) + L" of " +
+            std::to_wstring(plan.files.size()) + L" files; the first was " + run.failures.front());
+    }
+    
+    m_logger.Verbose() << L"Downloaded with up to " << run.controller.PeakLimit() << L" concurrent transfers";
+    
+    // Report what the limit cost: the throughput the job got, and what its transfers achieved while
+    // they weren't paused, which is about what it would have got without the limit
+    BandwidthStats stats = run.bandwidth->Stats();
+    double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - run.started).count();
+    double bytesPerSecond = wallSeconds > 0 ? stats.bytes / wallSeconds : 0;
+    if (BandwidthLimiter::Instance().Limit() > 0) {
+        double throttledShare = stats.transferSeconds > 0 ? stats.throttledSeconds / stats.transferSeconds : 0;
+        m_logger.Info() << L"Downloaded at " << FormatRate(bytesPerSecond) << L" with the bandwidth limit of "
+            << FormatRate(static_cast<double>(BandwidthLimiter::Instance().Limit())) << L" (paused for "
+            << static_cast<int>(throttledShare * 100) << L"% of the transfer time); about "
+            << FormatRate(stats.UnthrottledBytesPerSecond(wallSeconds)) << L" without it";
+    }
+    else {
+        m_logger.Verbose() << L"Downloaded at " << FormatRate(bytesPerSecond);
+    }
+    if (g_hedgePolicy.Hedges() > 0) {
+        m_logger.Verbose() << L"Hedged " << g_hedgePolicy.Hedges() << L" of " << g_hedgePolicy.Requests()
+            << L" small requests in this process; " << g_hedgePolicy.HedgesWon() << L" answered first";
+    }
+}
+
+void HuggingFaceDownloader::StartLanes(DownloadRun& run)
+{
+    while (!m_cancellationToken.IsCancelled() && !run.failed && run.schedule.Remaining() > 0 && run.controller.TryAddLane()) {
+        unsigned lane = 0;
+        {
+            std::lock_guard<std::mutex> lock(run.lanesMutex);
+            lane = run.nextLane++;
+        }
+        
+        // The lane runs until its first request is sent before this returns, so it is started
+        // outside the lock
+        IAsyncAction action = RunLaneAsync(run, lane);
+        
+        std::lock_guard<std::mutex> lock(run.lanesMutex);
+        run.lanes.push_back(action);
+    }
+}
+
+winrt::Windows::Foundation::IAsyncAction HuggingFaceDownloader::RunLaneAsync(
+    DownloadRun& run,
+    unsigned lane)
+{
+    size_t index = 0;
+    while (!m_cancellationToken.IsCancelled() && !run.failed) {
+        // The priority lane always stays; the others stop when the controller has lowered the limit
+        if (lane != 0 && run.controller.ShouldRemoveLane()) {
+            co_return;
+        }
+        
+        if (!run.schedule.Next(lane, index)) {
+            break;
+        }
+        
+        co_await DownloadWithRetriesAsync(run, run.plan.files[index]);
+        
+        run.controller.Update();
+        StartLanes(run);
+    }
+    
+    run.controller.RemoveLane();
+}
+
+winrt::Windows::Foundation::IAsyncAction HuggingFaceDownloader::DownloadWithRetriesAsync(
+    DownloadRun& run,
+    const PlannedFile& file)
+{
+    m_logger.Info() << L"Downloading: " << file.path << L" to " << file.destination.wstring();
+    
+    TransferOptions options;
+    options.controller = &run.controller;
+    options.bandwidth = run.bandwidth.get();
+    options.hedge = file.sizeKnown && file.size <= HedgeFileLimit;
+    options.storeWeights = run.plan.storeWeights;
+    
+    // One entry for the file however many attempts it takes, finished when it is done or given up
+    std::shared_ptr<TransferProgress> transfer = run.progressTracker
+        ? run.progressTracker->BeginTransfer(GetFileName(file.path), file.sizeKnown ? file.size : 0)
+        : nullptr;
+    auto completeTransfer = wil::scope_exit([&]() {
+        if (transfer) {
+            transfer->Complete();
+        }
+    });
+    options.progress = transfer.get();
+    
+    // A failure moves on to the next endpoint right away; once every endpoint has failed, the
+    // retry waits out the backoff and starts over with the best one
+    std::vector<size_t> order = m_endpoints.Order();
+    size_t next = 0;
+    unsigned attempt = 1;
+    
+    while (!m_cancellationToken.IsCancelled()) {
+        size_t endpoint = order[next];
+        TransferFailure failure;
+        std::wstring error;
+        options.endpoint = m_endpoints.Url(endpoint);
+        options.failure = &failure;
+        
+        try {
+            co_await TransferFileAsync(
+                run.plan.repoOwner,
+                run.plan.repoName,
+                run.plan.Revision(),
+                file.path,
+                file.destination,
+                options
+            );
+            m_endpoints.ReportSuccess(endpoint);
+            co_return;
+        }
+        catch (const winrt::hresult_error& ex) {
+            error = ex.message().c_str();
+        }
+        
+        if (m_cancellationToken.IsCancelled()) {
+            co_return;
+        }
+        
+        if (failure.IsCongestion()) {
+            run.controller.OnCongestion();
+        }
+        if (failure.IsRetryable()) {
+            m_endpoints.ReportFailure(endpoint);
+        }
+        
+        // Keep what arrived, unless it is the whole file and only the end of the response failed
+        options.resumeFrom = (file.sizeKnown && failure.received >= file.size) ? 0 : failure.received;
+        
+        // A mirror that lacks the file or has failed is no reason to give up while another remains
+        if (!failure.permanent && next + 1 < order.size()) {
+            next++;
+            m_logger.Warning() << L"Downloading " << file.path << L" from " << options.endpoint << L" failed ("
+                << failure.Describe() << L"), continuing at " << m_endpoints.Url(order[next])
+                << (options.resumeFrom > 0 ? L" from byte " + std::to_wstring(options.resumeFrom) : std::wstring());
+            continue;
+        }
+        
+        if (!run.retryPolicy.ShouldRetry(attempt, failure)) {
+            m_logger.Error() << L"Error downloading file " << file.path << L": " << error;
+            
+            // What arrived is kept only to be continued, so a file given up on is not left truncated
+            std::error_code removeError;
+            fs::remove(file.destination, removeError);
+            
+            std::lock_guard<std::mutex> lock(run.failuresMutex);
+            run.failures.push_back(file.path + L" (" + error + L")");
+            run.failed = true;
+            co_return;
+        }
+        
+        auto delay = run.retryPolicy.Delay(attempt, failure);
+        m_logger.Warning() << L"Downloading " << file.path << L" failed (" << failure.Describe() << L"), retrying in "
+            << delay.count() << L" ms (attempt " << attempt + 1 << L" of " << run.retryPolicy.MaxAttempts() << L")";
+        co_await WaitForRetryAsync(delay);
+        
+        attempt++;
+        order = m_endpoints.Order();
+        next = 0;
+    }
+}
+
+winrt::Windows::Foundation::IAsyncAction HuggingFaceDownloader::GetListingAsync(
+    const std::wstring& apiPath,
+    std::string& json)
+{
+    RetryPolicy retryPolicy;
+    std::vector<size_t> order = m_endpoints.Order();
+    size_t next = 0;
+    
+    for (unsigned attempt = 1;;) {
+        size_t endpoint = order[next];
+        TransferFailure failure;
+        TransferWatchdog watchdog;
+        
+        try {
+            auto request = HedgedSendAsync(m_httpClient, HttpMethod::Get(), Uri(m_endpoints.Url(endpoint) + apiPath), L"the file list", m_logger);
+            watchdog.Watch(request);
+            auto response = co_await request;
+            
+            if (!response.IsSuccessStatusCode()) {
+                failure.status = static_cast<uint32_t>(response.StatusCode());
+                failure.retryAfter = RetryAfter(response);
+                throw winrt::hresult_error(E_FAIL, L"HTTP " + std::to_wstring(failure.status) + L" " + std::wstring(response.ReasonPhrase()));
+            }
+            
+            // Get the JSON content as a string
+            auto read = response.Content().ReadAsStringAsync();
+            watchdog.Watch(read);
+            json = winrt::to_string(co_await read);
+            m_endpoints.ReportSuccess(endpoint);
+            co_return;
+        }
+        catch (const winrt::hresult_error&) {
+            failure.timedOut = watchdog.TimedOut();
+            if (failure.IsRetryable()) {
+                m_endpoints.ReportFailure(endpoint);
+            }
+            if (m_cancellationToken.IsCancelled() || (next + 1 == order.size() && !retryPolicy.ShouldRetry(attempt, failure))) {
+                throw;
+            }
+        }
+        
+        if (next + 1 < order.size()) {
+            next++;
+            m_logger.Warning() << L"Fetching the file list failed (" << failure.Describe() << L"), trying "
+                << m_endpoints.Url(order[next]);
+            continue;
+        }
+        
+        auto delay = retryPolicy.Delay(attempt, failure);
+        m_logger.Warning() << L"Fetching the file list failed (" << failure.Describe() << L"), retrying in "
+            << delay.count() << L" ms (attempt " << attempt + 1 << L" of " << retryPolicy.MaxAttempts() << L")";
+        co_await WaitForRetryAsync(delay);
+        
+        attempt++;
+        order = m_endpoints.Order();
+        next = 0;
+    }
+}
+
+winrt::Windows::Foundation::IAsyncAction HuggingFaceDownloader::WaitForRetryAsync(std::chrono::milliseconds delay)
+{
+    // Sleep on the thread pool in slices, so a cancellation doesn't wait out a long Retry-After
+    while (delay.count() > 0 && !m_cancellationToken.IsCancelled()) {
+        auto slice = (std::min)(delay, std::chrono::duration_cast<std::chrono::milliseconds>(RetryWaitSlice));
+        co_await winrt::resume_after(slice);
+        delay -= slice;
+    }
+}
+
+void HuggingFaceDownloader::CancelDownloads()
+{
+    m_cancellationToken.Cancel();
+}
+
+void HuggingFaceDownloader::SetCancellationToken(CancellationToken cancellationToken)
+{
+    m_cancellationToken = std::move(cancellationToken);
+}
+
+std::wstring HuggingFaceDownloader::BuildDownloadUrl(
+    const std::wstring& endpoint,
+    const std::wstring& repoOwner,
+    const std::wstring& repoName,
+    const std::wstring& branch,
+    const std::wstring& filePath)
+{
+    // Format: https://huggingface.co/{owner}/{repo}/resolve/{branch}/{path}
+    std::wstring url = endpoint + L"/";
+    url += repoOwner + L"/" + repoName + L"/resolve/" + branch + L"/";
+    
+    // Remove leading slash if present
+    std::wstring path = filePath;
+    if (!path.empty() && path[0] == L'/') {
+        path = path.substr(1);
+    }
+    
+    url += path;
+    return url;
+}
+
+void HuggingFaceDownloader::EnsureDirectoryExists(const fs::path& filePath)
+{
+    auto directory = filePath.parent_path();
+    if (!fs::exists(directory)) {
+        fs::create_directories(directory);
+    }
+}
+
+std::wstring HuggingFaceDownloader::GetFileName(const std::wstring& filePath)
+{
+    size_t pos = filePath.find_last_of(L"/\\");
+    if (pos != std::wstring::npos) {
+        return filePath.substr(pos + 1);
+    }
+    return filePath;
+}
+
+void HuggingFaceDownloader::SetLogger(Logger logger)
+{
+    m_listingCache.SetLogger(logger);
+    m_endpoints.SetLogger(logger);
+    m_logger = std::move(logger);
+}
+
+void HuggingFaceDownloader::SetEndpoints(std::vector<std::wstring> endpoints)
+{
+    m_endpoints.Set(endpoints.empty() ? EndpointsFromEnvironment() : std::move(endpoints));
+}
\ No newline at end of file
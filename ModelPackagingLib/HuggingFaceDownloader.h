@@ -0,0 +1,190 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <atomic>
+#include <winrt/base.h>
+#include <winrt/Windows.Foundation.h>
+#include <winrt/Windows.Web.Http.h>
+#include <winrt/Windows.Storage.Streams.h>
+#include "Logger.h"
+#include "CancellationToken.h"
+#include "ProgressTracker.h"
+#include "DownloadFilter.h"
+#include "DownloadPlan.h"
+#include "RetryPolicy.h"
+#include "ConcurrencyController.h"
+#include "BandwidthLimiter.h"
+#include "ListingCache.h"
+#include "EndpointList.h"
+
+namespace fs = std::filesystem;
+
+class HuggingFaceDownloader
+{
+public:
+    // A file in a repository folder listing
+    struct RemoteFile
+    {
+        std::wstring path;      // Path in the repository, with / separators
+        uint64_t size = 0;      // Size in bytes as the listing reports it
+        bool sizeKnown = false; // The listing has a size for the file
+    };
+
+    HuggingFaceDownloader();
+    ~HuggingFaceDownloader() = default;
+
+    // Download a single file from HuggingFace, moving on to the next endpoint when one fails
+    winrt::Windows::Foundation::IAsyncAction DownloadFileAsync(
+        const std::wstring& repoOwner,
+        const std::wstring& repoName,
+        const std::wstring& branch,
+        const std::wstring& filePath,
+        const fs::path& destinationPath,
+        ProgressTracker* progressTracker = nullptr);
+
+    // Download the files of a HuggingFace folder that pass the filter. The filter is applied to
+    // the folder listing, so skipped files are never requested.
+    winrt::Windows::Foundation::IAsyncAction DownloadFolderAsync(
+        const std::wstring& repoOwner,
+        const std::wstring& repoName,
+        const std::wstring& branch,
+        const std::wstring& folderPath,
+        const fs::path& destinationFolder,
+        ProgressTracker* progressTracker = nullptr,
+        DownloadFilter filter = DownloadFilter());
+
+    // List a HuggingFace folder, apply the filter, and find the size of every file to download and
+    // the order to fetch them in, without downloading anything. The branch is resolved to a commit
+    // first (plan.commit), and listings are cached on disk per commit. With several endpoints, they
+    // are probed first and the fastest is used.
+    winrt::Windows::Foundation::IAsyncAction PlanFolderAsync(
+        const std::wstring& repoOwner,
+        const std::wstring& repoName,
+        const std::wstring& branch,
+        const std::wstring& folderPath,
+        const fs::path& destinationFolder,
+        DownloadFilter filter,
+        DownloadPlan& plan);
+
+    // Download the files of a plan in the plan's order. The number of files downloaded at once starts
+    // at plan.connections and is adjusted to the throughput and to the server pushing back, and failed
+    // transfers are retried with backoff. A transfer that fails partway continues at the next
+    // endpoint with a Range request for the rest. The files share the process-wide bandwidth limit
+    // with the plan's weight. A cancelled token stops it, whether it was cancelled before or during the
+    // download. Throws when a file still fails after its retries, once the transfers already running
+    // have ended.
+    winrt::Windows::Foundation::IAsyncAction DownloadPlanAsync(
+        const DownloadPlan& plan,
+        ProgressTracker* progressTracker = nullptr);
+
+    // Cancel the downloads of the current cancellation token, running or yet to start; a new token is
+    // needed to download again
+    void CancelDownloads();
+
+    // Stop downloads when this token is cancelled, including ones started after it was
+    void SetCancellationToken(CancellationToken cancellationToken);
+
+    // Route status and error messages to the given logger
+    void SetLogger(Logger logger);
+
+    // Base URLs to download from, in order of preference; an empty list restores the ones HF_ENDPOINT
+    // names, or https://huggingface.co
+    void SetEndpoints(std::vector<std::wstring> endpoints);
+
+private:
+    struct DownloadRun;
+
+    // How TransferFileAsync sends its request and what it reports
+    struct TransferOptions
+    {
+        std::wstring endpoint;                          // Base URL to request the file from
+        uint64_t resumeFrom = 0;                        // Bytes on disk from an earlier attempt; the rest is asked for with a Range request
+        TransferFailure* failure = nullptr;             // Filled in on failure for the retry decision
+        ConcurrencyController* controller = nullptr;    // Counts the received bytes
+        BandwidthShare* bandwidth = nullptr;            // Reads pause as the share asks
+        TransferProgress* progress = nullptr;           // The file's counters for the progress sampler, shared by its attempts
+        bool hedge = false;                             // A slow request is duplicated as the hedge policy allows
+        bool storeWeights = false;                      // The package stores weights, so the sink hashes them
+    };
+
+    // Download a single file from options.endpoint
+    winrt::Windows::Foundation::IAsyncAction TransferFileAsync(
+        const std::wstring& repoOwner,
+        const std::wstring& repoName,
+        const std::wstring& branch,
+        const std::wstring& filePath,
+        const fs::path& destinationPath,
+        const TransferOptions& options);
+
+    // Fetch a folder listing from the API path given, hedging a slow request, moving on to the next
+    // endpoint when one fails and retrying failures that may go away
+    winrt::Windows::Foundation::IAsyncAction GetListingAsync(
+        const std::wstring& apiPath,
+        std::string& json);
+
+    // Resolve a branch to its commit, revalidating the one cached by an earlier run with its ETag.
+    // Leaves commit empty when the branch can't be resolved and no earlier run resolved it.
+    winrt::Windows::Foundation::IAsyncAction ResolveCommitAsync(
+        const std::wstring& repoOwner,
+        const std::wstring& repoName,
+        const std::wstring& branch,
+        std::wstring& commit);
+
+    // Ask for the sizes the listing didn't give with HEAD requests
+    winrt::Windows::Foundation::IAsyncAction FetchSizesAsync(DownloadPlan& plan);
+
+    // Start lanes until the running ones reach the controller's limit or no files are left
+    void StartLanes(DownloadRun& run);
+
+    // Download the files the schedule hands to one lane until none are left or the lane is retired
+    winrt::Windows::Foundation::IAsyncAction RunLaneAsync(
+        DownloadRun& run,
+        unsigned lane);
+
+    // Download a planned file, retrying as the retry policy allows; a file that still fails is deleted
+    // and recorded on the run, which then starts no more files and fails
+    winrt::Windows::Foundation::IAsyncAction DownloadWithRetriesAsync(
+        DownloadRun& run,
+        const PlannedFile& file);
+
+    // Wait before a retry, returning early on cancellation
+    winrt::Windows::Foundation::IAsyncAction WaitForRetryAsync(std::chrono::milliseconds delay);
+
+    // Parse a tree listing into its files, leaving out folder entries
+    std::vector<RemoteFile> ParseJsonFilesResponse(
+        const std::string& jsonStr);
+
+    // Build a download URL for a file in a HuggingFace repo at an endpoint
+    std::wstring BuildDownloadUrl(
+        const std::wstring& endpoint,
+        const std::wstring& repoOwner,
+        const std::wstring& repoName,
+        const std::wstring& branch,
+        const std::wstring& filePath);
+
+    // Create necessary directories for a file path
+    void EnsureDirectoryExists(const fs::path& filePath);
+
+    // Extract file name from path
+    std::wstring GetFileName(const std::wstring& filePath);
+
+    // Http client for making requests
+    winrt::Windows::Web::Http::HttpClient m_httpClient;
+    
+    // Cancelled from other threads
+    CancellationToken m_cancellationToken;
+
+    // Destination for status and error messages
+    Logger m_logger;
+
+    // Base URLs of the hub, https://huggingface.co unless HF_ENDPOINT or SetEndpoints says otherwise
+    EndpointList m_endpoints;
+
+    // Branch resolutions and per-commit listings kept between runs
+    ListingCache m_listingCache;
+};
\ No newline at end of file
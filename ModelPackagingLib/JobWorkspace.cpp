@@ -0,0 +1,281 @@
+#include "JobWorkspace.h"
+#include <atomic>
+#include <set>
+#include <vector>
+#include <Windows.h>
+
+namespace {
+    constexpr wchar_t TrashFolderName[] = L".trash";
+
+    // Move a folder into the trash folder of its root, which frees its name at once. Returns where the
+    // folder is now: a folder that can't be moved, because a file in it is still open, stays where it is.
+    fs::path MoveToTrash(const fs::path& folder)
+    {
+        std::error_code error;
+        fs::path trash = folder.parent_path() / TrashFolderName;
+        fs::create_directory(trash, error);
+        fs::path target = trash / folder.filename();
+        fs::rename(folder, target, error);
+        return error ? folder : target;
+    }
+
+    bool IsInTrash(const fs::path& folder)
+    {
+        return folder.parent_path().filename() == TrashFolderName;
+    }
+
+    // Start a process that empties the trash folder of a root and runs on after this one exits. It
+    // starts in the root and names the trash folder relatively, so no path goes through cmd.exe's
+    // parser, which would expand the % and ^ of a folder name.
+    void StartCleanerProcess(const fs::path& root)
+    {
+        wchar_t systemFolder[MAX_PATH] = {};
+        if (GetSystemDirectoryW(systemFolder, MAX_PATH) == 0) {
+            return;
+        }
+        
+        std::wstring commandLine = L"\"" + (fs::path(systemFolder) / L"cmd.exe").wstring() + L"\" /d /c rd /s /q " + TrashFolderName;
+        STARTUPINFOW startupInfo = {};
+        startupInfo.cb = sizeof(startupInfo);
+        wil::unique_process_information processInfo;
+        
+        // A console of its own, never shown, so closing or interrupting the tool's console doesn't stop it
+        CreateProcessW(nullptr, commandLine.data(), nullptr, nullptr, FALSE,
+            CREATE_NO_WINDOW | CREATE_NEW_PROCESS_GROUP | BELOW_NORMAL_PRIORITY_CLASS,
+            nullptr, root.c_str(), &startupInfo, &processInfo);
+    }
+}
+
+JobWorkspace::JobWorkspace(Logger logger)
+    : m_logger(std::move(logger)),
+      m_keep(false)
+{
+}
+
+JobWorkspace::~JobWorkspace()
+{
+    if (m_path.empty()) {
+        return;
+    }
+    
+    // The folder leaves its name before the lock is released, so no other run reclaims it meanwhile
+    if (!m_keep) {
+        WorkspaceCleaner::Instance().Delete(m_path);
+    }
+    m_lock.reset();
+}
+
+bool JobWorkspace::Create(const fs::path& root)
+{
+    static std::atomic<uint64_t> nextWorkspaceId = 0;
+    
+    std::error_code error;
+    fs::create_directories(root, error);
+    if (error) {
+        m_logger.Error() << L"Failed to create workspace root " << root.wstring() << L": " << error.message().c_str();
+        return false;
+    }
+    
+    for (int attempt = 0; attempt < 100; attempt++) {
+        std::wstring name = std::to_wstring(GetCurrentProcessId()) + L"-" + std::to_wstring(++nextWorkspaceId);
+        
+        // The lock comes first, so a running job's folder is never seen without it
+        wil::unique_hfile lock(CreateFileW((root / (name + L".lock")).c_str(), GENERIC_WRITE | DELETE, 0, nullptr,
+            CREATE_NEW, FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, nullptr));
+        if (!lock) {
+            continue;
+        }
+        
+        // A folder left behind by an earlier process with the same id is not reused
+        if (!CreateDirectoryW((root / name).c_str(), nullptr)) {
+            continue;
+        }
+        
+        m_lock = std::move(lock);
+        m_path = root / name;
+        return true;
+    }
+    
+    m_logger.Error() << L"Failed to create a workspace in " << root.wstring() << L", error code: " << GetLastError();
+    return false;
+}
+
+const fs::path& JobWorkspace::Path() const
+{
+    return m_path;
+}
+
+void JobWorkspace::Keep()
+{
+    if (m_path.empty() || m_keep) {
+        return;
+    }
+    
+    // Marked before the lock is released, so the folder is never unmarked and unlocked at once
+    fs::path markerPath = m_path;
+    markerPath += L".keep";
+    wil::unique_hfile marker(CreateFileW(markerPath.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+        FILE_ATTRIBUTE_NORMAL, nullptr));
+    if (!marker) {
+        m_logger.Warning() << L"Failed to mark the workspace to be kept, error code: " << GetLastError();
+        return;
+    }
+    m_keep = true;
+}
+
+fs::path JobWorkspace::DefaultRoot()
+{
+    return fs::temp_directory_path() / L"ModelPackagingTool_Jobs";
+}
+
+WorkspaceCleaner& WorkspaceCleaner::Instance()
+{
+    // Never destroyed: a detached cleaning thread may still be using it while the process exits
+    static WorkspaceCleaner* cleaner = new WorkspaceCleaner();
+    return *cleaner;
+}
+
+void WorkspaceCleaner::Delete(const fs::path& folder)
+{
+    // A folder that can't be moved into the trash is deleted where it is
+    fs::path target = MoveToTrash(folder);
+    
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_detached) {
+        if (IsInTrash(target)) {
+            StartCleanerProcess(target.parent_path().parent_path());
+        }
+        return;
+    }
+    
+    m_pending.push_back(std::move(target));
+    if (!m_thread.joinable()) {
+        m_thread = std::thread([this]() { CleanLoop(); });
+    }
+    m_queued.notify_one();
+}
+
+void WorkspaceCleaner::ReclaimAbandoned(const fs::path& root, const Logger& logger)
+{
+    std::error_code error;
+    if (!fs::is_directory(root, error)) {
+        return;
+    }
+    
+    // Listed first, since reclaiming moves folders out of the root
+    std::vector<fs::path> folders;
+    std::vector<fs::path> trash;
+    for (const auto& entry : fs::directory_iterator(root, error)) {
+        std::error_code entryError;
+        if (!entry.is_directory(entryError)) {
+            continue;
+        }
+        if (entry.path().filename() == TrashFolderName) {
+            for (const auto& leftover : fs::directory_iterator(entry.path(), entryError)) {
+                trash.push_back(leftover.path());
+            }
+        }
+        else {
+            folders.push_back(entry.path());
+        }
+    }
+    
+    size_t reclaimed = 0;
+    for (const auto& folder : folders) {
+        fs::path keepPath = folder;
+        keepPath += L".keep";
+        if (fs::exists(keepPath, error)) {
+            continue;
+        }
+        
+        // A running job holds its lock without sharing; a lock that can be opened or is gone has no job
+        fs::path lockPath = folder;
+        lockPath += L".lock";
+        wil::unique_hfile lock(CreateFileW(lockPath.c_str(), GENERIC_READ, 0, nullptr, OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL, nullptr));
+        if (!lock && GetLastError() == ERROR_SHARING_VIOLATION) {
+            continue;
+        }
+        lock.reset();
+        fs::remove(lockPath, error);
+        
+        Delete(folder);
+        reclaimed++;
+    }
+    
+    if (reclaimed > 0 || !trash.empty()) {
+        logger.Info() << L"Deleting " << (reclaimed + trash.size()) << L" abandoned workspace(s) in " << root.wstring()
+            << L" in the background";
+    }
+    
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (trash.empty() || m_detached) {
+        return;
+    }
+    
+    m_pending.insert(m_pending.end(), trash.begin(), trash.end());
+    if (!m_thread.joinable()) {
+        m_thread = std::thread([this]() { CleanLoop(); });
+    }
+    m_queued.notify_one();
+}
+
+void WorkspaceCleaner::Detach()
+{
+    std::vector<fs::path> folders;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_detached) {
+            return;
+        }
+        m_detached = true;
+        
+        // The folder being deleted is handed over too; the thread and the cleaner may both work on it
+        if (!m_current.empty()) {
+            folders.push_back(m_current);
+        }
+        folders.insert(folders.end(), m_pending.begin(), m_pending.end());
+        m_pending.clear();
+    }
+    
+    m_queued.notify_all();
+    if (m_thread.joinable()) {
+        m_thread.detach();
+    }
+    
+    // One cleaner per root empties its trash. A folder that was being deleted where it is gets another
+    // try at moving into the trash; one that still can't be moved is reclaimed by the next run.
+    std::set<fs::path> roots;
+    for (const auto& folder : folders) {
+        fs::path target = IsInTrash(folder) ? folder : MoveToTrash(folder);
+        if (IsInTrash(target)) {
+            roots.insert(target.parent_path().parent_path());
+        }
+    }
+    
+    for (const auto& root : roots) {
+        StartCleanerProcess(root);
+    }
+}
+
+void WorkspaceCleaner::CleanLoop()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_queued.wait(lock, [this]() { return !m_pending.empty() || m_detached; });
+        if (m_detached) {
+            return;
+        }
+        
+        m_current = std::move(m_pending.front());
+        m_pending.pop_front();
+        fs::path folder = m_current;
+        lock.unlock();
+        
+        std::error_code error;
+        fs::remove_all(folder, error);
+        
+        lock.lock();
+        m_current.clear();
+    }
+}
\ No newline at end of file
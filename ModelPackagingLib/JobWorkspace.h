@@ -0,0 +1,86 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <filesystem>
+#include <condition_variable>
+#include <wil/resource.h>
+#include "Logger.h"
+
+namespace fs = std::filesystem;
+
+// A folder of one job's own, such as the download of one /downloadAndPack run, so jobs running at the
+// same time on a host never share files.
+//
+// Each workspace under a root has a lock file beside it, <name>.lock, held open without sharing and
+// deleted when it is closed. Windows closes it when the process ends however it ends, so a workspace
+// whose lock file is gone, or can be opened, belongs to no running job and can be reclaimed. A kept
+// workspace has a <name>.keep file instead and is never reclaimed.
+class JobWorkspace
+{
+public:
+    explicit JobWorkspace(Logger logger = Logger());
+
+    // Hands the folder to the WorkspaceCleaner unless it is kept, then releases the lock
+    ~JobWorkspace();
+
+    JobWorkspace(const JobWorkspace&) = delete;
+    JobWorkspace& operator=(const JobWorkspace&) = delete;
+
+    // Create a new, empty workspace under root
+    bool Create(const fs::path& root);
+
+    // The workspace folder
+    const fs::path& Path() const;
+
+    // Leave the folder in place when the workspace is released
+    void Keep();
+
+    // Root the tool creates workspaces in: ModelPackagingTool_Jobs in the temporary folder
+    static fs::path DefaultRoot();
+
+private:
+    Logger m_logger;
+    fs::path m_path;
+    wil::unique_hfile m_lock;
+    bool m_keep;
+};
+
+// Deletes folders on a background thread, so jobs don't wait for tens of GB of files to be deleted.
+//
+// A folder is first renamed into the .trash folder of its root, which takes an instant and frees its
+// name, and then deleted. What is left when the process exits is handed to a detached cleaner process,
+// and whatever a crash leaves in .trash is reclaimed by the next run.
+class WorkspaceCleaner
+{
+public:
+    static WorkspaceCleaner& Instance();
+
+    WorkspaceCleaner(const WorkspaceCleaner&) = delete;
+    WorkspaceCleaner& operator=(const WorkspaceCleaner&) = delete;
+
+    // Queue a folder for deletion and return at once
+    void Delete(const fs::path& folder);
+
+    // Queue the workspaces under root that no running job holds, and anything left in its .trash
+    void ReclaimAbandoned(const fs::path& root, const Logger& logger);
+
+    // Hand the folders not deleted yet to a cleaner process that outlives this one, without waiting.
+    // Called before the process exits.
+    void Detach();
+
+private:
+    WorkspaceCleaner() = default;
+
+    // Background thread body
+    void CleanLoop();
+
+    std::mutex m_mutex;
+    std::condition_variable m_queued;
+    std::deque<fs::path> m_pending;
+    fs::path m_current;             // Folder the background thread is deleting
+    std::thread m_thread;
+    bool m_detached = false;
+};
\ No newline at end of file
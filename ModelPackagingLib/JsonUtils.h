@@ -0,0 +1,49 @@
+#pragma once
+
+#include <string>
+#include <cstdio>
+#include <winrt/base.h>
+
+namespace JsonUtils {
+
+    // Escape a UTF-8 string for use inside a JSON string literal
+    inline std::string Escape(const std::string& value)
+    {
+        std::string escaped;
+        escaped.reserve(value.size() + 2);
+
+        for (char c : value) {
+            switch (c) {
+                case '"':  escaped += "\\\""; break;
+                case '\\': escaped += "\\\\"; break;
+                case '\n': escaped += "\\n"; break;
+                case '\r': escaped += "\\r"; break;
+                case '\t': escaped += "\\t"; break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20) {
+                        char buffer[8];
+                        snprintf(buffer, sizeof(buffer), "\\u%04x", static_cast<unsigned char>(c));
+                        escaped += buffer;
+                    }
+                    else {
+                        escaped += c;
+                    }
+                    break;
+            }
+        }
+
+        return escaped;
+    }
+
+    // Convert a wide string to a quoted, escaped JSON string literal
+    inline std::string Quote(const std::wstring& value)
+    {
+        return "\"" + Escape(winrt::to_string(value)) + "\"";
+    }
+
+    // Convert a UTF-8 string to a quoted, escaped JSON string literal
+    inline std::string Quote(const std::string& value)
+    {
+        return "\"" + Escape(value) + "\"";
+    }
+}
\ No newline at end of file
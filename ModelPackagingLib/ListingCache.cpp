@@ -0,0 +1,131 @@
+#include "ListingCache.h"
+#include <Windows.h>
+#include <fstream>
+#include <sstream>
+#include <winrt/base.h>
+
+namespace {
+    // Branch and folder names may hold slashes; escape them, and the escape character, so each
+    // name maps to one file name
+    std::wstring EscapeName(const std::wstring& name)
+    {
+        std::wstring escaped;
+        for (wchar_t c : name) {
+            if (c == L'/' || c == L'\\') {
+                escaped += L"%2F";
+            }
+            else if (c == L'%') {
+                escaped += L"%25";
+            }
+            else {
+                escaped += c;
+            }
+        }
+        return escaped;
+    }
+
+    bool ReadFile(const fs::path& path, std::string& contents)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()) {
+            return false;
+        }
+
+        std::ostringstream buffer;
+        buffer << file.rdbuf();
+        contents = buffer.str();
+        return !file.bad();
+    }
+}
+
+ListingCache::ListingCache(fs::path cacheFolder, Logger logger)
+    : m_folder(std::move(cacheFolder)),
+      m_logger(std::move(logger))
+{
+}
+
+fs::path ListingCache::DefaultFolder()
+{
+    return fs::temp_directory_path() / L"ModelPackagingTool_Listings";
+}
+
+bool ListingCache::IsCommit(const std::wstring& revision)
+{
+    return revision.size() == 40 && revision.find_first_not_of(L"0123456789abcdef") == std::wstring::npos;
+}
+
+bool ListingCache::LoadRef(const std::wstring& owner, const std::wstring& repo, const std::wstring& branch, CachedRef& ref) const
+{
+    std::string contents;
+    if (!ReadFile(RepoFolder(owner, repo) / L"refs" / (EscapeName(branch) + L".ref"), contents)) {
+        return false;
+    }
+    
+    std::istringstream lines(contents);
+    std::string commit;
+    std::string etag;
+    std::getline(lines, commit);
+    std::getline(lines, etag);
+    
+    ref.commit = winrt::to_hstring(commit);
+    ref.etag = winrt::to_hstring(etag);
+    return IsCommit(ref.commit);
+}
+
+void ListingCache::StoreRef(const std::wstring& owner, const std::wstring& repo, const std::wstring& branch, const CachedRef& ref) const
+{
+    std::string contents = winrt::to_string(ref.commit) + "\n" + winrt::to_string(ref.etag) + "\n";
+    WriteFileAtomically(RepoFolder(owner, repo) / L"refs" / (EscapeName(branch) + L".ref"), contents);
+}
+
+bool ListingCache::LoadListing(const std::wstring& owner, const std::wstring& repo, const std::wstring& commit,
+                               const std::wstring& folderPath, std::string& json) const
+{
+    std::wstring name = folderPath.empty() ? L"_root" : EscapeName(folderPath);
+    return ReadFile(RepoFolder(owner, repo) / commit / (name + L".json"), json) && !json.empty();
+}
+
+void ListingCache::StoreListing(const std::wstring& owner, const std::wstring& repo, const std::wstring& commit,
+                                const std::wstring& folderPath, const std::string& json) const
+{
+    std::wstring name = folderPath.empty() ? L"_root" : EscapeName(folderPath);
+    WriteFileAtomically(RepoFolder(owner, repo) / commit / (name + L".json"), json);
+}
+
+void ListingCache::SetLogger(Logger logger)
+{
+    m_logger = std::move(logger);
+}
+
+fs::path ListingCache::RepoFolder(const std::wstring& owner, const std::wstring& repo) const
+{
+    return m_folder / EscapeName(owner) / EscapeName(repo);
+}
+
+void ListingCache::WriteFileAtomically(const fs::path& path, const std::string& contents) const
+{
+    std::error_code error;
+    fs::create_directories(path.parent_path(), error);
+    
+    // A name of its own per process and thread, so concurrent jobs don't write the same temporary file
+    fs::path temporaryPath = path;
+    temporaryPath += L"." + std::to_wstring(GetCurrentProcessId()) + L"." + std::to_wstring(GetCurrentThreadId()) + L".tmp";
+    
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        file.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+        file.close();
+        if (!file) {
+            m_logger.Warning() << L"Could not write the listing cache file " << temporaryPath.wstring();
+            fs::remove(temporaryPath, error);
+            return;
+        }
+    }
+    
+    fs::rename(temporaryPath, path, error);
+    if (error) {
+        m_logger.Warning() << L"Could not write the listing cache file " << path.wstring() << L": "
+            << winrt::to_hstring(error.message()).c_str();
+        fs::remove(temporaryPath, error);
+    }
+}
\ No newline at end of file
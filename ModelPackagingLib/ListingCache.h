@@ -0,0 +1,59 @@
+#pragma once
+
+#include <string>
+#include <filesystem>
+#include "Logger.h"
+
+namespace fs = std::filesystem;
+
+// A branch resolved to a commit, with the ETag of the response that resolved it
+struct CachedRef
+{
+    std::wstring commit;
+    std::wstring etag;
+};
+
+// Repository listings kept on disk between runs.
+//
+// A listing is stored per commit, so it never goes stale: once a branch has been resolved to a
+// commit whose listing is cached, the listing needs no request at all. Branch resolutions are
+// stored with their ETag, so a rerun asks the server with If-None-Match and gets a 304 back while
+// the branch hasn't moved.
+//
+// Layout: {owner}\{repo}\refs\{branch}.ref holds the commit and ETag on two lines, and
+// {owner}\{repo}\{commit}\{folder}.json the tree listing as the server returned it. Files are
+// written to a temporary name and renamed, so a crash never leaves half a listing behind.
+class ListingCache
+{
+public:
+    ListingCache(fs::path cacheFolder, Logger logger = Logger());
+    ~ListingCache() = default;
+
+    // %TEMP%\ModelPackagingTool_Listings
+    static fs::path DefaultFolder();
+
+    // Whether a revision is a full commit SHA rather than a branch or tag name
+    static bool IsCommit(const std::wstring& revision);
+
+    bool LoadRef(const std::wstring& owner, const std::wstring& repo, const std::wstring& branch, CachedRef& ref) const;
+    void StoreRef(const std::wstring& owner, const std::wstring& repo, const std::wstring& branch, const CachedRef& ref) const;
+
+    // Listing of a folder at a commit; folderPath is empty for the repository root
+    bool LoadListing(const std::wstring& owner, const std::wstring& repo, const std::wstring& commit,
+                     const std::wstring& folderPath, std::string& json) const;
+    void StoreListing(const std::wstring& owner, const std::wstring& repo, const std::wstring& commit,
+                      const std::wstring& folderPath, const std::string& json) const;
+
+    void SetLogger(Logger logger);
+
+private:
+    // Folder of a repository's files
+    fs::path RepoFolder(const std::wstring& owner, const std::wstring& repo) const;
+
+    // Write a file through a temporary name, logging a failure as a warning; the cache is an
+    // optimization, so failing to write it doesn't fail the run
+    void WriteFileAtomically(const fs::path& path, const std::string& contents) const;
+
+    fs::path m_folder;
+    Logger m_logger;
+};
\ No newline at end of file
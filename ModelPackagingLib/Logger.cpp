@@ -0,0 +1,51 @@
+#include "Logger.h"
+
+Logger::Logger(LogSink sink, LogLevel maxLevel) : m_sink(std::move(sink)), m_maxLevel(maxLevel)
+{
+}
+
+bool Logger::IsEnabled(LogLevel level) const
+{
+    return m_sink && level <= m_maxLevel;
+}
+
+void Logger::Write(LogLevel level, const std::wstring& message) const
+{
+    if (IsEnabled(level)) {
+        m_sink(level, message);
+    }
+}
+
+LogLine Logger::Error() const
+{
+    return LogLine(*this, LogLevel::Error);
+}
+
+LogLine Logger::Warning() const
+{
+    return LogLine(*this, LogLevel::Warning);
+}
+
+LogLine Logger::Info() const
+{
+    return LogLine(*this, LogLevel::Info);
+}
+
+LogLine Logger::Verbose() const
+{
+    return LogLine(*this, LogLevel::Verbose);
+}
+
+LogLine::LogLine(const Logger& logger, LogLevel level)
+    : m_logger(logger),
+      m_level(level),
+      m_enabled(logger.IsEnabled(level))
+{
+}
+
+LogLine::~LogLine()
+{
+    if (m_enabled) {
+        m_logger.Write(m_level, m_stream.str());
+    }
+}
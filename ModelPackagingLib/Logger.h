@@ -0,0 +1,71 @@
+#pragma once
+
+#include <string>
+#include <sstream>
+#include <functional>
+
+// Severity of a log message
+enum class LogLevel
+{
+    Error,
+    Warning,
+    Info,
+    Verbose
+};
+
+// Receives every message logged by the pipeline; the library itself never writes to the console
+using LogSink = std::function<void(LogLevel level, const std::wstring& message)>;
+
+class LogLine;
+
+class Logger
+{
+public:
+    // A logger without a sink discards everything
+    Logger() = default;
+
+    // Messages less severe than maxLevel are dropped before they are formatted
+    explicit Logger(LogSink sink, LogLevel maxLevel = LogLevel::Verbose);
+
+    // Whether messages of the given level reach the sink
+    bool IsEnabled(LogLevel level) const;
+
+    // Forward a complete message to the sink
+    void Write(LogLevel level, const std::wstring& message) const;
+
+    // Start a message that is written when the returned line goes out of scope
+    LogLine Error() const;
+    LogLine Warning() const;
+    LogLine Info() const;
+    LogLine Verbose() const;
+
+private:
+    LogSink m_sink;
+    LogLevel m_maxLevel = LogLevel::Verbose;
+};
+
+// Collects a single message with stream syntax and hands it to the logger on destruction
+class LogLine
+{
+public:
+    LogLine(const Logger& logger, LogLevel level);
+    ~LogLine();
+
+    LogLine(const LogLine&) = delete;
+    LogLine& operator=(const LogLine&) = delete;
+
+    template <typename T>
+    LogLine& operator<<(const T& value)
+    {
+        if (m_enabled) {
+            m_stream << value;
+        }
+        return *this;
+    }
+
+private:
+    const Logger& m_logger;
+    LogLevel m_level;
+    bool m_enabled;
+    std::wostringstream m_stream;
+};
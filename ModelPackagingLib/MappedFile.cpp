@@ -0,0 +1,66 @@
+#include "MappedFile.h"
+
+bool MappedFile::Open(const fs::path& path, const Logger& logger)
+{
+    Close();
+    
+    m_file.reset(CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr));
+    if (!m_file) {
+        logger.Error() << L"Failed to open file: " << path.wstring() << L" (error " << GetLastError() << L")";
+        return false;
+    }
+    
+    LARGE_INTEGER size = {};
+    if (!GetFileSizeEx(m_file.get(), &size)) {
+        logger.Error() << L"Failed to get the size of file: " << path.wstring() << L" (error " << GetLastError() << L")";
+        Close();
+        return false;
+    }
+    
+    // An empty file can't be mapped, and has nothing to read anyway
+    m_size = static_cast<uint64_t>(size.QuadPart);
+    if (m_size == 0) {
+        return true;
+    }
+    
+    m_mapping.reset(CreateFileMappingW(m_file.get(), nullptr, PAGE_READONLY, 0, 0, nullptr));
+    if (m_mapping) {
+        m_view.reset(static_cast<uint8_t*>(MapViewOfFile(m_mapping.get(), FILE_MAP_READ, 0, 0, 0)));
+    }
+    
+    if (!m_view) {
+        logger.Error() << L"Failed to map file into memory: " << path.wstring() << L" (error " << GetLastError() << L")";
+        Close();
+        return false;
+    }
+    
+    return true;
+}
+
+void MappedFile::Close()
+{
+    m_view.reset();
+    m_mapping.reset();
+    m_file.reset();
+    m_size = 0;
+}
+
+const uint8_t* MappedFile::Data() const
+{
+    return m_view.get();
+}
+
+uint64_t MappedFile::Size() const
+{
+    return m_size;
+}
+
+bool MappedFile::Contains(uint64_t offset, uint64_t size) const
+{
+    return offset <= m_size && size <= m_size - offset;
+}
+
+HANDLE MappedFile::Handle() const
+{
+    return m_file.get();
+}
\ No newline at end of file
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <Windows.h>
+#include <wil/resource.h>
+#include "Logger.h"
+
+namespace fs = std::filesystem;
+
+// A whole file mapped read-only into memory. Pages are read on first access, so threads can work on
+// different parts of a large package at once without copying it into buffers first.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile() = default;
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Map the given file, replacing any file mapped before
+    bool Open(const fs::path& path, const Logger& logger);
+
+    // Unmap the file
+    void Close();
+
+    // Start of the mapping, or nullptr for an empty file
+    const uint8_t* Data() const;
+
+    // Size of the file in bytes
+    uint64_t Size() const;
+
+    // Whether size bytes starting at offset lie within the file
+    bool Contains(uint64_t offset, uint64_t size) const;
+
+    // Handle of the file, open for reading
+    HANDLE Handle() const;
+
+private:
+    wil::unique_hfile m_file;
+    wil::unique_handle m_mapping;
+    wil::unique_mapview_ptr<uint8_t> m_view;
+    uint64_t m_size = 0;
+};
\ No newline at end of file
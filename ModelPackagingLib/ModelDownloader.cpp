@@ -1,5 +1,4 @@
 #include "ModelDownloader.h"
-#include <iostream>
 #include <regex>
 
 ModelDownloader::ModelDownloader()
@@ -34,6 +33,11 @@ RepositoryInfo ModelDownloader::ParseUri(const std::wstring& uri)
         if (matches[4].matched) {
             info.path = matches[4].str();
         }
+        
+        // A URI that names a commit is already pinned
+        if (ListingCache::IsCommit(info.branch)) {
+            info.commit = info.branch;
+        }
     }
     else if (std::regex_match(uri, matches, githubPattern)) {
         info.type = RepositoryType::GitHub;
@@ -57,18 +61,19 @@ RepositoryInfo ModelDownloader::ParseUri(const std::wstring& uri)
 winrt::Windows::Foundation::IAsyncAction ModelDownloader::DownloadModelAsync(
     const std::wstring& uri,
     const fs::path& destinationFolder,
-    ProgressCallback progressCallback)
+    ProgressTracker* progressTracker,
+    DownloadFilter filter)
 {
     // Parse the URI to determine the repository type and components
     RepositoryInfo repoInfo = ParseUri(uri);
     
     switch (repoInfo.type) {
         case RepositoryType::HuggingFace:
-            co_await DownloadFromHuggingFaceAsync(repoInfo, destinationFolder, progressCallback);
+            co_await DownloadFromHuggingFaceAsync(repoInfo, destinationFolder, progressTracker, std::move(filter));
             break;
             
         case RepositoryType::GitHub:
-            co_await DownloadFromGitHubAsync(repoInfo, destinationFolder, progressCallback);
+            co_await DownloadFromGitHubAsync(repoInfo, destinationFolder, progressTracker);
             break;
             
         default:
@@ -76,16 +81,72 @@ winrt::Windows::Foundation::IAsyncAction ModelDownloader::DownloadModelAsync(
     }
 }
 
+winrt::Windows::Foundation::IAsyncAction ModelDownloader::PlanModelAsync(
+    const std::wstring& uri,
+    const fs::path& destinationFolder,
+    DownloadFilter filter,
+    DownloadPlan& plan)
+{
+    RepositoryInfo repoInfo = ParseUri(uri);
+    
+    switch (repoInfo.type) {
+        case RepositoryType::HuggingFace:
+        {
+            // The root folder is "/", any other folder gets a trailing slash, as for downloads
+            std::wstring folderPath = repoInfo.path.empty() ? L"/" : repoInfo.path;
+            if (folderPath.back() != L'/' && folderPath.back() != L'\\') {
+                folderPath += L'/';
+            }
+            
+            co_await m_huggingFaceDownloader.PlanFolderAsync(
+                repoInfo.owner,
+                repoInfo.name,
+                repoInfo.branch,
+                folderPath,
+                destinationFolder,
+                std::move(filter),
+                plan
+            );
+            break;
+        }
+            
+        case RepositoryType::GitHub:
+            plan = DownloadPlan();
+            plan.repoOwner = repoInfo.owner;
+            plan.repoName = repoInfo.name;
+            plan.branch = repoInfo.branch;
+            plan.destinationFolder = destinationFolder;
+            break;
+            
+        default:
+            throw winrt::hresult_invalid_argument(L"Unsupported repository URI format");
+    }
+}
+
+winrt::Windows::Foundation::IAsyncAction ModelDownloader::DownloadPlanAsync(
+    const DownloadPlan& plan,
+    ProgressTracker* progressTracker)
+{
+    co_await m_huggingFaceDownloader.DownloadPlanAsync(plan, progressTracker);
+}
+
 void ModelDownloader::CancelDownloads()
 {
     m_huggingFaceDownloader.CancelDownloads();
     m_githubDownloader.CancelDownloads();
 }
 
+void ModelDownloader::SetCancellationToken(const CancellationToken& cancellationToken)
+{
+    m_huggingFaceDownloader.SetCancellationToken(cancellationToken);
+    m_githubDownloader.SetCancellationToken(cancellationToken);
+}
+
 winrt::Windows::Foundation::IAsyncAction ModelDownloader::DownloadFromHuggingFaceAsync(
     const RepositoryInfo& repoInfo,
     const fs::path& destinationFolder,
-    ProgressCallback progressCallback)
+    ProgressTracker* progressTracker,
+    DownloadFilter filter)
 {
     // Always treat the path as a folder path and use the API to list and download files
     // Ensure the path is properly formatted for use with the HuggingFace API
@@ -100,7 +161,8 @@ winrt::Windows::Foundation::IAsyncAction ModelDownloader::DownloadFromHuggingFac
             repoInfo.branch,
             L"/", // Root folder
             destinationFolder,
-            progressCallback
+            progressTracker,
+            std::move(filter)
         );
     }
     else {
@@ -116,7 +178,8 @@ winrt::Windows::Foundation::IAsyncAction ModelDownloader::DownloadFromHuggingFac
             repoInfo.branch,
             folderPath,
             destinationFolder,
-            progressCallback
+            progressTracker,
+            std::move(filter)
         );
     }
 }
@@ -124,7 +187,7 @@ winrt::Windows::Foundation::IAsyncAction ModelDownloader::DownloadFromHuggingFac
 winrt::Windows::Foundation::IAsyncAction ModelDownloader::DownloadFromGitHubAsync(
     const RepositoryInfo& repoInfo,
     const fs::path& destinationFolder,
-    ProgressCallback progressCallback)
+    ProgressTracker* progressTracker)
 {
     // Similar to HuggingFace, always treat the path as a folder path
     std::wstring folderPath = repoInfo.path;
@@ -138,7 +201,7 @@ winrt::Windows::Foundation::IAsyncAction ModelDownloader::DownloadFromGitHubAsyn
             repoInfo.branch,
             L"/", // Root folder
             destinationFolder,
-            progressCallback
+            progressTracker
         );
     }
     else {
@@ -154,7 +217,19 @@ winrt::Windows::Foundation::IAsyncAction ModelDownloader::DownloadFromGitHubAsyn
             repoInfo.branch,
             folderPath,
             destinationFolder,
-            progressCallback
+            progressTracker
         );
     }
+}
+
+void ModelDownloader::SetEndpoints(RepositoryType type, const std::vector<std::wstring>& endpoints)
+{
+    m_huggingFaceDownloader.SetEndpoints(type == RepositoryType::HuggingFace ? endpoints : std::vector<std::wstring>());
+    m_githubDownloader.SetEndpoints(type == RepositoryType::GitHub ? endpoints : std::vector<std::wstring>());
+}
+
+void ModelDownloader::SetLogger(Logger logger)
+{
+    m_huggingFaceDownloader.SetLogger(logger);
+    m_githubDownloader.SetLogger(std::move(logger));
 }
\ No newline at end of file
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <string>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <winrt/base.h>
+#include <winrt/Windows.Foundation.h>
+#include "HuggingFaceDownloader.h"
+#include "GitHubDownloader.h"
+
+namespace fs = std::filesystem;
+
+// Supported repository types
+enum class RepositoryType
+{
+    Unknown,
+    HuggingFace,
+    GitHub
+};
+
+// Structure to hold parsed URI information
+struct RepositoryInfo
+{
+    RepositoryType type = RepositoryType::Unknown;
+    std::wstring owner;
+    std::wstring name;
+    std::wstring branch = L"main";
+    std::wstring path;
+    std::wstring commit;    // Commit the branch resolved to, once known; the branch itself when the URI names a commit
+};
+
+class ModelDownloader
+{
+public:
+    ModelDownloader();
+    ~ModelDownloader() = default;
+
+    // Parse a URI to determine repository type and components
+    RepositoryInfo ParseUri(const std::wstring& uri);
+
+    // Download model files from a URI, keeping only the files that pass the filter
+    winrt::Windows::Foundation::IAsyncAction DownloadModelAsync(
+        const std::wstring& uri,
+        const fs::path& destinationFolder,
+        ProgressTracker* progressTracker = nullptr,
+        DownloadFilter filter = DownloadFilter());
+
+    // Work out which files a URI holds, how big they are and the order to fetch them in, without
+    // downloading anything. GitHub folders can't be listed yet and give an empty plan.
+    winrt::Windows::Foundation::IAsyncAction PlanModelAsync(
+        const std::wstring& uri,
+        const fs::path& destinationFolder,
+        DownloadFilter filter,
+        DownloadPlan& plan);
+
+    // Download the files of a plan made by PlanModelAsync
+    winrt::Windows::Foundation::IAsyncAction DownloadPlanAsync(
+        const DownloadPlan& plan,
+        ProgressTracker* progressTracker = nullptr);
+
+    // Cancel the downloads of the current cancellation token, running or yet to start; a new token is
+    // needed to download again
+    void CancelDownloads();
+
+    // Stop the downloads of every downloader when this token is cancelled, including ones started after it was
+    void SetCancellationToken(const CancellationToken& cancellationToken);
+
+    // Route status and error messages from all downloaders to the given logger
+    void SetLogger(Logger logger);
+
+    // Base URLs to download repositories of the given type from, in order of preference, in place of
+    // the ones the environment names; the other types go back to theirs
+    void SetEndpoints(RepositoryType type, const std::vector<std::wstring>& endpoints);
+
+private:
+    // Download model from HuggingFace
+    winrt::Windows::Foundation::IAsyncAction DownloadFromHuggingFaceAsync(
+        const RepositoryInfo& repoInfo,
+        const fs::path& destinationFolder,
+        ProgressTracker* progressTracker,
+        DownloadFilter filter);
+
+    // Download model from GitHub
+    winrt::Windows::Foundation::IAsyncAction DownloadFromGitHubAsync(
+        const RepositoryInfo& repoInfo,
+        const fs::path& destinationFolder,
+        ProgressTracker* progressTracker);
+
+    // Downloaders for different repositories
+    HuggingFaceDownloader m_huggingFaceDownloader;
+    GitHubDownloader m_githubDownloader;
+};
\ No newline at end of file
@@ -0,0 +1,517 @@
+#include "MsixPackager.h"
+#include "CertificateManager.h"
+#include "AppxManifestTemplates.h"
+#include "ProcessRunner.h"
+#include "TraceRecorder.h"
+#include "MsixWriter.h"
+#include "PackageCache.h"
+#include "PackageStaging.h"
+#include "SourceReadAhead.h"
+#include <algorithm>
+#include <optional>
+#include <fstream>
+#include <sstream>
+#include <Windows.h>
+#include <string>
+#include <regex>
+#include <winrt/base.h>
+
+MsixPackager::MsixPackager(Logger logger, CancellationToken cancellationToken, MsixPackagerOptions options)
+    : m_logger(std::move(logger)),
+      m_cancellationToken(std::move(cancellationToken)),
+      m_options(std::move(options))
+{
+}
+
+bool MsixPackager::CreateMsixPackage(
+    const fs::path& sourceFolder,
+    const fs::path& outputMsixPath,
+    const std::wstring& packageName,
+    const std::wstring& publisherName,
+    fs::path* createdPackagePath)
+{
+    m_logger.Info() << L"Creating MSIX package from folder: " << sourceFolder.wstring();
+    
+    // Extract repository name and owner from folder name
+    std::wstring finalPackageName;
+    std::wstring finalPublisherName;
+    
+    // Use provided names if available
+    if (!packageName.empty()) {
+        finalPackageName = packageName;
+        m_logger.Info() << L"Using provided package name: " << finalPackageName;
+    }
+    else {
+        // First try to infer from the folder structure
+        if (sourceFolder.has_filename()) {
+            finalPackageName = sourceFolder.filename().wstring();
+        }
+        else {
+            finalPackageName = L"ModelPackage";
+        }
+        m_logger.Info() << L"Using inferred package name: " << finalPackageName;
+    }
+    
+    if (!publisherName.empty()) {
+        finalPublisherName = publisherName;
+        m_logger.Info() << L"Using provided publisher name: " << finalPublisherName;
+    }
+    else {
+        // Check if the parent folder could be the owner
+        if (sourceFolder.has_parent_path() && sourceFolder.parent_path().has_filename()) {
+            finalPublisherName = sourceFolder.parent_path().filename().wstring();
+        }
+        else {
+            finalPublisherName = L"ModelPackagingTool";
+        }
+        m_logger.Info() << L"Using inferred publisher name: " << finalPublisherName;
+    }
+    
+    // Process the output path
+    fs::path finalOutputPath = ResolveOutputPath(outputMsixPath, finalPackageName, finalPublisherName);
+    
+    // If outputMsixPath is a directory, the package is created inside it
+    if (finalOutputPath != outputMsixPath) {
+        // Create the output directory if it doesn't exist
+        try {
+            if (!fs::exists(outputMsixPath)) {
+                m_logger.Info() << L"Creating output directory: " << outputMsixPath.wstring();
+                fs::create_directories(outputMsixPath);
+            }
+        }
+        catch (const std::exception& ex) {
+            m_logger.Error() << L"Error creating output directory: " << ex.what();
+            return false;
+        }
+    }
+    else {
+        // Ensure the parent directory of the output file exists
+        try {
+            fs::path parentDir = finalOutputPath.parent_path();
+            if (!parentDir.empty() && !fs::exists(parentDir)) {
+                m_logger.Info() << L"Creating parent directory: " << parentDir.wstring();
+                fs::create_directories(parentDir);
+            }
+        }
+        catch (const std::exception& ex) {
+            m_logger.Error() << L"Error creating parent directory: " << ex.what();
+            return false;
+        }
+    }
+    
+    m_logger.Info() << L"Output MSIX path: " << finalOutputPath.wstring();
+    
+    bool hasManifest = fs::exists(sourceFolder / L"AppxManifest.xml");
+    
+    // Only the files the scan options select are packaged, whichever tool builds the package
+    SourceFileList files;
+    if (!MsixWriter::ListPayloadFiles(sourceFolder, m_options.scanOptions, files, m_logger, m_cancellationToken)) {
+        m_logger.Error() << L"Failed to list the files of the source folder";
+        return false;
+    }
+    
+    if (hasManifest && !files.ContainsRootFile(L"AppxManifest.xml")) {
+        m_logger.Error() << L"AppxManifest.xml is left out by the exclude patterns";
+        return false;
+    }
+    
+    // The package is built from a staging folder of links to the files, so the source folder is only read
+    PackageStaging staging(m_logger);
+    {
+        TraceSpan stagingSpan("staging", sourceFolder.wstring());
+        if (!staging.Stage(sourceFolder, files)) {
+            return false;
+        }
+    }
+    
+    if (!hasManifest) {
+        // A generated AppxManifest.xml goes into the staging folder only
+        TraceSpan manifestSpan("manifest", L"Create AppxManifest.xml");
+        if (!CreateAppxManifest(staging, finalPackageName, finalPublisherName)) {
+            m_logger.Error() << L"Failed to create AppxManifest.xml";
+            return false;
+        }
+    } else {
+        m_logger.Info() << L"Using existing AppxManifest.xml found in source folder";
+    }
+    
+    // Build the MSIX package with the built-in writer, or with MakeAppx.exe from the Windows SDK if requested
+    {
+        TraceSpan packageSpan("package", finalOutputPath.filename().wstring());
+        bool built = m_options.useMakeAppx ?
+            BuildMsixPackage(staging, finalOutputPath, finalPackageName) :
+            WriteMsixPackage(staging, finalOutputPath, finalPackageName);
+        
+        if (!built) {
+            m_logger.Error() << L"Failed to build MSIX package";
+            return false;
+        }
+        
+        std::error_code sizeError;
+        uintmax_t packageSize = fs::file_size(finalOutputPath, sizeError);
+        packageSpan.SetBytes(sizeError ? 0 : packageSize);
+    }
+    
+    m_logger.Info() << L"MSIX package created successfully: " << finalOutputPath.wstring();
+    
+    if (createdPackagePath) {
+        *createdPackagePath = finalOutputPath;
+    }
+    
+    return true;
+}
+
+fs::path MsixPackager::ResolveOutputPath(
+    const fs::path& outputMsixPath,
+    const std::wstring& packageName,
+    const std::wstring& publisherName)
+{
+    // A path without an extension is treated as the output directory
+    if (fs::is_directory(outputMsixPath) || !outputMsixPath.has_extension()) {
+        // Use the naming pattern: publisher_package.msix
+        std::wstring msixFilename = CleanNameForPackage(publisherName) + L"_" + CleanNameForPackage(packageName) + L".msix";
+        return outputMsixPath / msixFilename;
+    }
+    
+    return outputMsixPath;
+}
+
+bool MsixPackager::CreateAppxManifest(
+    PackageStaging& staging,
+    const std::wstring& packageName,
+    const std::wstring& publisherName)
+{
+    // Clean package name to be valid for MSIX
+    std::wstring cleanPackageName = CleanNameForPackage(packageName);
+    std::wstring cleanPublisherName = CleanNameForPackage(publisherName);
+    
+    // Get the manifest content from the template
+    std::wstring manifestContent = AppxManifestTemplates::GetStandardManifestTemplate(
+        cleanPackageName, 
+        cleanPublisherName);
+    
+    // Write to the staging folder as UTF-8
+    if (!staging.AddGeneratedFile(L"AppxManifest.xml", winrt::to_string(manifestContent))) {
+        return false;
+    }
+    
+    m_logger.Info() << L"Created AppxManifest.xml in " << (staging.Root() / L"AppxManifest.xml").wstring();
+    return true;
+}
+
+bool MsixPackager::BuildMsixPackage(
+    const PackageStaging& staging,
+    const fs::path& outputMsixPath,
+    const std::wstring& packageName)
+{
+    // Ensure output directory exists
+    fs::path outputDir = outputMsixPath.parent_path();
+    if (!outputDir.empty() && !fs::exists(outputDir)) {
+        try {
+            fs::create_directories(outputDir);
+        }
+        catch (const std::exception& ex) {
+            m_logger.Error() << L"Error creating output directory: " << ex.what();
+            return false;
+        }
+    }
+    
+    // Check if MakeAppx.exe exists in the Windows SDK
+    fs::path sdkPath = FindWindowsSDKPath();
+    if (sdkPath.empty()) {
+        m_logger.Warning() << L"Windows SDK not found. Using the built-in package writer.";
+        return WriteMsixPackage(staging, outputMsixPath, packageName);
+    }
+    
+    fs::path makeAppxPath = sdkPath / L"makeappx.exe";
+    if (!fs::exists(makeAppxPath)) {
+        m_logger.Warning() << L"MakeAppx.exe not found in Windows SDK. Using the built-in package writer.";
+        return WriteMsixPackage(staging, outputMsixPath, packageName);
+    }
+    
+    // MakeAppx.exe is given the scanned file list rather than the whole folder, so excluded files stay out
+    fs::path mappingPath = outputMsixPath;
+    mappingPath += L".files.txt";
+    if (!WriteMappingFile(staging, mappingPath)) {
+        return WriteMsixPackage(staging, outputMsixPath, packageName);
+    }
+    
+    // Build the command line with /nv flag to skip validation of assets
+    std::wstring cmdLine = L"\"" + makeAppxPath.wstring() + L"\" pack /f \"" + 
+                          mappingPath.wstring() + L"\" /p \"" + 
+                          outputMsixPath.wstring() + L"\" /o /nv";
+    
+    m_logger.Info() << L"Executing: " << cmdLine;
+    
+    // Execute the command, forwarding its output to the logger
+    ProcessResult result = ProcessRunner::Run(cmdLine, m_logger, m_cancellationToken);
+    
+    std::error_code removeError;
+    fs::remove(mappingPath, removeError);
+    
+    if (!result.started) {
+        m_logger.Error() << L"Failed to execute MakeAppx.exe, error code: " << result.error;
+        return WriteMsixPackage(staging, outputMsixPath, packageName);
+    }
+    
+    if (result.cancelled) {
+        m_logger.Warning() << L"MakeAppx.exe was cancelled";
+        return false;
+    }
+    
+    if (result.exitCode != 0) {
+        m_logger.Error() << L"MakeAppx.exe failed with exit code: " << result.exitCode;
+        return WriteMsixPackage(staging, outputMsixPath, packageName);
+    }
+    
+    return true;
+}
+
+fs::path MsixPackager::FindWindowsSDKPath()
+{
+    // The SDK location doesn't change while the process runs, so a long-running
+    // server only pays for the registry and directory lookups once
+    static const fs::path sdkPath = LocateWindowsSDKPath();
+    return sdkPath;
+}
+
+fs::path MsixPackager::LocateWindowsSDKPath()
+{
+    // Try to locate Windows SDK bin path from registry
+    HKEY hKey;
+    LONG result = RegOpenKeyExW(HKEY_LOCAL_MACHINE,
+                              L"SOFTWARE\\Microsoft\\Windows Kits\\Installed Roots",
+                              0, KEY_READ, &hKey);
+    
+    if (result != ERROR_SUCCESS) {
+        return fs::path();
+    }
+    
+    // Get the installed Windows SDK version
+    wchar_t sdkVersion[256] = { 0 };
+    DWORD bufferSize = sizeof(sdkVersion);
+    DWORD dataType;
+    
+    result = RegQueryValueExW(hKey, L"KitsRoot10", NULL, &dataType,
+                           reinterpret_cast<LPBYTE>(sdkVersion), &bufferSize);
+    
+    RegCloseKey(hKey);
+    
+    if (result != ERROR_SUCCESS || dataType != REG_SZ) {
+        return fs::path();
+    }
+    
+    // Construct the path to the x64 binaries
+    fs::path sdkPath(sdkVersion);
+    sdkPath = sdkPath / L"bin" / L"10.0.22621.0" / L"x64";
+    
+    // If the specific version doesn't exist, try finding any version
+    if (!fs::exists(sdkPath)) {
+        fs::path baseSdkPath(sdkVersion);
+        baseSdkPath = baseSdkPath / L"bin";
+        
+        // Try to find any version folder
+        for (const auto& entry : fs::directory_iterator(baseSdkPath)) {
+            if (entry.is_directory()) {
+                fs::path versionPath = entry.path() / L"x64";
+                if (fs::exists(versionPath)) {
+                    sdkPath = versionPath;
+                    break;
+                }
+            }
+        }
+    }
+    
+    return sdkPath;
+}
+
+bool MsixPackager::WriteMsixPackage(
+    const PackageStaging& staging,
+    const fs::path& outputMsixPath,
+    const std::wstring& packageName)
+{
+    std::optional<PackageCache> cache;
+    if (!m_options.cacheFolder.empty()) {
+        cache.emplace(m_options.cacheFolder, m_logger);
+        cache->Load();
+    }
+    
+    MsixWriter writer(m_logger, m_cancellationToken);
+    if (!writer.Open(outputMsixPath)) {
+        return false;
+    }
+    writer.SetBlockCloning(m_options.blockClone);
+    
+    m_logger.Info() << L"Writing " << staging.Size() << L" files to " << outputMsixPath.wstring();
+    
+    // Cached files are looked up first, so the files that do have to be compressed can be read ahead
+    // in order; stored files are mapped by the writer instead
+    std::vector<MsixEntryData> cachedData(staging.Size());
+    std::vector<fs::path> blobPaths(staging.Size());
+    std::vector<PackageCacheEntry> stamps(staging.Size());
+    std::vector<fs::path> readPaths;
+    for (size_t i = 0; i < staging.Size(); i++) {
+        fs::path relativePath = staging.RelativePath(i);
+        bool compress = MsixWriter::ShouldCompress(relativePath, m_options.storeWeights);
+        if (!cache || !cache->Find(packageName + L"\\" + relativePath.wstring(), staging.SourcePath(i),
+                                   compress, cachedData[i], blobPaths[i])) {
+            blobPaths[i].clear();
+            
+            // Stamped before anything reads the file, so a file that changes while it is packaged isn't cached
+            if (cache) {
+                PackageCache::GetFileStamp(staging.SourcePath(i), stamps[i].size, stamps[i].lastWriteTime);
+            }
+            if (compress) {
+                readPaths.push_back(staging.SourcePath(i));
+            }
+        }
+    }
+    
+    SourceReadAhead reader(m_logger);
+    if (!reader.Start(std::move(readPaths), MsixWriter::BatchSize)) {
+        return false;
+    }
+    m_logger.Verbose() << L"Reading files with the " << FileIoEngine::BackendName(reader.Backend()) << L" I/O engine";
+    
+    size_t reusedFiles = 0;
+    uint64_t reusedBytes = 0;
+    
+    for (size_t i = 0; i < staging.Size(); i++) {
+        fs::path relativePath = staging.RelativePath(i);
+        fs::path sourcePath = staging.SourcePath(i);
+        std::wstring name = relativePath.wstring();
+        bool compress = MsixWriter::ShouldCompress(relativePath, m_options.storeWeights);
+        MsixEntryData data;
+        
+        auto addFile = [&](std::ostream* copyTo) {
+            return compress ? writer.AddFile(name, reader, true, data, copyTo) : writer.AddFile(name, sourcePath, false, data, copyTo);
+        };
+        
+        if (!cache) {
+            if (!addFile(nullptr)) {
+                return false;
+            }
+            continue;
+        }
+        
+        // Unchanged files are copied from the cache without being compressed again
+        std::wstring cacheKey = packageName + L"\\" + name;
+        if (!blobPaths[i].empty()) {
+            const fs::path& blobPath = blobPaths[i];
+            data = std::move(cachedData[i]);
+            std::ifstream blob(blobPath, std::ios::binary);
+            if (!blob || !writer.AddCompressedFile(name, data, blob)) {
+                m_logger.Error() << L"Failed to copy cached entry for: " << name;
+                return false;
+            }
+            
+            m_logger.Verbose() << L"Reused cached entry for: " << name;
+            reusedFiles++;
+            reusedBytes += data.uncompressedSize;
+            continue;
+        }
+        
+        fs::path temporaryBlobPath = cache->CreateTemporaryBlobPath();
+        bool added = false;
+        bool blobWritten = false;
+        {
+            std::ofstream blob(temporaryBlobPath, std::ios::binary | std::ios::trunc);
+            added = addFile(blob ? &blob : nullptr);
+            blob.close();
+            blobWritten = !blob.fail();
+        }
+        
+        if (added && blobWritten) {
+            cache->Store(cacheKey, sourcePath, stamps[i], data, temporaryBlobPath);
+        }
+        else {
+            std::error_code error;
+            fs::remove(temporaryBlobPath, error);
+        }
+        
+        if (!added) {
+            return false;
+        }
+    }
+    
+    if (!writer.Finish()) {
+        return false;
+    }
+    
+    if (cache) {
+        cache->Save();
+        m_logger.Info() << L"Reused " << reusedFiles << L" of " << staging.Size() << L" files ("
+                        << reusedBytes << L" bytes) from the package cache";
+    }
+    
+    return true;
+}
+
+bool MsixPackager::WriteMappingFile(const PackageStaging& staging, const fs::path& mappingPath)
+{
+    std::ofstream mapping(mappingPath, std::ios::binary | std::ios::trunc);
+    if (!mapping) {
+        m_logger.Error() << L"Failed to create MakeAppx mapping file: " << mappingPath.wstring();
+        return false;
+    }
+    
+    // UTF-8 with a byte order mark, one quoted source and package path per line
+    mapping << "\xEF\xBB\xBF[Files]\r\n";
+    for (size_t i = 0; i < staging.Size(); i++) {
+        fs::path relativePath = staging.RelativePath(i);
+        mapping << "\"" << winrt::to_string(staging.SourcePath(i).wstring()) << "\" \""
+                << winrt::to_string(relativePath.wstring()) << "\"\r\n";
+    }
+    
+    mapping.close();
+    if (mapping.fail()) {
+        m_logger.Error() << L"Failed to write MakeAppx mapping file: " << mappingPath.wstring();
+        return false;
+    }
+    
+    return true;
+}
+
+bool MsixPackager::SignMsixPackage(
+    const fs::path& msixPath,
+    const fs::path& certPath,
+    const std::wstring& certPassword)
+{
+    // Validate inputs
+    if (!fs::exists(msixPath)) {
+        m_logger.Error() << L"Error: MSIX package does not exist: " << msixPath.wstring();
+        return false;
+    }
+    
+    if (!fs::exists(certPath)) {
+        m_logger.Error() << L"Error: Certificate file does not exist: " << certPath.wstring();
+        return false;
+    }
+    
+    // Create a certificate manager and sign the package
+    CertificateManager certManager(m_logger, m_cancellationToken);
+    TraceSpan signSpan("sign", msixPath.filename().wstring());
+    return certManager.SignPackage(msixPath, certPath, certPassword);
+}
+
+std::wstring MsixPackager::CleanNameForPackage(const std::wstring& name)
+{
+    // Remove invalid characters and ensure it meets MSIX naming requirements
+    std::wstring cleanName = name;
+    
+    // Replace invalid characters with underscores
+    std::wregex invalidChars(L"[^a-zA-Z0-9_.-]");
+    cleanName = std::regex_replace(cleanName, invalidChars, L"_");
+    
+    // Ensure it starts with a letter or number
+    if (!cleanName.empty() && !(std::isalpha(cleanName[0]) || std::isdigit(cleanName[0]))) {
+        cleanName = L"App_" + cleanName;
+    }
+    
+    // If the name is empty, use a default
+    if (cleanName.empty()) {
+        cleanName = L"ModelPackage";
+    }
+    
+    return cleanName;
+}
\ No newline at end of file
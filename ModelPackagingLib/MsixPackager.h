@@ -0,0 +1,85 @@
+#pragma once
+
+#include <string>
+#include <filesystem>
+#include "Logger.h"
+#include "CancellationToken.h"
+#include "SourceScanner.h"
+#include "PackageStaging.h"
+
+namespace fs = std::filesystem;
+
+// How CreateMsixPackage builds the package
+struct MsixPackagerOptions
+{
+    bool useMakeAppx = false;       // Build with MakeAppx.exe from the Windows SDK instead of the built-in writer
+    fs::path cacheFolder;           // Reuse compressed files from earlier runs (built-in writer only)
+    bool blockClone = false;        // Clone the blocks of stored files into the package on ReFS (built-in writer only)
+    bool storeWeights = false;      // Store model weights instead of deflating them (built-in writer only)
+    SourceScanOptions scanOptions;  // Which files of the source folder are packaged
+};
+
+class MsixPackager
+{
+public:
+    MsixPackager(
+        Logger logger = Logger(),
+        CancellationToken cancellationToken = CancellationToken(),
+        MsixPackagerOptions options = MsixPackagerOptions());
+    ~MsixPackager() = default;
+
+    // Create an MSIX package from a folder, optionally reporting the path of the written package
+    bool CreateMsixPackage(
+        const fs::path& sourceFolder,
+        const fs::path& outputMsixPath,
+        const std::wstring& packageName = L"",
+        const std::wstring& publisherName = L"",
+        fs::path* createdPackagePath = nullptr);
+
+    // Sign an MSIX package
+    bool SignMsixPackage(
+        const fs::path& msixPath,
+        const fs::path& certPath,
+        const std::wstring& certPassword = L"");
+        
+    // Clean a name for use in the package manifest
+    std::wstring CleanNameForPackage(const std::wstring& name);
+    
+    // Path of the package CreateMsixPackage writes for the given output path and names
+    fs::path ResolveOutputPath(
+        const fs::path& outputMsixPath,
+        const std::wstring& packageName,
+        const std::wstring& publisherName);
+
+private:
+    // Generate an AppxManifest.xml into the staging folder, for a source folder that has none
+    bool CreateAppxManifest(
+        PackageStaging& staging,
+        const std::wstring& packageName,
+        const std::wstring& publisherName);
+    
+    // Build the MSIX package from the listed files using MakeAppx.exe
+    bool BuildMsixPackage(
+        const PackageStaging& staging,
+        const fs::path& outputMsixPath,
+        const std::wstring& packageName);
+    
+    // Build the MSIX package from the listed files with the built-in writer, reusing cached entries of unchanged files
+    bool WriteMsixPackage(
+        const PackageStaging& staging,
+        const fs::path& outputMsixPath,
+        const std::wstring& packageName);
+    
+    // Write a MakeAppx.exe mapping file that lists the files to package
+    bool WriteMappingFile(const PackageStaging& staging, const fs::path& mappingPath);
+    
+    // Find the Windows SDK path (looked up once per process)
+    fs::path FindWindowsSDKPath();
+    
+    // Locate the Windows SDK bin path from the registry
+    static fs::path LocateWindowsSDKPath();
+    
+    Logger m_logger;
+    CancellationToken m_cancellationToken;
+    MsixPackagerOptions m_options;
+};
\ No newline at end of file
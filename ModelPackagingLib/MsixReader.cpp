@@ -0,0 +1,331 @@
+#include "MsixReader.h"
+#include "ZipCentralDirectory.h"
+#include <algorithm>
+#include <cstring>
+#include <winrt/base.h>
+#include <zlib.h>
+
+namespace {
+    constexpr uint16_t MethodStored = 0;
+    constexpr uint16_t MethodDeflate = 8;
+
+    // Bytes handed to zlib at a time; its counters are 32-bit
+    constexpr uint64_t MaxInflateChunk = 1ull << 30;
+
+    // Part names are ASCII case-insensitive, and callers may use Windows separators
+    char FoldNameChar(char c)
+    {
+        if (c == '\\') {
+            return '/';
+        }
+        if (c >= 'A' && c <= 'Z') {
+            return static_cast<char>(c - 'A' + 'a');
+        }
+        return c;
+    }
+
+    // FNV-1a over the folded name
+    uint64_t HashName(std::string_view name)
+    {
+        uint64_t hash = 0xcbf29ce484222325ull;
+        for (char c : name) {
+            hash ^= static_cast<uint8_t>(FoldNameChar(c));
+            hash *= 0x100000001b3ull;
+        }
+        return hash;
+    }
+
+    bool NamesEqual(std::string_view a, std::string_view b)
+    {
+        return a.size() == b.size() &&
+            std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) { return FoldNameChar(x) == FoldNameChar(y); });
+    }
+
+    std::wstring DisplayName(std::string_view name)
+    {
+        return std::wstring(winrt::to_hstring(std::string(name)));
+    }
+}
+
+void MsixEntryStream::StreamDeleter::operator()(z_stream_s* stream) const
+{
+    inflateEnd(stream);
+    delete stream;
+}
+
+MsixEntryStream::MsixEntryStream()
+    : m_data(nullptr),
+      m_compressedSize(0),
+      m_size(0),
+      m_position(0),
+      m_consumed(0),
+      m_expectedCrc(0),
+      m_crc(0),
+      m_failed(false)
+{
+}
+
+MsixEntryStream::~MsixEntryStream() = default;
+
+MsixEntryStream::MsixEntryStream(MsixEntryStream&& other) noexcept = default;
+
+MsixEntryStream& MsixEntryStream::operator=(MsixEntryStream&& other) noexcept = default;
+
+size_t MsixEntryStream::Read(void* buffer, size_t size)
+{
+    if (m_failed || m_position >= m_size || size == 0) {
+        return 0;
+    }
+    
+    size = static_cast<size_t>((std::min)({ static_cast<uint64_t>(size), m_size - m_position, MaxInflateChunk }));
+    
+    if (!m_stream) {
+        std::memcpy(buffer, m_data + m_position, size);
+    }
+    else {
+        m_stream->next_out = static_cast<Bytef*>(buffer);
+        m_stream->avail_out = static_cast<uInt>(size);
+        
+        while (m_stream->avail_out > 0) {
+            if (m_stream->avail_in == 0) {
+                uint64_t chunk = (std::min)(MaxInflateChunk, m_compressedSize - m_consumed);
+                if (chunk == 0) {
+                    break;
+                }
+                
+                m_stream->next_in = const_cast<Bytef*>(m_data + m_consumed);
+                m_stream->avail_in = static_cast<uInt>(chunk);
+                m_consumed += chunk;
+            }
+            
+            int status = inflate(m_stream.get(), Z_NO_FLUSH);
+            if (status != Z_OK) {
+                break;
+            }
+        }
+        
+        // The stream ended, ran out or was damaged before the entry was complete
+        if (m_stream->avail_out > 0) {
+            m_failed = true;
+            return 0;
+        }
+    }
+    
+    m_crc = static_cast<uint32_t>(crc32(m_crc, static_cast<const Bytef*>(buffer), static_cast<uInt>(size)));
+    m_position += size;
+    
+    if (m_position == m_size && m_crc != m_expectedCrc) {
+        m_failed = true;
+        return 0;
+    }
+    
+    return size;
+}
+
+uint64_t MsixEntryStream::Size() const
+{
+    return m_size;
+}
+
+uint64_t MsixEntryStream::Position() const
+{
+    return m_position;
+}
+
+bool MsixEntryStream::Failed() const
+{
+    return m_failed;
+}
+
+MsixReader::MsixReader(Logger logger)
+    : m_logger(std::move(logger))
+{
+}
+
+bool MsixReader::Open(const fs::path& packagePath)
+{
+    m_names.clear();
+    m_entries.clear();
+    m_index.clear();
+    
+    ZipCentralDirectory directory;
+    if (!m_package.Open(packagePath, m_logger) ||
+        !directory.Read(m_package.Data(), m_package.Size(), packagePath, m_logger)) {
+        m_package.Close();
+        return false;
+    }
+    
+    // The names are gathered into one buffer before any view of them is taken
+    const auto& zipEntries = directory.Entries();
+    std::vector<size_t> nameOffsets;
+    nameOffsets.reserve(zipEntries.size() + 1);
+    
+    for (const auto& zipEntry : zipEntries) {
+        nameOffsets.push_back(m_names.size());
+        m_names += ZipCentralDirectory::DecodePartNameUtf8(zipEntry.name);
+    }
+    nameOffsets.push_back(m_names.size());
+    
+    m_entries.reserve(zipEntries.size());
+    for (size_t i = 0; i < zipEntries.size(); i++) {
+        MsixReaderEntry entry;
+        entry.name = std::string_view(m_names).substr(nameOffsets[i], nameOffsets[i + 1] - nameOffsets[i]);
+        entry.compressionMethod = zipEntries[i].compressionMethod;
+        entry.crc32 = zipEntries[i].crc32;
+        entry.compressedSize = zipEntries[i].compressedSize;
+        entry.uncompressedSize = zipEntries[i].uncompressedSize;
+        entry.localHeaderOffset = zipEntries[i].localHeaderOffset;
+        m_entries.push_back(entry);
+    }
+    
+    // At most half the slots are used, so probes stay short and always reach an empty slot
+    size_t slotCount = 1;
+    while (slotCount < m_entries.size() * 2) {
+        slotCount <<= 1;
+    }
+    
+    m_index.assign(slotCount, 0);
+    size_t mask = slotCount - 1;
+    
+    for (size_t i = 0; i < m_entries.size(); i++) {
+        size_t slot = static_cast<size_t>(HashName(m_entries[i].name)) & mask;
+        bool duplicate = false;
+        
+        while (m_index[slot] != 0 && !duplicate) {
+            duplicate = NamesEqual(m_entries[m_index[slot] - 1].name, m_entries[i].name);
+            slot = (slot + 1) & mask;
+        }
+        
+        // A name that appears twice resolves to its first entry
+        if (duplicate) {
+            m_logger.Warning() << L"Package has more than one entry named " << DisplayName(m_entries[i].name);
+            continue;
+        }
+        
+        m_index[slot] = static_cast<uint32_t>(i + 1);
+    }
+    
+    m_logger.Verbose() << L"Indexed " << m_entries.size() << L" entries of " << packagePath.wstring();
+    return true;
+}
+
+const std::vector<MsixReaderEntry>& MsixReader::Entries() const
+{
+    return m_entries;
+}
+
+const MsixReaderEntry* MsixReader::Find(std::string_view name) const
+{
+    while (!name.empty() && (name.front() == '/' || name.front() == '\\')) {
+        name.remove_prefix(1);
+    }
+    
+    if (m_index.empty()) {
+        return nullptr;
+    }
+    
+    size_t mask = m_index.size() - 1;
+    for (size_t slot = static_cast<size_t>(HashName(name)) & mask; m_index[slot] != 0; slot = (slot + 1) & mask) {
+        const MsixReaderEntry& entry = m_entries[m_index[slot] - 1];
+        if (NamesEqual(entry.name, name)) {
+            return &entry;
+        }
+    }
+    
+    return nullptr;
+}
+
+const MsixReaderEntry* MsixReader::Find(const std::wstring& name) const
+{
+    return Find(std::string_view(winrt::to_string(name)));
+}
+
+bool MsixReader::GetView(const MsixReaderEntry& entry, std::span<const uint8_t>& view) const
+{
+    const uint8_t* data = nullptr;
+    if (entry.compressionMethod != MethodStored || entry.compressedSize != entry.uncompressedSize || !FindData(entry, data)) {
+        return false;
+    }
+    
+    view = std::span<const uint8_t>(data, static_cast<size_t>(entry.uncompressedSize));
+    return true;
+}
+
+bool MsixReader::OpenStream(const MsixReaderEntry& entry, MsixEntryStream& stream) const
+{
+    if (entry.compressionMethod != MethodStored && entry.compressionMethod != MethodDeflate) {
+        m_logger.Error() << L"Unsupported compression method " << entry.compressionMethod << L" for " << DisplayName(entry.name);
+        return false;
+    }
+    
+    if (entry.compressionMethod == MethodStored && entry.compressedSize != entry.uncompressedSize) {
+        m_logger.Error() << L"Stored entry has different compressed and uncompressed sizes: " << DisplayName(entry.name);
+        return false;
+    }
+    
+    const uint8_t* data = nullptr;
+    if (!FindData(entry, data)) {
+        return false;
+    }
+    
+    MsixEntryStream opened;
+    opened.m_data = data;
+    opened.m_compressedSize = entry.compressedSize;
+    opened.m_size = entry.uncompressedSize;
+    opened.m_expectedCrc = entry.crc32;
+    
+    if (entry.compressionMethod == MethodDeflate) {
+        opened.m_stream.reset(new z_stream_s());
+        if (inflateInit2(opened.m_stream.get(), -MAX_WBITS) != Z_OK) {
+            m_logger.Error() << L"Failed to start inflating " << DisplayName(entry.name);
+            return false;
+        }
+    }
+    
+    stream = std::move(opened);
+    return true;
+}
+
+bool MsixReader::ReadEntry(const MsixReaderEntry& entry, std::vector<uint8_t>& content) const
+{
+    content.clear();
+    
+    MsixEntryStream stream;
+    if (!OpenStream(entry, stream)) {
+        return false;
+    }
+    
+    content.resize(static_cast<size_t>(entry.uncompressedSize));
+    size_t position = 0;
+    while (position < content.size()) {
+        size_t read = stream.Read(content.data() + position, content.size() - position);
+        if (read == 0) {
+            break;
+        }
+        position += read;
+    }
+    
+    if (position != content.size() || stream.Failed()) {
+        m_logger.Error() << L"Damaged package entry: " << DisplayName(entry.name);
+        content.clear();
+        return false;
+    }
+    
+    return true;
+}
+
+bool MsixReader::FindData(const MsixReaderEntry& entry, const uint8_t*& data) const
+{
+    ZipEntry zipEntry;
+    zipEntry.localHeaderOffset = entry.localHeaderOffset;
+    
+    uint64_t dataOffset = 0;
+    if (!ZipCentralDirectory::FindDataOffset(m_package.Data(), m_package.Size(), zipEntry, dataOffset) ||
+        !m_package.Contains(dataOffset, entry.compressedSize)) {
+        m_logger.Error() << L"Entry data lies outside the package: " << DisplayName(entry.name);
+        return false;
+    }
+    
+    data = m_package.Data() + dataOffset;
+    return true;
+}
\ No newline at end of file
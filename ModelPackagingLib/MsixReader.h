@@ -0,0 +1,122 @@
+#pragma once
+
+#include <span>
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <string_view>
+#include <filesystem>
+#include "Logger.h"
+#include "MappedFile.h"
+
+namespace fs = std::filesystem;
+
+struct z_stream_s;
+
+// One file of a package opened with MsixReader
+struct MsixReaderEntry
+{
+    std::string_view name;          // Decoded UTF-8 path with forward slashes, e.g. onnx/model.onnx
+    uint16_t compressionMethod = 0; // 0 = stored, 8 = deflate
+    uint32_t crc32 = 0;
+    uint64_t compressedSize = 0;
+    uint64_t uncompressedSize = 0;
+    uint64_t localHeaderOffset = 0;
+};
+
+// Sequential reader of one entry's content. Stored entries are copied straight out of the mapped
+// package and deflated entries are inflated as they are read. The CRC is checked when the last byte
+// has been read, so a damaged entry fails on its final Read.
+class MsixEntryStream
+{
+public:
+    MsixEntryStream();
+    ~MsixEntryStream();
+
+    MsixEntryStream(MsixEntryStream&& other) noexcept;
+    MsixEntryStream& operator=(MsixEntryStream&& other) noexcept;
+
+    MsixEntryStream(const MsixEntryStream&) = delete;
+    MsixEntryStream& operator=(const MsixEntryStream&) = delete;
+
+    // Read up to size bytes, returning the number read: 0 at the end of the entry or once it has failed
+    size_t Read(void* buffer, size_t size);
+
+    // Uncompressed size of the entry
+    uint64_t Size() const;
+
+    // Bytes read so far
+    uint64_t Position() const;
+
+    // Whether the entry's data turned out to be damaged
+    bool Failed() const;
+
+private:
+    friend class MsixReader;
+
+    struct StreamDeleter
+    {
+        void operator()(z_stream_s* stream) const;
+    };
+
+    const uint8_t* m_data;          // Compressed data in the mapped package
+    uint64_t m_compressedSize;
+    uint64_t m_size;
+    uint64_t m_position;
+    uint64_t m_consumed;            // Compressed bytes handed to the inflater
+    uint32_t m_expectedCrc;
+    uint32_t m_crc;
+    bool m_failed;
+    std::unique_ptr<z_stream_s, StreamDeleter> m_stream;   // nullptr for stored entries
+};
+
+// Random access to the files of an MSIX package, for loading model weights at run time.
+//
+// The package is mapped into memory and its central directory is parsed once into a compact table
+// and an open-addressing hash index, so finding a file takes one hash and one comparison however
+// many files the package has. Nothing is read from a file until it is asked for: stored entries are
+// returned as views of the mapping without a copy, and deflated entries are inflated as they are
+// streamed. Lookups and views may be used from any number of threads at once, as may separate
+// streams; the reader must outlive the views and streams it returns.
+class MsixReader
+{
+public:
+    MsixReader(Logger logger = Logger());
+    ~MsixReader() = default;
+
+    MsixReader(const MsixReader&) = delete;
+    MsixReader& operator=(const MsixReader&) = delete;
+
+    // Map a package and index its entries, replacing any package opened before
+    bool Open(const fs::path& packagePath);
+
+    // Entries in central directory order
+    const std::vector<MsixReaderEntry>& Entries() const;
+
+    // Find an entry by its path in the package, ignoring ASCII case and accepting either kind of
+    // slash, or nullptr
+    const MsixReaderEntry* Find(std::string_view name) const;
+    const MsixReaderEntry* Find(const std::wstring& name) const;
+
+    // Zero-copy view of a stored entry's bytes in the mapped package. Returns false for deflated
+    // entries and for entries whose data lies outside the package. The bytes are not checked
+    // against the entry's CRC.
+    bool GetView(const MsixReaderEntry& entry, std::span<const uint8_t>& view) const;
+
+    // Open a stream over an entry's uncompressed content
+    bool OpenStream(const MsixReaderEntry& entry, MsixEntryStream& stream) const;
+
+    // Read a whole entry into memory, checking its CRC
+    bool ReadEntry(const MsixReaderEntry& entry, std::vector<uint8_t>& content) const;
+
+private:
+    // Locate an entry's data after its local file header
+    bool FindData(const MsixReaderEntry& entry, const uint8_t*& data) const;
+
+    Logger m_logger;
+    MappedFile m_package;
+    std::string m_names;                    // Every entry's name, back to back
+    std::vector<MsixReaderEntry> m_entries;
+    std::vector<uint32_t> m_index;          // Entry index + 1 by name hash, 0 for an empty slot
+};
\ No newline at end of file
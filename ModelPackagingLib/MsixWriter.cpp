@@ -0,0 +1,1054 @@
+#include "MsixWriter.h"
+#include "TraceRecorder.h"
+#include "MappedFile.h"
+#include "FileDigests.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <cwctype>
+#include <deque>
+#include <execution>
+#include <map>
+#include <numeric>
+#include <winrt/base.h>
+#include <zlib.h>
+
+namespace {
+    constexpr uint32_t LocalFileHeaderSignature = 0x04034b50;
+    constexpr uint32_t CentralDirectoryHeaderSignature = 0x02014b50;
+    constexpr uint32_t Zip64EndOfCentralDirectorySignature = 0x06064b50;
+    constexpr uint32_t Zip64LocatorSignature = 0x07064b50;
+    constexpr uint32_t EndOfCentralDirectorySignature = 0x06054b50;
+    constexpr uint16_t Zip64ExtraFieldId = 0x0001;
+    constexpr uint16_t AlignmentExtraFieldId = 0xD935;     // The id zipalign pads local headers with
+
+    constexpr uint16_t ZipVersion = 20;
+    constexpr uint16_t Zip64Version = 45;
+    constexpr uint16_t MethodStored = 0;
+    constexpr uint16_t MethodDeflate = 8;
+    constexpr uint32_t Saturated32 = 0xFFFFFFFF;
+
+    // Timestamps are fixed at 1980-01-01 00:00 so identical inputs give identical packages
+    constexpr uint16_t DosTime = 0;
+    constexpr uint16_t DosDate = (1 << 5) | 1;
+
+    constexpr size_t LocalFileHeaderSize = 30;
+    constexpr size_t BlocksPerBatch = MsixWriter::BatchSize / AppxBlockMap::BlockSize;
+    constexpr size_t CopyChunkSize = 1024 * 1024;
+
+    // The package is written from StagingBuffers buffers of StagingSize bytes each
+    constexpr size_t StagingSize = 1024 * 1024;
+    constexpr size_t StagingBuffers = 8;
+
+    // Stored files at least this large are written from their view instead of the staging buffers
+    constexpr uint64_t DirectWriteThreshold = StagingSize;
+
+    // Worst-case growth of a deflated block over its input, including the sync flush marker
+    constexpr uint64_t MaxBlockExpansion = 64;
+
+    // ZIP fields are little-endian
+    void PutUInt16(std::vector<uint8_t>& out, uint16_t value)
+    {
+        out.push_back(static_cast<uint8_t>(value));
+        out.push_back(static_cast<uint8_t>(value >> 8));
+    }
+
+    void PutUInt32(std::vector<uint8_t>& out, uint32_t value)
+    {
+        PutUInt16(out, static_cast<uint16_t>(value));
+        PutUInt16(out, static_cast<uint16_t>(value >> 16));
+    }
+
+    void PutUInt64(std::vector<uint8_t>& out, uint64_t value)
+    {
+        PutUInt32(out, static_cast<uint32_t>(value));
+        PutUInt32(out, static_cast<uint32_t>(value >> 32));
+    }
+
+    uint32_t Saturate(uint64_t value)
+    {
+        return value >= Saturated32 ? Saturated32 : static_cast<uint32_t>(value);
+    }
+
+    std::wstring ToLower(std::wstring value)
+    {
+        std::transform(value.begin(), value.end(), value.begin(), ::towlower);
+        return value;
+    }
+
+    const char* ContentTypeForExtension(const std::wstring& extension)
+    {
+        static const std::map<std::wstring, const char*> contentTypes = {
+            { L"xml", "application/xml" },
+            { L"json", "application/json" },
+            { L"txt", "text/plain" },
+            { L"md", "text/markdown" },
+            { L"png", "image/png" },
+            { L"jpg", "image/jpeg" },
+            { L"jpeg", "image/jpeg" },
+        };
+
+        auto match = contentTypes.find(extension);
+        return match != contentTypes.end() ? match->second : "application/octet-stream";
+    }
+}
+
+MsixWriter::MsixWriter(Logger logger, CancellationToken cancellationToken)
+    : m_logger(std::move(logger)),
+      m_cancellationToken(std::move(cancellationToken)),
+      m_position(0),
+      m_finished(false),
+      m_blockCloning(false),
+      m_stagingIndex(0),
+      m_stagingFilled(0),
+      m_stagingOffset(0),
+      m_writeFailed(false),
+      m_engine(m_logger),
+      m_packageFile(static_cast<size_t>(-1)),
+      m_entryWritten(0),
+      m_entryOpen(false)
+{
+}
+
+MsixWriter::~MsixWriter()
+{
+    Drain();
+    m_engine.CloseFile(m_packageFile);
+    
+    // Don't leave a truncated package behind
+    if (!m_finished && !m_packagePath.empty()) {
+        std::error_code error;
+        fs::remove(m_packagePath, error);
+    }
+}
+
+bool MsixWriter::Open(const fs::path& packagePath)
+{
+    m_packagePath = packagePath;
+    
+    m_staging.reset(static_cast<uint8_t*>(VirtualAlloc(nullptr, StagingBuffers * StagingSize, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE)));
+    m_stagedWrites.assign(StagingBuffers, StagedWrite());
+    
+    // One request more than there are buffers leaves room for a header patch
+    if (!m_staging || !m_engine.Start(FileIoEngine::DefaultBackend(), StagingBuffers + 1, m_staging.get(), StagingBuffers * StagingSize)) {
+        m_logger.Error() << L"Failed to set up writing of package file: " << packagePath.wstring();
+        return false;
+    }
+    
+    m_packageFile = m_engine.OpenFile(packagePath, true);
+    if (m_packageFile == static_cast<size_t>(-1)) {
+        m_logger.Error() << L"Failed to create package file: " << packagePath.wstring();
+        return false;
+    }
+    
+    return true;
+}
+
+void MsixWriter::SetBlockCloning(bool enabled)
+{
+    m_blockCloning = enabled;
+}
+
+bool MsixWriter::AddFile(
+    const std::wstring& name,
+    const fs::path& sourcePath,
+    bool compress,
+    MsixEntryData& data,
+    std::ostream* copyTo)
+{
+    if (!compress) {
+        return AddStoredFile(name, sourcePath, data, copyTo);
+    }
+    
+    std::ifstream source(sourcePath, std::ios::binary);
+    if (!source) {
+        m_logger.Error() << L"Failed to open file for packaging: " << sourcePath.wstring();
+        return false;
+    }
+    
+    std::error_code sizeError;
+    uint64_t fileSize = fs::file_size(sourcePath, sizeError);
+    if (sizeError) {
+        m_logger.Error() << L"Failed to read the size of: " << sourcePath.wstring();
+        return false;
+    }
+    
+    return AddStream(name, source, fileSize, compress, data, copyTo);
+}
+
+bool MsixWriter::AddFile(
+    const std::wstring& name,
+    SourceReadAhead& source,
+    bool compress,
+    MsixEntryData& data,
+    std::ostream* copyTo)
+{
+    fs::path sourcePath;
+    uint64_t fileSize = 0;
+    if (!source.NextFile(sourcePath, fileSize)) {
+        m_logger.Error() << L"Failed to open file for packaging: " << (sourcePath.empty() ? name : sourcePath.wstring());
+        return false;
+    }
+    
+    return AddBlocks(name, fileSize, compress, data, copyTo, [&source](size_t size) { return source.Read(size); });
+}
+
+bool MsixWriter::AddStream(
+    const std::wstring& name,
+    std::istream& source,
+    uint64_t fileSize,
+    bool compress,
+    MsixEntryData& data,
+    std::ostream* copyTo)
+{
+    std::vector<uint8_t> input(static_cast<size_t>((std::min)(fileSize, static_cast<uint64_t>(BatchSize))));
+    
+    return AddBlocks(name, fileSize, compress, data, copyTo, [&](size_t size) -> const uint8_t* {
+        source.read(reinterpret_cast<char*>(input.data()), static_cast<std::streamsize>(size));
+        return source.gcount() == static_cast<std::streamsize>(size) ? input.data() : nullptr;
+    });
+}
+
+bool MsixWriter::AddBlocks(
+    const std::wstring& name,
+    uint64_t fileSize,
+    bool compress,
+    MsixEntryData& data,
+    std::ostream* copyTo,
+    const std::function<const uint8_t*(size_t size)>& readBatch)
+{
+    TraceSpan compressSpan("compress", name);
+    
+    // Empty files are always stored; a deflate stream would be larger than the file
+    uint64_t blockCount = (fileSize + AppxBlockMap::BlockSize - 1) / AppxBlockMap::BlockSize;
+    compress = compress && fileSize > 0;
+    
+    data = MsixEntryData();
+    data.compressionMethod = compress ? MethodDeflate : MethodStored;
+    data.uncompressedSize = fileSize;
+    data.blocks.reserve(static_cast<size_t>(blockCount));
+    
+    // The local header is written before the data, so decide on ZIP64 from the worst-case compressed size
+    bool zip64 = NeedsZip64(data, blockCount);
+    
+    CentralDirectoryRecord record;
+    record.partName = EncodePartName(name);
+    record.localHeaderOffset = m_position;
+    record.zip64 = zip64;
+    
+    if (!WriteLocalHeader(record.partName, data, zip64)) {
+        return false;
+    }
+    
+    struct BlockResult
+    {
+        HashUtils::Sha256Digest hash;
+        uint32_t crc = 0;
+        std::vector<uint8_t> compressed;
+    };
+    
+    std::vector<BlockResult> results(BlocksPerBatch);
+    std::vector<size_t> indices(BlocksPerBatch);
+    std::iota(indices.begin(), indices.end(), size_t{ 0 });
+    
+    uint64_t remaining = fileSize;
+    uLong crc = crc32(0L, Z_NULL, 0);
+    
+    while (remaining > 0) {
+        if (m_cancellationToken.IsCancelled()) {
+            m_logger.Warning() << L"Packaging cancelled";
+            return false;
+        }
+        
+        size_t batchSize = static_cast<size_t>((std::min)(remaining, static_cast<uint64_t>(BatchSize)));
+        const uint8_t* input = readBatch(batchSize);
+        if (!input) {
+            m_logger.Error() << L"Failed to read file (was it modified while packaging?): " << name;
+            return false;
+        }
+        
+        bool lastBatch = batchSize == remaining;
+        size_t batchBlocks = (batchSize + AppxBlockMap::BlockSize - 1) / AppxBlockMap::BlockSize;
+        std::atomic<bool> compressionFailed = false;
+        
+        // Hash, checksum and deflate the blocks of the batch across all cores
+        std::for_each(std::execution::par, indices.begin(), indices.begin() + batchBlocks, [&](size_t i) {
+            const uint8_t* block = input + i * AppxBlockMap::BlockSize;
+            size_t blockSize = (std::min)(AppxBlockMap::BlockSize, batchSize - i * AppxBlockMap::BlockSize);
+            
+            BlockResult& result = results[i];
+            result.hash = HashUtils::Sha256(block, blockSize);
+            result.crc = crc32(0L, block, static_cast<uInt>(blockSize));
+            
+            if (compress && !CompressBlock(block, blockSize, lastBatch && i == batchBlocks - 1, result.compressed)) {
+                compressionFailed = true;
+            }
+        });
+        
+        if (compressionFailed) {
+            m_logger.Error() << L"Failed to compress: " << name;
+            return false;
+        }
+        
+        // Blocks are written in order, so the output is identical however the work was scheduled
+        for (size_t i = 0; i < batchBlocks; i++) {
+            size_t blockSize = (std::min)(AppxBlockMap::BlockSize, batchSize - i * AppxBlockMap::BlockSize);
+            const uint8_t* output = compress ? results[i].compressed.data() : input + i * AppxBlockMap::BlockSize;
+            size_t outputSize = compress ? results[i].compressed.size() : blockSize;
+            
+            if (!Write(output, outputSize)) {
+                return false;
+            }
+            
+            if (copyTo) {
+                copyTo->write(reinterpret_cast<const char*>(output), static_cast<std::streamsize>(outputSize));
+            }
+            
+            crc = crc32_combine(crc, results[i].crc, static_cast<z_off_t>(blockSize));
+            data.compressedSize += outputSize;
+            data.blocks.push_back(BlockMapBlock{ results[i].hash, compress ? static_cast<uint32_t>(outputSize) : 0 });
+        }
+        
+        remaining -= batchSize;
+    }
+    
+    data.crc32 = static_cast<uint32_t>(crc);
+    record.data = data;
+    record.data.blocks.clear();
+    
+    if (!PatchLocalHeader(record)) {
+        return false;
+    }
+    
+    AddToBlockMap(name, record.partName, data, zip64);
+    m_records.push_back(std::move(record));
+    compressSpan.SetBytes(fileSize);
+    return true;
+}
+
+bool MsixWriter::AddStoredFile(
+    const std::wstring& name,
+    const fs::path& sourcePath,
+    MsixEntryData& data,
+    std::ostream* copyTo)
+{
+    TraceSpan compressSpan("compress", name);
+    
+    MappedFile source;
+    if (!source.Open(sourcePath, m_logger)) {
+        return false;
+    }
+    
+    uint64_t fileSize = source.Size();
+    uint64_t blockCount = (fileSize + AppxBlockMap::BlockSize - 1) / AppxBlockMap::BlockSize;
+    
+    data = MsixEntryData();
+    data.compressionMethod = MethodStored;
+    data.uncompressedSize = fileSize;
+    data.compressedSize = fileSize;
+    data.blocks.reserve(static_cast<size_t>(blockCount));
+    
+    // Checksums taken while the file was downloaded spare reading it only to hash it
+    FileDigest digest;
+    bool digested = FileDigests::Instance().Take(sourcePath, digest) && digest.blockHashes.size() == blockCount;
+    if (digested) {
+        data.crc32 = digest.crc32;
+        for (const auto& hash : digest.blockHashes) {
+            data.blocks.push_back(BlockMapBlock{ hash, 0 });
+        }
+        m_logger.Verbose() << L"Using the checksums taken during the download of: " << name;
+    }
+    
+    CentralDirectoryRecord record;
+    record.partName = EncodePartName(name);
+    record.localHeaderOffset = m_position;
+    record.zip64 = NeedsZip64(data, blockCount);
+    record.data = data;
+    record.data.blocks.clear();
+    
+    // Cloned data has to start on a cluster boundary, which the padding in the local header moves it to;
+    // padding shorter than the extra field's own id and size takes another cluster
+    uint64_t cluster = m_blockCloning ? m_engine.CloneAlignment(m_packageFile, source.Handle()) : 0;
+    if (cluster > 0 && fileSize >= cluster) {
+        uint32_t zip64Extra = record.zip64 ? 20 : 0;
+        uint64_t dataOffset = m_position + LocalFileHeaderSize + record.partName.size() + zip64Extra;
+        uint64_t padding = (cluster - dataOffset % cluster) % cluster;
+        if (padding > 0 && padding < 4) {
+            padding += cluster;
+        }
+        record.padding = static_cast<uint32_t>(padding);
+        if (zip64Extra + padding > 0xFFFF) {
+            record.padding = 0;
+            cluster = 0;
+        }
+    }
+    else {
+        cluster = 0;
+    }
+    
+    if (!WriteLocalHeader(record.partName, record.data, record.zip64, record.padding)) {
+        return false;
+    }
+    
+    // Large files and cloned ones go to the package from the view, after what is in the staging buffers
+    bool direct = fileSize >= DirectWriteThreshold || cluster > 0;
+    if (direct && ((m_stagingFilled > 0 && !SubmitStaging()) || !Drain())) {
+        m_logger.Error() << L"Failed to write to package: " << m_packagePath.wstring() << L" (error " << m_engine.LastError() << L")";
+        return false;
+    }
+    
+    const uint8_t* view = source.Data();
+    uint64_t cloneEnd = cluster > 0 ? fileSize / cluster * cluster : 0;
+    uint64_t clonedBytes = 0;
+    std::deque<StagedWrite> directWrites;
+    
+    // Writes from the view are waited for before it is unmapped, whatever happens
+    auto waitForDirectWrite = [&]() {
+        uint32_t transferred = 0;
+        if (!m_engine.Wait(directWrites.front().ticket, transferred) || transferred != directWrites.front().size) {
+            m_writeFailed = true;
+        }
+        directWrites.pop_front();
+        return !m_writeFailed;
+    };
+    
+    auto writeRange = [&](uint64_t offset, uint64_t size) {
+        if (!direct) {
+            return Write(view + offset, static_cast<size_t>(size));
+        }
+        
+        // One request is left free for the header patch
+        if (directWrites.size() == StagingBuffers && !waitForDirectWrite()) {
+            return false;
+        }
+        
+        StagedWrite write;
+        write.offset = m_position;
+        write.size = static_cast<uint32_t>(size);
+        write.ticket = m_engine.Write(m_packageFile, write.offset, view + offset, write.size);
+        m_engine.Submit();
+        if (write.ticket == 0) {
+            m_writeFailed = true;
+            return false;
+        }
+        directWrites.push_back(write);
+        
+        m_position += size;
+        m_stagingOffset = m_position;
+        return true;
+    };
+    
+    std::vector<size_t> indices(BlocksPerBatch);
+    std::iota(indices.begin(), indices.end(), size_t{ 0 });
+    std::vector<BlockMapBlock> batchBlocks(BlocksPerBatch);
+    std::vector<uint32_t> batchCrcs(BlocksPerBatch);
+    uLong crc = crc32(0L, Z_NULL, 0);
+    bool succeeded = true;
+    
+    for (uint64_t offset = 0; offset < fileSize && succeeded; ) {
+        if (m_cancellationToken.IsCancelled()) {
+            m_logger.Warning() << L"Packaging cancelled";
+            succeeded = false;
+            break;
+        }
+        
+        size_t batchSize = static_cast<size_t>((std::min)(fileSize - offset, static_cast<uint64_t>(BatchSize)));
+        size_t blocks = (batchSize + AppxBlockMap::BlockSize - 1) / AppxBlockMap::BlockSize;
+        
+        // Hash and checksum the blocks of the batch across all cores, straight from the view
+        if (!digested) {
+            std::for_each(std::execution::par, indices.begin(), indices.begin() + blocks, [&](size_t i) {
+                const uint8_t* block = view + offset + i * AppxBlockMap::BlockSize;
+                size_t blockSize = (std::min)(AppxBlockMap::BlockSize, batchSize - i * AppxBlockMap::BlockSize);
+                batchBlocks[i].hash = HashUtils::Sha256(block, blockSize);
+                batchCrcs[i] = crc32(0L, block, static_cast<uInt>(blockSize));
+            });
+            
+            for (size_t i = 0; i < blocks; i++) {
+                size_t blockSize = (std::min)(AppxBlockMap::BlockSize, batchSize - i * AppxBlockMap::BlockSize);
+                crc = crc32_combine(crc, batchCrcs[i], static_cast<z_off_t>(blockSize));
+                data.blocks.push_back(batchBlocks[i]);
+            }
+        }
+        
+        // Whole clusters are cloned, and the rest of the file written; a volume that refuses the clone
+        // gets the rest of the file written too
+        uint64_t cloneSize = offset < cloneEnd ? (std::min)(static_cast<uint64_t>(batchSize), cloneEnd - offset) : 0;
+        if (cloneSize > 0) {
+            if (m_engine.CloneFrom(m_packageFile, m_position, source.Handle(), offset, cloneSize)) {
+                m_position += cloneSize;
+                m_stagingOffset = m_position;
+                clonedBytes += cloneSize;
+            }
+            else {
+                m_logger.Verbose() << L"Writing " << name << L" instead of cloning its blocks (error " << m_engine.LastError() << L")";
+                cloneEnd = 0;
+                cloneSize = 0;
+            }
+        }
+        
+        if (cloneSize < batchSize && !writeRange(offset + cloneSize, batchSize - cloneSize)) {
+            succeeded = false;
+        }
+        
+        if (copyTo) {
+            copyTo->write(reinterpret_cast<const char*>(view + offset), static_cast<std::streamsize>(batchSize));
+        }
+        
+        offset += batchSize;
+    }
+    
+    while (!directWrites.empty()) {
+        succeeded = waitForDirectWrite() && succeeded;
+    }
+    if (!succeeded) {
+        if (direct && m_writeFailed) {
+            m_logger.Error() << L"Failed to write to package: " << m_packagePath.wstring() << L" (error " << m_engine.LastError() << L")";
+        }
+        return false;
+    }
+    
+    // The header was written with the checksum when it came from the download
+    if (!digested) {
+        data.crc32 = static_cast<uint32_t>(crc);
+        record.data.crc32 = data.crc32;
+        if (!PatchLocalHeader(record)) {
+            return false;
+        }
+    }
+    
+    if (clonedBytes > 0) {
+        m_logger.Verbose() << L"Cloned " << clonedBytes << L" of " << fileSize << L" bytes of: " << name;
+    }
+    
+    AddToBlockMap(name, record.partName, data, record.zip64, record.padding);
+    m_records.push_back(std::move(record));
+    compressSpan.SetBytes(fileSize);
+    return true;
+}
+
+bool MsixWriter::AddCompressedFile(
+    const std::wstring& name,
+    const MsixEntryData& data,
+    std::istream& compressedStream)
+{
+    TraceSpan copySpan("copy", name);
+    
+    if (!BeginEntry(name, data)) {
+        return false;
+    }
+    
+    std::vector<char> buffer(CopyChunkSize);
+    uint64_t remaining = data.compressedSize;
+    
+    while (remaining > 0) {
+        if (m_cancellationToken.IsCancelled()) {
+            m_logger.Warning() << L"Packaging cancelled";
+            return false;
+        }
+        
+        size_t chunkSize = static_cast<size_t>((std::min)(remaining, static_cast<uint64_t>(buffer.size())));
+        compressedStream.read(buffer.data(), static_cast<std::streamsize>(chunkSize));
+        if (compressedStream.gcount() != static_cast<std::streamsize>(chunkSize)) {
+            m_logger.Error() << L"Compressed data ended early for: " << name;
+            return false;
+        }
+        
+        if (!WriteEntryData(buffer.data(), chunkSize)) {
+            return false;
+        }
+        
+        remaining -= chunkSize;
+    }
+    
+    copySpan.SetBytes(data.compressedSize);
+    return EndEntry(data.blocks);
+}
+
+bool MsixWriter::BeginEntry(const std::wstring& name, const MsixEntryData& data)
+{
+    if (m_entryOpen) {
+        m_logger.Error() << L"Package entry started before the previous one was finished: " << name;
+        return false;
+    }
+    
+    uint64_t blockCount = (data.uncompressedSize + AppxBlockMap::BlockSize - 1) / AppxBlockMap::BlockSize;
+    
+    m_entryName = name;
+    m_entryRecord = CentralDirectoryRecord();
+    m_entryRecord.partName = EncodePartName(name);
+    m_entryRecord.localHeaderOffset = m_position;
+    m_entryRecord.zip64 = NeedsZip64(data, blockCount);
+    m_entryRecord.data = data;
+    m_entryRecord.data.blocks.clear();
+    m_entryWritten = 0;
+    
+    if (!WriteLocalHeader(m_entryRecord.partName, data, m_entryRecord.zip64)) {
+        return false;
+    }
+    
+    m_entryOpen = true;
+    return true;
+}
+
+bool MsixWriter::WriteEntryData(const void* buffer, size_t size)
+{
+    if (!m_entryOpen || m_entryWritten + size > m_entryRecord.data.compressedSize) {
+        m_logger.Error() << L"Compressed data is longer than the package entry: " << m_entryName;
+        return false;
+    }
+    
+    m_entryWritten += size;
+    return Write(buffer, size);
+}
+
+bool MsixWriter::EndEntry(const std::vector<BlockMapBlock>& blocks)
+{
+    if (!m_entryOpen || m_entryWritten != m_entryRecord.data.compressedSize) {
+        m_logger.Error() << L"Compressed data ended early for: " << m_entryName;
+        return false;
+    }
+    
+    MsixEntryData data = m_entryRecord.data;
+    data.blocks = blocks;
+    AddToBlockMap(m_entryName, m_entryRecord.partName, data, m_entryRecord.zip64);
+    m_records.push_back(std::move(m_entryRecord));
+    m_entryOpen = false;
+    return true;
+}
+
+bool MsixWriter::Finish()
+{
+    {
+        TraceSpan blockMapSpan("blockmap", L"AppxBlockMap.xml");
+        if (!AddGeneratedFile(L"AppxBlockMap.xml", m_blockMap.ToXml()) ||
+            !AddGeneratedFile(L"[Content_Types].xml", BuildContentTypes())) {
+            return false;
+        }
+    }
+    
+    uint64_t directoryOffset = m_position;
+    std::vector<uint8_t> directory;
+    
+    for (const auto& record : m_records) {
+        const MsixEntryData& data = record.data;
+        bool offsetSaturated = record.localHeaderOffset >= Saturated32;
+        bool needsZip64 = record.zip64 || offsetSaturated;
+        
+        // The ZIP64 extra field holds, in order, only the values saturated in the header
+        std::vector<uint8_t> extra;
+        if (needsZip64) {
+            std::vector<uint8_t> values;
+            if (record.zip64) {
+                PutUInt64(values, data.uncompressedSize);
+                PutUInt64(values, data.compressedSize);
+            }
+            if (offsetSaturated) {
+                PutUInt64(values, record.localHeaderOffset);
+            }
+            PutUInt16(extra, Zip64ExtraFieldId);
+            PutUInt16(extra, static_cast<uint16_t>(values.size()));
+            extra.insert(extra.end(), values.begin(), values.end());
+        }
+        
+        uint16_t version = needsZip64 ? Zip64Version : ZipVersion;
+        PutUInt32(directory, CentralDirectoryHeaderSignature);
+        PutUInt16(directory, version);
+        PutUInt16(directory, version);
+        PutUInt16(directory, 0);
+        PutUInt16(directory, data.compressionMethod);
+        PutUInt16(directory, DosTime);
+        PutUInt16(directory, DosDate);
+        PutUInt32(directory, data.crc32);
+        PutUInt32(directory, record.zip64 ? Saturated32 : static_cast<uint32_t>(data.compressedSize));
+        PutUInt32(directory, record.zip64 ? Saturated32 : static_cast<uint32_t>(data.uncompressedSize));
+        PutUInt16(directory, static_cast<uint16_t>(record.partName.size()));
+        PutUInt16(directory, static_cast<uint16_t>(extra.size()));
+        PutUInt16(directory, 0);
+        PutUInt16(directory, 0);
+        PutUInt16(directory, 0);
+        PutUInt32(directory, 0);
+        PutUInt32(directory, Saturate(record.localHeaderOffset));
+        directory.insert(directory.end(), record.partName.begin(), record.partName.end());
+        directory.insert(directory.end(), extra.begin(), extra.end());
+    }
+    
+    uint64_t directorySize = directory.size();
+    uint64_t entryCount = m_records.size();
+    std::vector<uint8_t> trailer;
+    
+    if (entryCount >= 0xFFFF || directorySize >= Saturated32 || directoryOffset >= Saturated32) {
+        uint64_t zip64RecordOffset = directoryOffset + directorySize;
+        
+        PutUInt32(trailer, Zip64EndOfCentralDirectorySignature);
+        PutUInt64(trailer, 44);
+        PutUInt16(trailer, Zip64Version);
+        PutUInt16(trailer, Zip64Version);
+        PutUInt32(trailer, 0);
+        PutUInt32(trailer, 0);
+        PutUInt64(trailer, entryCount);
+        PutUInt64(trailer, entryCount);
+        PutUInt64(trailer, directorySize);
+        PutUInt64(trailer, directoryOffset);
+        
+        PutUInt32(trailer, Zip64LocatorSignature);
+        PutUInt32(trailer, 0);
+        PutUInt64(trailer, zip64RecordOffset);
+        PutUInt32(trailer, 1);
+    }
+    
+    uint16_t shortCount = entryCount >= 0xFFFF ? 0xFFFF : static_cast<uint16_t>(entryCount);
+    PutUInt32(trailer, EndOfCentralDirectorySignature);
+    PutUInt16(trailer, 0);
+    PutUInt16(trailer, 0);
+    PutUInt16(trailer, shortCount);
+    PutUInt16(trailer, shortCount);
+    PutUInt32(trailer, Saturate(directorySize));
+    PutUInt32(trailer, Saturate(directoryOffset));
+    PutUInt16(trailer, 0);
+    
+    if (!Write(directory.data(), directory.size()) || !Write(trailer.data(), trailer.size())) {
+        return false;
+    }
+    
+    if ((m_stagingFilled > 0 && !SubmitStaging()) || !Drain()) {
+        m_logger.Error() << L"Failed to finish writing package: " << m_packagePath.wstring() << L" (error "
+            << m_engine.LastError() << L")";
+        return false;
+    }
+    m_engine.CloseFile(m_packageFile);
+    
+    m_finished = true;
+    return true;
+}
+
+bool MsixWriter::ShouldCompress(const fs::path& name, bool storeWeights)
+{
+    static const wchar_t* const compressedExtensions[] = {
+        L".zip", L".gz", L".7z", L".xz", L".zst", L".bz2", L".msix", L".appx",
+        L".png", L".jpg", L".jpeg", L".gif", L".webp", L".mp3", L".mp4"
+    };
+    
+    // .data holds the external weights of an ONNX model, as in model.onnx.data
+    static const wchar_t* const weightExtensions[] = {
+        L".onnx", L".data", L".safetensors", L".bin", L".gguf", L".pt", L".pth", L".ckpt", L".h5", L".tflite"
+    };
+    
+    std::wstring extension = ToLower(name.extension().wstring());
+    for (const wchar_t* compressedExtension : compressedExtensions) {
+        if (extension == compressedExtension) {
+            return false;
+        }
+    }
+    
+    if (storeWeights) {
+        for (const wchar_t* weightExtension : weightExtensions) {
+            if (extension == weightExtension) {
+                return false;
+            }
+        }
+    }
+    
+    return true;
+}
+
+bool MsixWriter::ListPayloadFiles(
+    const fs::path& sourceFolder,
+    const SourceScanOptions& options,
+    SourceFileList& files,
+    const Logger& logger,
+    const CancellationToken& cancellationToken)
+{
+    // Footprint files are generated by the writer
+    SourceScanOptions payloadOptions = options;
+    for (const wchar_t* footprint : { L"/AppxBlockMap.xml", L"/[Content_Types].xml", L"/AppxSignature.p7x", L"/AppxMetadata" }) {
+        payloadOptions.excludePatterns.push_back(footprint);
+    }
+    
+    if (!payloadOptions.includePatterns.empty()) {
+        payloadOptions.includePatterns.push_back(L"/AppxManifest.xml");
+    }
+    
+    // The scanner returns files in sorted path order, and a stable order gives identical packages
+    // for identical folders
+    SourceScanner scanner(logger, cancellationToken);
+    return scanner.Scan(sourceFolder, payloadOptions, files);
+}
+
+std::string MsixWriter::EncodePartName(const std::wstring& name)
+{
+    static const char hexDigits[] = "0123456789ABCDEF";
+    std::string utf8 = winrt::to_string(name);
+    std::string encoded;
+    encoded.reserve(utf8.size());
+    
+    for (char c : utf8) {
+        unsigned char byte = static_cast<unsigned char>(c);
+        
+        if (c == '\\') {
+            encoded += '/';
+        }
+        else if ((byte < 0x80 && isalnum(byte)) || (c != '\0' && strchr("-._~!$&'()*+,;=:@/", c) != nullptr)) {
+            encoded += c;
+        }
+        else {
+            encoded += '%';
+            encoded += hexDigits[byte >> 4];
+            encoded += hexDigits[byte & 0x0F];
+        }
+    }
+    
+    return encoded;
+}
+
+bool MsixWriter::CompressBlock(const uint8_t* data, size_t size, bool last, std::vector<uint8_t>& output)
+{
+    z_stream stream = {};
+    if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return false;
+    }
+    
+    output.resize(deflateBound(&stream, static_cast<uLong>(size)) + 16);
+    stream.next_in = const_cast<Bytef*>(data);
+    stream.avail_in = static_cast<uInt>(size);
+    stream.next_out = output.data();
+    stream.avail_out = static_cast<uInt>(output.size());
+    
+    int status = deflate(&stream, last ? Z_FINISH : Z_SYNC_FLUSH);
+    bool succeeded = last ? status == Z_STREAM_END : (status == Z_OK && stream.avail_in == 0 && stream.avail_out > 0);
+    
+    output.resize(stream.total_out);
+    deflateEnd(&stream);
+    return succeeded;
+}
+
+bool MsixWriter::NeedsZip64(const MsixEntryData& data, uint64_t blockCount)
+{
+    uint64_t worstCase = data.uncompressedSize + (data.compressionMethod == MethodDeflate ? blockCount * MaxBlockExpansion : 0);
+    return worstCase >= Saturated32 || data.compressedSize >= Saturated32;
+}
+
+std::vector<uint8_t> MsixWriter::BuildLocalHeader(const std::string& partName, const MsixEntryData& data, bool zip64, uint32_t padding)
+{
+    std::vector<uint8_t> header;
+    header.reserve(LocalFileHeaderSize + partName.size() + 20 + padding);
+    
+    PutUInt32(header, LocalFileHeaderSignature);
+    PutUInt16(header, zip64 ? Zip64Version : ZipVersion);
+    PutUInt16(header, 0);
+    PutUInt16(header, data.compressionMethod);
+    PutUInt16(header, DosTime);
+    PutUInt16(header, DosDate);
+    PutUInt32(header, data.crc32);
+    PutUInt32(header, zip64 ? Saturated32 : static_cast<uint32_t>(data.compressedSize));
+    PutUInt32(header, zip64 ? Saturated32 : static_cast<uint32_t>(data.uncompressedSize));
+    PutUInt16(header, static_cast<uint16_t>(partName.size()));
+    PutUInt16(header, static_cast<uint16_t>((zip64 ? 20 : 0) + padding));
+    header.insert(header.end(), partName.begin(), partName.end());
+    
+    if (zip64) {
+        PutUInt16(header, Zip64ExtraFieldId);
+        PutUInt16(header, 16);
+        PutUInt64(header, data.uncompressedSize);
+        PutUInt64(header, data.compressedSize);
+    }
+    
+    // Readers skip extra fields they don't know, so zeros after the id and size do as padding
+    if (padding > 0) {
+        PutUInt16(header, AlignmentExtraFieldId);
+        PutUInt16(header, static_cast<uint16_t>(padding - 4));
+        header.resize(header.size() + padding - 4, 0);
+    }
+    
+    return header;
+}
+
+bool MsixWriter::WriteLocalHeader(const std::string& partName, const MsixEntryData& data, bool zip64, uint32_t padding)
+{
+    std::vector<uint8_t> header = BuildLocalHeader(partName, data, zip64, padding);
+    return Write(header.data(), header.size());
+}
+
+bool MsixWriter::PatchLocalHeader(const CentralDirectoryRecord& record)
+{
+    return PatchAt(record.localHeaderOffset, BuildLocalHeader(record.partName, record.data, record.zip64, record.padding));
+}
+
+bool MsixWriter::PatchAt(uint64_t offset, const std::vector<uint8_t>& bytes)
+{
+    // Whatever is still in the buffer being filled is changed there
+    size_t written = bytes.size();
+    if (offset + bytes.size() > m_stagingOffset) {
+        written = offset >= m_stagingOffset ? 0 : static_cast<size_t>(m_stagingOffset - offset);
+        memcpy(StagingBuffer(m_stagingIndex) + (offset + written - m_stagingOffset), bytes.data() + written, bytes.size() - written);
+    }
+    
+    if (written == 0) {
+        return true;
+    }
+    
+    // Writes in flight over the same bytes end first, so they can't land on top of the patch
+    for (size_t i = 0; i < m_stagedWrites.size(); i++) {
+        const StagedWrite& staged = m_stagedWrites[i];
+        if (staged.ticket != 0 && staged.offset < offset + written && offset < staged.offset + staged.size && !WaitForStaging(i)) {
+            m_logger.Error() << L"Failed to write to package: " << m_packagePath.wstring() << L" (error " << m_engine.LastError() << L")";
+            return false;
+        }
+    }
+    
+    uint32_t transferred = 0;
+    uint64_t ticket = m_engine.Write(m_packageFile, offset, bytes.data(), static_cast<uint32_t>(written));
+    m_engine.Submit();
+    if (ticket == 0 || !m_engine.Wait(ticket, transferred) || transferred != written) {
+        m_writeFailed = true;
+        m_logger.Error() << L"Failed to write to package: " << m_packagePath.wstring() << L" (error " << m_engine.LastError() << L")";
+        return false;
+    }
+    
+    return true;
+}
+
+bool MsixWriter::AddGeneratedFile(const std::wstring& name, const std::string& content)
+{
+    // Footprint names are stored literally; [Content_Types].xml must not be percent-encoded
+    CentralDirectoryRecord record;
+    record.partName = winrt::to_string(name);
+    record.localHeaderOffset = m_position;
+    record.data.compressionMethod = MethodDeflate;
+    record.data.uncompressedSize = content.size();
+    record.data.crc32 = static_cast<uint32_t>(crc32(0L, reinterpret_cast<const Bytef*>(content.data()), static_cast<uInt>(content.size())));
+    
+    std::vector<uint8_t> compressed;
+    if (!CompressBlock(reinterpret_cast<const uint8_t*>(content.data()), content.size(), true, compressed)) {
+        m_logger.Error() << L"Failed to compress " << name;
+        return false;
+    }
+    record.data.compressedSize = compressed.size();
+    
+    if (!WriteLocalHeader(record.partName, record.data, false) || !Write(compressed.data(), compressed.size())) {
+        return false;
+    }
+    
+    m_records.push_back(std::move(record));
+    return true;
+}
+
+void MsixWriter::AddToBlockMap(const std::wstring& name, const std::string& partName, const MsixEntryData& data, bool zip64, uint32_t padding)
+{
+    BlockMapFile file;
+    file.name = name;
+    std::replace(file.name.begin(), file.name.end(), L'/', L'\\');
+    file.size = data.uncompressedSize;
+    file.localHeaderSize = static_cast<uint32_t>(LocalFileHeaderSize + partName.size() + (zip64 ? 20 : 0) + padding);
+    file.compressed = data.compressionMethod == MethodDeflate;
+    file.blocks = data.blocks;
+    m_blockMap.AddFile(std::move(file));
+}
+
+std::string MsixWriter::BuildContentTypes() const
+{
+    std::string defaults;
+    std::string overrides;
+    std::map<std::wstring, bool> seenExtensions;
+    
+    for (const auto& record : m_records) {
+        if (record.partName == "AppxManifest.xml" || record.partName == "AppxBlockMap.xml") {
+            continue;
+        }
+        
+        std::wstring extension = ToLower(fs::path(record.partName).extension().wstring());
+        if (extension.empty()) {
+            // Files without an extension can only be typed individually
+            overrides += "<Override PartName=\"/" + record.partName + "\" ContentType=\"application/octet-stream\"/>";
+            continue;
+        }
+        
+        extension = extension.substr(1);
+        if (seenExtensions.emplace(extension, true).second) {
+            defaults += "<Default Extension=\"" + winrt::to_string(extension) + "\" ContentType=\"" +
+                ContentTypeForExtension(extension) + "\"/>";
+        }
+    }
+    
+    overrides += "<Override PartName=\"/AppxManifest.xml\" ContentType=\"application/vnd.ms-appx.manifest+xml\"/>";
+    overrides += "<Override PartName=\"/AppxBlockMap.xml\" ContentType=\"application/vnd.ms-appx.blockmap+xml\"/>";
+    
+    return "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\r\n"
+        "<Types xmlns=\"http://schemas.openxmlformats.org/package/2006/content-types\">" +
+        defaults + overrides + "</Types>";
+}
+
+bool MsixWriter::Write(const void* data, size_t size)
+{
+    if (!m_staging || m_writeFailed) {
+        m_logger.Error() << L"Failed to write to package: " << m_packagePath.wstring();
+        return false;
+    }
+    
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    size_t remaining = size;
+    while (remaining > 0) {
+        size_t copied = (std::min)(remaining, StagingSize - m_stagingFilled);
+        memcpy(StagingBuffer(m_stagingIndex) + m_stagingFilled, bytes, copied);
+        m_stagingFilled += copied;
+        bytes += copied;
+        remaining -= copied;
+        
+        if (m_stagingFilled == StagingSize && !SubmitStaging()) {
+            m_logger.Error() << L"Failed to write to package: " << m_packagePath.wstring() << L" (error " << m_engine.LastError() << L")";
+            return false;
+        }
+    }
+    
+    m_position += size;
+    return true;
+}
+
+bool MsixWriter::SubmitStaging()
+{
+    StagedWrite& staged = m_stagedWrites[m_stagingIndex];
+    staged.offset = m_stagingOffset;
+    staged.size = static_cast<uint32_t>(m_stagingFilled);
+    staged.ticket = m_engine.Write(m_packageFile, staged.offset, StagingBuffer(m_stagingIndex), staged.size);
+    m_engine.Submit();
+    if (staged.ticket == 0) {
+        m_writeFailed = true;
+        return false;
+    }
+    
+    m_stagingOffset += m_stagingFilled;
+    m_stagingFilled = 0;
+    m_stagingIndex = (m_stagingIndex + 1) % StagingBuffers;
+    
+    // The next buffer was written eight buffers ago, so this rarely waits
+    return WaitForStaging(m_stagingIndex);
+}
+
+bool MsixWriter::WaitForStaging(size_t index)
+{
+    StagedWrite& staged = m_stagedWrites[index];
+    if (staged.ticket == 0) {
+        return !m_writeFailed;
+    }
+    
+    uint32_t transferred = 0;
+    if (!m_engine.Wait(staged.ticket, transferred) || transferred != staged.size) {
+        m_writeFailed = true;
+    }
+    staged.ticket = 0;
+    return !m_writeFailed;
+}
+
+bool MsixWriter::Drain()
+{
+    bool written = true;
+    for (size_t i = 0; i < m_stagedWrites.size(); i++) {
+        written = WaitForStaging(i) && written;
+    }
+    return written;
+}
+
+uint8_t* MsixWriter::StagingBuffer(size_t index) const
+{
+    return m_staging.get() + index * StagingSize;
+}
\ No newline at end of file
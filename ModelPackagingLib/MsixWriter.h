@@ -0,0 +1,223 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <wil/resource.h>
+#include "Logger.h"
+#include "CancellationToken.h"
+#include "AppxBlockMap.h"
+#include "SourceScanner.h"
+#include "FileIoEngine.h"
+#include "SourceReadAhead.h"
+
+namespace fs = std::filesystem;
+
+// Compression and integrity data of one package entry, enough to copy its compressed stream into another package
+struct MsixEntryData
+{
+    uint16_t compressionMethod = 0; // 0 = stored, 8 = deflate
+    uint32_t crc32 = 0;
+    uint64_t compressedSize = 0;
+    uint64_t uncompressedSize = 0;
+    std::vector<BlockMapBlock> blocks;
+};
+
+// Writes an MSIX package without MakeAppx.exe: payload entries, AppxBlockMap.xml, [Content_Types].xml
+// and a ZIP64-capable central directory. Each 64 KB block of a file is deflated as an independent
+// segment, the way MakeAppx.exe does, so blocks compress in parallel and a file's compressed stream
+// can be copied into a later package unchanged.
+//
+// The package is written through a FileIoEngine: output collects in 1 MB staging buffers, and a full
+// buffer is written while the next one fills, with up to eight writes in flight. Stored files skip
+// the staging buffers and are written from a view of the file, or with block cloning don't have
+// their data written at all.
+class MsixWriter
+{
+public:
+    // Bytes of a file read, hashed and compressed together
+    static constexpr size_t BatchSize = 128 * AppxBlockMap::BlockSize;
+
+    MsixWriter(Logger logger = Logger(), CancellationToken cancellationToken = CancellationToken());
+    ~MsixWriter();
+
+    MsixWriter(const MsixWriter&) = delete;
+    MsixWriter& operator=(const MsixWriter&) = delete;
+
+    // Create the package file, replacing any existing file
+    bool Open(const fs::path& packagePath);
+
+    // Let stored files share their disk blocks with the package where the file system can clone
+    // blocks (ReFS, including Dev Drives). The data of such an entry starts on a cluster boundary,
+    // after an extra field of padding in its local header.
+    void SetBlockCloning(bool enabled);
+
+    // Compress or store a file as a payload entry, filling in data. The entry's compressed stream
+    // is also written to copyTo when given. A stored file is mapped and written from the view, with
+    // its checksums taken from FileDigests when the file was just downloaded.
+    bool AddFile(
+        const std::wstring& name,
+        const fs::path& sourcePath,
+        bool compress,
+        MsixEntryData& data,
+        std::ostream* copyTo = nullptr);
+
+    // Compress or store the next file of a read-ahead, which must have been started with BatchSize chunks
+    bool AddFile(
+        const std::wstring& name,
+        SourceReadAhead& source,
+        bool compress,
+        MsixEntryData& data,
+        std::ostream* copyTo = nullptr);
+
+    // Compress or store size bytes of a stream as a payload entry, filling in data
+    bool AddStream(
+        const std::wstring& name,
+        std::istream& source,
+        uint64_t size,
+        bool compress,
+        MsixEntryData& data,
+        std::ostream* copyTo = nullptr);
+
+    // Add a payload entry by copying data.compressedSize bytes of an existing compressed stream
+    bool AddCompressedFile(
+        const std::wstring& name,
+        const MsixEntryData& data,
+        std::istream& compressedStream);
+
+    // Start a payload entry whose compressed stream is supplied piece by piece with WriteEntryData.
+    // The compression method, CRC and sizes in data must be final; its blocks are not used.
+    bool BeginEntry(const std::wstring& name, const MsixEntryData& data);
+
+    // Append part of the compressed stream of the entry started with BeginEntry
+    bool WriteEntryData(const void* buffer, size_t size);
+
+    // Finish the entry started with BeginEntry, checking that its whole compressed stream was written,
+    // and record its block hashes
+    bool EndEntry(const std::vector<BlockMapBlock>& blocks);
+
+    // Write the footprint files and the central directory and close the package.
+    // A package that is never finished is deleted when the writer is destroyed.
+    bool Finish();
+
+    // Whether a file is worth deflating. Already-compressed formats are stored, and so are model weights
+    // (.onnx, .safetensors, .bin and the like) with storeWeights, which deflate by a few percent at most.
+    static bool ShouldCompress(const fs::path& name, bool storeWeights = false);
+
+    // Payload files of a folder in package order, leaving out footprint files and whatever options
+    // excludes. AppxManifest.xml is kept whatever the include patterns say.
+    static bool ListPayloadFiles(
+        const fs::path& sourceFolder,
+        const SourceScanOptions& options,
+        SourceFileList& files,
+        const Logger& logger,
+        const CancellationToken& cancellationToken = CancellationToken());
+
+    // Encode a relative path as a percent-encoded ZIP part name with forward slashes
+    static std::string EncodePartName(const std::wstring& name);
+
+    // Deflate one 64 KB block as a raw stream segment. Every segment but a file's last ends on a byte
+    // boundary with a sync flush, so the segments concatenate into a single valid deflate stream.
+    static bool CompressBlock(const uint8_t* data, size_t size, bool last, std::vector<uint8_t>& output);
+
+private:
+    struct CentralDirectoryRecord
+    {
+        std::string partName;
+        MsixEntryData data;
+        uint64_t localHeaderOffset = 0;
+        bool zip64 = false;
+        uint32_t padding = 0;       // Bytes of the extra field that aligns a cloned entry's data
+    };
+
+    // Write of a staging buffer in flight
+    struct StagedWrite
+    {
+        uint64_t ticket = 0;
+        uint64_t offset = 0;
+        uint32_t size = 0;
+    };
+
+    // Whether an entry needs ZIP64 sizes, judged from the worst-case compressed size so that the
+    // decision is the same whether the entry is compressed here or copied from another package
+    static bool NeedsZip64(const MsixEntryData& data, uint64_t blockCount);
+
+    // Compress or store fileSize bytes delivered a batch at a time by readBatch, which returns nullptr
+    // when the source fails
+    bool AddBlocks(
+        const std::wstring& name,
+        uint64_t fileSize,
+        bool compress,
+        MsixEntryData& data,
+        std::ostream* copyTo,
+        const std::function<const uint8_t*(size_t size)>& readBatch);
+
+    // Store a file from a view of it, cloning its blocks when enabled and possible
+    bool AddStoredFile(
+        const std::wstring& name,
+        const fs::path& sourcePath,
+        MsixEntryData& data,
+        std::ostream* copyTo);
+
+    // Local file header of an entry, with padding bytes of alignment extra field when not 0
+    static std::vector<uint8_t> BuildLocalHeader(const std::string& partName, const MsixEntryData& data, bool zip64, uint32_t padding = 0);
+
+    // Write a local file header for the entry at the current position
+    bool WriteLocalHeader(const std::string& partName, const MsixEntryData& data, bool zip64, uint32_t padding = 0);
+
+    // Rewrite a local file header once the entry's sizes and CRC are known
+    bool PatchLocalHeader(const CentralDirectoryRecord& record);
+
+    // Add a generated footprint file, which is not listed in the block map
+    bool AddGeneratedFile(const std::wstring& name, const std::string& content);
+
+    // Record a payload entry in the block map
+    void AddToBlockMap(const std::wstring& name, const std::string& partName, const MsixEntryData& data, bool zip64, uint32_t padding = 0);
+
+    // Build [Content_Types].xml for the entries written so far
+    std::string BuildContentTypes() const;
+
+    // Overwrite bytes already written, in the staging buffer if they are still there
+    bool PatchAt(uint64_t offset, const std::vector<uint8_t>& bytes);
+
+    bool Write(const void* data, size_t size);
+
+    // Queue the write of the staging buffer being filled and wait until the next one is free
+    bool SubmitStaging();
+
+    // Wait for the write of a staging buffer, if it has one in flight
+    bool WaitForStaging(size_t index);
+
+    // Wait for every write in flight
+    bool Drain();
+
+    uint8_t* StagingBuffer(size_t index) const;
+
+    Logger m_logger;
+    CancellationToken m_cancellationToken;
+    fs::path m_packagePath;
+    uint64_t m_position;
+    bool m_finished;
+    bool m_blockCloning;
+    std::vector<CentralDirectoryRecord> m_records;
+    AppxBlockMap m_blockMap;
+
+    // The staging buffers are declared before the engine, so writes in flight end before they are freed
+    wil::unique_virtualalloc_ptr<uint8_t> m_staging;
+    std::vector<StagedWrite> m_stagedWrites;
+    size_t m_stagingIndex;
+    size_t m_stagingFilled;
+    uint64_t m_stagingOffset;       // Position in the package of the buffer being filled
+    bool m_writeFailed;
+    FileIoEngine m_engine;
+    size_t m_packageFile;
+
+    // Entry started with BeginEntry
+    std::wstring m_entryName;
+    CentralDirectoryRecord m_entryRecord;
+    uint64_t m_entryWritten;
+    bool m_entryOpen;
+};
\ No newline at end of file
@@ -0,0 +1,383 @@
+#include "PackageCache.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <execution>
+#include <fstream>
+#include <numeric>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <Windows.h>
+#include <winrt/base.h>
+
+namespace {
+    constexpr char IndexHeader[] = "ModelPackagingCache 1";
+    constexpr uint16_t MethodDeflate = 8;
+    constexpr size_t BlocksPerBatch = 128;
+
+    // How long Save waits for another run to finish saving the index
+    constexpr int IndexLockAttempts = 600;
+    constexpr auto IndexLockRetryInterval = std::chrono::milliseconds(50);
+
+    // Open a lock file no other handle may share, deleted when it is closed or the process ends
+    wil::unique_hfile OpenLockFile(const fs::path& path, DWORD disposition)
+    {
+        return wil::unique_hfile(CreateFileW(path.c_str(), GENERIC_WRITE | DELETE, 0, nullptr, disposition,
+            FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, nullptr));
+    }
+}
+
+PackageCache::PackageCache(fs::path cacheFolder, Logger logger)
+    : m_cacheFolder(std::move(cacheFolder)),
+      m_blobFolder(m_cacheFolder / L"blobs"),
+      m_sessionFolder(m_cacheFolder / L"sessions"),
+      m_logger(std::move(logger))
+{
+}
+
+void PackageCache::Load()
+{
+    static std::atomic<uint64_t> nextSessionId = 0;
+    
+    m_index.clear();
+    m_changedKeys.clear();
+    
+    std::error_code error;
+    fs::create_directories(m_blobFolder, error);
+    fs::create_directories(m_sessionFolder, error);
+    
+    // The session lock comes before the index is read, so no other run deletes a blob this one finds
+    if (!m_sessionLock) {
+        m_sessionPath = m_sessionFolder / (std::to_wstring(GetCurrentProcessId()) + L"-" + std::to_wstring(++nextSessionId) + L".lock");
+        m_sessionLock = OpenLockFile(m_sessionPath, CREATE_NEW);
+        if (!m_sessionLock) {
+            m_logger.Warning() << L"Failed to create a package cache session lock, error code: " << GetLastError();
+        }
+    }
+    
+    if (!ReadIndex(m_index)) {
+        m_logger.Verbose() << L"Starting a new package cache in: " << m_cacheFolder.wstring();
+        return;
+    }
+    
+    m_logger.Verbose() << L"Loaded " << m_index.size() << L" files from the package cache index";
+}
+
+bool PackageCache::ReadIndex(std::map<std::wstring, PackageCacheEntry>& index)
+{
+    std::ifstream file(m_cacheFolder / L"index.txt");
+    if (!file) {
+        return false;
+    }
+    
+    std::string line;
+    if (!std::getline(file, line) || line != IndexHeader) {
+        m_logger.Warning() << L"Ignoring package cache index in an unknown format: " << m_cacheFolder.wstring();
+        return false;
+    }
+    
+    // Each line is: size <tab> last write time <tab> content hash <tab> key
+    while (std::getline(file, line)) {
+        std::istringstream fields(line);
+        PackageCacheEntry entry;
+        std::string key;
+        
+        if (!(fields >> entry.size >> entry.lastWriteTime >> entry.contentHash) || fields.get() != '\t' ||
+            !std::getline(fields, key) || key.empty()) {
+            continue;
+        }
+        
+        index[std::wstring(winrt::to_hstring(key))] = std::move(entry);
+    }
+    
+    return true;
+}
+
+bool PackageCache::Find(
+    const std::wstring& key,
+    const fs::path& sourcePath,
+    bool compress,
+    MsixEntryData& data,
+    fs::path& blobPath)
+{
+    auto match = m_index.find(key);
+    if (match == m_index.end()) {
+        return false;
+    }
+    
+    PackageCacheEntry& entry = match->second;
+    uint64_t size = 0;
+    int64_t lastWriteTime = 0;
+    if (!GetFileStamp(sourcePath, size, lastWriteTime) || size != entry.size) {
+        return false;
+    }
+    
+    // Same size but touched since it was cached: only reuse it if the content is unchanged
+    if (lastWriteTime != entry.lastWriteTime) {
+        std::vector<BlockMapBlock> blocks;
+        if (!HashFile(sourcePath, blocks) || ContentHash(blocks) != entry.contentHash) {
+            return false;
+        }
+        
+        entry.lastWriteTime = lastWriteTime;
+        m_changedKeys.insert(key);
+    }
+    
+    uint16_t expectedMethod = compress && size > 0 ? MethodDeflate : 0;
+    if (!ReadMetadata(entry.contentHash, data) || data.compressionMethod != expectedMethod) {
+        return false;
+    }
+    
+    blobPath = m_blobFolder / (entry.contentHash + ".bin");
+    std::error_code error;
+    return fs::file_size(blobPath, error) == data.compressedSize && !error;
+}
+
+fs::path PackageCache::CreateTemporaryBlobPath()
+{
+    static std::atomic<uint64_t> nextBlobId = 0;
+    
+    return m_blobFolder / (std::to_wstring(GetCurrentProcessId()) + L"-" + std::to_wstring(++nextBlobId) + L".tmp");
+}
+
+bool PackageCache::Store(
+    const std::wstring& key,
+    const fs::path& sourcePath,
+    const PackageCacheEntry& stamp,
+    const MsixEntryData& data,
+    const fs::path& temporaryBlobPath)
+{
+    PackageCacheEntry entry;
+    entry.contentHash = ContentHash(data.blocks);
+    
+    // A file written to while it was read may have been packaged half old and half new, which its
+    // stamp from before the read would then vouch for
+    std::error_code error;
+    if (!GetFileStamp(sourcePath, entry.size, entry.lastWriteTime) || entry.size != stamp.size ||
+        entry.lastWriteTime != stamp.lastWriteTime || entry.size != data.uncompressedSize) {
+        m_logger.Verbose() << L"Not caching " << key << L", which changed while it was packaged";
+        fs::remove(temporaryBlobPath, error);
+        return false;
+    }
+    
+    // Identical content under another key already has a blob
+    fs::path blobPath = m_blobFolder / (entry.contentHash + ".bin");
+    MsixEntryData existing;
+    if (ReadMetadata(entry.contentHash, existing) && existing.compressionMethod == data.compressionMethod &&
+        fs::file_size(blobPath, error) == existing.compressedSize && !error) {
+        fs::remove(temporaryBlobPath, error);
+    }
+    else {
+        fs::rename(temporaryBlobPath, blobPath, error);
+        if (error || !WriteMetadata(entry.contentHash, data)) {
+            m_logger.Warning() << L"Failed to store " << key << L" in the package cache";
+            fs::remove(temporaryBlobPath, error);
+            return false;
+        }
+    }
+    
+    m_index[key] = std::move(entry);
+    m_changedKeys.insert(key);
+    return true;
+}
+
+bool PackageCache::Save()
+{
+    fs::path indexPath = m_cacheFolder / L"index.txt";
+    fs::path temporaryPath = m_cacheFolder / L"index.txt.tmp";
+    
+    wil::unique_hfile indexLock;
+    for (int attempt = 0; attempt < IndexLockAttempts && !indexLock; attempt++) {
+        indexLock = OpenLockFile(m_cacheFolder / L"index.lock", OPEN_ALWAYS);
+        if (!indexLock) {
+            std::this_thread::sleep_for(IndexLockRetryInterval);
+        }
+    }
+    
+    if (!indexLock) {
+        m_logger.Warning() << L"Timed out waiting for another run to save the package cache index";
+        return false;
+    }
+    
+    // Other runs may have saved the index since this one loaded it: their entries are kept, and
+    // this run's own replace them only where it added or refreshed one
+    std::map<std::wstring, PackageCacheEntry> merged;
+    ReadIndex(merged);
+    for (const auto& key : m_changedKeys) {
+        merged[key] = m_index[key];
+    }
+    m_index = std::move(merged);
+    m_changedKeys.clear();
+    
+    {
+        std::ofstream index(temporaryPath, std::ios::trunc);
+        if (!index) {
+            m_logger.Warning() << L"Failed to write the package cache index: " << temporaryPath.wstring();
+            return false;
+        }
+        
+        index << IndexHeader << "\n";
+        for (const auto& [key, entry] : m_index) {
+            index << entry.size << '\t' << entry.lastWriteTime << '\t' << entry.contentHash << '\t'
+                  << winrt::to_string(key) << "\n";
+        }
+        
+        if (!index.good()) {
+            m_logger.Warning() << L"Failed to write the package cache index: " << temporaryPath.wstring();
+            return false;
+        }
+    }
+    
+    std::error_code error;
+    fs::rename(temporaryPath, indexPath, error);
+    if (error) {
+        m_logger.Warning() << L"Failed to replace the package cache index: " << indexPath.wstring();
+        return false;
+    }
+    
+    // A run that has the cache open may be about to copy a blob it found, or have stored blobs the
+    // index doesn't list yet, so unused blobs are left for the last run to save
+    if (IsOpenElsewhere()) {
+        m_logger.Verbose() << L"Leaving unused package cache entries in place while another run uses the cache";
+        return true;
+    }
+    
+    // Blobs of superseded file versions are dropped so the cache holds one version of each file
+    std::set<std::string> referencedHashes;
+    for (const auto& [key, entry] : m_index) {
+        referencedHashes.insert(entry.contentHash);
+    }
+    
+    uint64_t removedBytes = 0;
+    for (const auto& file : fs::directory_iterator(m_blobFolder, error)) {
+        std::string extension = file.path().extension().string();
+        if ((extension == ".bin" || extension == ".meta" || extension == ".tmp") &&
+            referencedHashes.count(file.path().stem().string()) == 0) {
+            removedBytes += file.is_regular_file(error) ? file.file_size(error) : 0;
+            fs::remove(file.path(), error);
+        }
+    }
+    
+    if (removedBytes > 0) {
+        m_logger.Verbose() << L"Removed " << removedBytes << L" bytes of unused entries from the package cache";
+    }
+    
+    return true;
+}
+
+std::string PackageCache::ContentHash(const std::vector<BlockMapBlock>& blocks)
+{
+    std::vector<uint8_t> hashes;
+    hashes.reserve(blocks.size() * sizeof(HashUtils::Sha256Digest));
+    
+    for (const auto& block : blocks) {
+        hashes.insert(hashes.end(), block.hash.begin(), block.hash.end());
+    }
+    
+    HashUtils::Sha256Digest digest = HashUtils::Sha256(hashes.data(), hashes.size());
+    return HashUtils::ToHex(digest.data(), digest.size());
+}
+
+bool PackageCache::ReadMetadata(const std::string& contentHash, MsixEntryData& data)
+{
+    std::ifstream metadata(m_blobFolder / (contentHash + ".meta"));
+    if (!metadata) {
+        return false;
+    }
+    
+    // First line: method, CRC-32, compressed size, uncompressed size, block count; then one line per block
+    size_t blockCount = 0;
+    data = MsixEntryData();
+    if (!(metadata >> data.compressionMethod >> data.crc32 >> data.compressedSize >> data.uncompressedSize >> blockCount) ||
+        blockCount != (data.uncompressedSize + AppxBlockMap::BlockSize - 1) / AppxBlockMap::BlockSize) {
+        return false;
+    }
+    
+    data.blocks.resize(blockCount);
+    for (auto& block : data.blocks) {
+        std::string hash;
+        if (!(metadata >> hash >> block.compressedSize) || !HashUtils::FromHex(hash, block.hash.data(), block.hash.size())) {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+bool PackageCache::WriteMetadata(const std::string& contentHash, const MsixEntryData& data)
+{
+    std::ofstream metadata(m_blobFolder / (contentHash + ".meta"), std::ios::trunc);
+    if (!metadata) {
+        return false;
+    }
+    
+    metadata << data.compressionMethod << ' ' << data.crc32 << ' ' << data.compressedSize << ' '
+             << data.uncompressedSize << ' ' << data.blocks.size() << "\n";
+    
+    for (const auto& block : data.blocks) {
+        metadata << HashUtils::ToHex(block.hash.data(), block.hash.size()) << ' ' << block.compressedSize << "\n";
+    }
+    
+    return metadata.good();
+}
+
+bool PackageCache::HashFile(const fs::path& sourcePath, std::vector<BlockMapBlock>& blocks)
+{
+    std::ifstream source(sourcePath, std::ios::binary);
+    std::error_code error;
+    uint64_t remaining = fs::file_size(sourcePath, error);
+    if (!source || error) {
+        return false;
+    }
+    
+    std::vector<uint8_t> input(static_cast<size_t>((std::min)(remaining, static_cast<uint64_t>(BlocksPerBatch * AppxBlockMap::BlockSize))));
+    std::vector<size_t> indices(BlocksPerBatch);
+    std::iota(indices.begin(), indices.end(), size_t{ 0 });
+    
+    while (remaining > 0) {
+        size_t batchSize = static_cast<size_t>((std::min)(remaining, static_cast<uint64_t>(input.size())));
+        source.read(reinterpret_cast<char*>(input.data()), static_cast<std::streamsize>(batchSize));
+        if (source.gcount() != static_cast<std::streamsize>(batchSize)) {
+            return false;
+        }
+        
+        size_t firstBlock = blocks.size();
+        size_t batchBlocks = (batchSize + AppxBlockMap::BlockSize - 1) / AppxBlockMap::BlockSize;
+        blocks.resize(firstBlock + batchBlocks);
+        
+        std::for_each(std::execution::par, indices.begin(), indices.begin() + batchBlocks, [&](size_t i) {
+            size_t offset = i * AppxBlockMap::BlockSize;
+            blocks[firstBlock + i].hash = HashUtils::Sha256(input.data() + offset, (std::min)(AppxBlockMap::BlockSize, batchSize - offset));
+        });
+        
+        remaining -= batchSize;
+    }
+    
+    return true;
+}
+
+bool PackageCache::IsOpenElsewhere()
+{
+    // The lock file of a running session can't be deleted; what can be was left by a run that ended
+    bool openElsewhere = false;
+    std::error_code error;
+    for (const auto& file : fs::directory_iterator(m_sessionFolder, error)) {
+        if (file.path() != m_sessionPath && !fs::remove(file.path(), error) && error) {
+            openElsewhere = true;
+        }
+    }
+    return openElsewhere;
+}
+
+bool PackageCache::GetFileStamp(const fs::path& sourcePath, uint64_t& size, int64_t& lastWriteTime)
+{
+    std::error_code error;
+    size = fs::file_size(sourcePath, error);
+    if (error) {
+        return false;
+    }
+    
+    lastWriteTime = static_cast<int64_t>(fs::last_write_time(sourcePath, error).time_since_epoch().count());
+    return !error;
+}
\ No newline at end of file
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <filesystem>
+#include <wil/resource.h>
+#include "Logger.h"
+#include "MsixWriter.h"
+
+namespace fs = std::filesystem;
+
+// What the cache knows about one source file
+struct PackageCacheEntry
+{
+    uint64_t size = 0;
+    int64_t lastWriteTime = 0;
+    std::string contentHash;    // Hex SHA-256 over the file's block hashes
+};
+
+// Persistent store of compressed package entries, so repackaging a folder in which only a few files
+// changed copies every other entry's compressed stream instead of recompressing and rehashing it.
+//
+// Files are keyed by package name and relative path. A file whose size and timestamp match its index
+// entry is reused without being read. A file with the same size but a new timestamp (a fresh download,
+// say) is hashed and reused if its content is unchanged. Compressed streams are stored once per content
+// hash under blobs\, with their CRC, sizes and block map hashes alongside.
+//
+// Several runs may share a cache. Each holds a lock file under sessions\ while it has the cache open,
+// and saves the index under index.lock by merging the entries it added into the index on disk. Unused
+// blobs are only deleted by a run that finds no other run holding the cache.
+class PackageCache
+{
+public:
+    PackageCache(fs::path cacheFolder, Logger logger = Logger());
+    ~PackageCache() = default;
+
+    // Open the cache and load the index; a missing or unreadable index starts an empty cache
+    void Load();
+
+    // Find the cached compressed stream of a file, filling in its entry data and blob path
+    bool Find(
+        const std::wstring& key,
+        const fs::path& sourcePath,
+        bool compress,
+        MsixEntryData& data,
+        fs::path& blobPath);
+
+    // A new temporary path to write a file's compressed stream to before it is stored
+    fs::path CreateTemporaryBlobPath();
+
+    // Record a file's compressed stream, moving the temporary blob into the cache. The stamp is the
+    // file's size and timestamp taken before it was read; a file changed since is not stored.
+    bool Store(
+        const std::wstring& key,
+        const fs::path& sourcePath,
+        const PackageCacheEntry& stamp,
+        const MsixEntryData& data,
+        const fs::path& temporaryBlobPath);
+
+    // Merge this run's entries into the index and delete blobs that no file refers to any more
+    bool Save();
+
+    // Content hash of a file: SHA-256 over its block hashes
+    static std::string ContentHash(const std::vector<BlockMapBlock>& blocks);
+
+    // Size and last write time of a file
+    static bool GetFileStamp(const fs::path& sourcePath, uint64_t& size, int64_t& lastWriteTime);
+
+private:
+    // Read the index file, returning false if there is none or it can't be read
+    bool ReadIndex(std::map<std::wstring, PackageCacheEntry>& index);
+
+    // Whether another run has the cache open
+    bool IsOpenElsewhere();
+
+    // Read a blob's entry data
+    bool ReadMetadata(const std::string& contentHash, MsixEntryData& data);
+
+    // Write a blob's entry data
+    bool WriteMetadata(const std::string& contentHash, const MsixEntryData& data);
+
+    // Hash the 64 KB blocks of a file without compressing it
+    bool HashFile(const fs::path& sourcePath, std::vector<BlockMapBlock>& blocks);
+
+    fs::path m_cacheFolder;
+    fs::path m_blobFolder;
+    fs::path m_sessionFolder;
+    Logger m_logger;
+    std::map<std::wstring, PackageCacheEntry> m_index;
+    std::set<std::wstring> m_changedKeys;   // Entries this run added or refreshed
+    fs::path m_sessionPath;
+    wil::unique_hfile m_sessionLock;
+};
\ No newline at end of file
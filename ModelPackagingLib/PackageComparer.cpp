@@ -0,0 +1,171 @@
+#include "PackageComparer.h"
+#include "AppxBlockMap.h"
+#include "ZipCentralDirectory.h"
+#include "JsonUtils.h"
+#include "TraceRecorder.h"
+#include <algorithm>
+#include <chrono>
+#include <cwctype>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+namespace {
+    // Part names are compared case-insensitively, as Windows does when installing a package
+    std::wstring NormalizeName(std::wstring name)
+    {
+        std::transform(name.begin(), name.end(), name.begin(), ::towlower);
+        return name;
+    }
+
+    // Read a package's block map, which lists every payload file with its block hashes
+    bool ReadBlockMap(const fs::path& packagePath, AppxBlockMap& blockMap, const Logger& logger)
+    {
+        TraceSpan blockMapSpan("blockmap", packagePath.filename().wstring());
+
+        ZipCentralDirectory directory;
+        if (!directory.Read(packagePath, logger)) {
+            return false;
+        }
+
+        std::ifstream package(packagePath, std::ios::binary);
+        const ZipEntry* blockMapEntry = directory.Find("AppxBlockMap.xml");
+        std::string blockMapXml;
+
+        if (!package || !blockMapEntry || !ZipCentralDirectory::ReadEntryContent(package, *blockMapEntry, blockMapXml) ||
+            !blockMap.Parse(blockMapXml)) {
+            logger.Error() << L"Package has no valid AppxBlockMap.xml: " << packagePath.wstring();
+            return false;
+        }
+
+        blockMapSpan.SetBytes(blockMapXml.size());
+        return true;
+    }
+}
+
+PackageComparer::PackageComparer(Logger logger)
+    : m_logger(std::move(logger))
+{
+}
+
+bool PackageComparer::Compare(const fs::path& oldPackagePath, const fs::path& newPackagePath, PackageComparison& comparison)
+{
+    auto start = std::chrono::steady_clock::now();
+    comparison = PackageComparison();
+    
+    AppxBlockMap oldBlockMap;
+    AppxBlockMap newBlockMap;
+    if (!ReadBlockMap(oldPackagePath, oldBlockMap, m_logger) || !ReadBlockMap(newPackagePath, newBlockMap, m_logger)) {
+        return false;
+    }
+    
+    // Pair up the files of both packages by name
+    std::map<std::wstring, std::pair<const BlockMapFile*, const BlockMapFile*>> files;
+    for (const auto& file : oldBlockMap.Files()) {
+        files[NormalizeName(file.name)].first = &file;
+    }
+    for (const auto& file : newBlockMap.Files()) {
+        files[NormalizeName(file.name)].second = &file;
+    }
+    
+    comparison.files.reserve(files.size());
+    
+    for (const auto& [key, pair] : files) {
+        const BlockMapFile* oldFile = pair.first;
+        const BlockMapFile* newFile = pair.second;
+        
+        FileComparison file;
+        file.name = newFile ? newFile->name : oldFile->name;
+        file.oldSize = oldFile ? oldFile->size : 0;
+        file.newSize = newFile ? newFile->size : 0;
+        
+        if (!oldFile) {
+            file.change = FileChange::Added;
+            file.changedBlocks = newFile->blocks.size();
+            file.changedBytes = newFile->size;
+            comparison.addedFiles++;
+        }
+        else if (!newFile) {
+            file.change = FileChange::Removed;
+            file.changedBlocks = oldFile->blocks.size();
+            file.changedBytes = oldFile->size;
+            comparison.removedFiles++;
+        }
+        else {
+            // Blocks are compared at the same offset; model weights are rewritten in place, not shifted.
+            // Blocks past the end of the shorter file count as changed.
+            size_t blockCount = (std::max)(oldFile->blocks.size(), newFile->blocks.size());
+            for (size_t i = 0; i < blockCount; i++) {
+                bool inOld = i < oldFile->blocks.size();
+                bool inNew = i < newFile->blocks.size();
+                if (inOld && inNew && oldFile->blocks[i].hash == newFile->blocks[i].hash) {
+                    continue;
+                }
+                
+                uint64_t size = inNew ? newFile->size : oldFile->size;
+                file.changedBlocks++;
+                file.changedBytes += (std::min)(static_cast<uint64_t>(AppxBlockMap::BlockSize), size - i * AppxBlockMap::BlockSize);
+            }
+            
+            if (file.changedBlocks == 0) {
+                file.change = FileChange::Identical;
+                comparison.identicalFiles++;
+            }
+            else {
+                file.change = FileChange::Changed;
+                comparison.changedFiles++;
+            }
+        }
+        
+        comparison.changedBytes += file.changedBytes;
+        comparison.files.push_back(std::move(file));
+    }
+    
+    comparison.elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return true;
+}
+
+std::string PackageComparer::ToJson(const fs::path& oldPackagePath, const fs::path& newPackagePath, const PackageComparison& comparison)
+{
+    std::ostringstream json;
+    json << "{\n";
+    json << "  \"old\": " << JsonUtils::Quote(oldPackagePath.wstring()) << ",\n";
+    json << "  \"new\": " << JsonUtils::Quote(newPackagePath.wstring()) << ",\n";
+    json << "  \"identical\": " << (comparison.Identical() ? "true" : "false") << ",\n";
+    json << "  \"identicalFiles\": " << comparison.identicalFiles << ",\n";
+    json << "  \"changedFiles\": " << comparison.changedFiles << ",\n";
+    json << "  \"addedFiles\": " << comparison.addedFiles << ",\n";
+    json << "  \"removedFiles\": " << comparison.removedFiles << ",\n";
+    json << "  \"changedBytes\": " << comparison.changedBytes << ",\n";
+    json << "  \"seconds\": " << comparison.elapsedSeconds << ",\n";
+    
+    json << "  \"files\": [";
+    for (size_t i = 0; i < comparison.files.size(); i++) {
+        const FileComparison& file = comparison.files[i];
+        json << (i == 0 ? "\n" : ",\n");
+        json << "    {\"name\": " << JsonUtils::Quote(file.name)
+             << ", \"change\": \"" << ChangeName(file.change) << "\""
+             << ", \"oldBytes\": " << file.oldSize
+             << ", \"newBytes\": " << file.newSize
+             << ", \"changedBlocks\": " << file.changedBlocks
+             << ", \"changedBytes\": " << file.changedBytes << "}";
+    }
+    json << (comparison.files.empty() ? "]\n" : "\n  ]\n");
+    json << "}\n";
+    
+    return json.str();
+}
+
+const char* PackageComparer::ChangeName(FileChange change)
+{
+    switch (change) {
+        case FileChange::Changed:
+            return "changed";
+        case FileChange::Added:
+            return "added";
+        case FileChange::Removed:
+            return "removed";
+        default:
+            return "identical";
+    }
+}
\ No newline at end of file
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <filesystem>
+#include "Logger.h"
+
+namespace fs = std::filesystem;
+
+// How a payload file differs between two packages
+enum class FileChange
+{
+    Identical,
+    Changed,
+    Added,
+    Removed
+};
+
+// One payload file of either package
+struct FileComparison
+{
+    std::wstring name;              // Relative path with backslash separators
+    FileChange change = FileChange::Identical;
+    uint64_t oldSize = 0;
+    uint64_t newSize = 0;
+    uint64_t changedBlocks = 0;     // 64 KB blocks of the new file whose hash differs from the old file's at the same offset
+    uint64_t changedBytes = 0;      // Bytes in those blocks; the whole file for added and removed files
+};
+
+// Result of comparing two packages
+struct PackageComparison
+{
+    std::vector<FileComparison> files;  // Sorted by name
+    size_t identicalFiles = 0;
+    size_t changedFiles = 0;
+    size_t addedFiles = 0;
+    size_t removedFiles = 0;
+    uint64_t changedBytes = 0;
+    double elapsedSeconds = 0;
+
+    bool Identical() const { return changedFiles == 0 && addedFiles == 0 && removedFiles == 0; }
+};
+
+// Compares two packages from their central directories and AppxBlockMap.xml files alone.
+// Nothing is decompressed beyond the block maps, so the time taken depends on the number of
+// blocks rather than the size of the model.
+class PackageComparer
+{
+public:
+    PackageComparer(Logger logger = Logger());
+    ~PackageComparer() = default;
+
+    // Compare the payload of oldPackagePath with that of newPackagePath
+    bool Compare(const fs::path& oldPackagePath, const fs::path& newPackagePath, PackageComparison& comparison);
+
+    // Serialize a comparison as JSON
+    static std::string ToJson(const fs::path& oldPackagePath, const fs::path& newPackagePath, const PackageComparison& comparison);
+
+    // Lower-case name of a change, as used in the JSON output
+    static const char* ChangeName(FileChange change);
+
+private:
+    Logger m_logger;
+};
\ No newline at end of file
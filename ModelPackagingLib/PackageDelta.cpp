@@ -0,0 +1,655 @@
+#include "PackageDelta.h"
+#include "MsixWriter.h"
+#include "TraceRecorder.h"
+#include <algorithm>
+#include <atomic>
+#include <execution>
+#include <fstream>
+#include <numeric>
+#include <winrt/base.h>
+#include <zlib.h>
+
+// Delta file layout, little-endian:
+//
+//   "MSIXDLT1", SHA-256 of the old package's AppxBlockMap.xml, file count (u32)
+//   For each payload file of the new package, in package order:
+//     name length (u16), UTF-8 name with backslash separators
+//     compression method (u16), CRC-32 (u32), compressed size (u64), uncompressed size (u64)
+//     records covering the file's 64 KB blocks in order:
+//       0: one new block: SHA-256, segment size (u32), compressed segment
+//       1: a run of old blocks: old file index in block map order (u32), first block (u32), count (u32)
+
+namespace {
+    constexpr char DeltaSignature[8] = { 'M', 'S', 'I', 'X', 'D', 'L', 'T', '1' };
+    constexpr uint8_t RecordNewBlock = 0;
+    constexpr uint8_t RecordBaseBlocks = 1;
+
+    constexpr uint16_t MethodStored = 0;
+    constexpr uint16_t MethodDeflate = 8;
+    constexpr size_t BlocksPerBatch = 128;
+    constexpr size_t CopyChunkSize = 1024 * 1024;
+    constexpr size_t StreamBufferSize = 1024 * 1024;
+
+    // A deflated block never comes close to this; anything larger means the delta is damaged
+    constexpr uint32_t MaxSegmentSize = 2 * AppxBlockMap::BlockSize;
+
+    template <typename T>
+    void PutValue(std::ostream& out, T value)
+    {
+        for (size_t i = 0; i < sizeof(T); i++) {
+            out.put(static_cast<char>(static_cast<uint64_t>(value) >> (8 * i)));
+        }
+    }
+
+    template <typename T>
+    bool GetValue(std::istream& in, T& value)
+    {
+        uint8_t bytes[sizeof(T)];
+        if (!in.read(reinterpret_cast<char*>(bytes), sizeof(T))) {
+            return false;
+        }
+
+        uint64_t result = 0;
+        for (size_t i = 0; i < sizeof(T); i++) {
+            result |= static_cast<uint64_t>(bytes[i]) << (8 * i);
+        }
+
+        value = static_cast<T>(result);
+        return true;
+    }
+
+    void PutEntryFields(std::ostream& out, const MsixEntryData& data)
+    {
+        PutValue(out, data.compressionMethod);
+        PutValue(out, data.crc32);
+        PutValue(out, data.compressedSize);
+        PutValue(out, data.uncompressedSize);
+    }
+
+    bool GetEntryFields(std::istream& in, MsixEntryData& data)
+    {
+        return GetValue(in, data.compressionMethod) && GetValue(in, data.crc32) &&
+            GetValue(in, data.compressedSize) && GetValue(in, data.uncompressedSize);
+    }
+
+    uint64_t BlockCount(uint64_t size)
+    {
+        return (size + AppxBlockMap::BlockSize - 1) / AppxBlockMap::BlockSize;
+    }
+
+    // A deflated block's segment depends on whether it ends the file, so that is part of the key
+    std::string BlockKey(const HashUtils::Sha256Digest& hash, bool compressed, bool last)
+    {
+        std::string key(reinterpret_cast<const char*>(hash.data()), hash.size());
+        key += compressed ? (last ? '2' : '1') : '0';
+        return key;
+    }
+}
+
+PackageDelta::PackageDelta(Logger logger, CancellationToken cancellationToken)
+    : m_logger(std::move(logger)),
+      m_cancellationToken(std::move(cancellationToken))
+{
+}
+
+bool PackageDelta::Create(
+    const fs::path& oldPackagePath,
+    const fs::path& newFolder,
+    const fs::path& deltaPath,
+    const SourceScanOptions& scanOptions,
+    PackageDeltaStats* stats)
+{
+    m_logger.Info() << L"Comparing " << newFolder.wstring() << L" with " << oldPackagePath.wstring();
+    
+    std::ifstream oldPackage(oldPackagePath, std::ios::binary);
+    if (!oldPackage) {
+        m_logger.Error() << L"Failed to open package: " << oldPackagePath.wstring();
+        return false;
+    }
+    
+    BasePackage base;
+    if (!ReadBasePackage(oldPackagePath, oldPackage, base)) {
+        return false;
+    }
+    
+    SourceFileList payloadFiles;
+    if (!MsixWriter::ListPayloadFiles(newFolder, scanOptions, payloadFiles, m_logger, m_cancellationToken)) {
+        return false;
+    }
+    
+    std::vector<fs::path> files;
+    files.reserve(payloadFiles.Size() + 1);
+    for (size_t i = 0; i < payloadFiles.Size(); i++) {
+        files.push_back(payloadFiles.RelativePath(i));
+    }
+    
+    // A folder that was never packaged has no manifest of its own, so the old package's is kept
+    const fs::path manifestPath(L"AppxManifest.xml");
+    uint32_t baseManifestIndex = 0;
+    bool reuseManifest = std::find(files.begin(), files.end(), manifestPath) == files.end();
+    if (reuseManifest) {
+        const BlockMapFile* manifest = base.blockMap.Find(manifestPath.wstring());
+        if (manifest) {
+            baseManifestIndex = static_cast<uint32_t>(manifest - base.blockMap.Files().data());
+        }
+        
+        if (!manifest || !base.files[baseManifestIndex].blockMapFile) {
+            m_logger.Error() << L"Neither the folder nor the old package has a usable AppxManifest.xml";
+            return false;
+        }
+        
+        m_logger.Info() << L"Using the AppxManifest.xml of the old package";
+        files.push_back(manifestPath);
+        std::sort(files.begin(), files.end());
+    }
+    
+    // Every block of the old package, by content and by whether it ends its file
+    BlockIndex blockIndex;
+    for (uint32_t fileIndex = 0; fileIndex < base.files.size(); fileIndex++) {
+        const BlockMapFile* file = base.files[fileIndex].blockMapFile;
+        if (!file) {
+            continue;
+        }
+        
+        for (uint32_t block = 0; block < file->blocks.size(); block++) {
+            bool last = block + 1 == file->blocks.size();
+            blockIndex.emplace(BlockKey(file->blocks[block].hash, file->compressed, last), BlockReference{ fileIndex, block });
+        }
+    }
+    
+    std::vector<char> deltaBuffer(StreamBufferSize);
+    std::ofstream delta;
+    delta.rdbuf()->pubsetbuf(deltaBuffer.data(), static_cast<std::streamsize>(deltaBuffer.size()));
+    delta.open(deltaPath, std::ios::binary | std::ios::trunc);
+    if (!delta) {
+        m_logger.Error() << L"Failed to create delta file: " << deltaPath.wstring();
+        return false;
+    }
+    
+    delta.write(DeltaSignature, sizeof(DeltaSignature));
+    delta.write(reinterpret_cast<const char*>(base.identity.data()), base.identity.size());
+    PutValue(delta, static_cast<uint32_t>(files.size()));
+    
+    PackageDeltaStats totals;
+    totals.files = files.size();
+    
+    for (const auto& relativePath : files) {
+        std::string utf8Name = winrt::to_string(relativePath.wstring());
+        PutValue(delta, static_cast<uint16_t>(utf8Name.size()));
+        delta.write(utf8Name.data(), static_cast<std::streamsize>(utf8Name.size()));
+        
+        if (reuseManifest && relativePath == manifestPath) {
+            const BaseFile& manifest = base.files[baseManifestIndex];
+            MsixEntryData data;
+            data.compressionMethod = manifest.entry->compressionMethod;
+            data.crc32 = manifest.entry->crc32;
+            data.compressedSize = manifest.entry->compressedSize;
+            data.uncompressedSize = manifest.entry->uncompressedSize;
+            PutEntryFields(delta, data);
+            
+            uint32_t blockCount = static_cast<uint32_t>(manifest.blockMapFile->blocks.size());
+            PutValue(delta, RecordBaseBlocks);
+            PutValue(delta, baseManifestIndex);
+            PutValue(delta, uint32_t{ 0 });
+            PutValue(delta, blockCount);
+            
+            totals.blocks += blockCount;
+            totals.reusedBlocks += blockCount;
+            totals.unchangedFiles++;
+            continue;
+        }
+        
+        if (!WriteFileDelta(delta, newFolder / relativePath, relativePath.wstring(), base, blockIndex, totals)) {
+            delta.close();
+            std::error_code error;
+            fs::remove(deltaPath, error);
+            return false;
+        }
+    }
+    
+    delta.close();
+    if (delta.fail()) {
+        m_logger.Error() << L"Failed to write delta file: " << deltaPath.wstring();
+        return false;
+    }
+    
+    std::error_code sizeError;
+    totals.deltaBytes = fs::file_size(deltaPath, sizeError);
+    
+    m_logger.Info() << L"Reused " << totals.reusedBlocks << L" of " << totals.blocks << L" blocks; "
+        << totals.unchangedFiles << L" of " << totals.files << L" files are unchanged";
+    m_logger.Info() << L"Delta written: " << deltaPath.wstring() << L" (" << totals.deltaBytes << L" bytes, "
+        << totals.newDataBytes << L" bytes of new data)";
+    
+    if (stats) {
+        *stats = totals;
+    }
+    
+    return true;
+}
+
+bool PackageDelta::Apply(const fs::path& oldPackagePath, const fs::path& deltaPath, const fs::path& outputPath)
+{
+    m_logger.Info() << L"Applying delta " << deltaPath.wstring() << L" to " << oldPackagePath.wstring();
+    
+    // The old package is read while the new one is written
+    std::error_code error;
+    if (fs::equivalent(oldPackagePath, outputPath, error)) {
+        m_logger.Error() << L"The new package can't replace the package the delta is applied to";
+        return false;
+    }
+    
+    std::vector<char> oldBuffer(StreamBufferSize);
+    std::ifstream oldPackage;
+    oldPackage.rdbuf()->pubsetbuf(oldBuffer.data(), static_cast<std::streamsize>(oldBuffer.size()));
+    oldPackage.open(oldPackagePath, std::ios::binary);
+    if (!oldPackage) {
+        m_logger.Error() << L"Failed to open package: " << oldPackagePath.wstring();
+        return false;
+    }
+    
+    std::vector<char> deltaBuffer(StreamBufferSize);
+    std::ifstream delta;
+    delta.rdbuf()->pubsetbuf(deltaBuffer.data(), static_cast<std::streamsize>(deltaBuffer.size()));
+    delta.open(deltaPath, std::ios::binary);
+    if (!delta) {
+        m_logger.Error() << L"Failed to open delta file: " << deltaPath.wstring();
+        return false;
+    }
+    
+    BasePackage base;
+    if (!ReadBasePackage(oldPackagePath, oldPackage, base)) {
+        return false;
+    }
+    
+    char signature[sizeof(DeltaSignature)];
+    HashUtils::Sha256Digest identity{};
+    uint32_t fileCount = 0;
+    
+    if (!delta.read(signature, sizeof(signature)) || !std::equal(signature, signature + sizeof(signature), DeltaSignature) ||
+        !delta.read(reinterpret_cast<char*>(identity.data()), identity.size()) || !GetValue(delta, fileCount)) {
+        m_logger.Error() << L"Not a package delta file: " << deltaPath.wstring();
+        return false;
+    }
+    
+    if (identity != base.identity) {
+        m_logger.Error() << L"The delta was made against a different package than " << oldPackagePath.wstring();
+        return false;
+    }
+    
+    MsixWriter writer(m_logger, m_cancellationToken);
+    if (!writer.Open(outputPath)) {
+        return false;
+    }
+    
+    std::vector<char> buffer(CopyChunkSize);
+    auto copyToEntry = [&](std::istream& from, uint64_t size) {
+        while (size > 0) {
+            size_t chunkSize = static_cast<size_t>((std::min)(size, static_cast<uint64_t>(buffer.size())));
+            if (!from.read(buffer.data(), static_cast<std::streamsize>(chunkSize)) || !writer.WriteEntryData(buffer.data(), chunkSize)) {
+                return false;
+            }
+            size -= chunkSize;
+        }
+        return true;
+    };
+    
+    auto damaged = [&](const std::wstring& name) {
+        m_logger.Error() << L"The delta file is damaged at: " << (name.empty() ? deltaPath.wstring() : name);
+        return false;
+    };
+    
+    uint64_t copiedBytes = 0;
+    
+    for (uint32_t fileNumber = 0; fileNumber < fileCount; fileNumber++) {
+        if (m_cancellationToken.IsCancelled()) {
+            m_logger.Warning() << L"Packaging cancelled";
+            return false;
+        }
+        
+        uint16_t nameLength = 0;
+        std::string utf8Name;
+        MsixEntryData data;
+        
+        if (!GetValue(delta, nameLength)) {
+            return damaged(L"");
+        }
+        
+        utf8Name.resize(nameLength);
+        if (!delta.read(utf8Name.data(), nameLength) || !GetEntryFields(delta, data) ||
+            (data.compressionMethod != MethodStored && data.compressionMethod != MethodDeflate)) {
+            return damaged(L"");
+        }
+        
+        std::wstring name(winrt::to_hstring(utf8Name));
+        bool compressed = data.compressionMethod == MethodDeflate;
+        uint64_t blockCount = BlockCount(data.uncompressedSize);
+        TraceSpan copySpan("copy", name);
+        
+        if (!writer.BeginEntry(name, data)) {
+            return false;
+        }
+        
+        std::vector<BlockMapBlock> blocks;
+        blocks.reserve(static_cast<size_t>(blockCount));
+        
+        while (blocks.size() < blockCount) {
+            uint8_t record = 0;
+            if (!GetValue(delta, record)) {
+                return damaged(name);
+            }
+            
+            if (record == RecordNewBlock) {
+                BlockMapBlock block;
+                uint32_t segmentSize = 0;
+                if (!delta.read(reinterpret_cast<char*>(block.hash.data()), block.hash.size()) || !GetValue(delta, segmentSize) ||
+                    segmentSize > MaxSegmentSize || !copyToEntry(delta, segmentSize)) {
+                    return damaged(name);
+                }
+                
+                block.compressedSize = compressed ? segmentSize : 0;
+                blocks.push_back(block);
+            }
+            else if (record == RecordBaseBlocks) {
+                uint32_t fileIndex = 0;
+                uint32_t firstBlock = 0;
+                uint32_t count = 0;
+                if (!GetValue(delta, fileIndex) || !GetValue(delta, firstBlock) || !GetValue(delta, count) ||
+                    fileIndex >= base.files.size() || count == 0 || blocks.size() + count > blockCount) {
+                    return damaged(name);
+                }
+                
+                const BaseFile& baseFile = base.files[fileIndex];
+                if (!baseFile.blockMapFile || baseFile.blockMapFile->compressed != compressed ||
+                    static_cast<uint64_t>(firstBlock) + count > baseFile.blockMapFile->blocks.size()) {
+                    return damaged(name);
+                }
+                
+                // A run of old blocks is one contiguous range of the old entry's compressed stream
+                uint64_t start = baseFile.segmentOffsets[firstBlock];
+                uint64_t length = baseFile.segmentOffsets[firstBlock + count] - start;
+                oldPackage.clear();
+                oldPackage.seekg(static_cast<std::streamoff>(baseFile.dataOffset + start));
+                if (!copyToEntry(oldPackage, length)) {
+                    m_logger.Error() << L"Failed to copy from the old package for: " << name;
+                    return false;
+                }
+                
+                const auto& baseBlocks = baseFile.blockMapFile->blocks;
+                blocks.insert(blocks.end(), baseBlocks.begin() + firstBlock, baseBlocks.begin() + firstBlock + count);
+                copiedBytes += length;
+            }
+            else {
+                return damaged(name);
+            }
+        }
+        
+        if (!writer.EndEntry(blocks)) {
+            return false;
+        }
+        
+        copySpan.SetBytes(data.compressedSize);
+    }
+    
+    if (!writer.Finish()) {
+        return false;
+    }
+    
+    m_logger.Info() << L"Copied " << copiedBytes << L" bytes from the old package";
+    m_logger.Info() << L"MSIX package created successfully: " << outputPath.wstring();
+    return true;
+}
+
+bool PackageDelta::WriteFileDelta(
+    std::ostream& delta,
+    const fs::path& sourcePath,
+    const std::wstring& name,
+    const BasePackage& base,
+    const BlockIndex& blockIndex,
+    PackageDeltaStats& totals)
+{
+    TraceSpan compressSpan("compress", name);
+    
+    std::ifstream source(sourcePath, std::ios::binary);
+    std::error_code sizeError;
+    uint64_t fileSize = fs::file_size(sourcePath, sizeError);
+    if (!source || sizeError) {
+        m_logger.Error() << L"Failed to open file: " << sourcePath.wstring();
+        return false;
+    }
+    
+    // Same choices as the package writer, so the rebuilt package matches /pack
+    bool compress = MsixWriter::ShouldCompress(sourcePath) && fileSize > 0;
+    uint64_t blockCount = BlockCount(fileSize);
+    
+    MsixEntryData data;
+    data.compressionMethod = compress ? MethodDeflate : MethodStored;
+    data.uncompressedSize = fileSize;
+    
+    // The CRC and compressed size are filled in once the whole file has been read
+    std::streampos fieldsPosition = delta.tellp();
+    PutEntryFields(delta, data);
+    
+    struct BlockResult
+    {
+        HashUtils::Sha256Digest hash;
+        uint32_t crc = 0;
+        bool reused = false;
+        BlockReference reference;
+        std::vector<uint8_t> compressed;
+    };
+    
+    std::vector<uint8_t> input(static_cast<size_t>((std::min)(fileSize, static_cast<uint64_t>(BlocksPerBatch * AppxBlockMap::BlockSize))));
+    std::vector<BlockResult> results(BlocksPerBatch);
+    std::vector<size_t> indices(BlocksPerBatch);
+    std::iota(indices.begin(), indices.end(), size_t{ 0 });
+    
+    uint64_t remaining = fileSize;
+    uint64_t firstBlockOfBatch = 0;
+    uint64_t reusedBlocks = 0;
+    uLong crc = crc32(0L, Z_NULL, 0);
+    
+    // Consecutive old blocks are written as a single run
+    BlockReference run;
+    uint32_t runLength = 0;
+    auto flushRun = [&]() {
+        if (runLength > 0) {
+            PutValue(delta, RecordBaseBlocks);
+            PutValue(delta, run.file);
+            PutValue(delta, run.block);
+            PutValue(delta, runLength);
+            runLength = 0;
+        }
+    };
+    
+    while (remaining > 0) {
+        if (m_cancellationToken.IsCancelled()) {
+            m_logger.Warning() << L"Packaging cancelled";
+            return false;
+        }
+        
+        size_t batchSize = static_cast<size_t>((std::min)(remaining, static_cast<uint64_t>(input.size())));
+        source.read(reinterpret_cast<char*>(input.data()), static_cast<std::streamsize>(batchSize));
+        if (source.gcount() != static_cast<std::streamsize>(batchSize)) {
+            m_logger.Error() << L"Failed to read file (was it modified while packaging?): " << name;
+            return false;
+        }
+        
+        size_t batchBlocks = (batchSize + AppxBlockMap::BlockSize - 1) / AppxBlockMap::BlockSize;
+        
+        std::for_each(std::execution::par, indices.begin(), indices.begin() + batchBlocks, [&](size_t i) {
+            const uint8_t* block = input.data() + i * AppxBlockMap::BlockSize;
+            size_t blockSize = (std::min)(AppxBlockMap::BlockSize, batchSize - i * AppxBlockMap::BlockSize);
+            results[i].hash = HashUtils::Sha256(block, blockSize);
+            results[i].crc = crc32(0L, block, static_cast<uInt>(blockSize));
+        });
+        
+        // Prefer the block after the previous match, so unchanged stretches stay in one run
+        BlockReference previous = run;
+        bool havePrevious = runLength > 0;
+        previous.block += runLength - 1;
+        
+        for (size_t i = 0; i < batchBlocks; i++) {
+            BlockResult& result = results[i];
+            bool last = firstBlockOfBatch + i + 1 == blockCount;
+            result.reused = false;
+            
+            if (havePrevious) {
+                const auto& previousBlocks = base.files[previous.file].blockMapFile->blocks;
+                uint32_t next = previous.block + 1;
+                if (next < previousBlocks.size() && previousBlocks[next].hash == result.hash &&
+                    (!compress || (next + 1 == previousBlocks.size()) == last)) {
+                    result.reused = true;
+                    result.reference = BlockReference{ previous.file, next };
+                }
+            }
+            
+            if (!result.reused) {
+                auto match = blockIndex.find(BlockKey(result.hash, compress, last));
+                if (match != blockIndex.end()) {
+                    result.reused = true;
+                    result.reference = match->second;
+                }
+            }
+            
+            havePrevious = result.reused;
+            previous = result.reference;
+        }
+        
+        // Only blocks the old package doesn't have are compressed
+        std::atomic<bool> compressionFailed = false;
+        if (compress) {
+            std::for_each(std::execution::par, indices.begin(), indices.begin() + batchBlocks, [&](size_t i) {
+                if (results[i].reused) {
+                    return;
+                }
+                
+                const uint8_t* block = input.data() + i * AppxBlockMap::BlockSize;
+                size_t blockSize = (std::min)(AppxBlockMap::BlockSize, batchSize - i * AppxBlockMap::BlockSize);
+                if (!MsixWriter::CompressBlock(block, blockSize, firstBlockOfBatch + i + 1 == blockCount, results[i].compressed)) {
+                    compressionFailed = true;
+                }
+            });
+        }
+        
+        if (compressionFailed) {
+            m_logger.Error() << L"Failed to compress: " << name;
+            return false;
+        }
+        
+        for (size_t i = 0; i < batchBlocks; i++) {
+            const BlockResult& result = results[i];
+            size_t blockSize = (std::min)(AppxBlockMap::BlockSize, batchSize - i * AppxBlockMap::BlockSize);
+            
+            if (result.reused) {
+                const BaseFile& baseFile = base.files[result.reference.file];
+                data.compressedSize += baseFile.segmentOffsets[result.reference.block + 1] - baseFile.segmentOffsets[result.reference.block];
+                reusedBlocks++;
+                
+                if (runLength > 0 && result.reference.file == run.file && result.reference.block == run.block + runLength) {
+                    runLength++;
+                }
+                else {
+                    flushRun();
+                    run = result.reference;
+                    runLength = 1;
+                }
+            }
+            else {
+                flushRun();
+                
+                const uint8_t* output = compress ? result.compressed.data() : input.data() + i * AppxBlockMap::BlockSize;
+                size_t outputSize = compress ? result.compressed.size() : blockSize;
+                
+                PutValue(delta, RecordNewBlock);
+                delta.write(reinterpret_cast<const char*>(result.hash.data()), result.hash.size());
+                PutValue(delta, static_cast<uint32_t>(outputSize));
+                delta.write(reinterpret_cast<const char*>(output), static_cast<std::streamsize>(outputSize));
+                
+                data.compressedSize += outputSize;
+                totals.newDataBytes += outputSize;
+            }
+            
+            crc = crc32_combine(crc, result.crc, static_cast<z_off_t>(blockSize));
+        }
+        
+        firstBlockOfBatch += batchBlocks;
+        remaining -= batchSize;
+    }
+    
+    flushRun();
+    data.crc32 = static_cast<uint32_t>(crc);
+    
+    std::streampos endPosition = delta.tellp();
+    delta.seekp(fieldsPosition);
+    PutEntryFields(delta, data);
+    delta.seekp(endPosition);
+    
+    if (!delta) {
+        m_logger.Error() << L"Failed to write delta for: " << name;
+        return false;
+    }
+    
+    totals.blocks += blockCount;
+    totals.reusedBlocks += reusedBlocks;
+    if (reusedBlocks == blockCount) {
+        totals.unchangedFiles++;
+    }
+    
+    m_logger.Verbose() << name << L": " << reusedBlocks << L" of " << blockCount << L" blocks unchanged";
+    compressSpan.SetBytes(fileSize);
+    return true;
+}
+
+bool PackageDelta::ReadBasePackage(const fs::path& packagePath, std::istream& package, BasePackage& base)
+{
+    if (!base.directory.Read(packagePath, m_logger)) {
+        return false;
+    }
+    
+    const ZipEntry* blockMapEntry = base.directory.Find("AppxBlockMap.xml");
+    std::string blockMapXml;
+    if (!blockMapEntry || !ZipCentralDirectory::ReadEntryContent(package, *blockMapEntry, blockMapXml) ||
+        !base.blockMap.Parse(blockMapXml)) {
+        m_logger.Error() << L"Package has no valid AppxBlockMap.xml: " << packagePath.wstring();
+        return false;
+    }
+    
+    // The block map covers every payload byte, so its hash identifies the package contents
+    base.identity = HashUtils::Sha256(blockMapXml.data(), blockMapXml.size());
+    
+    const auto& blockMapFiles = base.blockMap.Files();
+    base.files.assign(blockMapFiles.size(), BaseFile());
+    
+    for (const auto& entry : base.directory.Entries()) {
+        std::wstring name = ZipCentralDirectory::DecodePartName(entry.name);
+        std::replace(name.begin(), name.end(), L'/', L'\\');
+        
+        const BlockMapFile* file = base.blockMap.Find(name);
+        if (!file || file->size != entry.uncompressedSize || file->compressed != (entry.compressionMethod == MethodDeflate) ||
+            file->blocks.size() != BlockCount(file->size)) {
+            continue;
+        }
+        
+        // The segments must add up to the entry, or its compressed stream can't be split into blocks
+        BaseFile& baseFile = base.files[file - blockMapFiles.data()];
+        uint64_t offset = 0;
+        baseFile.segmentOffsets.reserve(file->blocks.size() + 1);
+        for (size_t i = 0; i < file->blocks.size(); i++) {
+            baseFile.segmentOffsets.push_back(offset);
+            offset += file->compressed ? file->blocks[i].compressedSize : (std::min)(static_cast<uint64_t>(AppxBlockMap::BlockSize), file->size - i * AppxBlockMap::BlockSize);
+        }
+        baseFile.segmentOffsets.push_back(offset);
+        
+        if (offset != entry.compressedSize || !ZipCentralDirectory::FindDataOffset(package, entry, baseFile.dataOffset)) {
+            m_logger.Verbose() << L"Not reusing package entry: " << name;
+            baseFile.segmentOffsets.clear();
+            continue;
+        }
+        
+        baseFile.blockMapFile = file;
+        baseFile.entry = &entry;
+    }
+    
+    return true;
+}
\ No newline at end of file
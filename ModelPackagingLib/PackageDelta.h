@@ -0,0 +1,97 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <istream>
+#include <ostream>
+#include <cstdint>
+#include <unordered_map>
+#include <filesystem>
+#include "Logger.h"
+#include "CancellationToken.h"
+#include "AppxBlockMap.h"
+#include "ZipCentralDirectory.h"
+#include "SourceScanner.h"
+
+namespace fs = std::filesystem;
+
+// Size of a delta and how much of the old package it reuses
+struct PackageDeltaStats
+{
+    uint64_t files = 0;
+    uint64_t unchangedFiles = 0;
+    uint64_t blocks = 0;
+    uint64_t reusedBlocks = 0;
+    uint64_t newDataBytes = 0;      // Compressed bytes of changed blocks carried in the delta
+    uint64_t deltaBytes = 0;
+};
+
+// Block-level differences between a package and a newer version of the folder it was built from.
+//
+// Create hashes every 64 KB block of the new folder and looks it up in the old package's
+// AppxBlockMap.xml. Blocks the old package already has are recorded as references to its compressed
+// segments, in runs, so an unchanged file costs a few bytes; only changed blocks are compressed and
+// carried in the delta. Apply rebuilds the new package from the old package and the delta by copying
+// the referenced segments, and gives the same package that /pack would build from the new folder.
+class PackageDelta
+{
+public:
+    PackageDelta(Logger logger = Logger(), CancellationToken cancellationToken = CancellationToken());
+    ~PackageDelta() = default;
+
+    // Write the delta that turns oldPackagePath into the package of newFolder, taking the files
+    // scanOptions selects as /pack would
+    bool Create(
+        const fs::path& oldPackagePath,
+        const fs::path& newFolder,
+        const fs::path& deltaPath,
+        const SourceScanOptions& scanOptions = SourceScanOptions(),
+        PackageDeltaStats* stats = nullptr);
+
+    // Build the new package from the old package and a delta made against it
+    bool Apply(const fs::path& oldPackagePath, const fs::path& deltaPath, const fs::path& outputPath);
+
+private:
+    // Where one payload file of the old package keeps its compressed segments
+    struct BaseFile
+    {
+        const BlockMapFile* blockMapFile = nullptr; // nullptr if the entry can't be reused
+        const ZipEntry* entry = nullptr;
+        uint64_t dataOffset = 0;
+        std::vector<uint64_t> segmentOffsets;       // Start of each block's segment, plus the end
+    };
+
+    // The old package, with its payload files in block map order
+    struct BasePackage
+    {
+        ZipCentralDirectory directory;
+        AppxBlockMap blockMap;
+        std::vector<BaseFile> files;
+        HashUtils::Sha256Digest identity{};         // SHA-256 of AppxBlockMap.xml
+    };
+
+    // A block of the old package: file index in block map order and block index within the file
+    struct BlockReference
+    {
+        uint32_t file = 0;
+        uint32_t block = 0;
+    };
+
+    // Old blocks by hash, compression and whether they end their file
+    using BlockIndex = std::unordered_map<std::string, BlockReference>;
+
+    // Read the old package's central directory and block map and locate every block's segment
+    bool ReadBasePackage(const fs::path& packagePath, std::istream& package, BasePackage& base);
+
+    // Write the entry fields and block records of one file of the new folder
+    bool WriteFileDelta(
+        std::ostream& delta,
+        const fs::path& sourcePath,
+        const std::wstring& name,
+        const BasePackage& base,
+        const BlockIndex& blockIndex,
+        PackageDeltaStats& totals);
+
+    Logger m_logger;
+    CancellationToken m_cancellationToken;
+};
\ No newline at end of file
@@ -0,0 +1,628 @@
+#include "PackageExtractor.h"
+#include "TraceRecorder.h"
+#include <algorithm>
+#include <chrono>
+#include <execution>
+#include <fstream>
+#include <numeric>
+#include <winioctl.h>
+#include <zlib.h>
+
+namespace {
+    constexpr uint16_t MethodStored = 0;
+    constexpr uint16_t MethodDeflate = 8;
+    constexpr size_t BlocksPerBatch = 128;
+
+    // Compressed bytes handed to zlib at a time; its counters are 32-bit
+    constexpr uint64_t MaxInflateInput = 1ull << 30;
+
+    // Files with less zero data than this are preallocated rather than made sparse
+    constexpr uint64_t MinSparseBytes = 1024 * 1024;
+
+    enum class BlockStatus : uint8_t
+    {
+        Good,
+        HashMismatch,
+        NotInflated     // The segment couldn't be inflated on its own
+    };
+
+    struct BlockResult
+    {
+        BlockStatus status = BlockStatus::Good;
+        const uint8_t* data = nullptr;  // The inflated block, or a stored block in the mapped package
+        size_t size = 0;
+        uint32_t crc = 0;
+    };
+
+    bool IsFootprintFile(const std::wstring& name)
+    {
+        return name == L"AppxBlockMap.xml" || name == L"[Content_Types].xml" ||
+            name == L"AppxSignature.p7x" || name.rfind(L"AppxMetadata\\", 0) == 0;
+    }
+
+    // A payload path must stay inside the output folder
+    bool IsSafeRelativePath(const fs::path& path)
+    {
+        if (path.empty() || path.has_root_name() || path.has_root_directory()) {
+            return false;
+        }
+
+        return std::none_of(path.begin(), path.end(), [](const fs::path& part) { return part == L".."; });
+    }
+
+    uint64_t BlockCount(uint64_t size)
+    {
+        return (size + AppxBlockMap::BlockSize - 1) / AppxBlockMap::BlockSize;
+    }
+
+    // SHA-256 of a 64 KB block of zeros, which sparse output files leave as a hole
+    const HashUtils::Sha256Digest& ZeroBlockHash()
+    {
+        static const HashUtils::Sha256Digest hash = [] {
+            std::vector<uint8_t> zeros(AppxBlockMap::BlockSize);
+            return HashUtils::Sha256(zeros.data(), zeros.size());
+        }();
+        return hash;
+    }
+
+    bool WriteAt(HANDLE file, uint64_t offset, const void* data, size_t size)
+    {
+        OVERLAPPED overlapped = {};
+        overlapped.Offset = static_cast<DWORD>(offset);
+        overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+        DWORD written = 0;
+        return WriteFile(file, data, static_cast<DWORD>(size), &written, &overlapped) && written == size;
+    }
+
+    // Raw inflate state kept by each thread and reset for every block rather than set up again
+    class BlockInflater
+    {
+    public:
+        BlockInflater()
+            : m_stream{},
+              m_ready(inflateInit2(&m_stream, -MAX_WBITS) == Z_OK)
+        {
+        }
+
+        ~BlockInflater()
+        {
+            if (m_ready) {
+                inflateEnd(&m_stream);
+            }
+        }
+
+        BlockInflater(const BlockInflater&) = delete;
+        BlockInflater& operator=(const BlockInflater&) = delete;
+
+        // Inflate one block's segment on its own into exactly size bytes. Only the last segment of an
+        // entry may end the deflate stream.
+        bool Inflate(const uint8_t* segment, size_t segmentSize, bool last, uint8_t* output, size_t size)
+        {
+            if (!m_ready || inflateReset(&m_stream) != Z_OK) {
+                return false;
+            }
+
+            m_stream.next_in = const_cast<Bytef*>(segment);
+            m_stream.avail_in = static_cast<uInt>(segmentSize);
+            m_stream.next_out = output;
+            m_stream.avail_out = static_cast<uInt>(size);
+
+            int status = inflate(&m_stream, Z_SYNC_FLUSH);
+
+            // The block is full; the input left over may only hold the end of the segment, not more data
+            if (status == Z_OK && m_stream.avail_out == 0 && m_stream.avail_in > 0) {
+                uint8_t extra = 0;
+                m_stream.next_out = &extra;
+                m_stream.avail_out = 1;
+
+                status = inflate(&m_stream, Z_SYNC_FLUSH);
+                if (m_stream.avail_out == 0) {
+                    return false;
+                }
+            }
+
+            if (status == Z_BUF_ERROR) {
+                status = Z_OK;
+            }
+
+            return m_stream.avail_in == 0 && m_stream.total_out == size && status == (last ? Z_STREAM_END : Z_OK);
+        }
+
+    private:
+        z_stream m_stream;
+        bool m_ready;
+    };
+}
+
+PackageExtractor::PackageExtractor(Logger logger, CancellationToken cancellationToken)
+    : m_logger(std::move(logger)),
+      m_cancellationToken(std::move(cancellationToken))
+{
+}
+
+bool PackageExtractor::Verify(const fs::path& packagePath, PackageExtractStats* stats)
+{
+    return Run(packagePath, nullptr, stats);
+}
+
+bool PackageExtractor::Unpack(const fs::path& packagePath, const fs::path& outputFolder, PackageExtractStats* stats)
+{
+    return Run(packagePath, &outputFolder, stats);
+}
+
+bool PackageExtractor::Run(const fs::path& packagePath, const fs::path* outputFolder, PackageExtractStats* stats)
+{
+    auto start = std::chrono::steady_clock::now();
+    TraceSpan runSpan(outputFolder ? "unpack" : "verify", packagePath.filename().wstring());
+    
+    ZipCentralDirectory directory;
+    MappedFile package;
+    if (!package.Open(packagePath, m_logger) || !directory.Read(package.Data(), package.Size(), packagePath, m_logger)) {
+        return false;
+    }
+    
+    // The block map is read through a stream so that its own CRC is checked before anything relies on it
+    std::ifstream packageStream(packagePath, std::ios::binary);
+    const ZipEntry* blockMapEntry = directory.Find("AppxBlockMap.xml");
+    std::string blockMapXml;
+    AppxBlockMap blockMap;
+    
+    if (!packageStream || !blockMapEntry || !ZipCentralDirectory::ReadEntryContent(packageStream, *blockMapEntry, blockMapXml) ||
+        !blockMap.Parse(blockMapXml)) {
+        m_logger.Error() << L"Package has no valid AppxBlockMap.xml: " << packagePath.wstring();
+        return false;
+    }
+    
+    std::vector<EntryJob> jobs;
+    bool complete = PlanEntries(directory, blockMap, package, jobs);
+    
+    if (outputFolder) {
+        std::error_code error;
+        fs::create_directories(*outputFolder, error);
+        
+        for (auto& job : jobs) {
+            if (job.blockMapFile && job.error.empty()) {
+                CreateOutputFile(job, *outputFolder);
+            }
+        }
+    }
+    
+    std::vector<BlockTask> tasks;
+    for (size_t i = 0; i < jobs.size(); i++) {
+        if (jobs[i].error.empty() && !jobs[i].streaming) {
+            for (size_t block = 0; block < jobs[i].blockMapFile->blocks.size(); block++) {
+                tasks.push_back(BlockTask{ static_cast<uint32_t>(i), static_cast<uint32_t>(block) });
+            }
+        }
+    }
+    
+    bool finished = CheckBlocks(package, jobs, tasks);
+    
+    // Entries that can't be split into blocks, including any found above, are inflated as whole
+    // streams, several entries at a time
+    if (finished) {
+        std::vector<EntryJob*> streamJobs;
+        for (auto& job : jobs) {
+            if (job.error.empty() && job.streaming) {
+                streamJobs.push_back(&job);
+            }
+        }
+        
+        if (!streamJobs.empty()) {
+            m_logger.Verbose() << L"Inflating " << streamJobs.size() << L" entries as whole streams";
+        }
+        
+        std::for_each(std::execution::par, streamJobs.begin(), streamJobs.end(), [&](EntryJob* job) {
+            CheckStream(package, *job);
+        });
+        
+        finished = !m_cancellationToken.IsCancelled();
+    }
+    
+    PackageExtractStats totals;
+    bool success = complete && finished;
+    
+    for (auto& job : jobs) {
+        if (finished && job.error.empty() && job.crc != job.entry->crc32) {
+            job.error = L"CRC-32 doesn't match the central directory";
+        }
+        
+        bool failed = !finished || !job.error.empty();
+        if (job.output) {
+            job.output.reset();
+            
+            // A file that didn't check out is not left behind looking like a good one
+            if (failed) {
+                std::error_code error;
+                fs::remove(job.outputPath, error);
+            }
+            else {
+                totals.unpackedFiles++;
+                totals.sparseBytes += job.sparseBytes;
+            }
+        }
+        
+        if (!finished) {
+            continue;
+        }
+        
+        totals.entries++;
+        if (failed) {
+            m_logger.Error() << L"Damaged package entry " << job.name << L": " << job.error;
+            totals.failedEntries++;
+            success = false;
+        }
+        else {
+            totals.bytes += job.entry->uncompressedSize;
+            totals.blocks += job.blockMapFile ? job.blockMapFile->blocks.size() : 0;
+        }
+    }
+    
+    if (!finished) {
+        m_logger.Warning() << (outputFolder ? L"Unpacking cancelled" : L"Verification cancelled");
+    }
+    
+    totals.elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    runSpan.SetBytes(totals.bytes);
+    
+    if (stats) {
+        *stats = totals;
+    }
+    
+    return success;
+}
+
+bool PackageExtractor::PlanEntries(
+    const ZipCentralDirectory& directory,
+    const AppxBlockMap& blockMap,
+    const MappedFile& package,
+    std::vector<EntryJob>& jobs)
+{
+    const auto& blockMapFiles = blockMap.Files();
+    std::vector<bool> found(blockMapFiles.size());
+    
+    jobs.clear();
+    jobs.reserve(directory.Entries().size());
+    
+    for (const auto& entry : directory.Entries()) {
+        EntryJob& job = jobs.emplace_back();
+        job.entry = &entry;
+        job.name = ZipCentralDirectory::DecodePartName(entry.name);
+        std::replace(job.name.begin(), job.name.end(), L'/', L'\\');
+        
+        if (entry.compressionMethod != MethodStored && entry.compressionMethod != MethodDeflate) {
+            job.error = L"unsupported compression method " + std::to_wstring(entry.compressionMethod);
+            continue;
+        }
+        
+        if (!ZipCentralDirectory::FindDataOffset(package.Data(), package.Size(), entry, job.dataOffset) ||
+            !package.Contains(job.dataOffset, entry.compressedSize)) {
+            job.error = L"entry data lies outside the package";
+            continue;
+        }
+        
+        if (entry.compressionMethod == MethodStored && entry.compressedSize != entry.uncompressedSize) {
+            job.error = L"stored entry has different compressed and uncompressed sizes";
+            continue;
+        }
+        
+        // Footprint files aren't in the block map; their CRC is all there is to check
+        if (IsFootprintFile(job.name)) {
+            job.streaming = true;
+            continue;
+        }
+        
+        const BlockMapFile* file = blockMap.Find(job.name);
+        if (!file) {
+            job.error = L"not listed in AppxBlockMap.xml";
+            continue;
+        }
+        
+        size_t fileIndex = static_cast<size_t>(file - blockMapFiles.data());
+        if (found[fileIndex]) {
+            job.error = L"appears more than once in the package";
+            continue;
+        }
+        found[fileIndex] = true;
+        
+        if (file->size != entry.uncompressedSize || file->compressed != (entry.compressionMethod == MethodDeflate) ||
+            file->blocks.size() != BlockCount(file->size)) {
+            job.error = L"doesn't match its entry in AppxBlockMap.xml";
+            continue;
+        }
+        
+        if (!IsSafeRelativePath(fs::path(job.name))) {
+            job.error = L"path leads outside the package";
+            continue;
+        }
+        
+        job.blockMapFile = file;
+        
+        // Blocks are inflated one by one when their segments add up to the entry, else as one stream
+        uint64_t offset = 0;
+        job.segmentOffsets.reserve(file->blocks.size() + 1);
+        for (size_t i = 0; i < file->blocks.size(); i++) {
+            job.segmentOffsets.push_back(offset);
+            offset += file->compressed ? file->blocks[i].compressedSize : (std::min)(static_cast<uint64_t>(AppxBlockMap::BlockSize), file->size - i * AppxBlockMap::BlockSize);
+        }
+        job.segmentOffsets.push_back(offset);
+        
+        if (offset != entry.compressedSize) {
+            m_logger.Verbose() << L"Block segments don't add up to the entry, inflating it as one stream: " << job.name;
+            job.segmentOffsets.clear();
+            job.streaming = true;
+        }
+    }
+    
+    bool complete = true;
+    for (size_t i = 0; i < blockMapFiles.size(); i++) {
+        if (!found[i]) {
+            m_logger.Error() << L"File listed in AppxBlockMap.xml is missing from the package: " << blockMapFiles[i].name;
+            complete = false;
+        }
+    }
+    
+    return complete;
+}
+
+void PackageExtractor::CreateOutputFile(EntryJob& job, const fs::path& outputFolder)
+{
+    job.outputPath = outputFolder / fs::path(job.name);
+    
+    std::error_code error;
+    fs::create_directories(job.outputPath.parent_path(), error);
+    
+    job.output.reset(CreateFileW(job.outputPath.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr));
+    if (!job.output) {
+        job.error = L"failed to create " + job.outputPath.wstring() + L" (error " + std::to_wstring(GetLastError()) + L")";
+        return;
+    }
+    
+    const BlockMapFile& file = *job.blockMapFile;
+    uint64_t zeroBytes = AppxBlockMap::BlockSize * static_cast<uint64_t>(std::count_if(file.blocks.begin(), file.blocks.end(),
+        [](const BlockMapBlock& block) { return block.hash == ZeroBlockHash(); }));
+    
+    // Zero-filled tensors and padding are left as holes. Other files get their space up front, which keeps
+    // them in one piece on disk and fails early when the volume is full.
+    if (zeroBytes >= MinSparseBytes) {
+        DWORD returned = 0;
+        job.sparse = DeviceIoControl(job.output.get(), FSCTL_SET_SPARSE, nullptr, 0, nullptr, 0, &returned, nullptr) != FALSE;
+    }
+    
+    if (!job.sparse) {
+        FILE_ALLOCATION_INFO allocation = {};
+        allocation.AllocationSize.QuadPart = static_cast<LONGLONG>(file.size);
+        SetFileInformationByHandle(job.output.get(), FileAllocationInfo, &allocation, sizeof(allocation));
+    }
+    
+    FILE_END_OF_FILE_INFO endOfFile = {};
+    endOfFile.EndOfFile.QuadPart = static_cast<LONGLONG>(file.size);
+    if (!SetFileInformationByHandle(job.output.get(), FileEndOfFileInfo, &endOfFile, sizeof(endOfFile))) {
+        job.error = L"failed to set the size of " + job.outputPath.wstring() + L" (error " + std::to_wstring(GetLastError()) + L")";
+    }
+}
+
+bool PackageExtractor::CheckBlocks(const MappedFile& package, std::vector<EntryJob>& jobs, const std::vector<BlockTask>& tasks)
+{
+    std::vector<uint8_t> inflated(BlocksPerBatch * AppxBlockMap::BlockSize);
+    std::vector<BlockResult> results(BlocksPerBatch);
+    std::vector<size_t> indices(BlocksPerBatch);
+    std::iota(indices.begin(), indices.end(), size_t{ 0 });
+    
+    // Consecutive blocks of a file that lie next to each other in memory are written with one call
+    EntryJob* pendingJob = nullptr;
+    uint64_t pendingOffset = 0;
+    const uint8_t* pendingData = nullptr;
+    size_t pendingSize = 0;
+    
+    auto flushPending = [&]() {
+        if (pendingSize > 0 && pendingJob->error.empty() && !pendingJob->streaming &&
+            !WriteAt(pendingJob->output.get(), pendingOffset, pendingData, pendingSize)) {
+            pendingJob->error = L"failed to write " + pendingJob->outputPath.wstring() + L" (error " + std::to_wstring(GetLastError()) + L")";
+        }
+        pendingSize = 0;
+    };
+    
+    for (size_t first = 0; first < tasks.size(); first += BlocksPerBatch) {
+        if (m_cancellationToken.IsCancelled()) {
+            return false;
+        }
+        
+        size_t batchBlocks = (std::min)(BlocksPerBatch, tasks.size() - first);
+        
+        // Inflate, hash and checksum the blocks of the batch across all cores. Jobs are only changed
+        // between batches, so reading them here is safe.
+        std::for_each(std::execution::par, indices.begin(), indices.begin() + batchBlocks, [&](size_t i) {
+            const BlockTask& task = tasks[first + i];
+            const EntryJob& job = jobs[task.job];
+            const BlockMapFile& file = *job.blockMapFile;
+            
+            BlockResult& result = results[i];
+            result = BlockResult();
+            if (!job.error.empty() || job.streaming) {
+                return;
+            }
+            
+            result.size = static_cast<size_t>((std::min)(static_cast<uint64_t>(AppxBlockMap::BlockSize), file.size - static_cast<uint64_t>(task.block) * AppxBlockMap::BlockSize));
+            const uint8_t* segment = package.Data() + job.dataOffset + job.segmentOffsets[task.block];
+            size_t segmentSize = static_cast<size_t>(job.segmentOffsets[task.block + 1] - job.segmentOffsets[task.block]);
+            
+            if (file.compressed) {
+                thread_local BlockInflater inflater;
+                uint8_t* output = inflated.data() + i * AppxBlockMap::BlockSize;
+                
+                if (!inflater.Inflate(segment, segmentSize, task.block + 1 == file.blocks.size(), output, result.size)) {
+                    result.status = BlockStatus::NotInflated;
+                    return;
+                }
+                result.data = output;
+            }
+            else {
+                result.data = segment;
+            }
+            
+            if (HashUtils::Sha256(result.data, result.size) != file.blocks[task.block].hash) {
+                result.status = BlockStatus::HashMismatch;
+                return;
+            }
+            
+            result.crc = crc32(0L, result.data, static_cast<uInt>(result.size));
+        });
+        
+        // Results are taken in order, so each entry's CRC is built up block by block and its file is
+        // written front to back
+        for (size_t i = 0; i < batchBlocks; i++) {
+            const BlockTask& task = tasks[first + i];
+            EntryJob& job = jobs[task.job];
+            const BlockResult& result = results[i];
+            
+            if (!job.error.empty() || job.streaming) {
+                continue;
+            }
+            
+            if (result.status == BlockStatus::NotInflated) {
+                // The segments depend on each other after all; the entry starts over as one stream
+                job.streaming = true;
+                continue;
+            }
+            
+            if (result.status == BlockStatus::HashMismatch) {
+                job.error = L"block " + std::to_wstring(task.block) + L" doesn't match its hash in AppxBlockMap.xml";
+                continue;
+            }
+            
+            job.crc = static_cast<uint32_t>(crc32_combine(job.crc, result.crc, static_cast<z_off_t>(result.size)));
+            
+            if (!job.output) {
+                continue;
+            }
+            
+            if (job.sparse && job.blockMapFile->blocks[task.block].hash == ZeroBlockHash()) {
+                job.sparseBytes += result.size;
+                continue;
+            }
+            
+            uint64_t offset = static_cast<uint64_t>(task.block) * AppxBlockMap::BlockSize;
+            if (pendingSize > 0 && (pendingJob != &job || pendingData + pendingSize != result.data || pendingOffset + pendingSize != offset)) {
+                flushPending();
+            }
+            
+            if (pendingSize == 0) {
+                pendingJob = &job;
+                pendingOffset = offset;
+                pendingData = result.data;
+            }
+            pendingSize += result.size;
+        }
+        
+        // The next batch reuses the buffers
+        flushPending();
+    }
+    
+    return true;
+}
+
+void PackageExtractor::CheckStream(const MappedFile& package, EntryJob& job)
+{
+    const ZipEntry& entry = *job.entry;
+    const uint8_t* input = package.Data() + job.dataOffset;
+    bool deflated = entry.compressionMethod == MethodDeflate;
+    
+    job.crc = 0;
+    job.sparseBytes = 0;
+    
+    z_stream stream = {};
+    if (deflated && inflateInit2(&stream, -MAX_WBITS) != Z_OK) {
+        job.error = L"failed to start inflating";
+        return;
+    }
+    
+    auto endStream = wil::scope_exit([&]() {
+        if (deflated) {
+            inflateEnd(&stream);
+        }
+    });
+    
+    // Hands zlib the next part of the compressed data once it has used up the last
+    uint64_t consumed = 0;
+    auto feedInput = [&]() {
+        uint64_t chunk = (std::min)(MaxInflateInput, entry.compressedSize - consumed);
+        stream.next_in = const_cast<Bytef*>(input + consumed);
+        stream.avail_in = static_cast<uInt>(chunk);
+        consumed += chunk;
+        return chunk > 0;
+    };
+    
+    std::vector<uint8_t> buffer(deflated ? AppxBlockMap::BlockSize : 0);
+    int status = Z_OK;
+    size_t blockIndex = 0;
+    
+    for (uint64_t offset = 0; offset < entry.uncompressedSize; offset += AppxBlockMap::BlockSize, blockIndex++) {
+        if (m_cancellationToken.IsCancelled()) {
+            return;
+        }
+        
+        size_t size = static_cast<size_t>((std::min)(static_cast<uint64_t>(AppxBlockMap::BlockSize), entry.uncompressedSize - offset));
+        const uint8_t* block = input + offset;
+        
+        if (deflated) {
+            stream.next_out = buffer.data();
+            stream.avail_out = static_cast<uInt>(size);
+            
+            while (stream.avail_out > 0 && status == Z_OK) {
+                if (stream.avail_in == 0 && !feedInput()) {
+                    break;
+                }
+                status = inflate(&stream, Z_NO_FLUSH);
+            }
+            
+            if (stream.avail_out > 0) {
+                job.error = L"compressed data is damaged or truncated";
+                return;
+            }
+            block = buffer.data();
+        }
+        
+        if (job.blockMapFile) {
+            if (HashUtils::Sha256(block, size) != job.blockMapFile->blocks[blockIndex].hash) {
+                job.error = L"block " + std::to_wstring(blockIndex) + L" doesn't match its hash in AppxBlockMap.xml";
+                return;
+            }
+        }
+        
+        job.crc = static_cast<uint32_t>(crc32(job.crc, block, static_cast<uInt>(size)));
+        
+        if (job.output) {
+            if (job.sparse && job.blockMapFile->blocks[blockIndex].hash == ZeroBlockHash()) {
+                job.sparseBytes += size;
+            }
+            else if (!WriteAt(job.output.get(), offset, block, size)) {
+                job.error = L"failed to write " + job.outputPath.wstring() + L" (error " + std::to_wstring(GetLastError()) + L")";
+                return;
+            }
+        }
+    }
+    
+    // The deflate stream must end exactly where the entry's data does
+    if (deflated) {
+        while (status == Z_OK) {
+            uint8_t extra = 0;
+            stream.next_out = &extra;
+            stream.avail_out = 1;
+            
+            if (stream.avail_in == 0 && !feedInput()) {
+                break;
+            }
+            
+            status = inflate(&stream, Z_NO_FLUSH);
+            if (stream.avail_out == 0) {
+                status = Z_DATA_ERROR;
+            }
+        }
+        
+        if (status != Z_STREAM_END || stream.avail_in != 0 || consumed != entry.compressedSize) {
+            job.error = L"compressed data doesn't end with the entry";
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <filesystem>
+#include "Logger.h"
+#include "CancellationToken.h"
+#include "AppxBlockMap.h"
+#include "MappedFile.h"
+#include "ZipCentralDirectory.h"
+
+namespace fs = std::filesystem;
+
+// Totals of a verify or unpack run
+struct PackageExtractStats
+{
+    uint64_t entries = 0;
+    uint64_t failedEntries = 0;
+    uint64_t blocks = 0;            // 64 KB blocks checked against AppxBlockMap.xml
+    uint64_t bytes = 0;             // Uncompressed bytes checked
+    uint64_t unpackedFiles = 0;
+    uint64_t sparseBytes = 0;       // All-zero blocks left as holes in unpacked files instead of written
+    double elapsedSeconds = 0;
+};
+
+// Checks a package the way installing it would, without installing it, and extracts its payload.
+//
+// The package is mapped into memory and its blocks are inflated in batches across all cores.
+// Every 64 KB block is checked against its SHA-256 in AppxBlockMap.xml and every entry against the
+// CRC-32 in the central directory. Blocks are inflated on their own where the block map gives their
+// compressed segments, as in packages from MsixWriter and MakeAppx.exe; an entry whose segments can't
+// be inflated on their own is inflated as one stream instead.
+class PackageExtractor
+{
+public:
+    PackageExtractor(Logger logger = Logger(), CancellationToken cancellationToken = CancellationToken());
+    ~PackageExtractor() = default;
+
+    // Check every entry of a package, reporting each one that is damaged
+    bool Verify(const fs::path& packagePath, PackageExtractStats* stats = nullptr);
+
+    // Check a package as Verify does while writing its payload files under outputFolder.
+    // Files that fail the check are deleted.
+    bool Unpack(const fs::path& packagePath, const fs::path& outputFolder, PackageExtractStats* stats = nullptr);
+
+private:
+    // One entry of the package and where its check stands
+    struct EntryJob
+    {
+        const ZipEntry* entry = nullptr;
+        std::wstring name;                          // Relative path with backslash separators
+        const BlockMapFile* blockMapFile = nullptr; // nullptr for footprint files, which only have a CRC
+        uint64_t dataOffset = 0;
+        std::vector<uint64_t> segmentOffsets;       // Start of each block's segment, plus the end
+        bool streaming = false;                     // Inflate as one stream rather than block by block
+        uint32_t crc = 0;                           // CRC-32 of the blocks checked so far
+        std::wstring error;                         // Why the entry failed, empty while it is good
+
+        // Unpack only
+        fs::path outputPath;
+        wil::unique_hfile output;
+        bool sparse = false;                        // All-zero blocks are skipped rather than written
+        uint64_t sparseBytes = 0;
+    };
+
+    // A block of an entry that is checked block by block
+    struct BlockTask
+    {
+        uint32_t job = 0;
+        uint32_t block = 0;
+    };
+
+    // Check, and unpack when outputFolder is given, every entry of a package
+    bool Run(const fs::path& packagePath, const fs::path* outputFolder, PackageExtractStats* stats);
+
+    // Match the central directory with the block map and locate every entry's data
+    bool PlanEntries(
+        const ZipCentralDirectory& directory,
+        const AppxBlockMap& blockMap,
+        const MappedFile& package,
+        std::vector<EntryJob>& jobs);
+
+    // Create the output file of a payload entry, sparse if it has enough all-zero blocks, else preallocated
+    void CreateOutputFile(EntryJob& job, const fs::path& outputFolder);
+
+    // Inflate and check the blocks of every block-by-block entry in parallel batches
+    bool CheckBlocks(const MappedFile& package, std::vector<EntryJob>& jobs, const std::vector<BlockTask>& tasks);
+
+    // Inflate and check an entry as a single stream
+    void CheckStream(const MappedFile& package, EntryJob& job);
+
+    Logger m_logger;
+    CancellationToken m_cancellationToken;
+};
\ No newline at end of file
@@ -0,0 +1,164 @@
+#include "PackageStaging.h"
+#include <algorithm>
+#include <atomic>
+#include <execution>
+#include <fstream>
+#include <numeric>
+#include <Windows.h>
+
+namespace {
+    constexpr wchar_t StagingFolderName[] = L"ModelPackagingTool_Staging";
+
+    // Mount point of the volume a path is on, such as C:\, or empty when it can't be found
+    std::wstring VolumeOf(const fs::path& path)
+    {
+        wchar_t volumePath[MAX_PATH + 1] = {};
+        if (!GetVolumePathNameW(path.c_str(), volumePath, static_cast<DWORD>(std::size(volumePath)))) {
+            return std::wstring();
+        }
+        return volumePath;
+    }
+
+    bool SameVolume(const std::wstring& a, const std::wstring& b)
+    {
+        return !a.empty() && _wcsicmp(a.c_str(), b.c_str()) == 0;
+    }
+}
+
+PackageStaging::PackageStaging(Logger logger)
+    : m_logger(std::move(logger)),
+      m_workspace(Logger()),
+      m_files(nullptr)
+{
+}
+
+bool PackageStaging::Stage(const fs::path& sourceFolder, const SourceFileList& files)
+{
+    m_sourceFolder = sourceFolder;
+    m_files = &files;
+    m_linked.assign(files.Size(), 0);
+    m_generated.clear();
+    m_order.resize(files.Size());
+    std::iota(m_order.begin(), m_order.end(), uint32_t{ 0 });
+    
+    // Links only work within a volume: the temporary folder is used when it is on the source folder's
+    // volume, and a folder at the root of that volume otherwise
+    std::error_code error;
+    std::wstring sourceVolume = VolumeOf(fs::absolute(sourceFolder, error));
+    fs::path temporaryFolder = fs::temp_directory_path(error);
+    
+    std::vector<fs::path> candidates;
+    if (!SameVolume(VolumeOf(temporaryFolder), sourceVolume) && !sourceVolume.empty()) {
+        candidates.push_back(fs::path(sourceVolume) / StagingFolderName);
+    }
+    candidates.push_back(temporaryFolder / StagingFolderName);
+    
+    for (const auto& candidate : candidates) {
+        // Staging folders that runs which have ended left behind are deleted in the background
+        WorkspaceCleaner::Instance().ReclaimAbandoned(candidate, m_logger);
+        if (m_workspace.Create(candidate)) {
+            m_root = m_workspace.Path();
+            break;
+        }
+    }
+    
+    if (m_root.empty()) {
+        m_logger.Error() << L"Failed to create a staging folder in: " << candidates.back().wstring();
+        return false;
+    }
+    
+    if (!SameVolume(VolumeOf(m_root), sourceVolume)) {
+        m_logger.Verbose() << L"Packaging the files where they are; no staging folder could be made on the volume of "
+            << sourceFolder.wstring();
+        return true;
+    }
+    
+    // Folders are made in list order, where a folder's files follow each other, and the links in parallel
+    fs::path lastFolder;
+    for (size_t i = 0; i < files.Size(); i++) {
+        fs::path folder = files.RelativePath(i).parent_path();
+        if (!folder.empty() && folder != lastFolder) {
+            fs::create_directories(m_root / folder, error);
+            lastFolder = folder;
+        }
+    }
+    
+    std::atomic<DWORD> firstError = 0;
+    std::vector<size_t> indices(files.Size());
+    std::iota(indices.begin(), indices.end(), size_t{ 0 });
+    std::for_each(std::execution::par, indices.begin(), indices.end(), [&](size_t i) {
+        fs::path relativePath = files.RelativePath(i);
+        if (CreateHardLinkW((m_root / relativePath).c_str(), (sourceFolder / relativePath).c_str(), nullptr)) {
+            m_linked[i] = 1;
+        }
+        else {
+            DWORD expected = 0;
+            firstError.compare_exchange_strong(expected, GetLastError());
+        }
+    });
+    
+    size_t linked = std::count(m_linked.begin(), m_linked.end(), 1);
+    m_logger.Verbose() << L"Staged " << files.Size() << L" files in " << m_root.wstring();
+    if (linked < files.Size()) {
+        m_logger.Verbose() << (files.Size() - linked) << L" files could not be linked and are packaged where they are (error "
+            << firstError.load() << L")";
+    }
+    return true;
+}
+
+bool PackageStaging::AddGeneratedFile(const fs::path& relativePath, const std::string& content)
+{
+    fs::path path = m_root / relativePath;
+    std::error_code error;
+    fs::create_directories(path.parent_path(), error);
+    
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(content.data(), static_cast<std::streamsize>(content.size()));
+    file.close();
+    if (file.fail()) {
+        m_logger.Error() << L"Failed to write generated file: " << path.wstring();
+        return false;
+    }
+    
+    // Slotted into the sorted order, as if the scan had found it
+    uint32_t index = static_cast<uint32_t>(m_linked.size() + m_generated.size());
+    m_generated.push_back(relativePath);
+    auto position = std::partition_point(m_order.begin(), m_order.end(), [&](uint32_t entry) {
+        return (entry < m_linked.size() ? m_files->RelativePath(entry) : m_generated[entry - m_linked.size()]) < relativePath;
+    });
+    m_order.insert(position, index);
+    return true;
+}
+
+size_t PackageStaging::Size() const
+{
+    return m_order.size();
+}
+
+fs::path PackageStaging::RelativePath(size_t index) const
+{
+    uint32_t entry = m_order[index];
+    return entry < m_linked.size() ? m_files->RelativePath(entry) : m_generated[entry - m_linked.size()];
+}
+
+fs::path PackageStaging::SourcePath(size_t index) const
+{
+    uint32_t entry = m_order[index];
+    if (entry >= m_linked.size()) {
+        return m_root / m_generated[entry - m_linked.size()];
+    }
+    return (m_linked[entry] ? m_root : m_sourceFolder) / m_files->RelativePath(entry);
+}
+
+bool PackageStaging::ContainsRootFile(const std::wstring& name) const
+{
+    if (m_files && m_files->ContainsRootFile(name)) {
+        return true;
+    }
+    return std::find(m_generated.begin(), m_generated.end(), fs::path(name)) != m_generated.end();
+}
+
+const fs::path& PackageStaging::Root() const
+{
+    return m_root;
+}
\ No newline at end of file
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <filesystem>
+#include "Logger.h"
+#include "JobWorkspace.h"
+#include "SourceScanner.h"
+
+namespace fs = std::filesystem;
+
+// The root a package is built from, assembled without touching the source folder.
+//
+// The listed files of the source folder are hard-linked into a staging folder on the same volume,
+// and files the tool generates, such as AppxManifest.xml, are written only there. A link shares the
+// file's data, so staging copies nothing, and a file that is replaced in the source folder while the
+// package is built (as editors and downloads do, by writing a new file and renaming it over the old
+// one) is still packaged as it was when staged. Files that can't be linked, because no staging folder
+// could be made on their volume or the file system has no hard links, are packaged where they are.
+//
+// A staging folder is a JobWorkspace, so the folder of a run that ended without deleting it is
+// reclaimed by the next run that stages on the same volume.
+class PackageStaging
+{
+public:
+    explicit PackageStaging(Logger logger = Logger());
+
+    // Hands the staging folder to the WorkspaceCleaner; the files its links point to are left alone
+    ~PackageStaging() = default;
+
+    PackageStaging(const PackageStaging&) = delete;
+    PackageStaging& operator=(const PackageStaging&) = delete;
+
+    // Create the staging folder and link the listed files of sourceFolder into it. The list must
+    // outlive the staging.
+    bool Stage(const fs::path& sourceFolder, const SourceFileList& files);
+
+    // Write a generated file into the staging folder. Its path must not be one of the listed files.
+    bool AddGeneratedFile(const fs::path& relativePath, const std::string& content);
+
+    // Number of files in the package root, listed and generated
+    size_t Size() const;
+
+    // Path of a file in the package, in the sorted order of the file list
+    fs::path RelativePath(size_t index) const;
+
+    // Where to read a file from: its link or generated file in the staging folder, or the source file
+    fs::path SourcePath(size_t index) const;
+
+    // Whether the package root has a file with this name at the top
+    bool ContainsRootFile(const std::wstring& name) const;
+
+    // The staging folder
+    const fs::path& Root() const;
+
+private:
+    Logger m_logger;
+    JobWorkspace m_workspace;               // Logs nothing: failing on one volume only means trying the next
+    fs::path m_sourceFolder;
+    fs::path m_root;
+    const SourceFileList* m_files;
+    std::vector<uint8_t> m_linked;          // Per listed file, whether it was linked into the staging folder
+    std::vector<fs::path> m_generated;
+
+    // Indexes of the files in package order: listed files first by index, then generated ones
+    std::vector<uint32_t> m_order;
+};
\ No newline at end of file
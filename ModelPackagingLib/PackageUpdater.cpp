@@ -0,0 +1,239 @@
+#include "PackageUpdater.h"
+#include "MsixWriter.h"
+#include "ZipCentralDirectory.h"
+#include "AppxBlockMap.h"
+#include "TraceRecorder.h"
+#include <algorithm>
+#include <cstring>
+#include <cwctype>
+#include <fstream>
+#include <map>
+#include <regex>
+#include <sstream>
+#include <winrt/base.h>
+
+namespace {
+    // Part names are compared case-insensitively, with backslash separators as in the block map
+    std::wstring NormalizeName(std::wstring name)
+    {
+        std::replace(name.begin(), name.end(), L'/', L'\\');
+        while (!name.empty() && name.front() == L'\\') {
+            name.erase(name.begin());
+        }
+        std::transform(name.begin(), name.end(), name.begin(), ::towlower);
+        return name;
+    }
+
+    // Files that are generated for every package rather than copied
+    bool IsFootprintFile(const std::wstring& name)
+    {
+        return name == L"AppxBlockMap.xml" || name == L"[Content_Types].xml" ||
+            name == L"AppxSignature.p7x" || name.rfind(L"AppxMetadata\\", 0) == 0;
+    }
+}
+
+PackageUpdater::PackageUpdater(Logger logger, CancellationToken cancellationToken)
+    : m_logger(std::move(logger)),
+      m_cancellationToken(std::move(cancellationToken))
+{
+}
+
+bool PackageUpdater::Update(const fs::path& packagePath, const fs::path& outputPath, const PackageEdits& edits)
+{
+    m_logger.Info() << L"Updating MSIX package: " << packagePath.wstring();
+    
+    ZipCentralDirectory directory;
+    if (!directory.Read(packagePath, m_logger)) {
+        return false;
+    }
+    
+    fs::path temporaryPath = outputPath;
+    temporaryPath += L".tmp";
+    
+    {
+        std::ifstream package(packagePath, std::ios::binary);
+        if (!package) {
+            m_logger.Error() << L"Failed to open package: " << packagePath.wstring();
+            return false;
+        }
+        
+        // Unchanged entries keep their block hashes from the old block map
+        const ZipEntry* blockMapEntry = directory.Find("AppxBlockMap.xml");
+        const ZipEntry* manifestEntry = directory.Find("AppxManifest.xml");
+        std::string blockMapXml;
+        std::string manifest;
+        AppxBlockMap blockMap;
+        
+        if (!blockMapEntry || !ZipCentralDirectory::ReadEntryContent(package, *blockMapEntry, blockMapXml) ||
+            !blockMap.Parse(blockMapXml)) {
+            m_logger.Error() << L"Package has no valid AppxBlockMap.xml: " << packagePath.wstring();
+            return false;
+        }
+        
+        if (!manifestEntry || !ZipCentralDirectory::ReadEntryContent(package, *manifestEntry, manifest)) {
+            m_logger.Error() << L"Package has no readable AppxManifest.xml: " << packagePath.wstring();
+            return false;
+        }
+        
+        if (!EditManifest(manifest, edits)) {
+            m_logger.Error() << L"AppxManifest.xml has no Identity element: " << packagePath.wstring();
+            return false;
+        }
+        
+        std::map<std::wstring, fs::path> replacements;
+        for (const auto& [name, sourcePath] : edits.replacedFiles) {
+            replacements[NormalizeName(name)] = sourcePath;
+        }
+        
+        std::map<std::wstring, bool> removals;
+        for (const auto& name : edits.removedFiles) {
+            removals[NormalizeName(name)] = false;
+        }
+        
+        if (directory.Find("AppxSignature.p7x")) {
+            m_logger.Warning() << L"The package signature is dropped; sign the updated package again";
+        }
+        
+        MsixWriter writer(m_logger, m_cancellationToken);
+        if (!writer.Open(temporaryPath)) {
+            return false;
+        }
+        
+        size_t copiedFiles = 0;
+        uint64_t copiedBytes = 0;
+        
+        for (const auto& entry : directory.Entries()) {
+            std::wstring name = ZipCentralDirectory::DecodePartName(entry.name);
+            std::replace(name.begin(), name.end(), L'/', L'\\');
+            
+            if (IsFootprintFile(name)) {
+                continue;
+            }
+            
+            std::wstring key = NormalizeName(name);
+            MsixEntryData data;
+            
+            auto removal = removals.find(key);
+            if (removal != removals.end()) {
+                m_logger.Info() << L"Removing: " << name;
+                removal->second = true;
+                continue;
+            }
+            
+            auto replacement = replacements.find(key);
+            if (replacement != replacements.end()) {
+                m_logger.Info() << L"Replacing: " << name;
+                if (!writer.AddFile(name, replacement->second, MsixWriter::ShouldCompress(name), data)) {
+                    return false;
+                }
+                replacements.erase(replacement);
+                continue;
+            }
+            
+            if (&entry == manifestEntry) {
+                std::istringstream manifestStream(manifest);
+                if (!writer.AddStream(name, manifestStream, manifest.size(), true, data)) {
+                    return false;
+                }
+                continue;
+            }
+            
+            const BlockMapFile* blockMapFile = blockMap.Find(name);
+            uint64_t dataOffset = 0;
+            if (!blockMapFile || blockMapFile->size != entry.uncompressedSize) {
+                m_logger.Error() << L"Package entry is missing from AppxBlockMap.xml: " << name;
+                return false;
+            }
+            
+            if (!ZipCentralDirectory::FindDataOffset(package, entry, dataOffset)) {
+                m_logger.Error() << L"Failed to locate package entry: " << name;
+                return false;
+            }
+            
+            data.compressionMethod = entry.compressionMethod;
+            data.crc32 = entry.crc32;
+            data.compressedSize = entry.compressedSize;
+            data.uncompressedSize = entry.uncompressedSize;
+            data.blocks = blockMapFile->blocks;
+            
+            if (!writer.AddCompressedFile(name, data, package)) {
+                return false;
+            }
+            
+            copiedFiles++;
+            copiedBytes += entry.compressedSize;
+        }
+        
+        // Replacements that matched no existing entry are new files
+        for (const auto& [key, sourcePath] : replacements) {
+            auto original = std::find_if(edits.replacedFiles.begin(), edits.replacedFiles.end(),
+                [&](const auto& replacedFile) { return NormalizeName(replacedFile.first) == key; });
+            std::wstring name = original->first;
+            std::replace(name.begin(), name.end(), L'/', L'\\');
+            
+            m_logger.Info() << L"Adding: " << name;
+            MsixEntryData data;
+            if (!writer.AddFile(name, sourcePath, MsixWriter::ShouldCompress(name), data)) {
+                return false;
+            }
+        }
+        
+        for (const auto& [key, removed] : removals) {
+            if (!removed) {
+                m_logger.Warning() << L"File to remove is not in the package: " << key;
+            }
+        }
+        
+        if (!writer.Finish()) {
+            return false;
+        }
+        
+        m_logger.Info() << L"Copied " << copiedFiles << L" unchanged entries (" << copiedBytes << L" bytes) without recompressing";
+    }
+    
+    // The input is closed by now, so an in-place update can replace it
+    std::error_code error;
+    fs::rename(temporaryPath, outputPath, error);
+    if (error) {
+        m_logger.Error() << L"Failed to replace " << outputPath.wstring() << L": " << error.message().c_str();
+        fs::remove(temporaryPath, error);
+        return false;
+    }
+    
+    m_logger.Info() << L"MSIX package updated successfully: " << outputPath.wstring();
+    return true;
+}
+
+bool PackageUpdater::EditManifest(std::string& manifest, const PackageEdits& edits)
+{
+    std::smatch identity;
+    if (!std::regex_search(manifest, identity, std::regex("<Identity\\b[^>]*>"))) {
+        return false;
+    }
+    
+    std::string tag = identity.str();
+    
+    auto setAttribute = [&tag](const std::string& attribute, const std::wstring& value) {
+        if (value.empty()) {
+            return;
+        }
+        
+        std::string utf8Value = winrt::to_string(value);
+        std::regex pattern("(\\s" + attribute + "\\s*=\\s*\")[^\"]*\"");
+        std::smatch match;
+        
+        if (std::regex_search(tag, match, pattern)) {
+            tag = match.prefix().str() + match[1].str() + utf8Value + "\"" + match.suffix().str();
+        }
+        else {
+            tag.insert(strlen("<Identity"), " " + attribute + "=\"" + utf8Value + "\"");
+        }
+    };
+    
+    setAttribute("Name", edits.identityName);
+    setAttribute("Publisher", edits.publisher);
+    setAttribute("Version", edits.version);
+    
+    manifest = identity.prefix().str() + tag + identity.suffix().str();
+    return true;
+}
\ No newline at end of file
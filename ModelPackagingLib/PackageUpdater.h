@@ -0,0 +1,44 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <filesystem>
+#include "Logger.h"
+#include "CancellationToken.h"
+
+namespace fs = std::filesystem;
+
+// Changes to make to an existing package
+struct PackageEdits
+{
+    std::wstring version;           // New Identity Version, e.g. 1.2.0.0
+    std::wstring identityName;      // New Identity Name
+    std::wstring publisher;         // New Identity Publisher, e.g. CN=Contoso
+
+    // Files to add or replace: path in the package, file on disk
+    std::vector<std::pair<std::wstring, fs::path>> replacedFiles;
+
+    // Paths in the package to remove
+    std::vector<std::wstring> removedFiles;
+};
+
+// Produces a new version of a package by editing its manifest and swapping individual files.
+// Every other entry is copied byte for byte, compressed data included, using the hashes from the
+// old AppxBlockMap.xml, so the time taken depends on the size of the change rather than the model.
+class PackageUpdater
+{
+public:
+    PackageUpdater(Logger logger = Logger(), CancellationToken cancellationToken = CancellationToken());
+    ~PackageUpdater() = default;
+
+    // Write the edited package to outputPath, which may be the input package itself
+    bool Update(const fs::path& packagePath, const fs::path& outputPath, const PackageEdits& edits);
+
+    // Apply the Identity changes to a manifest, returning false if it has no Identity element
+    static bool EditManifest(std::string& manifest, const PackageEdits& edits);
+
+private:
+    Logger m_logger;
+    CancellationToken m_cancellationToken;
+};
\ No newline at end of file
@@ -0,0 +1,393 @@
+#include "PackagingPipeline.h"
+#include "MsixPackager.h"
+#include "PackageUpdater.h"
+#include "PackageDelta.h"
+#include "TraceRecorder.h"
+#include "JobWorkspace.h"
+#include <vector>
+#include <optional>
+#include <winrt/base.h>
+
+PackagingResult PackagingPipeline::Pack(const PackagingRequest& request, const PackagingContext& context)
+{
+    PackagingResult result;
+    TraceSpan pipelineSpan("pipeline", L"Pack " + request.source);
+    
+    try {
+        context.logger.Info() << L"Packaging folder: " << request.source;
+        
+        result.modelFolder = request.source;
+        PackageAndSign(request, result.modelFolder, request.packageName, request.publisherName, context, result);
+    }
+    catch (const std::exception& ex) {
+        result.success = false;
+        result.errorMessage = winrt::to_hstring(ex.what());
+    }
+    
+    if (!result.success && !result.errorMessage.empty()) {
+        context.logger.Error() << L"Error: " << result.errorMessage;
+    }
+    
+    return result;
+}
+
+PackagingResult PackagingPipeline::DownloadAndPack(
+    const PackagingRequest& request,
+    const fs::path& workspaceRoot,
+    const PackagingContext& context)
+{
+    PackagingResult result;
+    TraceSpan pipelineSpan("pipeline", L"DownloadAndPack " + request.source);
+    
+    // Every run downloads into a new folder of its own, so runs at the same time never share files
+    JobWorkspace workspace(context.logger);
+    if (!workspace.Create(workspaceRoot)) {
+        result.errorMessage = L"Failed to create a folder to download into";
+        context.logger.Error() << L"Error: " << result.errorMessage;
+        return result;
+    }
+    const fs::path& downloadFolder = workspace.Path();
+    
+    m_downloader.SetLogger(context.logger);
+    
+    // The downloaders stop as soon as the caller cancels, even if that was before they started
+    m_downloader.SetCancellationToken(context.cancellation);
+    
+    try {
+        context.logger.Info() << L"Downloading and packaging from URI: " << request.source;
+        
+        context.logger.Info() << L"Files will be downloaded to: " << downloadFolder.wstring();
+        
+        // Parse the URI to extract repository information for naming inference
+        RepositoryInfo repoInfo = m_downloader.ParseUri(request.source);
+        m_downloader.SetEndpoints(repoInfo.type, request.endpoints);
+        
+        std::wstring finalPackageName = request.packageName;
+        std::wstring finalPublisherName = request.publisherName;
+        
+        if (finalPackageName.empty()) {
+            finalPackageName = repoInfo.name;
+            context.logger.Info() << L"Package name will be inferred from repository: " << finalPackageName;
+        }
+        
+        if (finalPublisherName.empty()) {
+            finalPublisherName = repoInfo.owner;
+            context.logger.Info() << L"Publisher name will be inferred from repository owner: " << finalPublisherName;
+        }
+        
+        // List the repository and plan the download before anything is transferred
+        DownloadPlan plan;
+        {
+            TraceSpan planSpan("pipeline", L"Plan download");
+            m_downloader.PlanModelAsync(request.source, downloadFolder, request.downloadFilter, plan).get();
+        }
+        plan.bandwidthWeight = request.bandwidthWeight;
+        plan.storeWeights = request.storeWeights && !request.useMakeAppx;
+        repoInfo.commit = plan.commit;
+        result.sourceCommit = repoInfo.commit;
+        plan.Log(context.logger);
+        
+        if (!plan.CheckFreeSpace(downloadFolder, request.outputPath, context.logger)) {
+            result.errorMessage = L"Not enough free disk space for the download and the package";
+        }
+        else if (request.planOnly) {
+            context.logger.Info() << L"Nothing was downloaded (/plan)";
+            result.success = true;
+        }
+        else {
+            // Download and wait for it to complete. Transfers only update the tracker's counters;
+            // the progress callback is driven by a sampler thread.
+            {
+                TraceSpan downloadSpan("pipeline", L"Download model");
+                
+                ProgressTracker localTracker;
+                ProgressTracker& tracker = context.progressTracker ? *context.progressTracker : localTracker;
+                std::optional<ProgressSampler> sampler;
+                if (context.progress) {
+                    sampler.emplace(tracker, ProgressCallbackAdapter(context.progress));
+                }
+                
+                m_downloader.DownloadPlanAsync(plan, &tracker).get();
+            }
+            
+            if (context.cancellation.IsCancelled()) {
+                result.cancelled = true;
+                result.errorMessage = L"Cancelled";
+            }
+            else {
+                context.logger.Info() << L"Download completed successfully!";
+                context.logger.Info() << L"Downloaded files are in: " << downloadFolder.wstring();
+                
+                // Find the actual model folder inside the download folder
+                result.modelFolder = FindModelFolder(downloadFolder, repoInfo.name, context.logger);
+                context.logger.Info() << L"Using model folder: " << result.modelFolder.wstring();
+                
+                PackageAndSign(request, result.modelFolder, finalPackageName, finalPublisherName, context, result);
+            }
+        }
+    }
+    catch (const winrt::hresult_error& ex) {
+        result.success = false;
+        result.errorMessage = ex.message().c_str();
+    }
+    catch (const std::exception& ex) {
+        result.success = false;
+        result.errorMessage = winrt::to_hstring(ex.what());
+    }
+    
+    if (!result.success && !result.errorMessage.empty()) {
+        context.logger.Error() << L"Error: " << result.errorMessage;
+    }
+    
+    // The download folder is deleted in the background once the workspace goes out of scope
+    if (!request.keepDownloads) {
+        context.logger.Info() << L"Cleaning up temporary download folder in the background";
+    }
+    else {
+        workspace.Keep();
+        context.logger.Info() << L"Temporary download folder preserved at: " << downloadFolder.wstring();
+    }
+    
+    return result;
+}
+
+void PackagingPipeline::PackageAndSign(
+    const PackagingRequest& request,
+    const fs::path& modelFolder,
+    const std::wstring& packageName,
+    const std::wstring& publisherName,
+    const PackagingContext& context,
+    PackagingResult& result)
+{
+    MsixPackagerOptions packagerOptions;
+    packagerOptions.useMakeAppx = request.useMakeAppx;
+    packagerOptions.cacheFolder = request.cacheFolder;
+    packagerOptions.blockClone = request.blockClone;
+    packagerOptions.storeWeights = request.storeWeights;
+    packagerOptions.scanOptions = request.scanOptions;
+    
+    MsixPackager packager(context.logger, context.cancellation, packagerOptions);
+    
+    bool success = packager.CreateMsixPackage(
+        modelFolder,
+        request.outputPath,
+        packageName,
+        publisherName,
+        &result.packagePath
+    );
+    
+    if (context.cancellation.IsCancelled()) {
+        result.cancelled = true;
+        result.errorMessage = L"Cancelled";
+        return;
+    }
+    
+    if (!success) {
+        result.errorMessage = L"Failed to create MSIX package";
+        return;
+    }
+    
+    SignIfRequested(request, packager, context, result);
+}
+
+PackagingResult PackagingPipeline::Update(const PackagingRequest& request, const PackagingContext& context)
+{
+    PackagingResult result;
+    TraceSpan pipelineSpan("pipeline", L"Update " + request.source);
+    
+    try {
+        MsixPackager packager(context.logger, context.cancellation);
+        
+        // Identity names are cleaned the same way as when the package was created
+        PackageEdits edits;
+        edits.version = request.version;
+        edits.replacedFiles = request.replacedFiles;
+        edits.removedFiles = request.removedFiles;
+        if (!request.packageName.empty()) {
+            edits.identityName = packager.CleanNameForPackage(request.packageName) + L"ModelPackage";
+        }
+        if (!request.publisherName.empty()) {
+            edits.publisher = L"CN=" + packager.CleanNameForPackage(request.publisherName);
+        }
+        
+        // A directory output keeps the package's file name
+        fs::path sourcePath(request.source);
+        result.packagePath = request.outputPath.empty() ? sourcePath : request.outputPath;
+        if (fs::is_directory(result.packagePath)) {
+            result.packagePath /= sourcePath.filename();
+        }
+        
+        PackageUpdater updater(context.logger, context.cancellation);
+        TraceSpan packageSpan("package", result.packagePath.filename().wstring());
+        bool success = updater.Update(sourcePath, result.packagePath, edits);
+        
+        if (context.cancellation.IsCancelled()) {
+            result.cancelled = true;
+            result.errorMessage = L"Cancelled";
+        }
+        else if (!success) {
+            result.errorMessage = L"Failed to update MSIX package";
+        }
+        else {
+            std::error_code sizeError;
+            uintmax_t packageSize = fs::file_size(result.packagePath, sizeError);
+            packageSpan.SetBytes(sizeError ? 0 : packageSize);
+            SignIfRequested(request, packager, context, result);
+        }
+    }
+    catch (const std::exception& ex) {
+        result.success = false;
+        result.errorMessage = winrt::to_hstring(ex.what());
+    }
+    
+    if (!result.success && !result.errorMessage.empty()) {
+        context.logger.Error() << L"Error: " << result.errorMessage;
+    }
+    
+    return result;
+}
+
+PackagingResult PackagingPipeline::Diff(const PackagingRequest& request, const PackagingContext& context)
+{
+    PackagingResult result;
+    TraceSpan pipelineSpan("pipeline", L"Diff " + request.source);
+    
+    try {
+        // A directory output is named after the new folder
+        fs::path newFolder = request.target;
+        if (!newFolder.has_filename()) {
+            newFolder = newFolder.parent_path();
+        }
+        
+        result.modelFolder = newFolder;
+        result.deltaPath = request.outputPath;
+        if (fs::is_directory(result.deltaPath)) {
+            result.deltaPath /= newFolder.filename().wstring() + L".msixdelta";
+        }
+        
+        PackageDelta delta(context.logger, context.cancellation);
+        TraceSpan packageSpan("package", result.deltaPath.filename().wstring());
+        PackageDeltaStats stats;
+        result.success = delta.Create(request.source, newFolder, result.deltaPath, request.scanOptions, &stats);
+        
+        if (context.cancellation.IsCancelled()) {
+            result.success = false;
+            result.cancelled = true;
+            result.errorMessage = L"Cancelled";
+        }
+        else if (!result.success) {
+            result.errorMessage = L"Failed to create package delta";
+        }
+        else {
+            packageSpan.SetBytes(stats.deltaBytes);
+        }
+    }
+    catch (const std::exception& ex) {
+        result.success = false;
+        result.errorMessage = winrt::to_hstring(ex.what());
+    }
+    
+    if (!result.success && !result.errorMessage.empty()) {
+        context.logger.Error() << L"Error: " << result.errorMessage;
+    }
+    
+    return result;
+}
+
+PackagingResult PackagingPipeline::ApplyDelta(const PackagingRequest& request, const PackagingContext& context)
+{
+    PackagingResult result;
+    TraceSpan pipelineSpan("pipeline", L"ApplyDelta " + request.source);
+    
+    try {
+        MsixPackager packager(context.logger, context.cancellation);
+        
+        // A directory output is named after the delta
+        result.deltaPath = request.target;
+        result.packagePath = request.outputPath;
+        if (fs::is_directory(result.packagePath)) {
+            result.packagePath /= request.target.stem().wstring() + L".msix";
+        }
+        
+        PackageDelta delta(context.logger, context.cancellation);
+        TraceSpan packageSpan("package", result.packagePath.filename().wstring());
+        bool success = delta.Apply(request.source, request.target, result.packagePath);
+        
+        if (context.cancellation.IsCancelled()) {
+            result.cancelled = true;
+            result.errorMessage = L"Cancelled";
+        }
+        else if (!success) {
+            result.errorMessage = L"Failed to apply package delta";
+        }
+        else {
+            std::error_code sizeError;
+            uintmax_t packageSize = fs::file_size(result.packagePath, sizeError);
+            packageSpan.SetBytes(sizeError ? 0 : packageSize);
+            SignIfRequested(request, packager, context, result);
+        }
+    }
+    catch (const std::exception& ex) {
+        result.success = false;
+        result.errorMessage = winrt::to_hstring(ex.what());
+    }
+    
+    if (!result.success && !result.errorMessage.empty()) {
+        context.logger.Error() << L"Error: " << result.errorMessage;
+    }
+    
+    return result;
+}
+
+void PackagingPipeline::SignIfRequested(
+    const PackagingRequest& request,
+    MsixPackager& packager,
+    const PackagingContext& context,
+    PackagingResult& result)
+{
+    // If signing is requested, sign the package
+    if (!request.certPath.empty()) {
+        context.logger.Info() << L"Signing MSIX package: " << result.packagePath.wstring();
+        
+        if (!packager.SignMsixPackage(result.packagePath, request.certPath, request.certPassword)) {
+            result.cancelled = context.cancellation.IsCancelled();
+            result.errorMessage = result.cancelled ? L"Cancelled" : L"Failed to sign MSIX package";
+            return;
+        }
+        
+        result.signedPackage = true;
+        context.logger.Info() << L"MSIX package signed successfully";
+    }
+    
+    result.success = true;
+}
+
+fs::path PackagingPipeline::FindModelFolder(const fs::path& downloadFolder, const std::wstring& repoName, const Logger& logger)
+{
+    // If the repo name folder exists, use it
+    fs::path modelFolder = downloadFolder / repoName;
+    if (fs::exists(modelFolder) && fs::is_directory(modelFolder)) {
+        return modelFolder;
+    }
+    
+    // Look for a single subdirectory in the download folder
+    std::vector<fs::path> subdirs;
+    try {
+        for (const auto& entry : fs::directory_iterator(downloadFolder)) {
+            if (entry.is_directory()) {
+                subdirs.push_back(entry.path());
+            }
+        }
+    }
+    catch (const std::exception& ex) {
+        logger.Error() << L"Error enumerating download folder: " << ex.what();
+    }
+    
+    // If there's exactly one subdirectory, it's likely the model folder
+    if (subdirs.size() == 1) {
+        return subdirs[0];
+    }
+    
+    // Otherwise, use the download folder itself
+    return downloadFolder;
+}
\ No newline at end of file
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <filesystem>
+#include "Logger.h"
+#include "CancellationToken.h"
+#include "ModelDownloader.h"
+#include "MsixPackager.h"
+#include "SourceScanner.h"
+#include "DownloadFilter.h"
+
+namespace fs = std::filesystem;
+
+// What to package: a local folder for Pack, or a repository URI for DownloadAndPack
+struct PackagingRequest
+{
+    std::wstring source;
+    fs::path outputPath;
+    std::wstring packageName;
+    std::wstring publisherName;
+    fs::path certPath;
+    std::wstring certPassword;
+    bool keepDownloads = false;
+    bool useMakeAppx = false;       // Package with MakeAppx.exe instead of the built-in writer
+    fs::path cacheFolder;           // Package cache that lets unchanged files skip compression
+    bool blockClone = false;        // Clone the blocks of stored files into the package where the volume allows it
+    bool storeWeights = false;      // Store model weights instead of deflating them, so they can be cloned and their download digests used
+    SourceScanOptions scanOptions;  // Which files of the source folder are packaged (Pack, DownloadAndPack, Diff)
+    DownloadFilter downloadFilter;  // Which files of the repository are downloaded (DownloadAndPack)
+    bool planOnly = false;          // Stop DownloadAndPack after the download plan and the free space check
+    double bandwidthWeight = 1.0;   // Share of the process-wide bandwidth limit (BandwidthLimiter) against other runs
+    std::vector<std::wstring> endpoints;    // Base URLs to download from in place of HF_ENDPOINT or GITHUB_RAW_ENDPOINT
+    
+    // Changes Update makes to an existing package; packageName and publisherName replace the Identity
+    std::wstring version;
+    std::vector<std::pair<std::wstring, fs::path>> replacedFiles;
+    std::vector<std::wstring> removedFiles;
+    
+    // Diff: the folder holding the new version; ApplyDelta: the delta file
+    fs::path target;
+};
+
+// Where a run reports to and how it is stopped
+struct PackagingContext
+{
+    Logger logger;
+
+    // Per-file download progress, called about ten times a second from a sampling thread
+    ProgressCallback progress;
+
+    // Optional caller-owned tracker for callers that sample the transfer counters themselves
+    ProgressTracker* progressTracker = nullptr;
+
+    CancellationToken cancellation;
+};
+
+// Outcome of a run
+struct PackagingResult
+{
+    bool success = false;
+    bool cancelled = false;
+    std::wstring errorMessage;
+    fs::path packagePath;
+    fs::path modelFolder;
+    std::wstring sourceCommit;  // DownloadAndPack: commit the files were downloaded from, to rerun the same download
+    fs::path deltaPath;
+    bool signedPackage = false;
+};
+
+// Download, package and sign pipeline shared by the command line tool and embedders.
+// The calling thread must have initialized the WinRT apartment (winrt::init_apartment).
+// A pipeline runs one request at a time; use one pipeline per thread for concurrent runs.
+class PackagingPipeline
+{
+public:
+    PackagingPipeline() = default;
+    ~PackagingPipeline() = default;
+
+    // Package a local folder and sign it if a certificate is given
+    PackagingResult Pack(const PackagingRequest& request, const PackagingContext& context);
+
+    // Download a repository into a new workspace under workspaceRoot, then package and sign it. The
+    // repository is listed and the download planned first, and the run fails before any transfer if
+    // the disks are too full. The workspace is deleted in the background when the run returns.
+    PackagingResult DownloadAndPack(
+        const PackagingRequest& request,
+        const fs::path& workspaceRoot,
+        const PackagingContext& context);
+    
+    // Edit an existing package (source) into outputPath, or in place if no output path is given
+    PackagingResult Update(const PackagingRequest& request, const PackagingContext& context);
+    
+    // Write the block-level delta from an existing package (source) to the folder target into outputPath
+    PackagingResult Diff(const PackagingRequest& request, const PackagingContext& context);
+    
+    // Rebuild a package from an existing package (source) and a delta (target), then sign it if requested
+    PackagingResult ApplyDelta(const PackagingRequest& request, const PackagingContext& context);
+
+private:
+    // Package modelFolder and sign the result, filling in the result fields
+    void PackageAndSign(
+        const PackagingRequest& request,
+        const fs::path& modelFolder,
+        const std::wstring& packageName,
+        const std::wstring& publisherName,
+        const PackagingContext& context,
+        PackagingResult& result);
+    
+    // Sign result.packagePath if the request has a certificate, filling in the result fields
+    void SignIfRequested(
+        const PackagingRequest& request,
+        MsixPackager& packager,
+        const PackagingContext& context,
+        PackagingResult& result);
+
+    // Find the actual model folder in the download directory
+    fs::path FindModelFolder(const fs::path& downloadFolder, const std::wstring& repoName, const Logger& logger);
+
+    // Kept across runs so HTTP connections are reused
+    ModelDownloader m_downloader;
+};
\ No newline at end of file
@@ -0,0 +1,117 @@
+#include "ProcessRunner.h"
+#include <thread>
+#include <vector>
+#include <winrt/base.h>
+
+// Include WIL for RAII resource management
+#include <wil/resource.h>
+
+ProcessResult ProcessRunner::Run(
+    const std::wstring& commandLine,
+    const Logger& logger,
+    const CancellationToken& cancellationToken)
+{
+    ProcessResult result;
+
+    // Capture stdout and stderr through an inheritable pipe
+    SECURITY_ATTRIBUTES securityAttributes = { sizeof(securityAttributes), nullptr, TRUE };
+    wil::unique_handle readPipe;
+    wil::unique_handle writePipe;
+
+    if (!CreatePipe(&readPipe, &writePipe, &securityAttributes, 0)) {
+        result.error = GetLastError();
+        return result;
+    }
+
+    // Only the write end may be inherited by the child
+    SetHandleInformation(readPipe.get(), HANDLE_FLAG_INHERIT, 0);
+
+    // Restrict inheritance to the pipe so that children started concurrently
+    // don't keep each other's pipes open
+    HANDLE inheritedHandles[] = { writePipe.get() };
+    SIZE_T attributeListSize = 0;
+    InitializeProcThreadAttributeList(nullptr, 1, 0, &attributeListSize);
+    std::vector<BYTE> attributeListBuffer(attributeListSize);
+    auto attributeList = reinterpret_cast<LPPROC_THREAD_ATTRIBUTE_LIST>(attributeListBuffer.data());
+
+    if (!InitializeProcThreadAttributeList(attributeList, 1, 0, &attributeListSize)) {
+        result.error = GetLastError();
+        return result;
+    }
+
+    auto deleteAttributeList = wil::scope_exit([&]() { DeleteProcThreadAttributeList(attributeList); });
+
+    if (!UpdateProcThreadAttribute(attributeList, 0, PROC_THREAD_ATTRIBUTE_HANDLE_LIST,
+            inheritedHandles, sizeof(inheritedHandles), nullptr, nullptr)) {
+        result.error = GetLastError();
+        return result;
+    }
+
+    STARTUPINFOEXW si = {};
+    si.StartupInfo.cb = sizeof(si);
+    si.StartupInfo.dwFlags = STARTF_USESTDHANDLES;
+    si.StartupInfo.hStdInput = nullptr;
+    si.StartupInfo.hStdOutput = writePipe.get();
+    si.StartupInfo.hStdError = writePipe.get();
+    si.lpAttributeList = attributeList;
+
+    wil::unique_process_information processInfo;
+
+    // CreateProcessW may modify the command line buffer
+    std::wstring cmdLineCopy = commandLine;
+
+    if (!CreateProcessW(NULL, cmdLineCopy.data(), NULL, NULL, TRUE, CREATE_NO_WINDOW | EXTENDED_STARTUPINFO_PRESENT,
+            NULL, NULL, &si.StartupInfo, &processInfo)) {
+        result.error = GetLastError();
+        return result;
+    }
+
+    result.started = true;
+
+    // Close our copy of the write end so that reads finish when the child exits
+    writePipe.reset();
+
+    // Forward the child's output line by line
+    std::thread outputReader([&readPipe, &logger]() {
+        std::string pending;
+        char buffer[4096];
+        DWORD bytesRead = 0;
+
+        while (ReadFile(readPipe.get(), buffer, sizeof(buffer), &bytesRead, nullptr) && bytesRead > 0) {
+            pending.append(buffer, bytesRead);
+
+            size_t lineEnd;
+            while ((lineEnd = pending.find('\n')) != std::string::npos) {
+                std::string line = pending.substr(0, lineEnd);
+                pending.erase(0, lineEnd + 1);
+
+                if (!line.empty() && line.back() == '\r') {
+                    line.pop_back();
+                }
+
+                if (!line.empty()) {
+                    logger.Write(LogLevel::Verbose, std::wstring(winrt::to_hstring(line)));
+                }
+            }
+        }
+
+        if (!pending.empty()) {
+            logger.Write(LogLevel::Verbose, std::wstring(winrt::to_hstring(pending)));
+        }
+    });
+
+    // Wait for the process, checking for cancellation periodically
+    while (WaitForSingleObject(processInfo.hProcess, 100) == WAIT_TIMEOUT) {
+        if (cancellationToken.IsCancelled()) {
+            TerminateProcess(processInfo.hProcess, ERROR_CANCELLED);
+            WaitForSingleObject(processInfo.hProcess, INFINITE);
+            result.cancelled = true;
+            break;
+        }
+    }
+
+    outputReader.join();
+
+    GetExitCodeProcess(processInfo.hProcess, &result.exitCode);
+    return result;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <string>
+#include <Windows.h>
+#include "Logger.h"
+#include "CancellationToken.h"
+
+// Outcome of running a child process
+struct ProcessResult
+{
+    bool started = false;       // The process was created
+    bool cancelled = false;     // The process was terminated because cancellation was requested
+    DWORD exitCode = 0;         // Exit code of the process
+    DWORD error = 0;            // GetLastError() if the process could not be created
+};
+
+class ProcessRunner
+{
+public:
+    // Run a command line without a console window, forwarding its output to the logger
+    // at verbose level, and wait for it to exit or for cancellation
+    static ProcessResult Run(
+        const std::wstring& commandLine,
+        const Logger& logger,
+        const CancellationToken& cancellationToken);
+};
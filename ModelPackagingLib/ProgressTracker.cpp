@@ -0,0 +1,209 @@
+#include "ProgressTracker.h"
+#include "TraceRecorder.h"
+#include <cmath>
+
+TransferProgress::TransferProgress(std::wstring name)
+    : m_name(std::move(name)),
+      m_totalBytes(0),
+      m_bytesReceived(0),
+      m_complete(false)
+{
+}
+
+const std::wstring& TransferProgress::Name() const
+{
+    return m_name;
+}
+
+void TransferProgress::SetTotalBytes(uint64_t totalBytes)
+{
+    m_totalBytes.store(totalBytes, std::memory_order_relaxed);
+}
+
+uint64_t TransferProgress::TotalBytes() const
+{
+    return m_totalBytes.load(std::memory_order_relaxed);
+}
+
+void TransferProgress::AddBytes(uint64_t bytes)
+{
+    m_bytesReceived.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+uint64_t TransferProgress::BytesReceived() const
+{
+    return m_bytesReceived.load(std::memory_order_relaxed);
+}
+
+void TransferProgress::SetBytesReceived(uint64_t bytes)
+{
+    m_bytesReceived.store(bytes, std::memory_order_relaxed);
+}
+
+void TransferProgress::Complete()
+{
+    m_complete.store(true, std::memory_order_release);
+}
+
+bool TransferProgress::IsComplete() const
+{
+    return m_complete.load(std::memory_order_acquire);
+}
+
+ProgressTracker::ProgressTracker()
+    : m_sampled(false),
+      m_lastBytesReceived(0),
+      m_bytesPerSecond(0.0)
+{
+}
+
+std::shared_ptr<TransferProgress> ProgressTracker::BeginTransfer(const std::wstring& name, uint64_t totalBytes)
+{
+    auto transfer = std::make_shared<TransferProgress>(name);
+    transfer->SetTotalBytes(totalBytes);
+    
+    std::lock_guard<std::mutex> lock(m_transfersMutex);
+    m_transfers.push_back(transfer);
+    return transfer;
+}
+
+ProgressSnapshot ProgressTracker::Sample()
+{
+    std::vector<std::shared_ptr<TransferProgress>> transfers;
+    {
+        std::lock_guard<std::mutex> lock(m_transfersMutex);
+        transfers = m_transfers;
+    }
+    
+    ProgressSnapshot snapshot;
+    snapshot.files.reserve(transfers.size());
+    
+    for (const auto& transfer : transfers) {
+        FileProgress file;
+        file.name = transfer->Name();
+        file.complete = transfer->IsComplete();
+        file.bytesReceived = transfer->BytesReceived();
+        file.totalBytes = transfer->TotalBytes();
+        
+        snapshot.bytesReceived += file.bytesReceived;
+        if (file.complete) {
+            snapshot.completedTransfers++;
+            snapshot.totalBytes += file.bytesReceived;
+        }
+        else {
+            snapshot.activeTransfers++;
+            snapshot.totalBytes += file.totalBytes;
+            snapshot.totalKnown = snapshot.totalKnown && file.totalBytes > 0;
+        }
+        
+        snapshot.files.push_back(std::move(file));
+    }
+    
+    auto now = std::chrono::steady_clock::now();
+    if (!m_sampled) {
+        m_sampled = true;
+        m_firstSampleTime = now;
+    }
+    else {
+        double elapsed = std::chrono::duration<double>(now - m_lastSampleTime).count();
+        if (elapsed > 0.0) {
+            // Weight each sample by the time it covers so the estimate doesn't depend on the sampling rate.
+            // The count drops when a retry starts a file over; that sample counts as receiving nothing.
+            uint64_t received = snapshot.bytesReceived > m_lastBytesReceived ? snapshot.bytesReceived - m_lastBytesReceived : 0;
+            double instantaneous = received / elapsed;
+            double weight = 1.0 - std::exp(-elapsed / ThroughputSmoothingSeconds);
+            m_bytesPerSecond += weight * (instantaneous - m_bytesPerSecond);
+        }
+    }
+    
+    m_lastSampleTime = now;
+    m_lastBytesReceived = snapshot.bytesReceived;
+    
+    double sinceFirstSample = std::chrono::duration<double>(now - m_firstSampleTime).count();
+    snapshot.bytesPerSecond = m_bytesPerSecond;
+    snapshot.averageBytesPerSecond = sinceFirstSample > 0.0 ? snapshot.bytesReceived / sinceFirstSample : 0.0;
+    
+    if (snapshot.totalKnown && snapshot.totalBytes >= snapshot.bytesReceived && m_bytesPerSecond > 0.0) {
+        snapshot.etaSeconds = (snapshot.totalBytes - snapshot.bytesReceived) / m_bytesPerSecond;
+    }
+    
+    return snapshot;
+}
+
+ProgressSampler::ProgressSampler(
+    ProgressTracker& tracker,
+    std::function<void(const ProgressSnapshot&)> callback,
+    std::chrono::milliseconds interval)
+    : m_tracker(tracker),
+      m_callback(std::move(callback)),
+      m_interval(interval),
+      m_stopRequested(false)
+{
+    m_thread = std::thread([this]() { SampleLoop(); });
+}
+
+ProgressSampler::~ProgressSampler()
+{
+    Stop();
+}
+
+void ProgressSampler::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_stopMutex);
+        m_stopRequested = true;
+    }
+    m_stopCondition.notify_one();
+    
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+void ProgressSampler::SampleLoop()
+{
+    bool stopping = false;
+    
+    while (!stopping) {
+        {
+            std::unique_lock<std::mutex> lock(m_stopMutex);
+            stopping = m_stopCondition.wait_for(lock, m_interval, [this]() { return m_stopRequested; });
+        }
+        
+        ProgressSnapshot snapshot = m_tracker.Sample();
+        
+        // Throughput shows up as a counter track next to the spans in the trace
+        TraceRecorder::Instance().RecordCounter("progress", L"Download MBps", snapshot.bytesPerSecond / 1000000.0);
+        
+        if (m_callback) {
+            m_callback(snapshot);
+        }
+    }
+}
+
+ProgressCallbackAdapter::ProgressCallbackAdapter(ProgressCallback callback)
+    : m_callback(std::move(callback))
+{
+}
+
+void ProgressCallbackAdapter::operator()(const ProgressSnapshot& snapshot)
+{
+    if (!m_callback) {
+        return;
+    }
+    
+    // Transfers are only ever appended, so a file keeps its index across snapshots
+    m_reportedBytes.resize(snapshot.files.size(), UINT64_MAX);
+    m_reportedComplete.resize(snapshot.files.size(), false);
+    
+    for (size_t i = 0; i < snapshot.files.size(); i++) {
+        const FileProgress& file = snapshot.files[i];
+        if (file.bytesReceived == m_reportedBytes[i] && file.complete == m_reportedComplete[i]) {
+            continue;
+        }
+        
+        m_reportedBytes[i] = file.bytesReceived;
+        m_reportedComplete[i] = file.complete;
+        m_callback(file.name, file.bytesReceived, file.complete ? file.bytesReceived : file.totalBytes);
+    }
+}
\ No newline at end of file
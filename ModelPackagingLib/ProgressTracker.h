@@ -0,0 +1,140 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <condition_variable>
+
+// Per-file progress reported to callers; invoked from a sampling thread, never from a transfer
+using ProgressCallback = std::function<void(const std::wstring& fileName, uint64_t bytesReceived, uint64_t totalBytes)>;
+
+// Counters for one file transfer. The transfer only performs relaxed atomic updates.
+class TransferProgress
+{
+public:
+    explicit TransferProgress(std::wstring name);
+
+    const std::wstring& Name() const;
+
+    // Total size once it is known (0 = unknown)
+    void SetTotalBytes(uint64_t totalBytes);
+    uint64_t TotalBytes() const;
+
+    // Count bytes that have arrived
+    void AddBytes(uint64_t bytes);
+    uint64_t BytesReceived() const;
+
+    // Start the count over from the bytes already on disk, when a retry restarts or continues the file
+    void SetBytesReceived(uint64_t bytes);
+
+    // Mark the transfer finished (successfully or not)
+    void Complete();
+    bool IsComplete() const;
+
+private:
+    std::wstring m_name;
+    std::atomic<uint64_t> m_totalBytes;
+    std::atomic<uint64_t> m_bytesReceived;
+    std::atomic<bool> m_complete;
+};
+
+// State of one file at the time of a sample
+struct FileProgress
+{
+    std::wstring name;
+    uint64_t bytesReceived = 0;
+    uint64_t totalBytes = 0;
+    bool complete = false;
+};
+
+// Aggregate state at the time of a sample
+struct ProgressSnapshot
+{
+    std::vector<FileProgress> files;
+    size_t activeTransfers = 0;
+    size_t completedTransfers = 0;
+    uint64_t bytesReceived = 0;
+    uint64_t totalBytes = 0;            // Sum of the known sizes
+    bool totalKnown = true;             // False if any transfer's size is unknown
+    double bytesPerSecond = 0.0;        // Exponentially weighted recent throughput
+    double averageBytesPerSecond = 0.0; // Since the first transfer started
+    double etaSeconds = -1.0;           // -1 when it can't be estimated
+};
+
+// Registry of the transfers of a run. Transfers update their own counters; a single
+// sampler reads them all and keeps the throughput estimate used for the ETA.
+class ProgressTracker
+{
+public:
+    ProgressTracker();
+
+    // Register a transfer; its counters stay valid for the tracker's lifetime
+    std::shared_ptr<TransferProgress> BeginTransfer(const std::wstring& name, uint64_t totalBytes = 0);
+
+    // Read all counters and update the throughput estimate (call from one thread)
+    ProgressSnapshot Sample();
+
+private:
+    // Time constant of the throughput average
+    static constexpr double ThroughputSmoothingSeconds = 3.0;
+
+    std::mutex m_transfersMutex;
+    std::vector<std::shared_ptr<TransferProgress>> m_transfers;
+
+    // Sampler state
+    bool m_sampled;
+    std::chrono::steady_clock::time_point m_firstSampleTime;
+    std::chrono::steady_clock::time_point m_lastSampleTime;
+    uint64_t m_lastBytesReceived;
+    double m_bytesPerSecond;
+};
+
+// Samples a tracker at a fixed rate on its own thread and hands each snapshot to a callback
+class ProgressSampler
+{
+public:
+    ProgressSampler(
+        ProgressTracker& tracker,
+        std::function<void(const ProgressSnapshot&)> callback,
+        std::chrono::milliseconds interval = std::chrono::milliseconds(100));
+
+    // Stops the thread after a final sample
+    ~ProgressSampler();
+
+    ProgressSampler(const ProgressSampler&) = delete;
+    ProgressSampler& operator=(const ProgressSampler&) = delete;
+
+    // Take a final sample and stop sampling
+    void Stop();
+
+private:
+    void SampleLoop();
+
+    ProgressTracker& m_tracker;
+    std::function<void(const ProgressSnapshot&)> m_callback;
+    std::chrono::milliseconds m_interval;
+
+    std::mutex m_stopMutex;
+    std::condition_variable m_stopCondition;
+    bool m_stopRequested;
+    std::thread m_thread;
+};
+
+// Turns snapshots into per-file callbacks, reporting only the files that changed since the last sample
+class ProgressCallbackAdapter
+{
+public:
+    explicit ProgressCallbackAdapter(ProgressCallback callback);
+
+    void operator()(const ProgressSnapshot& snapshot);
+
+private:
+    ProgressCallback m_callback;
+    std::vector<uint64_t> m_reportedBytes;
+    std::vector<bool> m_reportedComplete;
+};
\ No newline at end of file
@@ -0,0 +1,74 @@
+#include "RetryPolicy.h"
+#include <random>
+#include <algorithm>
+
+namespace {
+    // Retry-After values beyond this are treated as this, so a misconfigured server can't park a
+    // download for hours
+    constexpr std::chrono::milliseconds MaxRetryAfter = std::chrono::minutes(5);
+
+    // Spread added to Retry-After, so every lane told to come back in a second doesn't
+    constexpr std::chrono::milliseconds RetryAfterJitter = std::chrono::milliseconds(1000);
+
+    // Uniform random duration from zero to limit
+    std::chrono::milliseconds RandomDelay(std::chrono::milliseconds limit)
+    {
+        thread_local std::mt19937 generator(std::random_device{}());
+        std::uniform_int_distribution<int64_t> distribution(0, (std::max)(int64_t(0), static_cast<int64_t>(limit.count())));
+        return std::chrono::milliseconds(distribution(generator));
+    }
+}
+
+bool TransferFailure::IsCongestion() const
+{
+    return timedOut || status == 429 || status == 503;
+}
+
+bool TransferFailure::IsRetryable() const
+{
+    return !permanent && (IsCongestion() || status == 0 || status == 408 || status >= 500);
+}
+
+std::wstring TransferFailure::Describe() const
+{
+    if (timedOut) {
+        return L"timed out";
+    }
+    if (status == 0) {
+        return L"no response";
+    }
+    return L"HTTP " + std::to_wstring(status);
+}
+
+RetryPolicy::RetryPolicy(unsigned maxAttempts, std::chrono::milliseconds baseDelay, std::chrono::milliseconds maxDelay)
+    : m_maxAttempts(maxAttempts),
+      m_baseDelay(baseDelay),
+      m_maxDelay(maxDelay)
+{
+}
+
+bool RetryPolicy::ShouldRetry(unsigned attempt, const TransferFailure& failure) const
+{
+    return attempt < m_maxAttempts && failure.IsRetryable();
+}
+
+std::chrono::milliseconds RetryPolicy::Delay(unsigned attempt, const TransferFailure& failure) const
+{
+    // base * 2^(attempt - 1) without overflowing for large attempt numbers
+    std::chrono::milliseconds ceiling = m_baseDelay;
+    for (unsigned i = 1; i < attempt && ceiling < m_maxDelay; i++) {
+        ceiling *= 2;
+    }
+    ceiling = (std::min)(ceiling, m_maxDelay);
+    
+    std::chrono::milliseconds delay = RandomDelay(ceiling);
+    if (failure.retryAfter.count() > 0) {
+        delay = (std::max)(delay, (std::min)(failure.retryAfter, MaxRetryAfter) + RandomDelay(RetryAfterJitter));
+    }
+    return delay;
+}
+
+unsigned RetryPolicy::MaxAttempts() const
+{
+    return m_maxAttempts;
+}
\ No newline at end of file
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Why a request failed, as far as deciding whether and when to retry it is concerned
+struct TransferFailure
+{
+    uint32_t status = 0;                        // HTTP status, 0 when no response arrived
+    bool timedOut = false;                      // Nothing arrived for the stall timeout
+    bool permanent = false;                     // No retry can help, such as a file that can't be written
+    std::chrono::milliseconds retryAfter{ 0 };  // What the server's Retry-After header asked for
+    uint64_t received = 0;                      // Bytes of the file on disk, which the next attempt can continue from
+
+    // Whether the server is overloaded or rate limiting us (429, 503) or stopped answering, so
+    // fewer requests should be in flight
+    bool IsCongestion() const;
+
+    // Whether the same request may succeed later: congestion, other 5xx and 408 responses, and
+    // failures without a response such as a reset connection. 4xx errors and local failures are final.
+    bool IsRetryable() const;
+
+    // Short description for log messages
+    std::wstring Describe() const;
+};
+
+// Retries with jittered exponential backoff. The delay before attempt n is drawn uniformly from
+// zero to base * 2^(n-1), capped, so clients that failed together don't retry together; when the
+// server sent Retry-After, the delay is at least that long.
+class RetryPolicy
+{
+public:
+    RetryPolicy(unsigned maxAttempts = 5,
+                std::chrono::milliseconds baseDelay = std::chrono::milliseconds(1000),
+                std::chrono::milliseconds maxDelay = std::chrono::milliseconds(60000));
+    ~RetryPolicy() = default;
+
+    // Whether a request that failed on the given attempt, counting from 1, should be tried again
+    bool ShouldRetry(unsigned attempt, const TransferFailure& failure) const;
+
+    // How long to wait before the attempt after the given one
+    std::chrono::milliseconds Delay(unsigned attempt, const TransferFailure& failure) const;
+
+    unsigned MaxAttempts() const;
+
+private:
+    unsigned m_maxAttempts;
+    std::chrono::milliseconds m_baseDelay;
+    std::chrono::milliseconds m_maxDelay;
+};
\ No newline at end of file
@@ -0,0 +1,301 @@
+#include "RunReport.h"
+#include "TraceRecorder.h"
+#include "ZipCentralDirectory.h"
+#include "JsonUtils.h"
+#include <map>
+#include <vector>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <Windows.h>
+#include <psapi.h>
+#include <tlhelp32.h>
+
+namespace {
+    // Phases reported in order, identified by trace span category
+    const char* const ReportedPhases[] = { "listing", "download", "manifest", "scan", "staging", "package", "compress", "copy", "blockmap", "sign" };
+
+    struct PhaseTotals
+    {
+        uint64_t count = 0;
+        uint64_t bytes = 0;
+        int64_t busyMicroseconds = 0;
+        int64_t firstStart = INT64_MAX;
+        int64_t lastEnd = 0;
+    };
+
+    struct FileReport
+    {
+        std::wstring name;
+        bool downloaded = false;
+        uint64_t downloadBytes = 0;
+        int64_t downloadMicroseconds = 0;
+        bool packaged = false;
+        uint64_t uncompressedBytes = 0;
+        uint64_t compressedBytes = 0;
+        int64_t compressMicroseconds = 0;
+    };
+
+    double ToSeconds(int64_t microseconds)
+    {
+        return microseconds / 1000000.0;
+    }
+
+    // Bytes per microsecond is the same ratio as megabytes per second
+    double ToMegabytesPerSecond(uint64_t bytes, int64_t microseconds)
+    {
+        return microseconds > 0 ? static_cast<double>(bytes) / microseconds : 0.0;
+    }
+
+    // Spans and the package name the same file with either separator
+    std::wstring NormalizePath(std::wstring path)
+    {
+        std::replace(path.begin(), path.end(), L'\\', L'/');
+        return path;
+    }
+
+    // Files makeappx adds to every package
+    bool IsPackageFootprintFile(const std::wstring& name)
+    {
+        return name == L"AppxBlockMap.xml" || name == L"[Content_Types].xml" ||
+            name == L"AppxSignature.p7x" || name.rfind(L"AppxMetadata/", 0) == 0;
+    }
+
+    uint32_t CountProcessThreads()
+    {
+        HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPTHREAD, 0);
+        if (snapshot == INVALID_HANDLE_VALUE) {
+            return 0;
+        }
+        
+        DWORD processId = GetCurrentProcessId();
+        uint32_t count = 0;
+        THREADENTRY32 entry = { sizeof(entry) };
+        
+        for (BOOL more = Thread32First(snapshot, &entry); more; more = Thread32Next(snapshot, &entry)) {
+            if (entry.th32OwnerProcessID == processId) {
+                count++;
+            }
+        }
+        
+        CloseHandle(snapshot);
+        return count;
+    }
+}
+
+RunReport::RunReport(std::wstring command, std::wstring source)
+    : m_command(std::move(command)),
+      m_source(std::move(source)),
+      m_startMicroseconds(TraceRecorder::Instance().NowMicroseconds()),
+      m_startTime(std::chrono::system_clock::now())
+{
+}
+
+bool RunReport::Write(const fs::path& reportPath, const PackagingResult& result, const Logger& logger) const
+{
+    TraceRecorder& recorder = TraceRecorder::Instance();
+    int64_t endMicroseconds = recorder.NowMicroseconds();
+    
+    uint64_t droppedEvents = 0;
+    std::vector<TraceEvent> events = recorder.Snapshot(droppedEvents);
+    
+    // Aggregate the spans of this run by phase, and collect the per-file transfers
+    std::map<std::string, PhaseTotals> phases;
+    std::vector<FileReport> files;
+    std::map<std::wstring, size_t> fileIndexByPath;
+    std::map<std::wstring, int64_t> compressMicrosecondsByPath;
+    double peakMegabytesPerSecond = 0.0;
+    
+    for (const auto& event : events) {
+        if (event.startMicroseconds < m_startMicroseconds) {
+            continue;
+        }
+        
+        // Counter samples come from the progress sampler's throughput estimate
+        if (event.phase == 'C') {
+            peakMegabytesPerSecond = (std::max)(peakMegabytesPerSecond, event.value);
+            continue;
+        }
+        
+        PhaseTotals& phase = phases[event.category];
+        phase.count++;
+        phase.bytes += event.bytes;
+        phase.busyMicroseconds += event.durationMicroseconds;
+        phase.firstStart = (std::min)(phase.firstStart, event.startMicroseconds);
+        phase.lastEnd = (std::max)(phase.lastEnd, event.startMicroseconds + event.durationMicroseconds);
+        
+        if (std::string(event.category) == "download") {
+            FileReport file;
+            file.name = event.name;
+            file.downloaded = true;
+            file.downloadBytes = event.bytes;
+            file.downloadMicroseconds = event.durationMicroseconds;
+            fileIndexByPath[NormalizePath(event.name)] = files.size();
+            files.push_back(std::move(file));
+        }
+        else if (std::string(event.category) == "compress") {
+            // Hashing and checksumming the blocks happen within the same span
+            compressMicrosecondsByPath[NormalizePath(event.name)] += event.durationMicroseconds;
+        }
+    }
+    
+    // Per-file compression comes from the package's central directory. Downloads are named by their
+    // path in the repository and package entries by their path in the downloaded folder, which is
+    // the same path without the folder's own path in front; that prefix is found from the first
+    // entry that is the end of a download's path.
+    uint64_t packageBytes = 0;
+    uint64_t packageEntries = 0;
+    uint64_t totalUncompressed = 0;
+    uint64_t totalCompressed = 0;
+    
+    if (!result.packagePath.empty() && fs::exists(result.packagePath)) {
+        std::error_code sizeError;
+        packageBytes = fs::file_size(result.packagePath, sizeError);
+        
+        ZipCentralDirectory directory;
+        std::wstring downloadPrefix;
+        if (directory.Read(result.packagePath, logger)) {
+            for (const auto& entry : directory.Entries()) {
+                std::wstring name = ZipCentralDirectory::DecodePartName(entry.name);
+                packageEntries++;
+                totalUncompressed += entry.uncompressedSize;
+                totalCompressed += entry.compressedSize;
+                
+                if (IsPackageFootprintFile(name)) {
+                    continue;
+                }
+                
+                auto match = fileIndexByPath.find(downloadPrefix + name);
+                if (match == fileIndexByPath.end() && downloadPrefix.empty()) {
+                    for (auto candidate = fileIndexByPath.begin(); candidate != fileIndexByPath.end(); ++candidate) {
+                        const std::wstring& path = candidate->first;
+                        if (path.size() > name.size() && path[path.size() - name.size() - 1] == L'/' &&
+                            path.compare(path.size() - name.size(), name.size(), name) == 0) {
+                            downloadPrefix = path.substr(0, path.size() - name.size());
+                            match = candidate;
+                            break;
+                        }
+                    }
+                }
+                
+                FileReport* file = nullptr;
+                if (match != fileIndexByPath.end() && !files[match->second].packaged) {
+                    file = &files[match->second];
+                }
+                else {
+                    files.push_back(FileReport{ name });
+                    file = &files.back();
+                }
+                
+                file->packaged = true;
+                file->uncompressedBytes = entry.uncompressedSize;
+                file->compressedBytes = entry.compressedSize;
+                
+                auto compressTime = compressMicrosecondsByPath.find(name);
+                if (compressTime != compressMicrosecondsByPath.end()) {
+                    file->compressMicroseconds = compressTime->second;
+                }
+            }
+        }
+    }
+    
+    PROCESS_MEMORY_COUNTERS memoryCounters = { sizeof(memoryCounters) };
+    GetProcessMemoryInfo(GetCurrentProcess(), &memoryCounters, sizeof(memoryCounters));
+    
+    std::ostringstream json;
+    json << "{\n";
+    json << "  \"command\": " << JsonUtils::Quote(m_command) << ",\n";
+    json << "  \"source\": " << JsonUtils::Quote(m_source) << ",\n";
+    if (!result.sourceCommit.empty()) {
+        json << "  \"commit\": " << JsonUtils::Quote(result.sourceCommit) << ",\n";
+    }
+    json << "  \"startedAt\": " << std::chrono::duration_cast<std::chrono::seconds>(m_startTime.time_since_epoch()).count() << ",\n";
+    json << "  \"success\": " << (result.success ? "true" : "false") << ",\n";
+    json << "  \"cancelled\": " << (result.cancelled ? "true" : "false") << ",\n";
+    if (!result.errorMessage.empty()) {
+        json << "  \"error\": " << JsonUtils::Quote(result.errorMessage) << ",\n";
+    }
+    json << "  \"totalSeconds\": " << ToSeconds(endMicroseconds - m_startMicroseconds) << ",\n";
+    
+    // Wall time is first start to last end; busy time adds up overlapping spans
+    json << "  \"phases\": [";
+    bool firstPhase = true;
+    for (const char* phaseName : ReportedPhases) {
+        auto phase = phases.find(phaseName);
+        if (phase == phases.end()) {
+            continue;
+        }
+        
+        const PhaseTotals& totals = phase->second;
+        int64_t wallMicroseconds = totals.lastEnd - totals.firstStart;
+        json << (firstPhase ? "\n" : ",\n");
+        json << "    {\"name\": \"" << phaseName << "\""
+             << ", \"count\": " << totals.count
+             << ", \"bytes\": " << totals.bytes
+             << ", \"seconds\": " << ToSeconds(wallMicroseconds)
+             << ", \"busySeconds\": " << ToSeconds(totals.busyMicroseconds)
+             << ", \"MBps\": " << ToMegabytesPerSecond(totals.bytes, wallMicroseconds) << "}";
+        firstPhase = false;
+    }
+    json << (firstPhase ? "],\n" : "\n  ],\n");
+    json << "  \"peakDownloadMBps\": " << peakMegabytesPerSecond << ",\n";
+    
+    json << "  \"files\": [";
+    for (size_t i = 0; i < files.size(); i++) {
+        const FileReport& file = files[i];
+        json << (i == 0 ? "\n" : ",\n");
+        json << "    {\"name\": " << JsonUtils::Quote(file.name);
+        
+        if (file.downloaded) {
+            json << ", \"downloadBytes\": " << file.downloadBytes
+                 << ", \"downloadSeconds\": " << ToSeconds(file.downloadMicroseconds)
+                 << ", \"downloadMBps\": " << ToMegabytesPerSecond(file.downloadBytes, file.downloadMicroseconds);
+        }
+        
+        if (file.packaged) {
+            json << ", \"uncompressedBytes\": " << file.uncompressedBytes
+                 << ", \"compressedBytes\": " << file.compressedBytes
+                 << ", \"compressionRatio\": "
+                 << (file.compressedBytes > 0 ? static_cast<double>(file.uncompressedBytes) / file.compressedBytes : 0.0);
+            if (file.compressMicroseconds > 0) {
+                json << ", \"compressSeconds\": " << ToSeconds(file.compressMicroseconds)
+                     << ", \"compressMBps\": " << ToMegabytesPerSecond(file.uncompressedBytes, file.compressMicroseconds);
+            }
+        }
+        
+        json << "}";
+    }
+    json << (files.empty() ? "],\n" : "\n  ],\n");
+    
+    json << "  \"package\": {\"path\": " << JsonUtils::Quote(result.packagePath.wstring())
+         << ", \"bytes\": " << packageBytes
+         << ", \"entries\": " << packageEntries
+         << ", \"uncompressedBytes\": " << totalUncompressed
+         << ", \"compressedBytes\": " << totalCompressed
+         << ", \"signed\": " << (result.signedPackage ? "true" : "false") << "},\n";
+    
+    json << "  \"process\": {\"peakWorkingSetBytes\": " << memoryCounters.PeakWorkingSetSize
+         << ", \"peakPagefileBytes\": " << memoryCounters.PeakPagefileUsage
+         << ", \"threadCount\": " << CountProcessThreads() << "},\n";
+    
+    json << "  \"droppedTraceEvents\": " << droppedEvents << "\n";
+    json << "}\n";
+    
+    std::ofstream file(reportPath, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        logger.Error() << L"Failed to create report file: " << reportPath.wstring();
+        return false;
+    }
+    
+    std::string content = json.str();
+    file.write(content.data(), static_cast<std::streamsize>(content.size()));
+    file.close();
+    
+    if (!file) {
+        logger.Error() << L"Failed to write report file: " << reportPath.wstring();
+        return false;
+    }
+    
+    logger.Info() << L"Run report written to: " << reportPath.wstring();
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string>
+#include <chrono>
+#include <filesystem>
+#include "Logger.h"
+#include "PackagingPipeline.h"
+
+namespace fs = std::filesystem;
+
+// Machine-readable summary of one pipeline run: per-file sizes and timings, phase totals,
+// the final package and process resource usage. Timings come from the spans recorded by
+// TraceRecorder, so tracing must be enabled before the run starts.
+class RunReport
+{
+public:
+    // Start timing a run
+    RunReport(std::wstring command, std::wstring source);
+    ~RunReport() = default;
+
+    // Write the report for the finished run as JSON
+    bool Write(const fs::path& reportPath, const PackagingResult& result, const Logger& logger) const;
+
+private:
+    std::wstring m_command;
+    std::wstring m_source;
+    int64_t m_startMicroseconds;
+    std::chrono::system_clock::time_point m_startTime;
+};
\ No newline at end of file
@@ -0,0 +1,176 @@
+#include "SourceReadAhead.h"
+#include <algorithm>
+
+namespace {
+    // Chunks start on page boundaries
+    constexpr size_t ChunkAlignment = 4096;
+}
+
+SourceReadAhead::SourceReadAhead(Logger logger)
+    : m_logger(logger),
+      m_chunkSize(0),
+      m_nextPath(0),
+      m_current(false),
+      m_chunkReturned(false),
+      m_head(0),
+      m_used(0),
+      m_engine(logger)
+{
+}
+
+bool SourceReadAhead::Start(std::vector<fs::path> paths, size_t chunkSize, IoBackend backend)
+{
+    if (chunkSize == 0 || chunkSize > BufferSize / 4) {
+        m_logger.Error() << L"Read-ahead chunks of " << chunkSize << L" bytes don't fit the buffer";
+        return false;
+    }
+    
+    m_buffer.reset(static_cast<uint8_t*>(VirtualAlloc(nullptr, BufferSize, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE)));
+    if (!m_buffer) {
+        m_logger.Error() << L"Failed to allocate the read-ahead buffer (error " << GetLastError() << L")";
+        return false;
+    }
+    
+    m_paths = std::move(paths);
+    m_chunkSize = chunkSize;
+    return m_engine.Start(backend, QueueDepth, m_buffer.get(), BufferSize);
+}
+
+bool SourceReadAhead::NextFile(fs::path& path, uint64_t& size)
+{
+    // Chunks of the previous file that were never asked for are waited for and dropped
+    if (m_current) {
+        while (!m_chunks.empty() && m_chunks.front().pathIndex == m_files.front().pathIndex) {
+            ReleaseFront();
+        }
+        m_chunkReturned = false;
+        
+        if (!m_files.front().failed) {
+            m_engine.CloseFile(m_files.front().engineFile);
+        }
+        m_files.pop_front();
+        m_current = false;
+    }
+    
+    Fill();
+    if (m_files.empty()) {
+        return false;
+    }
+    
+    const SourceFile& file = m_files.front();
+    path = m_paths[file.pathIndex];
+    size = file.size;
+    m_current = true;
+    return !file.failed;
+}
+
+const uint8_t* SourceReadAhead::Read(size_t size)
+{
+    if (m_chunkReturned) {
+        ReleaseFront();
+        m_chunkReturned = false;
+    }
+    Fill();
+    
+    if (!m_current || m_chunks.empty() || m_chunks.front().pathIndex != m_files.front().pathIndex ||
+        m_chunks.front().size != size) {
+        return nullptr;
+    }
+    
+    // Released by the next call whether or not the read worked
+    Chunk& chunk = m_chunks.front();
+    m_chunkReturned = true;
+    
+    uint32_t transferred = 0;
+    bool succeeded = m_engine.Wait(chunk.ticket, transferred);
+    chunk.ticket = 0;
+    if (!succeeded || transferred != chunk.size) {
+        return nullptr;
+    }
+    
+    return m_buffer.get() + chunk.offset;
+}
+
+IoBackend SourceReadAhead::Backend() const
+{
+    return m_engine.Backend();
+}
+
+void SourceReadAhead::Fill()
+{
+    while (m_chunks.size() < QueueDepth) {
+        // Open the next file once every byte of the last one has a read queued
+        if (m_files.empty() || m_files.back().issued == m_files.back().size) {
+            if (m_nextPath == m_paths.size() || m_files.size() > QueueDepth) {
+                break;
+            }
+            
+            SourceFile file;
+            file.pathIndex = m_nextPath++;
+            file.engineFile = m_engine.OpenFile(m_paths[file.pathIndex], false, &file.size);
+            if (file.engineFile == static_cast<size_t>(-1)) {
+                m_logger.Verbose() << L"Failed to open " << m_paths[file.pathIndex].wstring() << L" (error "
+                    << m_engine.LastError() << L")";
+                file.failed = true;
+                file.size = 0;
+            }
+            m_files.push_back(file);
+            continue;
+        }
+        
+        SourceFile& file = m_files.back();
+        uint32_t size = static_cast<uint32_t>((std::min)(file.size - file.issued, static_cast<uint64_t>(m_chunkSize)));
+        
+        Chunk chunk;
+        size_t head = m_head;
+        if (!Allocate(size, chunk.offset, chunk.reserved)) {
+            break;
+        }
+        
+        chunk.ticket = m_engine.Read(file.engineFile, file.issued, m_buffer.get() + chunk.offset, size);
+        if (chunk.ticket == 0) {
+            m_used -= chunk.reserved;
+            m_head = head;
+            break;
+        }
+        
+        chunk.pathIndex = file.pathIndex;
+        chunk.size = size;
+        m_chunks.push_back(chunk);
+        file.issued += size;
+    }
+    
+    m_engine.Submit();
+}
+
+bool SourceReadAhead::Allocate(uint32_t size, size_t& offset, size_t& reserved)
+{
+    size_t aligned = (size + ChunkAlignment - 1) / ChunkAlignment * ChunkAlignment;
+    if (m_used == 0) {
+        m_head = 0;
+    }
+    
+    // A chunk that doesn't fit before the end of the buffer starts again at the beginning
+    size_t gap = m_head + aligned > BufferSize ? BufferSize - m_head : 0;
+    if (m_used + gap + aligned > BufferSize) {
+        return false;
+    }
+    
+    offset = gap > 0 ? 0 : m_head;
+    reserved = gap + aligned;
+    m_head = offset + aligned;
+    m_used += reserved;
+    return true;
+}
+
+void SourceReadAhead::ReleaseFront()
+{
+    Chunk& chunk = m_chunks.front();
+    if (chunk.ticket != 0) {
+        uint32_t transferred = 0;
+        m_engine.Wait(chunk.ticket, transferred);
+    }
+    
+    m_used -= chunk.reserved;
+    m_chunks.pop_front();
+}
\ No newline at end of file
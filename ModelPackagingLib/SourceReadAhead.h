@@ -0,0 +1,90 @@
+#pragma once
+
+#include <deque>
+#include <vector>
+#include <cstdint>
+#include <filesystem>
+#include <Windows.h>
+#include <wil/resource.h>
+#include "Logger.h"
+#include "FileIoEngine.h"
+
+namespace fs = std::filesystem;
+
+// Reads a list of files front to back, in order, ahead of the code consuming them.
+//
+// Files are read in chunks into one 64 MB buffer used as a ring, with up to QueueDepth reads in
+// flight across as many files as that takes, so a folder of small files keeps the disk as busy as
+// one large file does. The consumer asks for the chunks of each file in the sizes they were read in
+// and gets them back in the buffer, without another copy.
+class SourceReadAhead
+{
+public:
+    static constexpr size_t BufferSize = 64 * 1024 * 1024;
+    static constexpr uint32_t QueueDepth = 32;
+
+    explicit SourceReadAhead(Logger logger = Logger());
+
+    SourceReadAhead(const SourceReadAhead&) = delete;
+    SourceReadAhead& operator=(const SourceReadAhead&) = delete;
+
+    // Start reading the files, each in pieces of chunkSize bytes, which must be at most a quarter of
+    // the buffer
+    bool Start(std::vector<fs::path> paths, size_t chunkSize, IoBackend backend = FileIoEngine::DefaultBackend());
+
+    // Move on to the next file, dropping whatever is left of the previous one. Returns false when
+    // there are no more files, or with the path filled in when the file could not be opened.
+    bool NextFile(fs::path& path, uint64_t& size);
+
+    // Next chunk of the current file, min(chunkSize, bytes left) bytes long; valid until the next call.
+    // Returns nullptr when the read failed or came up short.
+    const uint8_t* Read(size_t size);
+
+    // Backend the reads went to
+    IoBackend Backend() const;
+
+private:
+    struct SourceFile
+    {
+        size_t pathIndex = 0;
+        size_t engineFile = 0;
+        uint64_t size = 0;
+        uint64_t issued = 0;        // Bytes with reads queued
+        bool failed = false;
+    };
+
+    // A read into the buffer; chunks are released in the order they were allocated
+    struct Chunk
+    {
+        uint64_t ticket = 0;        // 0 once waited for
+        size_t pathIndex = 0;
+        size_t offset = 0;
+        uint32_t size = 0;
+        size_t reserved = 0;        // Buffer bytes held, with alignment and any gap left at the end of the buffer
+    };
+
+    // Queue reads until the queue or the buffer is full
+    void Fill();
+
+    // Find room for a chunk at the head of the ring
+    bool Allocate(uint32_t size, size_t& offset, size_t& reserved);
+
+    // Wait for the oldest chunk if needed and give its room back
+    void ReleaseFront();
+
+    Logger m_logger;
+    std::vector<fs::path> m_paths;
+    size_t m_chunkSize;
+    size_t m_nextPath;
+    bool m_current;             // The front file was handed out by NextFile
+    bool m_chunkReturned;       // The front chunk was handed out by Read
+
+    // The buffer is declared before the engine, so reads in flight are waited for before it is freed
+    wil::unique_virtualalloc_ptr<uint8_t> m_buffer;
+    size_t m_head;
+    size_t m_used;
+    FileIoEngine m_engine;
+
+    std::deque<SourceFile> m_files;
+    std::deque<Chunk> m_chunks;
+};
\ No newline at end of file
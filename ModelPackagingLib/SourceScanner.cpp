@@ -0,0 +1,533 @@
+#include "SourceScanner.h"
+#include "TraceRecorder.h"
+#include "FormatUtils.h"
+#include <algorithm>
+#include <chrono>
+#include <cwctype>
+#include <execution>
+#include <functional>
+#include <numeric>
+#include <Windows.h>
+#include <wil/resource.h>
+
+namespace {
+    // Left out unless SourceScanOptions::defaultExcludes is turned off
+    const wchar_t* const DefaultExcludePatterns[] = {
+        L".git", L".svn", L".hg", L"__pycache__", L"*.pyc", L".ipynb_checkpoints",
+        L"**/.cache/huggingface", L".DS_Store", L"Thumbs.db"
+    };
+
+    // Files listed at info level by the size report
+    constexpr size_t LargestFilesReported = 10;
+
+    std::wstring NormalizePattern(std::wstring pattern)
+    {
+        std::replace(pattern.begin(), pattern.end(), L'\\', L'/');
+        while (pattern.size() > 1 && pattern.back() == L'/') {
+            pattern.pop_back();
+        }
+        return pattern;
+    }
+
+    bool CharsEqual(wchar_t a, wchar_t b)
+    {
+        return a == b || std::towlower(a) == std::towlower(b);
+    }
+
+    // Glob match of a normalized pattern against a path with / separators
+    bool MatchGlob(std::wstring_view pattern, std::wstring_view text)
+    {
+        while (!pattern.empty()) {
+            // A trailing /** also matches the folder itself, so the folder can be skipped whole
+            if (text.empty() && pattern == L"/**") {
+                return true;
+            }
+
+            if (pattern.substr(0, 2) == L"**") {
+                pattern.remove_prefix(2);
+                if (!pattern.empty() && pattern.front() == L'/' && MatchGlob(pattern.substr(1), text)) {
+                    return true;
+                }
+                for (size_t i = 0; i <= text.size(); i++) {
+                    if (MatchGlob(pattern, text.substr(i))) {
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            if (pattern.front() == L'*') {
+                pattern.remove_prefix(1);
+                for (size_t i = 0;; i++) {
+                    if (MatchGlob(pattern, text.substr(i))) {
+                        return true;
+                    }
+                    if (i == text.size() || text[i] == L'/') {
+                        return false;
+                    }
+                }
+            }
+
+            if (text.empty() || (pattern.front() == L'?' ? text.front() == L'/' : !CharsEqual(pattern.front(), text.front()))) {
+                return false;
+            }
+
+            pattern.remove_prefix(1);
+            text.remove_prefix(1);
+        }
+
+        return text.empty();
+    }
+
+    // Match a normalized pattern: one without a separator is matched against the last segment only
+    bool MatchNormalized(std::wstring_view pattern, std::wstring_view relativePath)
+    {
+        if (pattern.find(L'/') == std::wstring_view::npos) {
+            size_t separator = relativePath.rfind(L'/');
+            return MatchGlob(pattern, separator == std::wstring_view::npos ? relativePath : relativePath.substr(separator + 1));
+        }
+
+        if (pattern.front() == L'/') {
+            pattern.remove_prefix(1);
+        }
+        return MatchGlob(pattern, relativePath);
+    }
+
+    // Whether path is ancestor or lies inside it; both come from GetFinalPathNameByHandleW
+    bool IsWithin(const std::wstring& path, const std::wstring& ancestor)
+    {
+        return !ancestor.empty() && path.size() >= ancestor.size() &&
+            std::equal(ancestor.begin(), ancestor.end(), path.begin(), CharsEqual) &&
+            (path.size() == ancestor.size() || path[ancestor.size()] == L'\\');
+    }
+
+    std::wstring GetFinalPath(HANDLE handle)
+    {
+        std::wstring path(MAX_PATH, L'\0');
+        DWORD length = GetFinalPathNameByHandleW(handle, path.data(), static_cast<DWORD>(path.size()), FILE_NAME_NORMALIZED);
+        if (length >= path.size()) {
+            path.resize(length);
+            length = GetFinalPathNameByHandleW(handle, path.data(), static_cast<DWORD>(path.size()), FILE_NAME_NORMALIZED);
+        }
+
+        path.resize(length < path.size() ? length : 0);
+        return path;
+    }
+}
+
+void SourceScanOptions::AddPatterns(const std::wstring& list, std::vector<std::wstring>& patterns)
+{
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t end = list.find(L';', start);
+        if (end == std::wstring::npos) {
+            end = list.size();
+        }
+        
+        if (end > start) {
+            patterns.push_back(list.substr(start, end - start));
+        }
+        start = end + 1;
+    }
+}
+
+SourceFileList::SourceFileList()
+    : m_folders(1)
+{
+}
+
+size_t SourceFileList::Size() const
+{
+    return m_files.size();
+}
+
+fs::path SourceFileList::RelativePath(size_t index) const
+{
+    const File& file = m_files[index];
+    
+    // Walk up to the root, then put the names together from the top
+    std::vector<uint32_t> folders;
+    for (uint32_t folder = file.folder; folder != 0; folder = m_folders[folder].parent) {
+        folders.push_back(folder);
+    }
+    
+    fs::path path;
+    for (auto it = folders.rbegin(); it != folders.rend(); ++it) {
+        path /= Name(m_folders[*it].nameOffset, m_folders[*it].nameLength);
+    }
+    
+    path /= Name(file.nameOffset, file.nameLength);
+    return path;
+}
+
+std::wstring_view SourceFileList::FileName(size_t index) const
+{
+    return Name(m_files[index].nameOffset, m_files[index].nameLength);
+}
+
+uint64_t SourceFileList::FileSize(size_t index) const
+{
+    return m_files[index].size;
+}
+
+bool SourceFileList::ContainsRootFile(const std::wstring& name) const
+{
+    return std::any_of(m_files.begin(), m_files.end(), [&](const File& file) {
+        return file.folder == 0 && Name(file.nameOffset, file.nameLength) == name;
+    });
+}
+
+uint64_t SourceFileList::TotalBytes() const
+{
+    uint64_t total = 0;
+    for (const auto& file : m_files) {
+        total += file.size;
+    }
+    return total;
+}
+
+uint32_t SourceFileList::AddName(std::wstring_view name)
+{
+    uint32_t offset = static_cast<uint32_t>(m_names.size());
+    m_names.append(name);
+    return offset;
+}
+
+std::wstring_view SourceFileList::Name(uint32_t offset, uint32_t length) const
+{
+    return std::wstring_view(m_names).substr(offset, length);
+}
+
+SourceScanner::SourceScanner(Logger logger, CancellationToken cancellationToken)
+    : m_logger(std::move(logger)),
+      m_cancellationToken(std::move(cancellationToken)),
+      m_symlinks(SymlinkPolicy::Follow)
+{
+}
+
+bool SourceScanner::Scan(const fs::path& root, const SourceScanOptions& options, SourceFileList& files, SourceScanStats* stats)
+{
+    TraceSpan scanSpan("scan", root.filename().wstring());
+    auto start = std::chrono::steady_clock::now();
+    
+    files = SourceFileList();
+    m_symlinks = options.symlinks;
+    m_includePatterns.clear();
+    m_excludePatterns.clear();
+    
+    for (const auto& pattern : options.includePatterns) {
+        m_includePatterns.push_back(NormalizePattern(pattern));
+    }
+    for (const auto& pattern : options.excludePatterns) {
+        m_excludePatterns.push_back(NormalizePattern(pattern));
+    }
+    if (options.defaultExcludes) {
+        m_excludePatterns.insert(m_excludePatterns.end(), std::begin(DefaultExcludePatterns), std::end(DefaultExcludePatterns));
+    }
+    
+    SourceScanStats totals;
+    std::vector<PendingFolder> level(1);
+    level[0].path = root;
+    level[0].included = m_includePatterns.empty();
+    
+    // Each level of the tree is listed in parallel and merged in order, so the result doesn't
+    // depend on which folder finished first
+    while (!level.empty()) {
+        if (m_cancellationToken.IsCancelled()) {
+            m_logger.Warning() << L"Scan of " << root.wstring() << L" was cancelled";
+            return false;
+        }
+        
+        std::vector<FolderListing> listings(level.size());
+        std::vector<size_t> indices(level.size());
+        std::iota(indices.begin(), indices.end(), 0);
+        std::for_each(std::execution::par, indices.begin(), indices.end(), [&](size_t i) {
+            ListFolder(level[i], listings[i]);
+        });
+        
+        std::vector<PendingFolder> nextLevel;
+        bool failed = false;
+        
+        for (size_t i = 0; i < level.size(); i++) {
+            const PendingFolder& folder = level[i];
+            FolderListing& listing = listings[i];
+            
+            for (const auto& warning : listing.warnings) {
+                m_logger.Warning() << warning;
+            }
+            if (!listing.error.empty()) {
+                m_logger.Error() << listing.error;
+                failed = true;
+                continue;
+            }
+            
+            totals.folders++;
+            totals.excludedFiles += listing.excludedFiles;
+            totals.excludedBytes += listing.excludedBytes;
+            totals.excludedFolders += listing.excludedFolders;
+            totals.skippedLinks += listing.skippedLinks;
+            
+            for (auto& entry : listing.entries) {
+                if (!entry.folder) {
+                    SourceFileList::File file;
+                    file.folder = folder.index;
+                    file.nameOffset = files.AddName(entry.name);
+                    file.nameLength = static_cast<uint32_t>(entry.name.size());
+                    file.size = entry.size;
+                    files.m_files.push_back(file);
+                    continue;
+                }
+                
+                SourceFileList::Folder subfolder;
+                subfolder.parent = folder.index;
+                subfolder.nameOffset = files.AddName(entry.name);
+                subfolder.nameLength = static_cast<uint32_t>(entry.name.size());
+                files.m_folders.push_back(subfolder);
+                
+                PendingFolder pending;
+                pending.index = static_cast<uint32_t>(files.m_folders.size() - 1);
+                pending.path = folder.path / entry.name;
+                pending.relativePath = folder.relativePath.empty() ? entry.name : folder.relativePath + L"/" + entry.name;
+                pending.included = folder.included || IsIncluded(pending.relativePath);
+                pending.linkParents = folder.linkParents;
+                if (!entry.resolvedParent.empty()) {
+                    pending.linkParents.push_back(std::move(entry.resolvedParent));
+                }
+                nextLevel.push_back(std::move(pending));
+            }
+        }
+        
+        if (failed) {
+            return false;
+        }
+        
+        level = std::move(nextLevel);
+    }
+    
+    SortFiles(files);
+    
+    totals.files = files.Size();
+    totals.bytes = files.TotalBytes();
+    totals.elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    scanSpan.SetBytes(totals.bytes);
+    
+    LogSizes(files, totals);
+    
+    if (stats) {
+        *stats = totals;
+    }
+    
+    return true;
+}
+
+bool SourceScanner::MatchesPattern(const std::wstring& pattern, std::wstring_view relativePath)
+{
+    std::wstring normalized = NormalizePattern(pattern);
+    return !normalized.empty() && MatchNormalized(normalized, relativePath);
+}
+
+void SourceScanner::ListFolder(const PendingFolder& folder, FolderListing& listing) const
+{
+    // The basic information level skips short names, and large fetches cut the number of calls
+    // into the file system for big folders
+    WIN32_FIND_DATAW data = {};
+    wil::unique_hfind find(FindFirstFileExW(
+        (folder.path / L"*").c_str(), FindExInfoBasic, &data, FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH));
+    if (!find) {
+        listing.error = L"Failed to enumerate folder: " + folder.path.wstring() + L" (error " + std::to_wstring(GetLastError()) + L")";
+        return;
+    }
+    
+    do {
+        std::wstring name = data.cFileName;
+        if (name == L"." || name == L"..") {
+            continue;
+        }
+        
+        std::wstring relativePath = folder.relativePath.empty() ? name : folder.relativePath + L"/" + name;
+        
+        FolderListing::Entry entry;
+        entry.name = std::move(name);
+        entry.folder = (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+        entry.size = (static_cast<uint64_t>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+        
+        if (IsExcluded(relativePath)) {
+            if (entry.folder) {
+                listing.excludedFolders++;
+            }
+            else {
+                listing.excludedFiles++;
+                listing.excludedBytes += entry.size;
+            }
+            continue;
+        }
+        
+        // Only symbolic links and junctions count as links; other reparse points, such as
+        // deduplicated or cloud files, read like ordinary files
+        bool link = (data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) != 0 &&
+            (data.dwReserved0 == IO_REPARSE_TAG_SYMLINK || data.dwReserved0 == IO_REPARSE_TAG_MOUNT_POINT);
+        
+        if (link) {
+            if (m_symlinks == SymlinkPolicy::Fail) {
+                listing.error = L"Found a link where links are not allowed: " + (folder.path / entry.name).wstring();
+                return;
+            }
+            
+            if (m_symlinks == SymlinkPolicy::Skip) {
+                listing.skippedLinks++;
+                continue;
+            }
+            
+            std::wstring resolvedTarget;
+            if (!ResolveLink(folder.path, entry, resolvedTarget)) {
+                listing.warnings.push_back(L"Skipping broken link: " + (folder.path / entry.name).wstring());
+                listing.skippedLinks++;
+                continue;
+            }
+            
+            // A link to a folder that contains it would be scanned forever
+            if (entry.folder) {
+                bool cycle = IsWithin(entry.resolvedParent, resolvedTarget) ||
+                    std::any_of(folder.linkParents.begin(), folder.linkParents.end(), [&](const std::wstring& parent) {
+                        return IsWithin(parent, resolvedTarget);
+                    });
+                
+                if (cycle) {
+                    listing.warnings.push_back(L"Skipping link back into the scanned tree: " + (folder.path / entry.name).wstring());
+                    listing.skippedLinks++;
+                    continue;
+                }
+            }
+        }
+        
+        if (!entry.folder && !folder.included && !IsIncluded(relativePath)) {
+            listing.excludedFiles++;
+            listing.excludedBytes += entry.size;
+            continue;
+        }
+        
+        listing.entries.push_back(std::move(entry));
+    } while (FindNextFileW(find.get(), &data));
+    
+    DWORD error = GetLastError();
+    if (error != ERROR_NO_MORE_FILES) {
+        listing.error = L"Failed to enumerate folder: " + folder.path.wstring() + L" (error " + std::to_wstring(error) + L")";
+    }
+}
+
+bool SourceScanner::ResolveLink(const fs::path& folderPath, FolderListing::Entry& entry, std::wstring& resolvedTarget) const
+{
+    // Opening without FILE_FLAG_OPEN_REPARSE_POINT follows the link to its target
+    const DWORD share = FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE;
+    wil::unique_hfile target(CreateFileW(
+        (folderPath / entry.name).c_str(), FILE_READ_ATTRIBUTES, share, nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, nullptr));
+    
+    BY_HANDLE_FILE_INFORMATION info = {};
+    if (!target || !GetFileInformationByHandle(target.get(), &info)) {
+        return false;
+    }
+    
+    entry.folder = (info.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+    entry.size = entry.folder ? 0 : (static_cast<uint64_t>(info.nFileSizeHigh) << 32) | info.nFileSizeLow;
+    if (!entry.folder) {
+        return true;
+    }
+    
+    wil::unique_hfile parent(CreateFileW(
+        folderPath.c_str(), FILE_READ_ATTRIBUTES, share, nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, nullptr));
+    if (!parent) {
+        return false;
+    }
+    
+    resolvedTarget = GetFinalPath(target.get());
+    entry.resolvedParent = GetFinalPath(parent.get());
+    return !resolvedTarget.empty() && !entry.resolvedParent.empty();
+}
+
+bool SourceScanner::IsExcluded(std::wstring_view relativePath) const
+{
+    return std::any_of(m_excludePatterns.begin(), m_excludePatterns.end(), [&](const std::wstring& pattern) {
+        return MatchNormalized(pattern, relativePath);
+    });
+}
+
+bool SourceScanner::IsIncluded(std::wstring_view relativePath) const
+{
+    return std::any_of(m_includePatterns.begin(), m_includePatterns.end(), [&](const std::wstring& pattern) {
+        return MatchNormalized(pattern, relativePath);
+    });
+}
+
+void SourceScanner::SortFiles(SourceFileList& files) const
+{
+    std::vector<std::vector<uint32_t>> subfolders(files.m_folders.size());
+    std::vector<std::vector<uint32_t>> folderFiles(files.m_folders.size());
+    
+    for (uint32_t i = 1; i < files.m_folders.size(); i++) {
+        subfolders[files.m_folders[i].parent].push_back(i);
+    }
+    for (uint32_t i = 0; i < files.m_files.size(); i++) {
+        folderFiles[files.m_files[i].folder].push_back(i);
+    }
+    
+    auto folderName = [&](uint32_t i) { return files.Name(files.m_folders[i].nameOffset, files.m_folders[i].nameLength); };
+    auto fileName = [&](uint32_t i) { return files.Name(files.m_files[i].nameOffset, files.m_files[i].nameLength); };
+    
+    // Sorted paths compare segment by segment, so within a folder its files and subfolders
+    // interleave by name and each subfolder's files come out where the subfolder sorts
+    std::vector<SourceFileList::File> sorted;
+    sorted.reserve(files.m_files.size());
+    
+    std::function<void(uint32_t)> visit = [&](uint32_t folder) {
+        auto& folderList = subfolders[folder];
+        auto& fileList = folderFiles[folder];
+        std::sort(folderList.begin(), folderList.end(), [&](uint32_t a, uint32_t b) { return folderName(a) < folderName(b); });
+        std::sort(fileList.begin(), fileList.end(), [&](uint32_t a, uint32_t b) { return fileName(a) < fileName(b); });
+        
+        size_t nextFolder = 0;
+        for (uint32_t file : fileList) {
+            while (nextFolder < folderList.size() && folderName(folderList[nextFolder]) < fileName(file)) {
+                visit(folderList[nextFolder++]);
+            }
+            sorted.push_back(files.m_files[file]);
+        }
+        while (nextFolder < folderList.size()) {
+            visit(folderList[nextFolder++]);
+        }
+    };
+    visit(0);
+    
+    files.m_files = std::move(sorted);
+}
+
+void SourceScanner::LogSizes(const SourceFileList& files, const SourceScanStats& stats) const
+{
+    m_logger.Info() << L"Scanned " << stats.folders << L" folders in " << stats.elapsedSeconds << L" s: "
+                    << stats.files << L" files (" << FormatUtils::FormatSize(stats.bytes) << L") to package, "
+                    << stats.excludedFiles << L" files (" << FormatUtils::FormatSize(stats.excludedBytes) << L") and "
+                    << stats.excludedFolders << L" folders left out";
+    
+    if (stats.skippedLinks > 0) {
+        m_logger.Info() << L"Skipped " << stats.skippedLinks << L" links";
+    }
+    
+    if (files.Size() == 0) {
+        return;
+    }
+    
+    // Every file at verbose level, otherwise just the largest, biggest first
+    std::vector<size_t> order(files.Size());
+    std::iota(order.begin(), order.end(), 0);
+    bool verbose = m_logger.IsEnabled(LogLevel::Verbose);
+    size_t reported = verbose ? order.size() : (std::min)(order.size(), LargestFilesReported);
+    
+    std::partial_sort(order.begin(), order.begin() + reported, order.end(), [&](size_t a, size_t b) {
+        return files.FileSize(a) > files.FileSize(b);
+    });
+    
+    LogLevel level = verbose ? LogLevel::Verbose : LogLevel::Info;
+    LogLine(m_logger, level) << (verbose ? L"File sizes:" : L"Largest files:");
+    for (size_t i = 0; i < reported; i++) {
+        LogLine(m_logger, level) << L"  " << FormatUtils::FormatSize(files.FileSize(order[i])) << L"  " << files.RelativePath(order[i]).wstring();
+    }
+}
\ No newline at end of file
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <string_view>
+#include <filesystem>
+#include "Logger.h"
+#include "CancellationToken.h"
+
+namespace fs = std::filesystem;
+
+// What the scanner does with symbolic links and junctions
+enum class SymlinkPolicy
+{
+    Follow,     // Package what the link points to; links back into a folder being scanned are skipped
+    Skip,       // Leave links out of the package
+    Fail        // Fail the scan, for trees that shouldn't contain links
+};
+
+// Which files of a folder go into the package.
+//
+// Patterns use / or \ as the separator and are matched ignoring case. * matches within one path
+// segment, ? matches one character and ** matches any number of segments. A pattern without a
+// separator matches a file or folder name at any depth (*.bin, .git); one with a separator is
+// matched against the whole path from the folder being scanned (onnx/**, /tokenizer.json).
+struct SourceScanOptions
+{
+    std::vector<std::wstring> includePatterns;  // Only files matching one of these are packaged; every file when empty
+    std::vector<std::wstring> excludePatterns;  // Files and whole folders matching any of these are left out
+    bool defaultExcludes = true;                // Also leave out version control folders and Python caches
+    SymlinkPolicy symlinks = SymlinkPolicy::Follow;
+
+    // Split a semicolon-separated pattern list such as "*.onnx;*.json" and append it to patterns
+    static void AddPatterns(const std::wstring& list, std::vector<std::wstring>& patterns);
+};
+
+// Totals of a scan
+struct SourceScanStats
+{
+    uint64_t folders = 0;           // Folders enumerated
+    uint64_t files = 0;             // Files kept
+    uint64_t bytes = 0;
+    uint64_t excludedFiles = 0;     // Files left out by a pattern, not counting those in excluded folders
+    uint64_t excludedBytes = 0;
+    uint64_t excludedFolders = 0;   // Folders left out without being enumerated
+    uint64_t skippedLinks = 0;
+    double elapsedSeconds = 0;
+};
+
+// The files a scan kept, in the order std::sort gives their relative paths.
+//
+// Paths are interned: every folder is stored once as its parent and its own name, and every file
+// as its folder and its name, with all names in one character pool. A tree of 100k files costs a
+// few megabytes rather than a path object per file.
+class SourceFileList
+{
+public:
+    SourceFileList();
+    ~SourceFileList() = default;
+
+    // Number of files
+    size_t Size() const;
+
+    // Path of a file relative to the scanned folder
+    fs::path RelativePath(size_t index) const;
+
+    // Name of a file without its folder
+    std::wstring_view FileName(size_t index) const;
+
+    // Size of a file when it was scanned
+    uint64_t FileSize(size_t index) const;
+
+    // Whether the scanned folder itself has a file with this name
+    bool ContainsRootFile(const std::wstring& name) const;
+
+    // Sum of the file sizes
+    uint64_t TotalBytes() const;
+
+private:
+    friend class SourceScanner;
+
+    struct Folder
+    {
+        uint32_t parent = 0;        // Index of the parent folder; the root is its own parent
+        uint32_t nameOffset = 0;
+        uint32_t nameLength = 0;
+    };
+
+    struct File
+    {
+        uint32_t folder = 0;
+        uint32_t nameOffset = 0;
+        uint32_t nameLength = 0;
+        uint64_t size = 0;
+    };
+
+    // Add a name to the pool, returning its offset
+    uint32_t AddName(std::wstring_view name);
+
+    std::wstring_view Name(uint32_t offset, uint32_t length) const;
+
+    std::wstring m_names;
+    std::vector<Folder> m_folders;  // The root folder, with an empty name, is always first
+    std::vector<File> m_files;
+};
+
+// Builds the list of files to package from a folder tree. Each level of the tree is enumerated in
+// parallel, one folder per task, with the sizes the directory listing already returns, and excluded
+// folders such as .git are left out without being enumerated at all.
+class SourceScanner
+{
+public:
+    SourceScanner(Logger logger = Logger(), CancellationToken cancellationToken = CancellationToken());
+    ~SourceScanner() = default;
+
+    // Scan a folder, replacing the contents of files. The kept files are listed with their sizes
+    // at verbose level and the largest of them at info level.
+    bool Scan(const fs::path& root, const SourceScanOptions& options, SourceFileList& files, SourceScanStats* stats = nullptr);
+
+    // Whether a relative path with / separators matches a pattern, as SourceScanOptions describes
+    static bool MatchesPattern(const std::wstring& pattern, std::wstring_view relativePath);
+
+private:
+    // A folder waiting to be enumerated
+    struct PendingFolder
+    {
+        uint32_t index = 0;                 // Index in SourceFileList::m_folders
+        fs::path path;                      // Full path, through any links followed
+        std::wstring relativePath;          // With / separators, empty for the root
+        bool included = false;              // The folder or one above it matches an include pattern
+        std::vector<std::wstring> linkParents;  // Resolved parents of the folder links followed to get here
+    };
+
+    // What enumerating one folder found
+    struct FolderListing
+    {
+        struct Entry
+        {
+            std::wstring name;
+            uint64_t size = 0;
+            bool folder = false;
+            std::wstring resolvedParent;    // Folder links: the resolved folder holding the link
+        };
+
+        std::vector<Entry> entries;
+        std::vector<std::wstring> warnings;
+        uint64_t excludedFiles = 0;
+        uint64_t excludedBytes = 0;
+        uint64_t excludedFolders = 0;
+        uint64_t skippedLinks = 0;
+        std::wstring error;
+    };
+
+    // Enumerate one folder, applying the patterns and the symlink policy
+    void ListFolder(const PendingFolder& folder, FolderListing& listing) const;
+
+    // Resolve a link found in a folder, filling in the entry's size and kind, and for a folder link
+    // its resolved parent and target. Returns false for a broken link.
+    bool ResolveLink(const fs::path& folderPath, FolderListing::Entry& entry, std::wstring& resolvedTarget) const;
+
+    // Whether a file or folder is left out by the exclude patterns
+    bool IsExcluded(std::wstring_view relativePath) const;
+
+    // Whether a file or folder matches one of the include patterns
+    bool IsIncluded(std::wstring_view relativePath) const;
+
+    // Put the files in sorted path order
+    void SortFiles(SourceFileList& files) const;
+
+    // Log the per-file size report
+    void LogSizes(const SourceFileList& files, const SourceScanStats& stats) const;
+
+    Logger m_logger;
+    CancellationToken m_cancellationToken;
+    SymlinkPolicy m_symlinks;
+    std::vector<std::wstring> m_includePatterns;
+    std::vector<std::wstring> m_excludePatterns;
+};
\ No newline at end of file
@@ -0,0 +1,197 @@
+#include "TraceRecorder.h"
+#include "JsonUtils.h"
+#include <fstream>
+#include <Windows.h>
+
+TraceRecorder& TraceRecorder::Instance()
+{
+    static TraceRecorder recorder;
+    return recorder;
+}
+
+TraceRecorder::TraceRecorder()
+    : m_enabled(false),
+      m_eventsPerThread(DefaultEventsPerThread),
+      m_origin(std::chrono::steady_clock::now())
+{
+}
+
+void TraceRecorder::Enable(size_t eventsPerThread)
+{
+    m_eventsPerThread = eventsPerThread > 0 ? eventsPerThread : DefaultEventsPerThread;
+    m_enabled = true;
+}
+
+bool TraceRecorder::IsEnabled() const
+{
+    return m_enabled.load(std::memory_order_relaxed);
+}
+
+int64_t TraceRecorder::NowMicroseconds() const
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_origin).count();
+}
+
+TraceRecorder::ThreadBuffer& TraceRecorder::GetThreadBuffer()
+{
+    // The recorder keeps the buffer alive after the thread exits so its spans are still exported
+    thread_local std::shared_ptr<ThreadBuffer> threadBuffer;
+    
+    if (!threadBuffer) {
+        threadBuffer = std::make_shared<ThreadBuffer>();
+        threadBuffer->events.resize(m_eventsPerThread);
+        
+        std::lock_guard<std::mutex> lock(m_buffersMutex);
+        m_buffers.push_back(threadBuffer);
+    }
+    
+    return *threadBuffer;
+}
+
+void TraceRecorder::Record(TraceEvent&& event)
+{
+    if (!IsEnabled()) {
+        return;
+    }
+    
+    ThreadBuffer& buffer = GetThreadBuffer();
+    
+    // Only the exporter ever competes for this lock
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    TraceEvent& slot = buffer.events[buffer.next % buffer.events.size()];
+    if (buffer.next >= buffer.events.size()) {
+        buffer.dropped++;
+    }
+    
+    slot = std::move(event);
+    buffer.next++;
+}
+
+std::vector<TraceEvent> TraceRecorder::Snapshot(uint64_t& droppedEvents)
+{
+    std::vector<TraceEvent> events;
+    droppedEvents = 0;
+    
+    std::lock_guard<std::mutex> lock(m_buffersMutex);
+    for (auto& buffer : m_buffers) {
+        std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+        size_t count = (std::min)(buffer->next, buffer->events.size());
+        size_t first = buffer->next - count;
+        
+        for (size_t i = first; i < buffer->next; i++) {
+            events.push_back(buffer->events[i % buffer->events.size()]);
+        }
+        
+        droppedEvents += buffer->dropped;
+    }
+    
+    return events;
+}
+
+void TraceRecorder::RecordCounter(const char* category, const std::wstring& name, double value)
+{
+    if (!IsEnabled()) {
+        return;
+    }
+    
+    TraceEvent event;
+    event.phase = 'C';
+    event.category = category;
+    event.name = name;
+    event.startMicroseconds = NowMicroseconds();
+    event.threadId = GetCurrentThreadId();
+    event.value = value;
+    Record(std::move(event));
+}
+
+bool TraceRecorder::WriteChromeTrace(const fs::path& tracePath, const Logger& logger)
+{
+    // Copy the buffers out so recording can continue while the file is written
+    uint64_t dropped = 0;
+    std::vector<TraceEvent> events = Snapshot(dropped);
+    
+    std::ofstream file(tracePath, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        logger.Error() << L"Failed to create trace file: " << tracePath.wstring();
+        return false;
+    }
+    
+    DWORD processId = GetCurrentProcessId();
+    
+    file << "{\"displayTimeUnit\":\"ms\",\"otherData\":{\"droppedEvents\":" << dropped << "},\"traceEvents\":[\n";
+    file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << processId
+         << ",\"tid\":0,\"args\":{\"name\":\"ModelPackagingTool\"}}";
+    
+    for (const auto& event : events) {
+        if (event.phase == 'C') {
+            file << ",\n{\"name\":" << JsonUtils::Quote(event.name)
+                 << ",\"cat\":\"" << event.category << "\""
+                 << ",\"ph\":\"C\",\"pid\":" << processId
+                 << ",\"ts\":" << event.startMicroseconds
+                 << ",\"args\":{\"value\":" << event.value << "}}";
+            continue;
+        }
+        
+        file << ",\n{\"name\":" << JsonUtils::Quote(event.name)
+             << ",\"cat\":\"" << event.category << "\""
+             << ",\"ph\":\"X\",\"pid\":" << processId
+             << ",\"tid\":" << event.threadId
+             << ",\"ts\":" << event.startMicroseconds
+             << ",\"dur\":" << event.durationMicroseconds;
+        
+        if (event.bytes > 0) {
+            // Throughput in MB/s; bytes per microsecond is the same ratio
+            double seconds = event.durationMicroseconds / 1000000.0;
+            double megabytesPerSecond = event.durationMicroseconds > 0
+                ? static_cast<double>(event.bytes) / event.durationMicroseconds
+                : 0.0;
+            
+            file << ",\"args\":{\"bytes\":" << event.bytes
+                 << ",\"seconds\":" << seconds
+                 << ",\"MBps\":" << megabytesPerSecond << "}";
+        }
+        
+        file << "}";
+    }
+    
+    file << "\n]}\n";
+    file.close();
+    
+    if (!file) {
+        logger.Error() << L"Failed to write trace file: " << tracePath.wstring();
+        return false;
+    }
+    
+    logger.Info() << L"Trace with " << events.size() << L" span(s) written to: " << tracePath.wstring();
+    if (dropped > 0) {
+        logger.Warning() << dropped << L" older span(s) were overwritten; each thread keeps its most recent "
+                         << m_eventsPerThread << L" span(s)";
+    }
+    
+    return true;
+}
+
+TraceSpan::TraceSpan(const char* category, std::wstring name)
+    : m_active(TraceRecorder::Instance().IsEnabled())
+{
+    if (m_active) {
+        m_event.category = category;
+        m_event.name = std::move(name);
+        m_event.threadId = GetCurrentThreadId();
+        m_event.startMicroseconds = TraceRecorder::Instance().NowMicroseconds();
+    }
+}
+
+TraceSpan::~TraceSpan()
+{
+    if (m_active) {
+        TraceRecorder& recorder = TraceRecorder::Instance();
+        m_event.durationMicroseconds = recorder.NowMicroseconds() - m_event.startMicroseconds;
+        recorder.Record(std::move(m_event));
+    }
+}
+
+void TraceSpan::SetBytes(uint64_t bytes)
+{
+    m_event.bytes = bytes;
+}
\ No newline at end of file
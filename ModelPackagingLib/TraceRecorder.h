@@ -0,0 +1,99 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include "Logger.h"
+
+namespace fs = std::filesystem;
+
+// One completed span, or one sample of a counter, on the timeline
+struct TraceEvent
+{
+    char phase = 'X';               // 'X' for a span, 'C' for a counter sample
+    const char* category = "";
+    std::wstring name;
+    int64_t startMicroseconds = 0;
+    int64_t durationMicroseconds = 0;
+    uint32_t threadId = 0;
+    uint64_t bytes = 0;
+    double value = 0.0;             // Counter value
+};
+
+// Process-wide recorder of pipeline spans, exported in Chrome trace event format
+// (chrome://tracing, ui.perfetto.dev). Each thread records into its own fixed-size
+// ring buffer, so recording never contends with other threads and memory stays bounded;
+// the oldest spans of a thread are overwritten once its buffer is full.
+class TraceRecorder
+{
+public:
+    static constexpr size_t DefaultEventsPerThread = 16 * 1024;
+
+    // The recorder shared by the whole process
+    static TraceRecorder& Instance();
+
+    // Start recording; spans are ignored until this is called
+    void Enable(size_t eventsPerThread = DefaultEventsPerThread);
+
+    // Whether spans are being recorded
+    bool IsEnabled() const;
+
+    // Microseconds since the recorder was created
+    int64_t NowMicroseconds() const;
+
+    // Add a completed span to the calling thread's buffer
+    void Record(TraceEvent&& event);
+
+    // Add a sample of a counter track
+    void RecordCounter(const char* category, const std::wstring& name, double value);
+
+    // Copy of every span still held in the buffers, and how many were overwritten
+    std::vector<TraceEvent> Snapshot(uint64_t& droppedEvents);
+
+    // Write every recorded span to a Chrome trace JSON file
+    bool WriteChromeTrace(const fs::path& tracePath, const Logger& logger);
+
+private:
+    TraceRecorder();
+
+    struct ThreadBuffer
+    {
+        std::mutex mutex;
+        std::vector<TraceEvent> events;
+        size_t next = 0;
+        uint64_t dropped = 0;
+    };
+
+    // Buffer of the calling thread, created on its first span
+    ThreadBuffer& GetThreadBuffer();
+
+    std::atomic<bool> m_enabled;
+    size_t m_eventsPerThread;
+    std::chrono::steady_clock::time_point m_origin;
+
+    std::mutex m_buffersMutex;
+    std::vector<std::shared_ptr<ThreadBuffer>> m_buffers;
+};
+
+// Records a span from construction to destruction when tracing is enabled
+class TraceSpan
+{
+public:
+    TraceSpan(const char* category, std::wstring name);
+    ~TraceSpan();
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+    // Bytes processed by the span, reported with its throughput
+    void SetBytes(uint64_t bytes);
+
+private:
+    bool m_active;
+    TraceEvent m_event;
+};
\ No newline at end of file
@@ -0,0 +1,335 @@
+#include "ZipCentralDirectory.h"
+#include <cstring>
+#include <fstream>
+#include <winrt/base.h>
+#include <zlib.h>
+
+namespace {
+    constexpr uint32_t EndOfCentralDirectorySignature = 0x06054b50;
+    constexpr uint32_t Zip64EndOfCentralDirectorySignature = 0x06064b50;
+    constexpr uint32_t Zip64LocatorSignature = 0x07064b50;
+    constexpr uint32_t CentralDirectoryHeaderSignature = 0x02014b50;
+    constexpr uint32_t LocalFileHeaderSignature = 0x04034b50;
+    constexpr uint16_t Zip64ExtraFieldId = 0x0001;
+
+    constexpr size_t EndOfCentralDirectorySize = 22;
+    constexpr size_t Zip64LocatorSize = 20;
+    constexpr size_t Zip64EndOfCentralDirectorySize = 56;
+    constexpr size_t CentralDirectoryHeaderSize = 46;
+    constexpr size_t LocalFileHeaderSize = 30;
+    constexpr size_t MaxCommentSize = 0xFFFF;
+    constexpr uint64_t MaxInMemoryEntrySize = 512ull * 1024 * 1024;
+
+    // ZIP fields are little-endian
+    uint16_t ReadUInt16(const uint8_t* data)
+    {
+        return static_cast<uint16_t>(data[0] | (data[1] << 8));
+    }
+
+    uint32_t ReadUInt32(const uint8_t* data)
+    {
+        return static_cast<uint32_t>(data[0]) | (static_cast<uint32_t>(data[1]) << 8) |
+            (static_cast<uint32_t>(data[2]) << 16) | (static_cast<uint32_t>(data[3]) << 24);
+    }
+
+    uint64_t ReadUInt64(const uint8_t* data)
+    {
+        return static_cast<uint64_t>(ReadUInt32(data)) | (static_cast<uint64_t>(ReadUInt32(data + 4)) << 32);
+    }
+
+    bool ReadAt(std::istream& file, uint64_t offset, uint8_t* buffer, size_t size)
+    {
+        file.clear();
+        file.seekg(static_cast<std::streamoff>(offset));
+        file.read(reinterpret_cast<char*>(buffer), static_cast<std::streamsize>(size));
+        return file.gcount() == static_cast<std::streamsize>(size);
+    }
+}
+
+bool ZipCentralDirectory::Read(const fs::path& zipPath, const Logger& logger)
+{
+    m_entries.clear();
+    
+    std::ifstream file(zipPath, std::ios::binary);
+    if (!file) {
+        logger.Error() << L"Failed to open package: " << zipPath.wstring();
+        return false;
+    }
+    
+    file.seekg(0, std::ios::end);
+    uint64_t fileSize = static_cast<uint64_t>(file.tellg());
+    
+    auto readAt = [&](uint64_t offset, uint8_t* buffer, size_t size) {
+        return ReadAt(file, offset, buffer, size);
+    };
+    
+    return ReadDirectory(readAt, fileSize, zipPath, logger);
+}
+
+bool ZipCentralDirectory::Read(const uint8_t* zip, uint64_t zipSize, const fs::path& zipPath, const Logger& logger)
+{
+    m_entries.clear();
+    
+    auto readAt = [&](uint64_t offset, uint8_t* buffer, size_t size) {
+        if (offset > zipSize || size > zipSize - offset) {
+            return false;
+        }
+        std::memcpy(buffer, zip + offset, size);
+        return true;
+    };
+    
+    return ReadDirectory(readAt, zipSize, zipPath, logger);
+}
+
+bool ZipCentralDirectory::ReadDirectory(
+    const std::function<bool(uint64_t, uint8_t*, size_t)>& readAt,
+    uint64_t fileSize,
+    const fs::path& zipPath,
+    const Logger& logger)
+{
+    if (fileSize < EndOfCentralDirectorySize) {
+        logger.Error() << L"Package is too small to be a ZIP file: " << zipPath.wstring();
+        return false;
+    }
+    
+    // The end of central directory record sits at the end of the file, before an optional comment
+    size_t tailSize = static_cast<size_t>((std::min)(fileSize, static_cast<uint64_t>(EndOfCentralDirectorySize + MaxCommentSize)));
+    std::vector<uint8_t> tail(tailSize);
+    if (!readAt(fileSize - tailSize, tail.data(), tailSize)) {
+        logger.Error() << L"Failed to read the end of package: " << zipPath.wstring();
+        return false;
+    }
+    
+    size_t recordPosition = std::string::npos;
+    for (size_t i = tailSize - EndOfCentralDirectorySize + 1; i-- > 0;) {
+        if (ReadUInt32(&tail[i]) == EndOfCentralDirectorySignature) {
+            recordPosition = i;
+            break;
+        }
+    }
+    
+    if (recordPosition == std::string::npos) {
+        logger.Error() << L"No ZIP central directory found in: " << zipPath.wstring();
+        return false;
+    }
+    
+    const uint8_t* record = &tail[recordPosition];
+    uint64_t entryCount = ReadUInt16(record + 10);
+    uint64_t directorySize = ReadUInt32(record + 12);
+    uint64_t directoryOffset = ReadUInt32(record + 16);
+    
+    // Saturated fields mean the real values are in the ZIP64 end of central directory record
+    if (entryCount == 0xFFFF || directorySize == 0xFFFFFFFF || directoryOffset == 0xFFFFFFFF) {
+        uint64_t recordOffset = fileSize - tailSize + recordPosition;
+        uint8_t locator[Zip64LocatorSize];
+        uint8_t zip64Record[Zip64EndOfCentralDirectorySize];
+        
+        if (recordOffset < Zip64LocatorSize ||
+            !readAt(recordOffset - Zip64LocatorSize, locator, sizeof(locator)) ||
+            ReadUInt32(locator) != Zip64LocatorSignature ||
+            !readAt(ReadUInt64(locator + 8), zip64Record, sizeof(zip64Record)) ||
+            ReadUInt32(zip64Record) != Zip64EndOfCentralDirectorySignature) {
+            logger.Error() << L"Invalid ZIP64 end of central directory in: " << zipPath.wstring();
+            return false;
+        }
+        
+        entryCount = ReadUInt64(zip64Record + 32);
+        directorySize = ReadUInt64(zip64Record + 40);
+        directoryOffset = ReadUInt64(zip64Record + 48);
+    }
+    
+    if (directoryOffset > fileSize || directorySize > fileSize - directoryOffset) {
+        logger.Error() << L"ZIP central directory lies outside the file: " << zipPath.wstring();
+        return false;
+    }
+    
+    std::vector<uint8_t> directory(static_cast<size_t>(directorySize));
+    if (!readAt(directoryOffset, directory.data(), directory.size())) {
+        logger.Error() << L"Failed to read the ZIP central directory of: " << zipPath.wstring();
+        return false;
+    }
+    
+    m_entries.reserve(static_cast<size_t>((std::min)(entryCount, static_cast<uint64_t>(directory.size() / CentralDirectoryHeaderSize))));
+    
+    size_t position = 0;
+    for (uint64_t i = 0; i < entryCount; i++) {
+        if (directory.size() - position < CentralDirectoryHeaderSize ||
+            ReadUInt32(&directory[position]) != CentralDirectoryHeaderSignature) {
+            logger.Error() << L"Corrupt ZIP central directory entry " << i << L" in: " << zipPath.wstring();
+            m_entries.clear();
+            return false;
+        }
+        
+        const uint8_t* header = &directory[position];
+        size_t nameLength = ReadUInt16(header + 28);
+        size_t extraLength = ReadUInt16(header + 30);
+        size_t commentLength = ReadUInt16(header + 32);
+        size_t headerLength = CentralDirectoryHeaderSize + nameLength + extraLength + commentLength;
+        
+        if (directory.size() - position < headerLength) {
+            logger.Error() << L"Truncated ZIP central directory entry " << i << L" in: " << zipPath.wstring();
+            m_entries.clear();
+            return false;
+        }
+        
+        ZipEntry entry;
+        entry.compressionMethod = ReadUInt16(header + 10);
+        entry.crc32 = ReadUInt32(header + 16);
+        entry.compressedSize = ReadUInt32(header + 20);
+        entry.uncompressedSize = ReadUInt32(header + 24);
+        entry.localHeaderOffset = ReadUInt32(header + 42);
+        entry.name.assign(reinterpret_cast<const char*>(header + CentralDirectoryHeaderSize), nameLength);
+        
+        // The ZIP64 extra field holds, in order, only the values that were saturated in the header
+        const uint8_t* extra = header + CentralDirectoryHeaderSize + nameLength;
+        size_t extraPosition = 0;
+        while (extraPosition + 4 <= extraLength) {
+            uint16_t fieldId = ReadUInt16(extra + extraPosition);
+            size_t fieldSize = ReadUInt16(extra + extraPosition + 2);
+            const uint8_t* field = extra + extraPosition + 4;
+            size_t fieldEnd = extraPosition + 4 + fieldSize;
+            
+            if (fieldEnd > extraLength) {
+                break;
+            }
+            
+            if (fieldId == Zip64ExtraFieldId) {
+                size_t fieldPosition = 0;
+                
+                if (entry.uncompressedSize == 0xFFFFFFFF && fieldPosition + 8 <= fieldSize) {
+                    entry.uncompressedSize = ReadUInt64(field + fieldPosition);
+                    fieldPosition += 8;
+                }
+                if (entry.compressedSize == 0xFFFFFFFF && fieldPosition + 8 <= fieldSize) {
+                    entry.compressedSize = ReadUInt64(field + fieldPosition);
+                    fieldPosition += 8;
+                }
+                if (entry.localHeaderOffset == 0xFFFFFFFF && fieldPosition + 8 <= fieldSize) {
+                    entry.localHeaderOffset = ReadUInt64(field + fieldPosition);
+                    fieldPosition += 8;
+                }
+            }
+            
+            extraPosition = fieldEnd;
+        }
+        
+        m_entries.push_back(std::move(entry));
+        position += headerLength;
+    }
+    
+    return true;
+}
+
+const std::vector<ZipEntry>& ZipCentralDirectory::Entries() const
+{
+    return m_entries;
+}
+
+const ZipEntry* ZipCentralDirectory::Find(const std::string& partName) const
+{
+    for (const auto& entry : m_entries) {
+        if (entry.name == partName) {
+            return &entry;
+        }
+    }
+    
+    return nullptr;
+}
+
+bool ZipCentralDirectory::FindDataOffset(std::istream& zip, const ZipEntry& entry, uint64_t& dataOffset)
+{
+    // The local header's name and extra field lengths can differ from the central directory's
+    uint8_t header[LocalFileHeaderSize];
+    if (!ReadAt(zip, entry.localHeaderOffset, header, sizeof(header)) || ReadUInt32(header) != LocalFileHeaderSignature) {
+        return false;
+    }
+    
+    dataOffset = entry.localHeaderOffset + LocalFileHeaderSize + ReadUInt16(header + 26) + ReadUInt16(header + 28);
+    zip.clear();
+    zip.seekg(static_cast<std::streamoff>(dataOffset));
+    return !zip.fail();
+}
+
+bool ZipCentralDirectory::FindDataOffset(const uint8_t* zip, uint64_t zipSize, const ZipEntry& entry, uint64_t& dataOffset)
+{
+    if (entry.localHeaderOffset > zipSize || zipSize - entry.localHeaderOffset < LocalFileHeaderSize) {
+        return false;
+    }
+    
+    const uint8_t* header = zip + entry.localHeaderOffset;
+    if (ReadUInt32(header) != LocalFileHeaderSignature) {
+        return false;
+    }
+    
+    dataOffset = entry.localHeaderOffset + LocalFileHeaderSize + ReadUInt16(header + 26) + ReadUInt16(header + 28);
+    return dataOffset <= zipSize;
+}
+
+bool ZipCentralDirectory::ReadEntryContent(std::istream& zip, const ZipEntry& entry, std::string& content)
+{
+    uint64_t dataOffset = 0;
+    if (entry.uncompressedSize > MaxInMemoryEntrySize || entry.compressedSize > MaxInMemoryEntrySize ||
+        !FindDataOffset(zip, entry, dataOffset)) {
+        return false;
+    }
+    
+    std::string compressed(static_cast<size_t>(entry.compressedSize), '\0');
+    if (!ReadAt(zip, dataOffset, reinterpret_cast<uint8_t*>(compressed.data()), compressed.size())) {
+        return false;
+    }
+    
+    if (entry.compressionMethod == 0) {
+        content = std::move(compressed);
+    }
+    else if (entry.compressionMethod == 8) {
+        content.assign(static_cast<size_t>(entry.uncompressedSize), '\0');
+        
+        z_stream stream = {};
+        if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) {
+            return false;
+        }
+        
+        stream.next_in = reinterpret_cast<Bytef*>(compressed.data());
+        stream.avail_in = static_cast<uInt>(compressed.size());
+        stream.next_out = reinterpret_cast<Bytef*>(content.data());
+        stream.avail_out = static_cast<uInt>(content.size());
+        
+        int status = inflate(&stream, Z_FINISH);
+        bool complete = status == Z_STREAM_END && stream.total_out == content.size();
+        inflateEnd(&stream);
+        
+        if (!complete) {
+            return false;
+        }
+    }
+    else {
+        return false;
+    }
+    
+    return crc32(crc32(0L, Z_NULL, 0), reinterpret_cast<const Bytef*>(content.data()), static_cast<uInt>(content.size())) == entry.crc32;
+}
+
+std::wstring ZipCentralDirectory::DecodePartName(const std::string& partName)
+{
+    return std::wstring(winrt::to_hstring(DecodePartNameUtf8(partName)));
+}
+
+std::string ZipCentralDirectory::DecodePartNameUtf8(const std::string& partName)
+{
+    std::string decoded;
+    decoded.reserve(partName.size());
+    
+    for (size_t i = 0; i < partName.size(); i++) {
+        if (partName[i] == '%' && i + 2 < partName.size() &&
+            isxdigit(static_cast<unsigned char>(partName[i + 1])) &&
+            isxdigit(static_cast<unsigned char>(partName[i + 2]))) {
+            decoded += static_cast<char>(std::stoi(partName.substr(i + 1, 2), nullptr, 16));
+            i += 2;
+        }
+        else {
+            decoded += partName[i];
+        }
+    }
+    
+    return decoded;
+}
\ No newline at end of file
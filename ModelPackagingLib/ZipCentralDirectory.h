@@ -0,0 +1,68 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <istream>
+#include <cstdint>
+#include <functional>
+#include <filesystem>
+#include "Logger.h"
+
+namespace fs = std::filesystem;
+
+// One file recorded in a ZIP central directory
+struct ZipEntry
+{
+    std::string name;               // Part name as stored (UTF-8, percent-encoded in MSIX packages)
+    uint16_t compressionMethod = 0; // 0 = stored, 8 = deflate
+    uint32_t crc32 = 0;
+    uint64_t compressedSize = 0;
+    uint64_t uncompressedSize = 0;
+    uint64_t localHeaderOffset = 0;
+};
+
+// Reads the central directory of a ZIP-based file such as an MSIX package, including ZIP64 archives
+class ZipCentralDirectory
+{
+public:
+    ZipCentralDirectory() = default;
+    ~ZipCentralDirectory() = default;
+
+    // Read the central directory of the given file
+    bool Read(const fs::path& zipPath, const Logger& logger);
+
+    // Read the central directory of a ZIP file held in memory, such as a mapped package.
+    // zipPath is only used in messages.
+    bool Read(const uint8_t* zip, uint64_t zipSize, const fs::path& zipPath, const Logger& logger);
+
+    // Entries in central directory order
+    const std::vector<ZipEntry>& Entries() const;
+
+    // Find an entry by its part name as stored, or nullptr
+    const ZipEntry* Find(const std::string& partName) const;
+
+    // Offset of an entry's data, which follows its local file header
+    static bool FindDataOffset(std::istream& zip, const ZipEntry& entry, uint64_t& dataOffset);
+
+    // Offset of an entry's data in a ZIP file held in memory, such as a mapped package
+    static bool FindDataOffset(const uint8_t* zip, uint64_t zipSize, const ZipEntry& entry, uint64_t& dataOffset);
+
+    // Read and inflate a small entry, such as a manifest, into memory, checking its CRC
+    static bool ReadEntryContent(std::istream& zip, const ZipEntry& entry, std::string& content);
+
+    // Decode a percent-encoded part name into a relative path
+    static std::wstring DecodePartName(const std::string& partName);
+
+    // Decode a percent-encoded part name into a UTF-8 relative path with forward slashes
+    static std::string DecodePartNameUtf8(const std::string& partName);
+
+private:
+    // Locate and parse the central directory, reading the file through readAt(offset, buffer, size)
+    bool ReadDirectory(
+        const std::function<bool(uint64_t, uint8_t*, size_t)>& readAt,
+        uint64_t fileSize,
+        const fs::path& zipPath,
+        const Logger& logger);
+
+    std::vector<ZipEntry> m_entries;
+};
\ No newline at end of file
@@ -1,5 +1,100 @@
 #include "CommandLineParser.h"
+#include "DownloadFilter.h"
+#include "EndpointList.h"
+#include "DownloadSink.h"
+#include "FileIoEngine.h"
 #include <iostream>
+#include <sstream>
+#include <climits>
+#include <cwctype>
+
+// Parse a non-negative integer option value, rejecting anything that isn't entirely digits
+static bool ParseUnsigned(const std::wstring& text, unsigned long long& value)
+{
+    if (text.empty() || text.find_first_not_of(L"0123456789") != std::wstring::npos) {
+        return false;
+    }
+    
+    try {
+        value = std::stoull(text);
+        return true;
+    }
+    catch (const std::exception&) {
+        return false;
+    }
+}
+
+// Parse a bandwidth in bytes per second: a whole number with an optional K, M or G suffix for
+// KB/s, MB/s or GB/s (10M, 512K, 2GB/s)
+static bool ParseBandwidth(const std::wstring& text, unsigned long long& value)
+{
+    std::wstring number = text;
+    if (number.size() > 2 && _wcsicmp(number.substr(number.size() - 2).c_str(), L"/s") == 0) {
+        number.resize(number.size() - 2);
+    }
+    if (!number.empty() && (number.back() == L'B' || number.back() == L'b')) {
+        number.pop_back();
+    }
+    
+    unsigned long long multiplier = 1;
+    if (!number.empty()) {
+        switch (towupper(number.back())) {
+            case L'K': multiplier = 1024ull; break;
+            case L'M': multiplier = 1024ull * 1024; break;
+            case L'G': multiplier = 1024ull * 1024 * 1024; break;
+        }
+        if (multiplier > 1) {
+            number.pop_back();
+        }
+    }
+    
+    if (!ParseUnsigned(number, value) || value == 0 || value > ULLONG_MAX / multiplier) {
+        return false;
+    }
+    value *= multiplier;
+    return true;
+}
+
+// Parse an /endpoint value: one or more http or https base URLs, separated by semicolons
+static bool ParseEndpoints(const std::wstring& text, std::vector<std::wstring>& endpoints)
+{
+    std::vector<std::wstring> urls = EndpointList::Parse(text);
+    for (const auto& url : urls) {
+        if (_wcsnicmp(url.c_str(), L"http://", 7) != 0 && _wcsnicmp(url.c_str(), L"https://", 8) != 0) {
+            return false;
+        }
+    }
+    
+    endpoints.insert(endpoints.end(), urls.begin(), urls.end());
+    return !urls.empty();
+}
+
+// Parse the /include, /exclude, /noDefaultExcludes and /symlinks options shared by the commands that
+// read a source folder, returning whether arg was one of them
+static bool ParseSourceFilterOption(const std::wstring& arg, int argc, wchar_t* argv[], int& i, CommandLineOptions& options)
+{
+    if ((arg == L"/include" || arg == L"-include") && i + 1 < argc) {
+        options.includePatterns.push_back(argv[++i]);
+    }
+    else if ((arg == L"/exclude" || arg == L"-exclude") && i + 1 < argc) {
+        options.excludePatterns.push_back(argv[++i]);
+    }
+    else if (arg == L"/noDefaultExcludes" || arg == L"-noDefaultExcludes") {
+        options.defaultExcludes = false;
+    }
+    else if ((arg == L"/symlinks" || arg == L"-symlinks") && i + 1 < argc) {
+        options.symlinks = argv[++i];
+        if (options.symlinks != L"follow" && options.symlinks != L"skip" && options.symlinks != L"fail") {
+            std::wcerr << L"Error: /symlinks must be follow, skip or fail: " << options.symlinks << std::endl;
+            options.command = CommandLineOptions::Command::ShowHelp;
+        }
+    }
+    else {
+        return false;
+    }
+    
+    return true;
+}
 
 CommandLineOptions CommandLineParser::Parse(int argc, wchar_t* argv[])
 {
@@ -63,6 +158,36 @@ CommandLineOptions CommandLineParser::Parse(int argc, wchar_t* argv[])
             else if (arg == L"/verbose" || arg == L"-verbose") {
                 options.verbose = true;
             }
+            else if ((arg == L"/trace" || arg == L"-trace") && i + 1 < argc) {
+                options.tracePath = argv[++i];
+            }
+            else if ((arg == L"/report" || arg == L"-report") && i + 1 < argc) {
+                options.reportPath = argv[++i];
+            }
+            else if ((arg == L"/cache" || arg == L"-cache") && i + 1 < argc) {
+                options.cacheFolder = argv[++i];
+            }
+            else if (arg == L"/makeappx" || arg == L"-makeappx") {
+                options.useMakeAppx = true;
+            }
+            else if (arg == L"/block-clone" || arg == L"-block-clone") {
+                options.blockClone = true;
+            }
+            else if (arg == L"/store-weights" || arg == L"-store-weights") {
+                options.storeWeights = true;
+            }
+            else if ((arg == L"/io-engine" || arg == L"-io-engine") && i + 1 < argc) {
+                IoBackend backend;
+                options.ioEngine = argv[++i];
+                if (!FileIoEngine::ParseBackend(options.ioEngine, backend)) {
+                    std::wcerr << L"Error: /io-engine must be auto, ioring or threadpool: " << options.ioEngine << std::endl;
+                    options.command = CommandLineOptions::Command::ShowHelp;
+                    return options;
+                }
+            }
+            else if (ParseSourceFilterOption(arg, argc, argv, i, options)) {
+                continue;
+            }
             else if (arg.substr(0, 1) == L"/" || arg.substr(0, 1) == L"-") {
                 std::wcerr << L"Error: Unknown option: " << arg << std::endl;
             }
@@ -158,6 +283,86 @@ CommandLineOptions CommandLineParser::Parse(int argc, wchar_t* argv[])
             else if (arg == L"/verbose" || arg == L"-verbose") {
                 options.verbose = true;
             }
+            else if ((arg == L"/trace" || arg == L"-trace") && i + 1 < argc) {
+                options.tracePath = argv[++i];
+            }
+            else if ((arg == L"/report" || arg == L"-report") && i + 1 < argc) {
+                options.reportPath = argv[++i];
+            }
+            else if ((arg == L"/cache" || arg == L"-cache") && i + 1 < argc) {
+                options.cacheFolder = argv[++i];
+            }
+            else if (arg == L"/makeappx" || arg == L"-makeappx") {
+                options.useMakeAppx = true;
+            }
+            else if (arg == L"/block-clone" || arg == L"-block-clone") {
+                options.blockClone = true;
+            }
+            else if (arg == L"/store-weights" || arg == L"-store-weights") {
+                options.storeWeights = true;
+            }
+            else if ((arg == L"/allow" || arg == L"-allow") && i + 1 < argc) {
+                options.allowPatterns.push_back(argv[++i]);
+            }
+            else if ((arg == L"/ignore" || arg == L"-ignore") && i + 1 < argc) {
+                options.ignorePatterns.push_back(argv[++i]);
+            }
+            else if ((arg == L"/profile" || arg == L"-profile") && i + 1 < argc) {
+                std::wstring profile = argv[++i];
+                if (!DownloadFilter::IsProfile(profile)) {
+                    std::wcerr << L"Error: Unknown /profile " << profile << L"; expected one of " << DownloadFilter::ProfileNames() << std::endl;
+                    options.command = CommandLineOptions::Command::ShowHelp;
+                    return options;
+                }
+                options.profiles.push_back(profile);
+            }
+            else if (arg == L"/plan" || arg == L"-plan") {
+                options.planOnly = true;
+            }
+            else if ((arg == L"/max-bandwidth" || arg == L"-max-bandwidth") && i + 1 < argc) {
+                if (!ParseBandwidth(argv[++i], options.maxBandwidth)) {
+                    std::wcerr << L"Error: Invalid bandwidth: " << argv[i] << std::endl;
+                    options.command = CommandLineOptions::Command::ShowHelp;
+                    return options;
+                }
+            }
+            else if ((arg == L"/weight" || arg == L"-weight") && i + 1 < argc) {
+                unsigned long long value = 0;
+                if (!ParseUnsigned(argv[++i], value) || value == 0 || value > 100) {
+                    std::wcerr << L"Error: Invalid weight, expected 1 to 100: " << argv[i] << std::endl;
+                    options.command = CommandLineOptions::Command::ShowHelp;
+                    return options;
+                }
+                options.bandwidthWeight = static_cast<unsigned>(value);
+            }
+            else if ((arg == L"/endpoint" || arg == L"-endpoint") && i + 1 < argc) {
+                if (!ParseEndpoints(argv[++i], options.endpoints)) {
+                    std::wcerr << L"Error: Invalid endpoint, expected http or https URLs: " << argv[i] << std::endl;
+                    options.command = CommandLineOptions::Command::ShowHelp;
+                    return options;
+                }
+            }
+            else if ((arg == L"/write-mode" || arg == L"-write-mode") && i + 1 < argc) {
+                DownloadWriteMode mode;
+                options.writeMode = argv[++i];
+                if (!DownloadSink::ParseMode(options.writeMode, mode)) {
+                    std::wcerr << L"Error: /write-mode must be inline, write-behind or unbuffered: " << options.writeMode << std::endl;
+                    options.command = CommandLineOptions::Command::ShowHelp;
+                    return options;
+                }
+            }
+            else if ((arg == L"/io-engine" || arg == L"-io-engine") && i + 1 < argc) {
+                IoBackend backend;
+                options.ioEngine = argv[++i];
+                if (!FileIoEngine::ParseBackend(options.ioEngine, backend)) {
+                    std::wcerr << L"Error: /io-engine must be auto, ioring or threadpool: " << options.ioEngine << std::endl;
+                    options.command = CommandLineOptions::Command::ShowHelp;
+                    return options;
+                }
+            }
+            else if (ParseSourceFilterOption(arg, argc, argv, i, options)) {
+                continue;
+            }
             else if (arg.substr(0, 1) == L"/" || arg.substr(0, 1) == L"-") {
                 std::wcerr << L"Error: Unknown option: " << arg << std::endl;
             }
@@ -187,6 +392,330 @@ CommandLineOptions CommandLineParser::Parse(int argc, wchar_t* argv[])
             return options;
         }
     }
+    else if (command == L"/update") {
+        options.command = CommandLineOptions::Command::Update;
+        
+        // Check if we have the required package path
+        if (argc < 3) {
+            std::wcerr << L"Error: Missing input package path" << std::endl;
+            options.command = CommandLineOptions::Command::ShowHelp;
+            return options;
+        }
+        
+        options.inputPath = argv[2];
+        
+        for (int i = 3; i < argc; i++) {
+            std::wstring arg = argv[i];
+            
+            if ((arg == L"/version" || arg == L"-version") && i + 1 < argc) {
+                options.version = argv[++i];
+            }
+            else if ((arg == L"/name" || arg == L"-name") && i + 1 < argc) {
+                options.packageName = argv[++i];
+            }
+            else if ((arg == L"/publisher" || arg == L"-publisher") && i + 1 < argc) {
+                options.publisherName = argv[++i];
+            }
+            else if ((arg == L"/replace" || arg == L"-replace") && i + 2 < argc) {
+                std::wstring partPath = argv[++i];
+                options.replacedFiles.emplace_back(partPath, fs::path(argv[++i]));
+            }
+            else if ((arg == L"/remove" || arg == L"-remove") && i + 1 < argc) {
+                options.removedFiles.push_back(argv[++i]);
+            }
+            else if ((arg == L"/o" || arg == L"-o") && i + 1 < argc) {
+                options.outputPath = argv[++i];
+            }
+            else if (arg == L"/sign" || arg == L"-sign") {
+                if (i + 1 < argc) {
+                    options.certPath = argv[++i];
+                    options.shouldSign = true;
+                }
+                else {
+                    std::wcerr << L"Error: Missing certificate path after /sign option" << std::endl;
+                    options.command = CommandLineOptions::Command::ShowHelp;
+                    return options;
+                }
+            }
+            else if ((arg == L"/pwd" || arg == L"-pwd") && i + 1 < argc) {
+                options.certPassword = argv[++i];
+            }
+            else if (arg == L"/verbose" || arg == L"-verbose") {
+                options.verbose = true;
+            }
+            else if ((arg == L"/trace" || arg == L"-trace") && i + 1 < argc) {
+                options.tracePath = argv[++i];
+            }
+            else if ((arg == L"/report" || arg == L"-report") && i + 1 < argc) {
+                options.reportPath = argv[++i];
+            }
+            else {
+                std::wcerr << L"Error: Unknown option: " << arg << std::endl;
+            }
+        }
+        
+        if (!fs::is_regular_file(options.inputPath)) {
+            std::wcerr << L"Error: Input package does not exist: " << options.inputPath << std::endl;
+            options.command = CommandLineOptions::Command::ShowHelp;
+            return options;
+        }
+        
+        // MSIX versions are four dot-separated numbers, each at most 65535
+        if (!options.version.empty()) {
+            std::wistringstream parts(options.version);
+            std::wstring part;
+            int partCount = 0;
+            bool valid = true;
+            
+            while (std::getline(parts, part, L'.')) {
+                unsigned long long value = 0;
+                valid = valid && ParseUnsigned(part, value) && value <= 65535;
+                partCount++;
+            }
+            
+            if (!valid || partCount != 4 || options.version.back() == L'.') {
+                std::wcerr << L"Error: Invalid version (expected four numbers such as 1.2.0.0): " << options.version << std::endl;
+                options.command = CommandLineOptions::Command::ShowHelp;
+                return options;
+            }
+        }
+        
+        for (const auto& [partPath, filePath] : options.replacedFiles) {
+            if (!fs::is_regular_file(filePath)) {
+                std::wcerr << L"Error: Replacement file does not exist: " << filePath.wstring() << std::endl;
+                options.command = CommandLineOptions::Command::ShowHelp;
+                return options;
+            }
+        }
+        
+        // Validate the certificate path if signing is requested
+        if (options.shouldSign && !fs::exists(options.certPath)) {
+            std::wcerr << L"Error: Certificate file does not exist: " << options.certPath.wstring() << std::endl;
+            options.command = CommandLineOptions::Command::ShowHelp;
+            return options;
+        }
+    }
+    else if (command == L"/diff" || command == L"/applyDelta") {
+        bool isDiff = command == L"/diff";
+        options.command = isDiff ? CommandLineOptions::Command::Diff : CommandLineOptions::Command::ApplyDelta;
+        
+        // Both take the old package and then the new folder or the delta
+        if (argc < 4) {
+            std::wcerr << (isDiff ? L"Error: Missing old package or new folder path" : L"Error: Missing old package or delta file path") << std::endl;
+            options.command = CommandLineOptions::Command::ShowHelp;
+            return options;
+        }
+        
+        options.inputPath = argv[2];
+        options.targetPath = argv[3];
+        
+        for (int i = 4; i < argc; i++) {
+            std::wstring arg = argv[i];
+            
+            if ((arg == L"/o" || arg == L"-o") && i + 1 < argc) {
+                options.outputPath = argv[++i];
+            }
+            else if (!isDiff && (arg == L"/sign" || arg == L"-sign")) {
+                if (i + 1 < argc) {
+                    options.certPath = argv[++i];
+                    options.shouldSign = true;
+                }
+                else {
+                    std::wcerr << L"Error: Missing certificate path after /sign option" << std::endl;
+                    options.command = CommandLineOptions::Command::ShowHelp;
+                    return options;
+                }
+            }
+            else if (!isDiff && (arg == L"/pwd" || arg == L"-pwd") && i + 1 < argc) {
+                options.certPassword = argv[++i];
+            }
+            else if (arg == L"/verbose" || arg == L"-verbose") {
+                options.verbose = true;
+            }
+            else if ((arg == L"/trace" || arg == L"-trace") && i + 1 < argc) {
+                options.tracePath = argv[++i];
+            }
+            else if ((arg == L"/report" || arg == L"-report") && i + 1 < argc) {
+                options.reportPath = argv[++i];
+            }
+            else if (isDiff && ParseSourceFilterOption(arg, argc, argv, i, options)) {
+                continue;
+            }
+            else {
+                std::wcerr << L"Error: Unknown option: " << arg << std::endl;
+            }
+        }
+        
+        if (!fs::is_regular_file(options.inputPath)) {
+            std::wcerr << L"Error: Old package does not exist: " << options.inputPath << std::endl;
+            options.command = CommandLineOptions::Command::ShowHelp;
+            return options;
+        }
+        
+        if (isDiff ? !fs::is_directory(options.targetPath) : !fs::is_regular_file(options.targetPath)) {
+            std::wcerr << (isDiff ? L"Error: New folder does not exist: " : L"Error: Delta file does not exist: ") << options.targetPath.wstring() << std::endl;
+            options.command = CommandLineOptions::Command::ShowHelp;
+            return options;
+        }
+        
+        if (options.outputPath.empty()) {
+            std::wcerr << L"Error: Missing required output path. Use /o option to specify output path" << std::endl;
+            options.command = CommandLineOptions::Command::ShowHelp;
+            return options;
+        }
+        
+        // Validate the certificate path if signing is requested
+        if (options.shouldSign && !fs::exists(options.certPath)) {
+            std::wcerr << L"Error: Certificate file does not exist: " << options.certPath.wstring() << std::endl;
+            options.command = CommandLineOptions::Command::ShowHelp;
+            return options;
+        }
+    }
+    else if (command == L"/compare") {
+        options.command = CommandLineOptions::Command::Compare;
+        
+        if (argc < 4) {
+            std::wcerr << L"Error: Missing package paths to compare" << std::endl;
+            options.command = CommandLineOptions::Command::ShowHelp;
+            return options;
+        }
+        
+        options.inputPath = argv[2];
+        options.targetPath = argv[3];
+        
+        for (int i = 4; i < argc; i++) {
+            std::wstring arg = argv[i];
+            
+            if ((arg == L"/o" || arg == L"-o") && i + 1 < argc) {
+                options.outputPath = argv[++i];
+            }
+            else if (arg == L"/verbose" || arg == L"-verbose") {
+                options.verbose = true;
+            }
+            else if ((arg == L"/trace" || arg == L"-trace") && i + 1 < argc) {
+                options.tracePath = argv[++i];
+            }
+            else {
+                std::wcerr << L"Error: Unknown option: " << arg << std::endl;
+            }
+        }
+        
+        for (const fs::path& packagePath : { fs::path(options.inputPath), options.targetPath }) {
+            if (!fs::is_regular_file(packagePath)) {
+                std::wcerr << L"Error: Package does not exist: " << packagePath.wstring() << std::endl;
+                options.command = CommandLineOptions::Command::ShowHelp;
+                return options;
+            }
+        }
+    }
+    else if (command == L"/verify" || command == L"/unpack") {
+        bool isUnpack = command == L"/unpack";
+        options.command = isUnpack ? CommandLineOptions::Command::Unpack : CommandLineOptions::Command::Verify;
+        
+        if (argc < 3) {
+            std::wcerr << L"Error: Missing package path" << std::endl;
+            options.command = CommandLineOptions::Command::ShowHelp;
+            return options;
+        }
+        
+        options.inputPath = argv[2];
+        
+        for (int i = 3; i < argc; i++) {
+            std::wstring arg = argv[i];
+            
+            if (isUnpack && (arg == L"/o" || arg == L"-o") && i + 1 < argc) {
+                options.outputPath = argv[++i];
+            }
+            else if (arg == L"/verbose" || arg == L"-verbose") {
+                options.verbose = true;
+            }
+            else if ((arg == L"/trace" || arg == L"-trace") && i + 1 < argc) {
+                options.tracePath = argv[++i];
+            }
+            else {
+                std::wcerr << L"Error: Unknown option: " << arg << std::endl;
+            }
+        }
+        
+        if (!fs::is_regular_file(options.inputPath)) {
+            std::wcerr << L"Error: Package does not exist: " << options.inputPath << std::endl;
+            options.command = CommandLineOptions::Command::ShowHelp;
+            return options;
+        }
+        
+        if (isUnpack && options.outputPath.empty()) {
+            std::wcerr << L"Error: Missing required output folder. Use /o option to specify output folder" << std::endl;
+            options.command = CommandLineOptions::Command::ShowHelp;
+            return options;
+        }
+    }
+    else if (command == L"/serve") {
+        options.command = CommandLineOptions::Command::Serve;
+        
+        for (int i = 2; i < argc; i++) {
+            std::wstring arg = argv[i];
+            unsigned long long value = 0;
+            
+            if ((arg == L"/port" || arg == L"-port") && i + 1 < argc) {
+                if (!ParseUnsigned(argv[++i], value) || value == 0 || value > 65535) {
+                    std::wcerr << L"Error: Invalid port: " << argv[i] << std::endl;
+                    options.command = CommandLineOptions::Command::ShowHelp;
+                    return options;
+                }
+                options.servePort = static_cast<uint16_t>(value);
+            }
+            else if ((arg == L"/workers" || arg == L"-workers") && i + 1 < argc) {
+                if (!ParseUnsigned(argv[++i], value) || value == 0 || value > 64) {
+                    std::wcerr << L"Error: Invalid worker count: " << argv[i] << std::endl;
+                    options.command = CommandLineOptions::Command::ShowHelp;
+                    return options;
+                }
+                options.serveWorkers = static_cast<int>(value);
+            }
+            else if ((arg == L"/queue" || arg == L"-queue") && i + 1 < argc) {
+                if (!ParseUnsigned(argv[++i], value) || value == 0) {
+                    std::wcerr << L"Error: Invalid queue size: " << argv[i] << std::endl;
+                    options.command = CommandLineOptions::Command::ShowHelp;
+                    return options;
+                }
+                options.serveQueueCapacity = static_cast<size_t>(value);
+            }
+            else if ((arg == L"/max-bandwidth" || arg == L"-max-bandwidth") && i + 1 < argc) {
+                if (!ParseBandwidth(argv[++i], options.maxBandwidth)) {
+                    std::wcerr << L"Error: Invalid bandwidth: " << argv[i] << std::endl;
+                    options.command = CommandLineOptions::Command::ShowHelp;
+                    return options;
+                }
+            }
+            else if ((arg == L"/write-mode" || arg == L"-write-mode") && i + 1 < argc) {
+                DownloadWriteMode mode;
+                options.writeMode = argv[++i];
+                if (!DownloadSink::ParseMode(options.writeMode, mode)) {
+                    std::wcerr << L"Error: /write-mode must be inline, write-behind or unbuffered: " << options.writeMode << std::endl;
+                    options.command = CommandLineOptions::Command::ShowHelp;
+                    return options;
+                }
+            }
+            else if ((arg == L"/io-engine" || arg == L"-io-engine") && i + 1 < argc) {
+                IoBackend backend;
+                options.ioEngine = argv[++i];
+                if (!FileIoEngine::ParseBackend(options.ioEngine, backend)) {
+                    std::wcerr << L"Error: /io-engine must be auto, ioring or threadpool: " << options.ioEngine << std::endl;
+                    options.command = CommandLineOptions::Command::ShowHelp;
+                    return options;
+                }
+            }
+            else if (arg == L"/verbose" || arg == L"-verbose") {
+                options.verbose = true;
+            }
+            else if ((arg == L"/trace" || arg == L"-trace") && i + 1 < argc) {
+                options.tracePath = argv[++i];
+            }
+            else {
+                std::wcerr << L"Error: Unknown option: " << arg << std::endl;
+            }
+        }
+    }
     else if (command == L"/help" || command == L"-help" || command == L"/?" || command == L"-?") {
         options.command = CommandLineOptions::Command::ShowHelp;
     }
@@ -202,13 +731,27 @@ void CommandLineParser::ShowUsage()
 {
     std::wcout << L"ModelPackagingTool - Tool for packaging model files into MSIX packages" << std::endl;
     std::wcout << L"Usage:" << std::endl;
-    std::wcout << L"  ModelPackagingTool /pack <path-to-folder> /name <n> /publisher <publisher> /o <output-dir> [/sign <cert-path>]" << std::endl;
-    std::wcout << L"  ModelPackagingTool /downloadAndPack <uri> /o <output-dir> [/name <n>] [/publisher <publisher>] [/sign <cert-path>]" << std::endl;
+    std::wcout << L"  ModelPackagingTool /pack <path-to-folder> /name <n> /publisher <publisher> /o <output-dir> [/sign <cert-path>] [/cache <dir>] [/include <patterns>] [/exclude <patterns>] [/io-engine <engine>] [/block-clone] [/store-weights] [/trace <file>] [/report <file>]" << std::endl;
+    std::wcout << L"  ModelPackagingTool /downloadAndPack <uri> /o <output-dir> [/name <n>] [/publisher <publisher>] [/sign <cert-path>] [/cache <dir>] [/profile <name>] [/allow <patterns>] [/ignore <patterns>] [/plan] [/max-bandwidth <rate>] [/endpoint <url>] [/write-mode <mode>] [/io-engine <engine>] [/block-clone] [/store-weights] [/trace <file>] [/report <file>]" << std::endl;
+    std::wcout << L"  ModelPackagingTool /update <package.msix> [/o <output>] [/version <x.x.x.x>] [/name <n>] [/publisher <publisher>] [/replace <path-in-package> <file>] [/remove <path-in-package>] [/sign <cert-path>]" << std::endl;
+    std::wcout << L"  ModelPackagingTool /diff <old.msix> <new-folder> /o <delta-file> [/include <patterns>] [/exclude <patterns>]" << std::endl;
+    std::wcout << L"  ModelPackagingTool /applyDelta <old.msix> <delta-file> /o <new.msix> [/sign <cert-path>]" << std::endl;
+    std::wcout << L"  ModelPackagingTool /compare <old.msix> <new.msix> [/o <report.json>]" << std::endl;
+    std::wcout << L"  ModelPackagingTool /verify <package.msix>" << std::endl;
+    std::wcout << L"  ModelPackagingTool /unpack <package.msix> /o <folder>" << std::endl;
+    std::wcout << L"  ModelPackagingTool /serve [/port <port>] [/workers <n>] [/queue <n>] [/max-bandwidth <rate>] [/write-mode <mode>] [/io-engine <engine>] [/trace <file>]" << std::endl;
     std::wcout << L"  ModelPackagingTool /help" << std::endl;
     std::wcout << std::endl;
     std::wcout << L"Commands:" << std::endl;
     std::wcout << L"  /pack                 Package a local folder into an MSIX package" << std::endl;
     std::wcout << L"  /downloadAndPack      Download model files from a URI and package them" << std::endl;
+    std::wcout << L"  /update               Edit an existing package, copying unchanged files without recompressing them" << std::endl;
+    std::wcout << L"  /diff                 Write the blocks that changed between a package and a newer model folder to a delta file" << std::endl;
+    std::wcout << L"  /applyDelta           Build the newer package from the old package and a delta file" << std::endl;
+    std::wcout << L"  /compare              List the files added, removed and changed between two packages, from their block maps" << std::endl;
+    std::wcout << L"  /verify               Check every block of a package against AppxBlockMap.xml and every file against its CRC" << std::endl;
+    std::wcout << L"  /unpack               Extract the files of a package into a folder, checking them as /verify does" << std::endl;
+    std::wcout << L"  /serve                Run as a local packaging server that accepts jobs over HTTP" << std::endl;
     std::wcout << L"  /help                 Show this help information" << std::endl;
     std::wcout << std::endl;
     std::wcout << L"Options:" << std::endl;
@@ -218,13 +761,100 @@ void CommandLineParser::ShowUsage()
     std::wcout << L"  /sign <cert-path>     Sign the MSIX package with the specified certificate" << std::endl;
     std::wcout << L"  /pwd <password>       Specify password for certificate (only needed if certificate is password-protected)" << std::endl;
     std::wcout << L"  /verbose              Enable verbose output" << std::endl;
+    std::wcout << L"  /trace <file>         Record a timeline of every phase to a Chrome trace file (chrome://tracing, ui.perfetto.dev)" << std::endl;
+    std::wcout << L"  /report <file>        Write a JSON report with per-file sizes and timings, phase totals and resource usage" << std::endl;
+    std::wcout << L"  /cache <dir>          Keep compressed files in a cache so repackaging only recompresses files that changed" << std::endl;
+    std::wcout << L"  /makeappx             Build the package with MakeAppx.exe from the Windows SDK instead of the built-in writer" << std::endl;
+    std::wcout << L"  /io-engine <engine>   How the built-in writer reads files and writes the package: auto (default) uses" << std::endl;
+    std::wcout << L"                        an I/O ring where Windows has them and the thread pool elsewhere; ioring or" << std::endl;
+    std::wcout << L"                        threadpool picks one (/pack, /downloadAndPack)" << std::endl;
+    std::wcout << L"  /block-clone          On ReFS and Dev Drives, share the disk blocks of stored files with the package" << std::endl;
+    std::wcout << L"                        instead of copying them; their data is aligned to clusters with padding in the" << std::endl;
+    std::wcout << L"                        local headers (/pack, /downloadAndPack)" << std::endl;
+    std::wcout << L"  /store-weights        Store model weights (.onnx, .onnx.data, .safetensors, .bin, .gguf and the like)" << std::endl;
+    std::wcout << L"                        instead of deflating them, so they are copied from a view, cloned with" << std::endl;
+    std::wcout << L"                        /block-clone and hashed while they download (/pack, /downloadAndPack)" << std::endl;
+    std::wcout << std::endl;
+    std::wcout << L"Source Folder Options (/pack, /downloadAndPack, /diff):" << std::endl;
+    std::wcout << L"  /include <patterns>   Only package files matching these patterns, separated by semicolons (repeatable)" << std::endl;
+    std::wcout << L"  /exclude <patterns>   Leave out files and folders matching these patterns (repeatable)" << std::endl;
+    std::wcout << L"  /noDefaultExcludes    Also package .git, __pycache__ and other version control and cache folders" << std::endl;
+    std::wcout << L"  /symlinks <policy>    follow (default) packages what links point to, skip leaves links out, fail stops" << std::endl;
+    std::wcout << L"  * matches within a folder name, ** across folders and ? one character, ignoring case. A pattern" << std::endl;
+    std::wcout << L"  without a slash matches a name at any depth (*.bin, .git); one with a slash matches the path from" << std::endl;
+    std::wcout << L"  the source folder (onnx/**). Excluded folders are skipped without being read." << std::endl;
+    std::wcout << std::endl;
+    std::wcout << L"Download Options (/downloadAndPack):" << std::endl;
+    std::wcout << L"  /allow <patterns>     Only download files matching these patterns, separated by semicolons (repeatable)" << std::endl;
+    std::wcout << L"  /ignore <patterns>    Don't download files matching these patterns, even if allowed (repeatable)" << std::endl;
+    std::wcout << L"  /profile <name>       Allow the files a built-in profile names (repeatable):" << std::endl;
+    std::wcout << L"                          onnx-only  ONNX models and their data, configuration and tokenizer files" << std::endl;
+    std::wcout << L"                          genai      What onnxruntime-genai loads: genai_config.json, models, tokenizer" << std::endl;
+    std::wcout << L"  Patterns are matched against paths in the downloaded folder, with the syntax of /include, and" << std::endl;
+    std::wcout << L"  filter the repository listing, so skipped files are never requested." << std::endl;
+    std::wcout << L"  /plan                 Print the files, sizes, download order and estimated time, check free disk" << std::endl;
+    std::wcout << L"                        space, and stop without downloading anything" << std::endl;
+    std::wcout << L"  /max-bandwidth <rate> Limit the download to a rate in bytes per second, with K, M or G for KB/s," << std::endl;
+    std::wcout << L"                        MB/s or GB/s (50M); the throughput with and without the limit is reported" << std::endl;
+    std::wcout << L"  /weight <n>           Share of the /serve bandwidth limit relative to other jobs downloading at" << std::endl;
+    std::wcout << L"                        the same time (1 to 100, default: 1)" << std::endl;
+    std::wcout << L"  /endpoint <url>       Download from this base URL, such as a local mirror, in place of the one" << std::endl;
+    std::wcout << L"                        HF_ENDPOINT or GITHUB_RAW_ENDPOINT names (repeatable). With several, the" << std::endl;
+    std::wcout << L"                        fastest to answer is used and a failed transfer continues at the next one" << std::endl;
+    std::wcout << L"  /write-mode <mode>    How downloaded files are written: write-behind (default) preallocates each file" << std::endl;
+    std::wcout << L"                        and writes 4 MB blocks on a separate thread, unbuffered does the same past the" << std::endl;
+    std::wcout << L"                        file system cache, inline writes every chunk as it arrives" << std::endl;
+    std::wcout << std::endl;
+    std::wcout << L"Update Options:" << std::endl;
+    std::wcout << L"  /o <path>             Output package or directory (default: update the package in place)" << std::endl;
+    std::wcout << L"  /version <x.x.x.x>    Set the package Identity Version" << std::endl;
+    std::wcout << L"  /name, /publisher     Set the package Identity Name and Publisher" << std::endl;
+    std::wcout << L"  /replace <p> <file>   Replace the file at path p in the package, or add it (repeatable)" << std::endl;
+    std::wcout << L"  /remove <p>           Remove the file at path p from the package (repeatable)" << std::endl;
+    std::wcout << L"  The signature of a signed package is removed; use /sign to sign the updated package." << std::endl;
+    std::wcout << std::endl;
+    std::wcout << L"Delta Options:" << std::endl;
+    std::wcout << L"  /o <path>             Delta file for /diff, new package for /applyDelta (a directory picks the name)" << std::endl;
+    std::wcout << L"  A delta only holds the 64 KB blocks the old package doesn't have, and /applyDelta only accepts" << std::endl;
+    std::wcout << L"  the package it was made against. The rebuilt package is the one /pack makes from the new folder." << std::endl;
+    std::wcout << std::endl;
+    std::wcout << L"Compare Options:" << std::endl;
+    std::wcout << L"  /o <file>             Also write the comparison as JSON" << std::endl;
+    std::wcout << L"  /verbose              List identical files too" << std::endl;
+    std::wcout << std::endl;
+    std::wcout << L"Verify and Unpack Options:" << std::endl;
+    std::wcout << L"  /o <folder>           Folder /unpack writes the package's files to" << std::endl;
+    std::wcout << L"  Files that fail the check are not left in the output folder. Runs of zero blocks are" << std::endl;
+    std::wcout << L"  left unallocated in sparse files; other files get their full size allocated up front." << std::endl;
+    std::wcout << std::endl;
+    std::wcout << L"Server Options:" << std::endl;
+    std::wcout << L"  /port <port>          Loopback port to listen on (default: 7878)" << std::endl;
+    std::wcout << L"  /workers <n>          Number of jobs to run concurrently (default: 2)" << std::endl;
+    std::wcout << L"  /queue <n>            Number of jobs that may wait for a worker (default: 16)" << std::endl;
+    std::wcout << L"  /max-bandwidth <rate> Limit the downloads of all jobs together; jobs split it by their /weight" << std::endl;
+    std::wcout << L"  /write-mode <mode>    How the downloads of all jobs are written, as for /downloadAndPack" << std::endl;
+    std::wcout << L"  /io-engine <engine>   How all jobs read files and write packages, as for /pack" << std::endl;
+    std::wcout << L"  Submit a job with POST /jobs, one command-line argument per line in the body." << std::endl;
+    std::wcout << L"  Progress is streamed back as newline-delimited JSON events; a full queue returns 503." << std::endl;
+    std::wcout << L"  GET /status reports worker and queue usage." << std::endl;
     std::wcout << std::endl;
     std::wcout << L"Examples:" << std::endl;
     std::wcout << L"  ModelPackagingTool /pack C:\\Models\\MyModel /name MyModel /publisher Contoso /o C:\\Output" << std::endl;
     std::wcout << L"  ModelPackagingTool /downloadAndPack https://huggingface.co/openai-community/gpt2/tree/main/onnx /o C:\\Output" << std::endl;
     std::wcout << L"  ModelPackagingTool /downloadAndPack https://huggingface.co/openai-community/gpt2 /o C:\\Output /name gpt2 /publisher openai-community" << std::endl;
+    std::wcout << L"  ModelPackagingTool /downloadAndPack https://huggingface.co/openai-community/gpt2/tree/main/onnx /o C:\\Output /profile onnx-only /ignore \"*_quantized.onnx\"" << std::endl;
+    std::wcout << L"  ModelPackagingTool /downloadAndPack https://huggingface.co/openai-community/gpt2/tree/main/onnx /o C:\\Output /plan" << std::endl;
+    std::wcout << L"  ModelPackagingTool /downloadAndPack https://huggingface.co/openai-community/gpt2/tree/main/onnx /o C:\\Output /max-bandwidth 20M" << std::endl;
+    std::wcout << L"  ModelPackagingTool /downloadAndPack https://huggingface.co/openai-community/gpt2/tree/main/onnx /o C:\\Output /endpoint http://mirror.contoso.local /endpoint https://huggingface.co" << std::endl;
     std::wcout << L"  ModelPackagingTool /pack C:\\Models\\MyModel /name MyModel /publisher Contoso /o C:\\Output /sign C:\\Certs\\MyCert.pfx" << std::endl;
     std::wcout << L"  ModelPackagingTool /pack C:\\Models\\MyModel /name MyModel /publisher Contoso /o C:\\Output /sign C:\\Certs\\MyCert.pfx /pwd mypassword" << std::endl;
+    std::wcout << L"  ModelPackagingTool /pack C:\\Models\\MyModel /name MyModel /publisher Contoso /o C:\\Output /exclude \"*.bin;*.safetensors\"" << std::endl;
+    std::wcout << L"  ModelPackagingTool /update C:\\Output\\Contoso_MyModel.msix /version 1.1.0.0 /replace genai_config.json C:\\Models\\MyModel\\genai_config.json" << std::endl;
+    std::wcout << L"  ModelPackagingTool /diff C:\\Output\\Contoso_MyModel.msix C:\\Models\\MyModel-v2 /o C:\\Output\\MyModel-v2.msixdelta" << std::endl;
+    std::wcout << L"  ModelPackagingTool /applyDelta C:\\Output\\Contoso_MyModel.msix C:\\Output\\MyModel-v2.msixdelta /o C:\\Output\\Contoso_MyModel-v2.msix" << std::endl;
+    std::wcout << L"  ModelPackagingTool /compare C:\\Release\\Contoso_MyModel.msix C:\\Output\\Contoso_MyModel.msix /o C:\\Output\\compare.json" << std::endl;
+    std::wcout << L"  ModelPackagingTool /verify C:\\Output\\Contoso_MyModel.msix" << std::endl;
+    std::wcout << L"  ModelPackagingTool /unpack C:\\Output\\Contoso_MyModel.msix /o D:\\Models\\MyModel" << std::endl;
     std::wcout << std::endl;
     std::wcout << L"Signing Options:" << std::endl;
     std::wcout << L"  /sign <cert-file>     Specify certificate file for signing (required for signed packages)" << std::endl;
@@ -3,7 +3,9 @@
 #include <string>
 #include <map>
 #include <vector>
+#include <utility>
 #include <filesystem>
+#include <cstdint>
 
 namespace fs = std::filesystem;
 
@@ -15,20 +17,65 @@ struct CommandLineOptions
         None,
         Package,
         DownloadAndPackage,
+        Update,
+        Diff,
+        ApplyDelta,
+        Compare,
+        Verify,
+        Unpack,
+        Serve,
         ShowHelp
     };
     
     Command command = Command::None;
     std::wstring inputPath;         // Folder path or URI
-    fs::path outputPath;            // Output MSIX path
+    fs::path outputPath;            // Output MSIX path, or the folder /unpack writes to
     bool verbose = false;           // Verbose output
     std::wstring packageName;       // Custom package name
     std::wstring publisherName;     // Custom publisher name
+    fs::path tracePath;             // Chrome trace output file for /trace
+    fs::path reportPath;            // JSON run report output file for /report
+    fs::path cacheFolder;           // Package cache folder for /cache
+    bool useMakeAppx = false;       // Package with MakeAppx.exe instead of the built-in writer
+    
+    // Source folder filters for /pack, /downloadAndPack and /diff
+    std::vector<std::wstring> includePatterns;  // /include <patterns>, each a semicolon-separated list
+    std::vector<std::wstring> excludePatterns;  // /exclude <patterns>
+    bool defaultExcludes = true;    // Cleared by /noDefaultExcludes
+    std::wstring symlinks = L"follow";  // /symlinks follow|skip|fail
+    
+    // Remote listing filters for /downloadAndPack
+    std::vector<std::wstring> allowPatterns;    // /allow <patterns>, each a semicolon-separated list
+    std::vector<std::wstring> ignorePatterns;   // /ignore <patterns>
+    std::vector<std::wstring> profiles;         // /profile <name>
+    bool planOnly = false;                      // /plan: list and plan the download without running it
+    unsigned long long maxBandwidth = 0;        // /max-bandwidth in bytes per second, 0 for no limit (also /serve)
+    unsigned bandwidthWeight = 1;               // /weight: share of the limit relative to concurrent jobs
+    std::vector<std::wstring> endpoints;        // /endpoint <url>: base URLs to download from, in order of preference
+    std::wstring writeMode = L"write-behind";   // /write-mode inline|write-behind|unbuffered (also /serve)
+    
+    // Package file I/O for /pack and /downloadAndPack
+    std::wstring ioEngine = L"auto";    // /io-engine auto|ioring|threadpool (also /serve)
+    bool blockClone = false;            // /block-clone: share the blocks of stored files with the package on ReFS
+    bool storeWeights = false;          // /store-weights: store model weights instead of deflating them
+    
+    // Update options
+    std::wstring version;           // New Identity Version for /update
+    std::vector<std::pair<std::wstring, fs::path>> replacedFiles;  // /replace <path-in-package> <file>
+    std::vector<std::wstring> removedFiles;                         // /remove <path-in-package>
+    
+    // Delta options
+    fs::path targetPath;            // New folder for /diff, delta file for /applyDelta, new package for /compare
     
     // Certificate options
     fs::path certPath;              // Path to certificate file for signing
     std::wstring certPassword;      // Password for certificate
     bool shouldSign = false;        // Whether to sign the package
+    
+    // Server options
+    uint16_t servePort = 7878;      // Loopback port for /serve
+    int serveWorkers = 2;           // Number of jobs /serve runs concurrently
+    size_t serveQueueCapacity = 16; // Jobs that may wait for a worker before /serve rejects new ones
 };
 
 class CommandLineParser
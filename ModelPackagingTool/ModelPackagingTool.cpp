@@ -3,244 +3,456 @@
 #include <iostream>
 #include <Windows.h>
 #include <filesystem>
+#include <fstream>
 #include <string>
+#include <mutex>
 #include <vector>
-#include <fstream>
+#include <sstream>
 #include <shellapi.h>
 #include <winrt/base.h>
-#include <regex>
-#include "HuggingFaceDownloader.h"
-#include "GitHubDownloader.h"
-#include "ModelDownloader.h"
-#include "MsixPackager.h"
+#include "PackagingPipeline.h"
+#include "PackageComparer.h"
+#include "PackageExtractor.h"
+#include "AsyncLogWriter.h"
+#include "TraceRecorder.h"
+#include "BandwidthLimiter.h"
+#include "DownloadSink.h"
+#include "FileIoEngine.h"
+#include "RunReport.h"
 #include "CommandLineParser.h"
-#include "CertificateManager.h"
+#include "PackagingServer.h"
+#include "JobWorkspace.h"
+#include "FormatUtils.h"
+
+// Most files shown with their own bar under the aggregate progress line
+constexpr size_t MaxProgressBars = 4;
+constexpr int ProgressBarWidth = 24;
+
+// Progress block built by the sampler thread and drawn by the console writer thread
+static std::mutex g_progressMutex;
+static std::vector<std::wstring> g_progressLines;
+static bool g_progressUpdated = false;
+
+// Console state touched only by the writer thread: the block to show, and how many lines of it are on screen
+static std::vector<std::wstring> g_shownProgressLines;
+static size_t g_progressLinesOnScreen = 0;
+
+// Whether the console understands VT sequences, which multi-line progress needs
+static bool g_virtualTerminal = false;
 
-// Progress callback for the downloader
-void DownloadProgressCallback(const std::wstring& fileName, uint64_t bytesReceived, uint64_t totalBytes)
+// Console writer for the pipeline's messages, owned by wmain
+static AsyncLogWriter* g_consoleWriter = nullptr;
+
+// Build the progress block from a snapshot (sampler thread)
+void RenderConsoleProgress(const ProgressSnapshot& snapshot)
 {
-    if (totalBytes > 0) {
-        double percentage = static_cast<double>(bytesReceived) / totalBytes * 100.0;
-        std::wcout << L"\rDownloading " << fileName << L": " << bytesReceived << L"/" << totalBytes 
-                  << L" bytes (" << static_cast<int>(percentage) << L"%)";
+    std::vector<std::wstring> lines;
+    
+    if (snapshot.activeTransfers > 0) {
+        std::wstringstream summary;
+        summary << L"Downloading " << snapshot.completedTransfers << L"/" << snapshot.files.size() << L" files: "
+                << FormatUtils::FormatSize(snapshot.bytesReceived);
+        
+        if (snapshot.totalKnown && snapshot.totalBytes > 0) {
+            summary << L" / " << FormatUtils::FormatSize(snapshot.totalBytes) << L" ("
+                    << static_cast<int>(100.0 * snapshot.bytesReceived / snapshot.totalBytes) << L"%)";
+        }
+        
+        summary << L" at " << FormatUtils::FormatSize(static_cast<uint64_t>(snapshot.bytesPerSecond)) << L"/s";
+        if (snapshot.etaSeconds >= 0.0) {
+            summary << L", ETA " << FormatUtils::FormatDuration(snapshot.etaSeconds);
+        }
+        lines.push_back(summary.str());
+        
+        // One bar per active file when the console can redraw several lines
+        if (g_virtualTerminal) {
+            for (const auto& file : snapshot.files) {
+                if (file.complete || lines.size() > MaxProgressBars) {
+                    continue;
+                }
+                
+                std::wstringstream bar;
+                int filled = file.totalBytes > 0
+                    ? static_cast<int>(ProgressBarWidth * static_cast<double>(file.bytesReceived) / file.totalBytes)
+                    : 0;
+                bar << L"  [" << std::wstring(filled, L'#') << std::wstring(ProgressBarWidth - filled, L'.') << L"] "
+                    << FormatUtils::FormatSize(file.bytesReceived) << L" " << file.name;
+                lines.push_back(bar.str());
+            }
+        }
     }
-    else {
-        std::wcout << L"\rDownloading " << fileName << L": " << bytesReceived << L" bytes";
+    
+    std::lock_guard<std::mutex> lock(g_progressMutex);
+    if (lines != g_progressLines) {
+        g_progressLines = std::move(lines);
+        g_progressUpdated = true;
     }
 }
 
-// Find the actual model folder in the download directory
-fs::path FindModelFolder(const fs::path& downloadFolder, const std::wstring& repoName)
+// Remove the progress block so a message can be printed in its place (writer thread)
+void ClearConsoleProgress()
 {
-    // If the repo name folder exists, use it
-    fs::path modelFolder = downloadFolder / repoName;
-    if (fs::exists(modelFolder) && fs::is_directory(modelFolder)) {
-        return modelFolder;
+    if (g_progressLinesOnScreen == 0) {
+        return;
     }
     
-    // Look for a single subdirectory in the download folder
-    std::vector<fs::path> subdirs;
-    try {
-        for (const auto& entry : fs::directory_iterator(downloadFolder)) {
-            if (entry.is_directory()) {
-                subdirs.push_back(entry.path());
-            }
+    if (g_virtualTerminal) {
+        // Erase each line of the block, moving up to the first one
+        std::wcout << L"\r\x1b[2K";
+        for (size_t i = 1; i < g_progressLinesOnScreen; i++) {
+            std::wcout << L"\x1b[1A\x1b[2K";
         }
     }
-    catch (const std::exception& ex) {
-        std::cerr << "Error enumerating download folder: " << ex.what() << std::endl;
+    else {
+        // Without VT support the single progress line is left in place
+        std::wcout << L'\n';
     }
+    
+    g_progressLinesOnScreen = 0;
+}
 
-    // If there's exactly one subdirectory, it's likely the model folder
-    if (subdirs.size() == 1) {
-        return subdirs[0];
-    }
+// Write one message to the console (writer thread)
+void WriteConsoleMessage(LogLevel level, const std::wstring& message)
+{
+    ClearConsoleProgress();
     
-    // Otherwise, use the download folder itself
-    return downloadFolder;
+    if (level == LogLevel::Error || level == LogLevel::Warning) {
+        std::wcout.flush();
+        std::wcerr << (level == LogLevel::Warning ? L"Warning: " : L"") << message << L'\n';
+    }
+    else {
+        std::wcout << message << L'\n';
+    }
 }
 
-// Execute the Package command
-int ExecutePackageCommand(const CommandLineOptions& options)
+// Redraw the progress block below the batch's messages, then flush the console once (writer thread)
+void FinishConsoleBatch()
 {
-    try {
-        std::wcout << L"Packaging folder: " << options.inputPath << std::endl;
-        
-        // Create the MSIX package
-        MsixPackager packager;
-        bool success = packager.CreateMsixPackage(
-            options.inputPath, 
-            options.outputPath,
-            options.packageName,
-            options.publisherName
-        );
-        
-        if (!success) {
-            std::wcerr << L"Error: Failed to create MSIX package" << std::endl;
-            return 1;
+    bool updated = false;
+    std::vector<std::wstring> previousLines = g_shownProgressLines;
+    {
+        std::lock_guard<std::mutex> lock(g_progressMutex);
+        if (g_progressUpdated) {
+            g_shownProgressLines = g_progressLines;
+            g_progressUpdated = false;
+            updated = true;
         }
-        
-        // If signing is requested, sign the package
-        if (options.shouldSign) {
-            fs::path msixPath;
+    }
+    
+    if (updated && g_progressLinesOnScreen > 0) {
+        if (g_virtualTerminal) {
+            ClearConsoleProgress();
+        }
+        else {
+            // Overwrite the single progress line in place, blanking what the new text doesn't cover
+            std::wstring line = g_shownProgressLines.empty() ? L"" : g_shownProgressLines[0];
+            size_t previousLength = previousLines.empty() ? 0 : previousLines[0].size();
+            if (line.size() < previousLength) {
+                line.append(previousLength - line.size(), L' ');
+            }
             
-            // Determine the MSIX file path
-            if (fs::is_directory(options.outputPath) || !options.outputPath.has_extension()) {
-                // The file will be in the output directory with a name based on publisher and package
-                std::wstring cleanPackageName = packager.CleanNameForPackage(options.packageName);
-                std::wstring cleanPublisherName = packager.CleanNameForPackage(options.publisherName);
-                std::wstring msixFilename = cleanPublisherName + L"_" + cleanPackageName + L".msix";
-                msixPath = options.outputPath / msixFilename;
+            std::wcout << L"\r" << line;
+            if (g_shownProgressLines.empty()) {
+                std::wcout << L"\r";
+                g_progressLinesOnScreen = 0;
             }
-            else {
-                // The file is already specified with full path
-                msixPath = options.outputPath;
+        }
+    }
+    
+    if (g_progressLinesOnScreen == 0 && !g_shownProgressLines.empty()) {
+        for (size_t i = 0; i < g_shownProgressLines.size(); i++) {
+            std::wcout << (i == 0 ? L"\r" : L"\n") << g_shownProgressLines[i];
+            if (g_virtualTerminal) {
+                std::wcout << L"\x1b[K";
             }
+        }
+        g_progressLinesOnScreen = g_shownProgressLines.size();
+    }
+    
+    std::wcout.flush();
+}
+
+// Turn on VT sequence processing for the console, if stdout is one
+bool EnableVirtualTerminal()
+{
+    HANDLE output = GetStdHandle(STD_OUTPUT_HANDLE);
+    DWORD mode = 0;
+    if (output == INVALID_HANDLE_VALUE || !GetConsoleMode(output, &mode)) {
+        return false;
+    }
+    
+    return SetConsoleMode(output, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING) != FALSE;
+}
+
+// Logger that writes the pipeline's messages to the console
+Logger CreateConsoleLogger(bool verbose)
+{
+    return Logger(g_consoleWriter->Sink(), verbose ? LogLevel::Verbose : LogLevel::Info);
+}
+
+// Build a pipeline request from the parsed command line
+PackagingRequest CreatePackagingRequest(const CommandLineOptions& options)
+{
+    PackagingRequest request;
+    request.source = options.inputPath;
+    request.outputPath = options.outputPath;
+    request.packageName = options.packageName;
+    request.publisherName = options.publisherName;
+    
+    if (options.shouldSign) {
+        request.certPath = options.certPath;
+        request.certPassword = options.certPassword;
+    }
+    
+    // Verbose runs keep the downloaded files around for inspection
+    request.keepDownloads = options.verbose;
+    request.useMakeAppx = options.useMakeAppx;
+    request.cacheFolder = options.cacheFolder;
+    request.blockClone = options.blockClone;
+    request.storeWeights = options.storeWeights;
+    
+    for (const auto& patterns : options.includePatterns) {
+        SourceScanOptions::AddPatterns(patterns, request.scanOptions.includePatterns);
+    }
+    for (const auto& patterns : options.excludePatterns) {
+        SourceScanOptions::AddPatterns(patterns, request.scanOptions.excludePatterns);
+    }
+    request.scanOptions.defaultExcludes = options.defaultExcludes;
+    request.scanOptions.symlinks = options.symlinks == L"skip" ? SymlinkPolicy::Skip :
+        options.symlinks == L"fail" ? SymlinkPolicy::Fail : SymlinkPolicy::Follow;
+    
+    for (const auto& profile : options.profiles) {
+        request.downloadFilter.AddProfile(profile);
+    }
+    for (const auto& patterns : options.allowPatterns) {
+        SourceScanOptions::AddPatterns(patterns, request.downloadFilter.allowPatterns);
+    }
+    for (const auto& patterns : options.ignorePatterns) {
+        SourceScanOptions::AddPatterns(patterns, request.downloadFilter.ignorePatterns);
+    }
+    request.planOnly = options.planOnly;
+    request.bandwidthWeight = options.bandwidthWeight;
+    request.endpoints = options.endpoints;
+    
+    request.version = options.version;
+    request.replacedFiles = options.replacedFiles;
+    request.removedFiles = options.removedFiles;
+    request.target = options.targetPath;
+    return request;
+}
+
+// Run a parsed /pack, /downloadAndPack, /update, /diff or /applyDelta command on the given pipeline
+PackagingResult RunPackagingCommand(
+    const CommandLineOptions& options,
+    PackagingPipeline& pipeline,
+    const fs::path& workspaceRoot,
+    const PackagingContext& context)
+{
+    PackagingRequest request = CreatePackagingRequest(options);
+    
+    switch (options.command) {
+        case CommandLineOptions::Command::Package:
+            return pipeline.Pack(request, context);
             
-            std::wcout << L"Signing MSIX package: " << msixPath.wstring() << std::endl;
+        case CommandLineOptions::Command::Update:
+            return pipeline.Update(request, context);
             
-            bool signSuccess = packager.SignMsixPackage(
-                msixPath,
-                options.certPath,
-                options.certPassword
-            );
+        case CommandLineOptions::Command::Diff:
+            return pipeline.Diff(request, context);
             
-            if (!signSuccess) {
-                std::wcerr << L"Error: Failed to sign MSIX package" << std::endl;
-                return 1;
-            }
+        case CommandLineOptions::Command::ApplyDelta:
+            return pipeline.ApplyDelta(request, context);
             
-            std::wcout << L"MSIX package signed successfully" << std::endl;
-        }
-        
-        return 0;
+        default:
+            return pipeline.DownloadAndPack(request, workspaceRoot, context);
     }
-    catch (const std::exception& ex) {
-        std::cerr << "Error: " << ex.what() << std::endl;
-        return 1;
+}
+
+// Name of a packaging command in run reports
+std::wstring CommandName(CommandLineOptions::Command command)
+{
+    switch (command) {
+        case CommandLineOptions::Command::Package:
+            return L"pack";
+        case CommandLineOptions::Command::Update:
+            return L"update";
+        case CommandLineOptions::Command::Diff:
+            return L"diff";
+        case CommandLineOptions::Command::ApplyDelta:
+            return L"applyDelta";
+        default:
+            return L"downloadAndPack";
     }
 }
 
-// Execute the DownloadAndPackage command
-int ExecuteDownloadAndPackageCommand(const CommandLineOptions& options)
+// Write the recorded spans if /trace was given
+void WriteTraceIfRequested(const CommandLineOptions& options)
 {
-    try {
-        std::wcout << L"Downloading and packaging from URI: " << options.inputPath << std::endl;
-        
-        // Create a temporary download folder
-        fs::path downloadFolder = fs::temp_directory_path() / L"ModelPackagingTool_Download";
-        if (fs::exists(downloadFolder)) {
-            fs::remove_all(downloadFolder);
-        }
-        fs::create_directories(downloadFolder);
-        
-        // Always print the download folder, it's useful information
-        std::wcout << L"Files will be downloaded to: " << downloadFolder.wstring() << std::endl;
-        
-        // Initialize the downloader
-        ModelDownloader downloader;
-        
-        // Parse the URI to extract repository information for naming inference
-        RepositoryInfo repoInfo = downloader.ParseUri(options.inputPath);
-        
-        // Show inference information if name or publisher not provided
-        std::wstring finalPackageName = options.packageName;
-        std::wstring finalPublisherName = options.publisherName;
-        
-        if (finalPackageName.empty()) {
-            finalPackageName = repoInfo.name;
-            std::wcout << L"Package name will be inferred from repository: " << finalPackageName << std::endl;
-        }
-        
-        if (finalPublisherName.empty()) {
-            finalPublisherName = repoInfo.owner;
-            std::wcout << L"Publisher name will be inferred from repository owner: " << finalPublisherName << std::endl;
-        }
-        
-        // Start the download
-        auto downloadTask = downloader.DownloadModelAsync(
-            options.inputPath,
-            downloadFolder,
-            DownloadProgressCallback
-        );
-        
-        // Wait for the download to complete
-        downloadTask.get();
-        
-        std::wcout << std::endl << L"Download completed successfully!" << std::endl;
-        std::wcout << L"Downloaded files are in: " << downloadFolder.wstring() << std::endl;
-        
-        // Find the actual model folder inside the download folder
-        fs::path modelFolder = FindModelFolder(downloadFolder, repoInfo.name);
-        std::wcout << L"Using model folder: " << modelFolder.wstring() << std::endl;
-        
-        // Now package the downloaded files
-        MsixPackager packager;
-        
-        bool success = packager.CreateMsixPackage(
-            modelFolder, 
-            options.outputPath,
-            finalPackageName,
-            finalPublisherName
-        );
-        
-        if (!success) {
-            std::wcerr << L"Error: Failed to create MSIX package" << std::endl;
-            return 1;
-        }
+    if (!options.tracePath.empty()) {
+        TraceRecorder::Instance().WriteChromeTrace(options.tracePath, CreateConsoleLogger(options.verbose));
+    }
+}
+
+// Execute the Package, DownloadAndPackage, Update, Diff and ApplyDelta commands
+int ExecutePackagingCommand(const CommandLineOptions& options)
+{
+    PackagingPipeline pipeline;
+    PackagingContext context;
+    context.logger = CreateConsoleLogger(options.verbose);
+    
+    // Transfers only bump the tracker's counters; the sampler renders them ten times a second
+    ProgressTracker progressTracker;
+    ProgressSampler progressSampler(progressTracker, RenderConsoleProgress);
+    context.progressTracker = &progressTracker;
+    
+    // Downloads go to a workspace of their own under the jobs root, where runs that crashed left theirs
+    fs::path workspaceRoot = JobWorkspace::DefaultRoot();
+    if (options.command == CommandLineOptions::Command::DownloadAndPackage) {
+        WorkspaceCleaner::Instance().ReclaimAbandoned(workspaceRoot, context.logger);
+    }
+    
+    RunReport report(CommandName(options.command), options.inputPath);
+    PackagingResult result = RunPackagingCommand(options, pipeline, workspaceRoot, context);
+    
+    if (!options.reportPath.empty()) {
+        report.Write(options.reportPath, result, context.logger);
+    }
+    
+    WriteTraceIfRequested(options);
+    
+    // Exiting doesn't wait for the download to be deleted
+    WorkspaceCleaner::Instance().Detach();
+    return result.success ? 0 : 1;
+}
+
+// Execute the Compare command
+int ExecuteCompareCommand(const CommandLineOptions& options)
+{
+    Logger logger = CreateConsoleLogger(options.verbose);
+    fs::path oldPackagePath(options.inputPath);
+    
+    PackageComparer comparer(logger);
+    PackageComparison comparison;
+    bool success = comparer.Compare(oldPackagePath, options.targetPath, comparison);
+    
+    if (success) {
+        logger.Info() << L"Comparing " << oldPackagePath.wstring() << L" with " << options.targetPath.wstring();
         
-        // If signing is requested, sign the package
-        if (options.shouldSign) {
-            fs::path msixPath;
-            
-            // Determine the MSIX file path
-            if (fs::is_directory(options.outputPath) || !options.outputPath.has_extension()) {
-                // The file will be in the output directory with a name based on publisher and package
-                std::wstring cleanPackageName = packager.CleanNameForPackage(finalPackageName);
-                std::wstring cleanPublisherName = packager.CleanNameForPackage(finalPublisherName);
-                std::wstring msixFilename = cleanPublisherName + L"_" + cleanPackageName + L".msix";
-                msixPath = options.outputPath / msixFilename;
+        for (const auto& file : comparison.files) {
+            if (file.change == FileChange::Identical) {
+                logger.Verbose() << L"  identical  " << file.name;
             }
-            else {
-                // The file is already specified with full path
-                msixPath = options.outputPath;
+            else if (file.change == FileChange::Changed) {
+                logger.Info() << L"  changed    " << file.name << L" (" << file.changedBlocks << L" blocks, "
+                    << file.changedBytes << L" of " << file.newSize << L" bytes)";
             }
-            
-            std::wcout << L"Signing MSIX package: " << msixPath.wstring() << std::endl;
-            
-            bool signSuccess = packager.SignMsixPackage(
-                msixPath,
-                options.certPath,
-                options.certPassword
-            );
-            
-            if (!signSuccess) {
-                std::wcerr << L"Error: Failed to sign MSIX package" << std::endl;
-                return 1;
+            else {
+                logger.Info() << (file.change == FileChange::Added ? L"  added      " : L"  removed    ")
+                    << file.name << L" (" << file.changedBytes << L" bytes)";
             }
-            
-            std::wcout << L"MSIX package signed successfully" << std::endl;
         }
         
-        // Clean up the temporary download folder
-        if (!options.verbose) {
-            std::wcout << L"Cleaning up temporary download folder..." << std::endl;
-            fs::remove_all(downloadFolder);
-        }
-        else {
-            std::wcout << L"Temporary download folder preserved at: " << downloadFolder.wstring() << std::endl;
-        }
+        logger.Info() << comparison.identicalFiles << L" identical, " << comparison.changedFiles << L" changed, "
+            << comparison.addedFiles << L" added, " << comparison.removedFiles << L" removed; "
+            << comparison.changedBytes << L" bytes changed (" << comparison.elapsedSeconds * 1000 << L" ms)";
         
-        return 0;
+        if (!options.outputPath.empty()) {
+            std::string json = PackageComparer::ToJson(oldPackagePath, options.targetPath, comparison);
+            std::ofstream file(options.outputPath, std::ios::binary | std::ios::trunc);
+            file.write(json.data(), static_cast<std::streamsize>(json.size()));
+            file.close();
+            
+            if (!file) {
+                logger.Error() << L"Failed to write comparison: " << options.outputPath.wstring();
+                success = false;
+            }
+        }
     }
-    catch (const winrt::hresult_error& ex) {
-        std::wcerr << L"Error: " << ex.message().c_str() << std::endl;
-        return 1;
+    
+    WriteTraceIfRequested(options);
+    return success ? 0 : 1;
+}
+
+// Execute the Verify and Unpack commands
+int ExecuteVerifyCommand(const CommandLineOptions& options)
+{
+    Logger logger = CreateConsoleLogger(options.verbose);
+    fs::path packagePath(options.inputPath);
+    bool unpack = options.command == CommandLineOptions::Command::Unpack;
+    
+    PackageExtractor extractor(logger);
+    PackageExtractStats stats;
+    
+    logger.Info() << (unpack ? L"Unpacking " : L"Verifying ") << packagePath.wstring();
+    bool success = unpack ? extractor.Unpack(packagePath, options.outputPath, &stats) : extractor.Verify(packagePath, &stats);
+    
+    double megabytes = stats.bytes / (1024.0 * 1024.0);
+    logger.Info() << stats.entries << L" entries, " << stats.blocks << L" blocks, " << megabytes << L" MB checked in "
+        << stats.elapsedSeconds << L" s (" << (stats.elapsedSeconds > 0 ? megabytes / stats.elapsedSeconds : 0) << L" MB/s)";
+    
+    if (unpack) {
+        logger.Info() << stats.unpackedFiles << L" files written to " << options.outputPath.wstring()
+            << L" (" << stats.sparseBytes / (1024 * 1024) << L" MB of zero blocks left sparse)";
     }
-    catch (const std::exception& ex) {
-        std::cerr << "Error: " << ex.what() << std::endl;
-        return 1;
+    
+    if (success) {
+        logger.Info() << L"Package is intact";
+    }
+    else if (stats.failedEntries > 0) {
+        logger.Error() << stats.failedEntries << L" of " << stats.entries << L" entries are damaged";
+    }
+    
+    WriteTraceIfRequested(options);
+    return success ? 0 : 1;
+}
+
+// Server instance that the console control handler shuts down
+static PackagingServer* g_server = nullptr;
+
+BOOL WINAPI ServeConsoleCtrlHandler(DWORD ctrlType)
+{
+    if (g_server && (ctrlType == CTRL_C_EVENT || ctrlType == CTRL_BREAK_EVENT || ctrlType == CTRL_CLOSE_EVENT)) {
+        // Through the console writer, so the message doesn't block on the console or cut into its output
+        CreateConsoleLogger(false).Info() << L"Stopping server...";
+        g_server->Stop();
+        return TRUE;
     }
+    
+    return FALSE;
+}
+
+// Execute the Serve command
+int ExecuteServeCommand(const CommandLineOptions& options)
+{
+    // Each job downloads into a workspace of its own, deleted in the background after the job
+    fs::path workspaceRoot = JobWorkspace::DefaultRoot();
+    Logger logger = CreateConsoleLogger(options.verbose);
+    WorkspaceCleaner::Instance().ReclaimAbandoned(workspaceRoot, logger);
+    
+    // Jobs run on the workers' long-lived pipelines, so HTTP connections and
+    // cached listings carry over from one job to the next
+    PackagingServer server(
+        options.servePort,
+        options.serveWorkers,
+        options.serveQueueCapacity,
+        [workspaceRoot](const CommandLineOptions& jobOptions, ServerWorkerContext& worker, const PackagingContext& context) {
+            return RunPackagingCommand(jobOptions, worker.pipeline, workspaceRoot, context).success ? 0 : 1;
+        },
+        logger);
+    
+    g_server = &server;
+    SetConsoleCtrlHandler(ServeConsoleCtrlHandler, TRUE);
+    
+    bool success = server.Run();
+    
+    SetConsoleCtrlHandler(ServeConsoleCtrlHandler, FALSE);
+    g_server = nullptr;
+    
+    // The trace covers every job the server ran
+    WriteTraceIfRequested(options);
+    
+    WorkspaceCleaner::Instance().Detach();
+    return success ? 0 : 1;
 }
 
 int wmain(int argc, wchar_t* argv[])
@@ -249,16 +461,50 @@ int wmain(int argc, wchar_t* argv[])
         // Initialize WinRT
         winrt::init_apartment();
         
+        // Console output happens on the writer's thread; it is flushed when the writer goes out of scope
+        g_virtualTerminal = EnableVirtualTerminal();
+        AsyncLogWriter consoleWriter(WriteConsoleMessage, FinishConsoleBatch);
+        g_consoleWriter = &consoleWriter;
+        
         // Parse command-line arguments
         CommandLineOptions options = CommandLineParser::Parse(argc, argv);
         
+        // Start recording spans before any work begins; the run report is built from them too
+        if (!options.tracePath.empty() || !options.reportPath.empty()) {
+            TraceRecorder::Instance().Enable();
+        }
+        
+        // One limit covers every download in the process, the jobs of /serve included
+        BandwidthLimiter::Instance().SetLimit(options.maxBandwidth);
+        
+        // Likewise the way downloaded files are written
+        DownloadWriteMode writeMode = DownloadWriteMode::WriteBehind;
+        DownloadSink::ParseMode(options.writeMode, writeMode);
+        DownloadSink::SetDefaultMode(writeMode);
+        
+        // And the engine packages are read and written with
+        IoBackend ioBackend = IoBackend::Auto;
+        FileIoEngine::ParseBackend(options.ioEngine, ioBackend);
+        FileIoEngine::SetDefaultBackend(ioBackend);
+        
         // Execute the appropriate command
         switch (options.command) {
             case CommandLineOptions::Command::Package:
-                return ExecutePackageCommand(options);
-                
             case CommandLineOptions::Command::DownloadAndPackage:
-                return ExecuteDownloadAndPackageCommand(options);
+            case CommandLineOptions::Command::Update:
+            case CommandLineOptions::Command::Diff:
+            case CommandLineOptions::Command::ApplyDelta:
+                return ExecutePackagingCommand(options);
+                
+            case CommandLineOptions::Command::Compare:
+                return ExecuteCompareCommand(options);
+                
+            case CommandLineOptions::Command::Verify:
+            case CommandLineOptions::Command::Unpack:
+                return ExecuteVerifyCommand(options);
+                
+            case CommandLineOptions::Command::Serve:
+                return ExecuteServeCommand(options);
                 
             case CommandLineOptions::Command::ShowHelp:
             default:
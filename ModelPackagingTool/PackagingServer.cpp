@@ -0,0 +1,560 @@
+// Winsock must be included before anything that pulls in Windows.h
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include "PackagingServer.h"
+#include "JsonUtils.h"
+#include <sstream>
+#include <regex>
+#include <chrono>
+#include <winrt/base.h>
+
+namespace {
+    // Limits that keep a misbehaving client from tying up the server: a request must arrive in full
+    // within RequestTimeout, and at most MaxConnectionHandlers requests are read at a time
+    constexpr size_t MaxHeaderBytes = 16 * 1024;
+    constexpr size_t MaxBodyBytes = 64 * 1024;
+    constexpr auto RequestTimeout = std::chrono::seconds(10);
+    constexpr int MaxConnectionHandlers = 32;
+
+    // Minimum time between progress events for the same file
+    constexpr auto ProgressEventInterval = std::chrono::milliseconds(250);
+}
+
+PackagingServer::PackagingServer(
+    uint16_t port,
+    int workerCount,
+    size_t queueCapacity,
+    JobHandler jobHandler,
+    Logger logger)
+    : m_port(port),
+      m_queueCapacity(queueCapacity),
+      m_jobHandler(std::move(jobHandler)),
+      m_logger(std::move(logger)),
+      m_listenSocket(INVALID_SOCKET),
+      m_stopRequested(false),
+      m_nextJobId(1),
+      m_completedJobs(0),
+      m_busyWorkers(0)
+{
+    // Each worker keeps its own pipeline (and HTTP connection pool) for its lifetime; every job gets
+    // a workspace of its own
+    for (int i = 0; i < workerCount; i++) {
+        auto context = std::make_unique<ServerWorkerContext>();
+        context->index = i;
+        m_workerContexts.push_back(std::move(context));
+    }
+}
+
+PackagingServer::~PackagingServer()
+{
+    Stop();
+
+    for (auto& worker : m_workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+bool PackagingServer::Run()
+{
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        m_logger.Error() << L"Failed to initialize Winsock";
+        return false;
+    }
+
+    SOCKET listenSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (listenSocket == INVALID_SOCKET) {
+        m_logger.Error() << L"Failed to create listening socket, error code: " << WSAGetLastError();
+        WSACleanup();
+        return false;
+    }
+
+    // Only listen on the loopback interface; the server is meant for local callers
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(m_port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if (bind(listenSocket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == SOCKET_ERROR ||
+        listen(listenSocket, SOMAXCONN) == SOCKET_ERROR) {
+        m_logger.Error() << L"Failed to listen on port " << m_port << L", error code: " << WSAGetLastError();
+        closesocket(listenSocket);
+        WSACleanup();
+        return false;
+    }
+
+    m_listenSocket = listenSocket;
+
+    // Start the workers
+    for (auto& context : m_workerContexts) {
+        m_workers.emplace_back([this, workerContext = context.get()]() {
+            WorkerLoop(*workerContext);
+        });
+    }
+
+    m_logger.Info() << L"Listening on http://127.0.0.1:" << m_port << L" with " << m_workerContexts.size()
+                    << L" worker(s) and a queue of " << m_queueCapacity << L" job(s)";
+    m_logger.Info() << L"Press Ctrl+C to stop the server";
+
+    AcceptLoop();
+
+    // Wait for the requests being read, then for the running jobs to finish
+    {
+        std::unique_lock<std::mutex> lock(m_connectionMutex);
+        m_connectionsDone.wait(lock, [this]() { return m_activeConnections == 0; });
+    }
+
+    for (auto& worker : m_workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+
+    WSACleanup();
+    m_logger.Info() << L"Server stopped after " << m_completedJobs.load() << L" job(s)";
+    return true;
+}
+
+void PackagingServer::Stop()
+{
+    if (m_stopRequested.exchange(true)) {
+        return;
+    }
+
+    // Closing the listening socket unblocks accept()
+    uintptr_t listenSocket = m_listenSocket.exchange(INVALID_SOCKET);
+    if (listenSocket != INVALID_SOCKET) {
+        closesocket(static_cast<SOCKET>(listenSocket));
+    }
+
+    // Reject the jobs that never started
+    std::deque<std::unique_ptr<ServerJob>> pendingJobs;
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        pendingJobs.swap(m_queue);
+    }
+
+    for (auto& job : pendingJobs) {
+        SendEvent(*job, "{\"event\":\"rejected\",\"job\":" + std::to_string(job->id) +
+            ",\"reason\":\"server is shutting down\"}");
+        FinishJob(*job);
+    }
+
+    // Abort the running jobs
+    m_shutdownToken.Cancel();
+
+    m_queueCondition.notify_all();
+}
+
+void PackagingServer::AcceptLoop()
+{
+    while (!m_stopRequested) {
+        SOCKET clientSocket = accept(static_cast<SOCKET>(m_listenSocket.load()), nullptr, nullptr);
+        if (clientSocket == INVALID_SOCKET) {
+            if (m_stopRequested) {
+                break;
+            }
+
+            m_logger.Error() << L"Failed to accept connection, error code: " << WSAGetLastError();
+            continue;
+        }
+
+        // Each request is read on a thread of its own, so a slow client can't hold up the others
+        {
+            std::lock_guard<std::mutex> lock(m_connectionMutex);
+            if (m_activeConnections >= MaxConnectionHandlers) {
+                SendResponse(clientSocket, 503, "Service Unavailable", "{\"error\":\"too many connections\"}", "Retry-After: 1\r\n");
+                continue;
+            }
+            m_activeConnections++;
+        }
+
+        std::thread([this, clientSocket]() {
+            HandleConnection(clientSocket);
+
+            std::lock_guard<std::mutex> lock(m_connectionMutex);
+            m_activeConnections--;
+            m_connectionsDone.notify_all();
+        }).detach();
+    }
+}
+
+void PackagingServer::HandleConnection(uintptr_t clientSocket)
+{
+    SOCKET socket = static_cast<SOCKET>(clientSocket);
+
+    // The whole request must arrive before the deadline, however slowly the client sends it: each
+    // receive waits only for the time that is left
+    auto deadline = std::chrono::steady_clock::now() + RequestTimeout;
+    char buffer[4096];
+    auto receive = [&]() {
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        if (remaining.count() <= 0) {
+            return 0;
+        }
+        DWORD timeout = static_cast<DWORD>(remaining.count());
+        setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+        return recv(socket, buffer, sizeof(buffer), 0);
+    };
+
+    // Read the request headers
+    std::string request;
+    size_t headerEnd = std::string::npos;
+
+    while (headerEnd == std::string::npos) {
+        int received = receive();
+        if (received <= 0) {
+            closesocket(socket);
+            return;
+        }
+
+        request.append(buffer, received);
+        headerEnd = request.find("\r\n\r\n");
+
+        if (headerEnd == std::string::npos && request.size() > MaxHeaderBytes) {
+            SendResponse(clientSocket, 431, "Request Header Fields Too Large", "{\"error\":\"headers too large\"}");
+            return;
+        }
+    }
+
+    // Parse the request line
+    std::istringstream requestLine(request.substr(0, request.find("\r\n")));
+    std::string method;
+    std::string target;
+    requestLine >> method >> target;
+
+    // Read the body if there is one
+    size_t contentLength = 0;
+    std::smatch match;
+    std::string headers = request.substr(0, headerEnd + 2);
+    std::regex contentLengthPattern("\r\ncontent-length:\\s*(\\d+)", std::regex::icase);
+    bool tooLarge = false;
+    if (std::regex_search(headers, match, contentLengthPattern)) {
+        // A value with more digits than the limit is too large without parsing it, so it can't overflow
+        std::string digits = match[1].str();
+        tooLarge = digits.size() > std::to_string(MaxBodyBytes).size();
+        if (!tooLarge) {
+            contentLength = std::stoull(digits);
+        }
+    }
+
+    if (tooLarge || contentLength > MaxBodyBytes) {
+        SendResponse(clientSocket, 413, "Payload Too Large", "{\"error\":\"request body too large\"}");
+        return;
+    }
+
+    std::string body = request.substr(headerEnd + 4);
+    while (body.size() < contentLength) {
+        int received = receive();
+        if (received <= 0) {
+            closesocket(socket);
+            return;
+        }
+        body.append(buffer, received);
+    }
+    body.resize(contentLength);
+
+    // Route the request
+    if (method == "GET" && target == "/status") {
+        SendResponse(clientSocket, 200, "OK", BuildStatusJson());
+        return;
+    }
+
+    if (method != "POST" || target != "/jobs") {
+        SendResponse(clientSocket, 404, "Not Found", "{\"error\":\"unknown endpoint\"}");
+        return;
+    }
+
+    auto job = std::make_unique<ServerJob>();
+    job->id = m_nextJobId++;
+    job->clientSocket = clientSocket;
+
+    std::string error;
+    if (!ParseJobArguments(body, job->options, error)) {
+        SendResponse(clientSocket, 400, "Bad Request", "{\"error\":" + JsonUtils::Quote(error) + "}");
+        return;
+    }
+
+    // Hold the send lock until the response headers and the queued event are written, so that
+    // a worker that picks the job up immediately cannot write its events first. Once the lock is
+    // released the job belongs to the workers, and may already be finished and gone.
+    ServerJob* acceptedJob = job.get();
+    std::unique_lock<std::mutex> sendLock(acceptedJob->sendMutex);
+
+    size_t position = 0;
+    if (!TryEnqueue(job, position)) {
+        sendLock.unlock();
+        SendResponse(clientSocket, 503, "Service Unavailable", "{\"error\":\"job queue is full\"}", "Retry-After: 1\r\n");
+        return;
+    }
+
+    std::string responseHeaders =
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: application/x-ndjson\r\n"
+        "Transfer-Encoding: chunked\r\n"
+        "Cache-Control: no-cache\r\n"
+        "Connection: close\r\n\r\n";
+    if (send(socket, responseHeaders.data(), static_cast<int>(responseHeaders.size()), 0) == SOCKET_ERROR) {
+        acceptedJob->clientGone = true;
+    }
+
+    WriteEvent(*acceptedJob, "{\"event\":\"queued\",\"job\":" + std::to_string(acceptedJob->id) +
+        ",\"position\":" + std::to_string(position) + "}");
+}
+
+bool PackagingServer::ParseJobArguments(const std::string& body, CommandLineOptions& options, std::string& error)
+{
+    // The body holds one command-line argument per line, exactly as it would be passed to the tool
+    std::vector<std::wstring> arguments = { L"ModelPackagingTool" };
+    std::istringstream lines(body);
+    std::string line;
+
+    while (std::getline(lines, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+
+        if (!line.empty()) {
+            arguments.push_back(std::wstring(winrt::to_hstring(line)));
+        }
+    }
+
+    std::vector<wchar_t*> argv;
+    for (auto& argument : arguments) {
+        argv.push_back(argument.data());
+    }
+
+    options = CommandLineParser::Parse(static_cast<int>(argv.size()), argv.data());
+
+    if (options.command != CommandLineOptions::Command::Package &&
+        options.command != CommandLineOptions::Command::DownloadAndPackage &&
+        options.command != CommandLineOptions::Command::Update &&
+        options.command != CommandLineOptions::Command::Diff &&
+        options.command != CommandLineOptions::Command::ApplyDelta) {
+        error = "expected a valid /pack, /downloadAndPack, /update, /diff or /applyDelta command, one argument per line";
+        return false;
+    }
+
+    // Jobs share the server's limit, in proportion to their /weight
+    if (options.maxBandwidth > 0) {
+        error = "/max-bandwidth applies to the whole server; pass it to /serve and use /weight in jobs";
+        return false;
+    }
+
+    if (options.writeMode != L"write-behind") {
+        error = "/write-mode applies to the whole server; pass it to /serve";
+        return false;
+    }
+
+    if (options.ioEngine != L"auto") {
+        error = "/io-engine applies to the whole server; pass it to /serve";
+        return false;
+    }
+
+    // A job may not point the server's requests at hosts of its choosing
+    if (!options.endpoints.empty()) {
+        error = "/endpoint is not accepted in jobs; set HF_ENDPOINT or GITHUB_RAW_ENDPOINT for the server";
+        return false;
+    }
+
+    return true;
+}
+
+bool PackagingServer::TryEnqueue(std::unique_ptr<ServerJob>& job, size_t& position)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+
+        // Push back on the caller instead of growing the queue without bound
+        if (m_stopRequested || m_queue.size() >= m_queueCapacity) {
+            return false;
+        }
+
+        m_queue.push_back(std::move(job));
+        position = m_queue.size();
+    }
+
+    m_queueCondition.notify_one();
+    return true;
+}
+
+void PackagingServer::WorkerLoop(ServerWorkerContext& context)
+{
+    winrt::init_apartment();
+
+    while (true) {
+        std::unique_ptr<ServerJob> job;
+        {
+            std::unique_lock<std::mutex> lock(m_queueMutex);
+            m_queueCondition.wait(lock, [this]() { return m_stopRequested || !m_queue.empty(); });
+
+            if (m_queue.empty()) {
+                break;
+            }
+
+            job = std::move(m_queue.front());
+            m_queue.pop_front();
+        }
+
+        m_busyWorkers++;
+
+        std::string jobId = std::to_string(job->id);
+        SendEvent(*job, "{\"event\":\"started\",\"job\":" + jobId + ",\"worker\":" + std::to_string(context.index) + "}");
+
+        // Stopping the server cancels the job
+        CancellationRegistration shutdownRegistration(m_shutdownToken, [&job]() {
+            job->cancellation.Cancel();
+        });
+
+        PackagingContext jobContext;
+        jobContext.cancellation = job->cancellation;
+
+        // Forward the pipeline's messages to the client
+        bool verbose = job->options.verbose;
+        jobContext.logger = Logger([&, verbose](LogLevel level, const std::wstring& message) {
+            static const char* levelNames[] = { "error", "warning", "info", "verbose" };
+            if (level == LogLevel::Verbose && !verbose) {
+                return;
+            }
+
+            std::string eventJson = "{\"event\":\"log\",\"job\":" + jobId +
+                ",\"level\":\"" + levelNames[static_cast<int>(level)] + "\"" +
+                ",\"message\":" + JsonUtils::Quote(message) + "}";
+
+            if (!SendEvent(*job, eventJson)) {
+                job->cancellation.Cancel();
+            }
+        });
+
+        // Forward download progress, rate limited per file
+        std::wstring lastFileName;
+        auto lastEventTime = std::chrono::steady_clock::time_point();
+
+        jobContext.progress = [&](const std::wstring& fileName, uint64_t bytesReceived, uint64_t totalBytes) {
+            auto now = std::chrono::steady_clock::now();
+            bool fileComplete = totalBytes > 0 && bytesReceived >= totalBytes;
+
+            if (!fileComplete && fileName == lastFileName && now - lastEventTime < ProgressEventInterval) {
+                return;
+            }
+
+            lastFileName = fileName;
+            lastEventTime = now;
+
+            std::string eventJson = "{\"event\":\"progress\",\"job\":" + jobId +
+                ",\"file\":" + JsonUtils::Quote(fileName) +
+                ",\"bytesReceived\":" + std::to_string(bytesReceived) +
+                ",\"totalBytes\":" + std::to_string(totalBytes) + "}";
+
+            // Nobody is waiting for the result any more, so stop the job
+            if (!SendEvent(*job, eventJson)) {
+                job->cancellation.Cancel();
+            }
+        };
+
+        int exitCode = 1;
+        std::string errorMessage;
+
+        try {
+            exitCode = m_jobHandler(job->options, context, jobContext);
+        }
+        catch (const winrt::hresult_error& ex) {
+            errorMessage = winrt::to_string(ex.message());
+        }
+        catch (const std::exception& ex) {
+            errorMessage = ex.what();
+        }
+
+        std::string completedEvent = "{\"event\":\"completed\",\"job\":" + jobId + ",\"exitCode\":" + std::to_string(exitCode);
+        if (!errorMessage.empty()) {
+            completedEvent += ",\"error\":" + JsonUtils::Quote(errorMessage);
+        }
+        completedEvent += "}";
+
+        SendEvent(*job, completedEvent);
+        FinishJob(*job);
+
+        m_busyWorkers--;
+        m_completedJobs++;
+    }
+
+    winrt::uninit_apartment();
+}
+
+void PackagingServer::SendResponse(uintptr_t clientSocket, int statusCode, const std::string& statusText,
+    const std::string& body, const std::string& extraHeaders)
+{
+    SOCKET socket = static_cast<SOCKET>(clientSocket);
+
+    std::string response = "HTTP/1.1 " + std::to_string(statusCode) + " " + statusText + "\r\n" +
+        "Content-Type: application/json\r\n" +
+        "Content-Length: " + std::to_string(body.size()) + "\r\n" +
+        extraHeaders +
+        "Connection: close\r\n\r\n" +
+        body;
+
+    send(socket, response.data(), static_cast<int>(response.size()), 0);
+    shutdown(socket, SD_SEND);
+    closesocket(socket);
+}
+
+bool PackagingServer::SendEvent(ServerJob& job, const std::string& eventJson)
+{
+    if (job.clientGone) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(job.sendMutex);
+    return WriteEvent(job, eventJson);
+}
+
+bool PackagingServer::WriteEvent(ServerJob& job, const std::string& eventJson)
+{
+    if (job.clientGone) {
+        return false;
+    }
+
+    // Each event is one line of NDJSON in its own HTTP chunk
+    std::string line = eventJson + "\n";
+    std::ostringstream chunk;
+    chunk << std::hex << line.size() << "\r\n" << line << "\r\n";
+    std::string data = chunk.str();
+
+    if (send(static_cast<SOCKET>(job.clientSocket), data.data(), static_cast<int>(data.size()), 0) == SOCKET_ERROR) {
+        job.clientGone = true;
+        return false;
+    }
+
+    return true;
+}
+
+void PackagingServer::FinishJob(ServerJob& job)
+{
+    std::lock_guard<std::mutex> lock(job.sendMutex);
+    SOCKET socket = static_cast<SOCKET>(job.clientSocket);
+
+    if (!job.clientGone) {
+        const char terminator[] = "0\r\n\r\n";
+        send(socket, terminator, static_cast<int>(sizeof(terminator) - 1), 0);
+    }
+
+    shutdown(socket, SD_SEND);
+    closesocket(socket);
+}
+
+std::string PackagingServer::BuildStatusJson()
+{
+    size_t queued = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        queued = m_queue.size();
+    }
+
+    return "{\"workers\":" + std::to_string(m_workerContexts.size()) +
+        ",\"busyWorkers\":" + std::to_string(m_busyWorkers.load()) +
+        ",\"queuedJobs\":" + std::to_string(queued) +
+        ",\"queueCapacity\":" + std::to_string(m_queueCapacity) +
+        ",\"completedJobs\":" + std::to_string(m_completedJobs.load()) + "}";
+}
\ No newline at end of file
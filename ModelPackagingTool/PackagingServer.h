@@ -0,0 +1,114 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <functional>
+#include <condition_variable>
+#include <filesystem>
+#include "CommandLineParser.h"
+#include "PackagingPipeline.h"
+
+namespace fs = std::filesystem;
+
+// State owned by a server worker and reused across jobs (HTTP connection pool)
+struct ServerWorkerContext
+{
+    int index = 0;
+    PackagingPipeline pipeline;
+};
+
+// A job that has been accepted by the server and is waiting for, or running on, a worker
+struct ServerJob
+{
+    uint64_t id = 0;
+    CommandLineOptions options;
+    uintptr_t clientSocket = 0;
+    std::mutex sendMutex;
+    std::atomic<bool> clientGone = false;
+    CancellationToken cancellation;
+};
+
+class PackagingServer
+{
+public:
+    // Runs a single job on a worker and returns the process-style exit code
+    using JobHandler = std::function<int(
+        const CommandLineOptions& options,
+        ServerWorkerContext& worker,
+        const PackagingContext& context)>;
+
+    PackagingServer(
+        uint16_t port,
+        int workerCount,
+        size_t queueCapacity,
+        JobHandler jobHandler,
+        Logger logger = Logger());
+    ~PackagingServer();
+
+    // Listen on the loopback interface and serve jobs until Stop() is called
+    bool Run();
+
+    // Stop accepting connections, cancel running jobs and wait for the workers
+    void Stop();
+
+private:
+    // Accept connections and read each request on a thread of its own
+    void AcceptLoop();
+
+    // Take jobs from the queue and run them
+    void WorkerLoop(ServerWorkerContext& context);
+
+    // Read and route a single HTTP request
+    void HandleConnection(uintptr_t clientSocket);
+
+    // Parse the newline-separated argument list of a job submission
+    bool ParseJobArguments(const std::string& body, CommandLineOptions& options, std::string& error);
+
+    // Queue a job, returning false if the queue is full
+    bool TryEnqueue(std::unique_ptr<ServerJob>& job, size_t& position);
+
+    // Write a complete (non-streamed) HTTP response and close the connection
+    void SendResponse(uintptr_t clientSocket, int statusCode, const std::string& statusText,
+        const std::string& body, const std::string& extraHeaders = "");
+
+    // Write one NDJSON event to a streamed job response
+    bool SendEvent(ServerJob& job, const std::string& eventJson);
+
+    // SendEvent for a caller that already holds the job's send lock
+    bool WriteEvent(ServerJob& job, const std::string& eventJson);
+
+    // Terminate a streamed job response and close the connection
+    void FinishJob(ServerJob& job);
+
+    // Build the JSON body for GET /status
+    std::string BuildStatusJson();
+
+    uint16_t m_port;
+    size_t m_queueCapacity;
+    JobHandler m_jobHandler;
+    Logger m_logger;
+
+    std::atomic<uintptr_t> m_listenSocket;
+    std::atomic<bool> m_stopRequested;
+    std::atomic<uint64_t> m_nextJobId;
+    std::atomic<uint64_t> m_completedJobs;
+    std::atomic<int> m_busyWorkers;
+    CancellationToken m_shutdownToken;
+
+    std::mutex m_queueMutex;
+    std::condition_variable m_queueCondition;
+    std::deque<std::unique_ptr<ServerJob>> m_queue;
+
+    // Requests being read, which Run() waits for before it returns
+    std::mutex m_connectionMutex;
+    std::condition_variable m_connectionsDone;
+    int m_activeConnections = 0;
+
+    std::vector<std::unique_ptr<ServerWorkerContext>> m_workerContexts;
+    std::vector<std::thread> m_workers;
+};
\ No newline at end of file
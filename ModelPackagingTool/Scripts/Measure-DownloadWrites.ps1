@@ -0,0 +1,291 @@
+# Measure-DownloadWrites.ps1
+# Benchmarks the ways /downloadAndPack writes downloaded files against a fast local server
+#
+# Usage:
+#   .\Measure-DownloadWrites.ps1 -ToolPath "C:\path\to\ModelPackagingTool.exe" [-WorkFolder "C:\Temp\WriteBench"] [-FileCount 4] [-FileSizeMB 1024]
+#
+# Parameters:
+#   -ToolPath:     Path to ModelPackagingTool.exe
+#   -WorkFolder:   Folder for the packages and run reports (default is .\WriteBenchmark; it is deleted first)
+#   -Port:         Port the stand-in server listens on
+#   -FileCount:    Number of weight files in the stand-in repository, besides a config and a tokenizer
+#   -FileSizeMB:   Size of each weight file in MB
+#   -Modes:        /write-mode values to compare; inline is the plain loop that writes each chunk as it arrives
+#   -Repeats:      Runs per mode; the table shows the median
+#
+# The stand-in serves the hub's listing and file URLs on 127.0.0.1 from memory, as fast as the
+# loopback connection allows, so the disk rather than the network sets the pace. Each run downloads
+# the whole repository with /write-mode set to one of the modes and takes the download phase time
+# and throughput from the /report file. The extent count of the first weight file, from fsutil,
+# shows how the file was laid out on disk. Files are checked byte for byte after every run.
+
+param(
+    [Parameter(Mandatory=$true)]
+    [string]$ToolPath,
+    
+    [Parameter(Mandatory=$false)]
+    [string]$WorkFolder = (Join-Path -Path (Get-Location) -ChildPath "WriteBenchmark"),
+    
+    [Parameter(Mandatory=$false)]
+    [int]$Port = 8091,
+    
+    [Parameter(Mandatory=$false)]
+    [int]$FileCount = 4,
+    
+    [Parameter(Mandatory=$false)]
+    [int]$FileSizeMB = 1024,
+    
+    [Parameter(Mandatory=$false)]
+    [string[]]$Modes = @("inline", "write-behind", "unbuffered"),
+    
+    [Parameter(Mandatory=$false)]
+    [int]$Repeats = 3
+)
+
+$ErrorActionPreference = "Stop"
+
+# The stand-in server, without limits or failures
+Add-Type -Language CSharp -TypeDefinition @'
+using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Linq;
+using System.Net;
+using System.Security.Cryptography;
+using System.Text;
+using System.Threading;
+
+public class FileServer : IDisposable
+{
+    readonly HttpListener listener = new HttpListener();
+    readonly Dictionary<string, long> files;
+    readonly string listing;
+    readonly string commit;
+    
+    public FileServer(int port, Dictionary<string, long> files)
+    {
+        this.files = files;
+        listing = "[" + string.Join(",", files.Select(file =>
+            "{\"type\":\"file\",\"oid\":\"0\",\"size\":" + file.Value + ",\"path\":\"" + file.Key + "\"}")) + "]";
+        using (var sha1 = SHA1.Create()) {
+            commit = BitConverter.ToString(sha1.ComputeHash(Encoding.UTF8.GetBytes(listing))).Replace("-", "").ToLowerInvariant();
+        }
+        listener.Prefixes.Add("http://127.0.0.1:" + port + "/");
+    }
+    
+    public void Start()
+    {
+        listener.Start();
+        new Thread(Listen) { IsBackground = true }.Start();
+    }
+    
+    public void Dispose()
+    {
+        listener.Close();
+    }
+    
+    // The contents of a file: a 64 KB pattern that depends on the name, repeated
+    public static byte[] Pattern(string name)
+    {
+        byte[] pattern = new byte[65536];
+        for (int i = 0; i < pattern.Length; i++) {
+            pattern[i] = (byte)(i * 31 + name.Length);
+        }
+        return pattern;
+    }
+    
+    public static bool Matches(string path, string name)
+    {
+        byte[] pattern = Pattern(name);
+        byte[] block = new byte[pattern.Length];
+        long position = 0;
+        using (FileStream stream = File.OpenRead(path)) {
+            int read;
+            while ((read = stream.Read(block, 0, block.Length)) > 0) {
+                for (int i = 0; i < read; i++) {
+                    if (block[i] != pattern[(position + i) % pattern.Length]) {
+                        return false;
+                    }
+                }
+                position += read;
+            }
+        }
+        return true;
+    }
+    
+    void Listen()
+    {
+        while (true) {
+            HttpListenerContext context;
+            try {
+                context = listener.GetContext();
+            }
+            catch (Exception) {
+                return;
+            }
+            ThreadPool.QueueUserWorkItem(_ => Handle(context));
+        }
+    }
+    
+    void Handle(HttpListenerContext context)
+    {
+        string path = Uri.UnescapeDataString(context.Request.Url.AbsolutePath);
+        try {
+            byte[] body = null;
+            if (path.StartsWith("/api/models/") && path.Contains("/revision/")) {
+                body = Encoding.UTF8.GetBytes("{\"id\":\"standin/model\",\"sha\":\"" + commit + "\"}");
+            }
+            else if (path.StartsWith("/api/models/")) {
+                body = Encoding.UTF8.GetBytes(listing);
+            }
+            else if (path.Contains("/resolve/")) {
+                ServeFile(context, path.Substring(path.LastIndexOf('/') + 1));
+                return;
+            }
+            else {
+                context.Response.StatusCode = 404;
+                return;
+            }
+            
+            context.Response.ContentType = "application/json";
+            context.Response.ContentLength64 = body.Length;
+            context.Response.OutputStream.Write(body, 0, body.Length);
+        }
+        catch (Exception) {
+            // The client went away
+        }
+        finally {
+            try { context.Response.Close(); } catch (Exception) { }
+        }
+    }
+    
+    void ServeFile(HttpListenerContext context, string name)
+    {
+        long size;
+        if (!files.TryGetValue(name, out size)) {
+            context.Response.StatusCode = 404;
+            return;
+        }
+        
+        context.Response.ContentLength64 = size;
+        if (context.Request.HttpMethod == "HEAD") {
+            return;
+        }
+        
+        byte[] buffer = Pattern(name);
+        long position = 0;
+        while (position < size) {
+            int chunk = (int)Math.Min(buffer.Length, size - position);
+            context.Response.OutputStream.Write(buffer, 0, chunk);
+            position += chunk;
+        }
+    }
+}
+'@
+
+# Extents of a file on disk, or $null when fsutil can't tell
+function Get-ExtentCount {
+    param([string]$Path)
+    
+    try {
+        $lines = & fsutil file queryextents $Path 2>$null
+        if ($LASTEXITCODE -ne 0) {
+            return $null
+        }
+        return @($lines | Where-Object { $_ -match "^VCN" }).Count
+    }
+    catch {
+        return $null
+    }
+}
+
+$files = New-Object 'System.Collections.Generic.Dictionary[string,long]'
+$files["config.json"] = 700
+$files["tokenizer.json"] = 2MB
+for ($i = 0; $i -lt $FileCount; $i++) {
+    $files["model-$i.onnx.data"] = [long]$FileSizeMB * 1MB
+}
+$totalBytes = ($files.Values | Measure-Object -Sum).Sum
+
+Write-Host "Download Write Benchmark" -ForegroundColor Cyan
+Write-Host "------------------------" -ForegroundColor Cyan
+Write-Host ("Repository: {0} files, {1:N0} MB" -f $files.Count, ($totalBytes / 1MB))
+Write-Host "Modes: $($Modes -join ', '), $Repeats runs each"
+
+if (Test-Path $WorkFolder) {
+    Remove-Item -Path $WorkFolder -Recurse -Force
+}
+New-Item -ItemType Directory -Path $WorkFolder | Out-Null
+
+$downloadFolder = Join-Path ([System.IO.Path]::GetTempPath()) "ModelPackagingTool_Download\model"
+$server = New-Object FileServer($Port, $files)
+$server.Start()
+$env:HF_ENDPOINT = "http://127.0.0.1:$Port"
+
+$results = @()
+$failed = $false
+
+try {
+    foreach ($mode in $Modes) {
+        $runs = @()
+        for ($run = 1; $run -le $Repeats; $run++) {
+            Write-Host "$mode, run $run..." -ForegroundColor Yellow
+            
+            $outputFolder = Join-Path $WorkFolder "$mode-$run"
+            $reportPath = Join-Path $WorkFolder "$mode-$run.json"
+            New-Item -ItemType Directory -Path $outputFolder | Out-Null
+            
+            # /verbose keeps the downloaded files for the checks
+            & $ToolPath /downloadAndPack "https://huggingface.co/standin/model" /o $outputFolder /write-mode $mode /report $reportPath /verbose | Out-Null
+            if ($LASTEXITCODE -ne 0) {
+                Write-Host "The run failed with exit code $LASTEXITCODE" -ForegroundColor Red
+                $failed = $true
+                continue
+            }
+            
+            foreach ($file in $files.GetEnumerator()) {
+                $path = Join-Path $downloadFolder $file.Key
+                if (-not (Test-Path $path) -or (Get-Item $path).Length -ne $file.Value -or -not [FileServer]::Matches($path, $file.Key)) {
+                    Write-Host "Missing or wrong: $($file.Key)" -ForegroundColor Red
+                    $failed = $true
+                }
+            }
+            
+            $report = Get-Content -Path $reportPath -Raw | ConvertFrom-Json
+            $download = $report.phases | Where-Object { $_.name -eq "download" }
+            $runs += [PSCustomObject]@{
+                Seconds = $download.seconds
+                MBps    = $download.MBps
+                Peak    = $report.peakDownloadMBps
+                Extents = Get-ExtentCount (Join-Path $downloadFolder "model-0.onnx.data")
+            }
+            
+            # The package isn't measured; don't let the runs fill the disk
+            Remove-Item -Path $outputFolder -Recurse -Force
+        }
+        
+        if ($runs.Count -eq 0) {
+            continue
+        }
+        
+        $median = $runs | Sort-Object Seconds | Select-Object -Index ([Math]::Floor(($runs.Count - 1) / 2))
+        $results += [PSCustomObject]@{
+            "Mode"        = $mode
+            "Seconds"     = [Math]::Round($median.Seconds, 2)
+            "MB/s"        = [Math]::Round($median.MBps, 1)
+            "Peak MB/s"   = [Math]::Round($median.Peak, 1)
+            "Extents"     = $(if ($median.Extents -ne $null) { $median.Extents } else { "n/a" })
+        }
+    }
+}
+finally {
+    $server.Dispose()
+    Remove-Item Env:\HF_ENDPOINT -ErrorAction SilentlyContinue
+}
+
+$results | Format-Table -AutoSize
+
+if ($failed) {
+    Write-Host "Some runs failed or downloaded wrong files" -ForegroundColor Red
+    exit 1
+}
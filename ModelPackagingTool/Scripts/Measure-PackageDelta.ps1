@@ -0,0 +1,165 @@
+# Measure-PackageDelta.ps1
+# Benchmarks block-level package deltas on synthetic model weights
+#
+# Usage:
+#   .\Measure-PackageDelta.ps1 -ToolPath "C:\path\to\ModelPackagingTool.exe" [-WorkFolder "C:\Temp\DeltaBench"] [-FileCount 2] [-FileSizeMB 256] [-ChangeRates 0,1,5,25,100]
+#
+# Parameters:
+#   -ToolPath:     Path to ModelPackagingTool.exe
+#   -WorkFolder:   Folder for the generated weights and packages (default is .\DeltaBenchmark; it is deleted first)
+#   -FileCount:    Number of weight files in the model
+#   -FileSizeMB:   Size of each weight file in MB
+#   -ChangeRates:  Percentages of 64 KB blocks to change for each new version
+#   -Seed:         Random seed, so runs with the same parameters use the same data
+#
+# For every change rate the script copies the base model, overwrites that share of randomly chosen
+# blocks in each weight file, and then times a full /pack of the new version, /diff against the
+# base package and /applyDelta. It reports the delta size and checks that the rebuilt package is
+# identical to the fully built one. The weights are random bytes, so they barely compress; the
+# delta sizes are therefore close to the worst case for a given change rate.
+
+param(
+    [Parameter(Mandatory=$true)]
+    [string]$ToolPath,
+    
+    [Parameter(Mandatory=$false)]
+    [string]$WorkFolder = (Join-Path -Path (Get-Location) -ChildPath "DeltaBenchmark"),
+    
+    [Parameter(Mandatory=$false)]
+    [int]$FileCount = 2,
+    
+    [Parameter(Mandatory=$false)]
+    [int]$FileSizeMB = 256,
+    
+    [Parameter(Mandatory=$false)]
+    [double[]]$ChangeRates = @(0, 1, 5, 25, 100),
+    
+    [Parameter(Mandatory=$false)]
+    [int]$Seed = 1234
+)
+
+$ErrorActionPreference = "Stop"
+$blockSize = 65536
+$random = [System.Random]::new($Seed)
+
+# Run the tool and return the elapsed seconds, stopping on failure
+function Invoke-Tool {
+    param([string[]]$Arguments)
+    
+    $elapsed = Measure-Command { & $ToolPath @Arguments | Out-Null }
+    if ($LASTEXITCODE -ne 0) {
+        throw "ModelPackagingTool $($Arguments -join ' ') failed with exit code $LASTEXITCODE"
+    }
+    return $elapsed.TotalSeconds
+}
+
+# Write a file of random bytes in 1 MB chunks
+function New-WeightFile {
+    param([string]$Path, [int]$SizeMB)
+    
+    $buffer = New-Object byte[] (1024 * 1024)
+    $stream = [System.IO.File]::Create($Path)
+    try {
+        for ($i = 0; $i -lt $SizeMB; $i++) {
+            $random.NextBytes($buffer)
+            $stream.Write($buffer, 0, $buffer.Length)
+        }
+    }
+    finally {
+        $stream.Dispose()
+    }
+}
+
+# Overwrite the given percentage of a file's 64 KB blocks with new random bytes
+function Set-ChangedBlocks {
+    param([string]$Path, [double]$Percent)
+    
+    $blockCount = [int][Math]::Ceiling((Get-Item $Path).Length / $blockSize)
+    $changeCount = [int][Math]::Round($blockCount * $Percent / 100)
+    if ($changeCount -eq 0) {
+        return
+    }
+    
+    $blocks = 0..($blockCount - 1) | Get-Random -Count $changeCount -SetSeed $random.Next()
+    $buffer = New-Object byte[] $blockSize
+    $stream = [System.IO.File]::Open($Path, [System.IO.FileMode]::Open)
+    try {
+        foreach ($block in $blocks) {
+            $random.NextBytes($buffer)
+            $stream.Position = [long]$block * $blockSize
+            $length = [Math]::Min($blockSize, $stream.Length - $stream.Position)
+            $stream.Write($buffer, 0, $length)
+        }
+    }
+    finally {
+        $stream.Dispose()
+    }
+}
+
+Write-Host "Package Delta Benchmark" -ForegroundColor Cyan
+Write-Host "-----------------------" -ForegroundColor Cyan
+Write-Host "Model: $FileCount x $FileSizeMB MB of synthetic weights"
+Write-Host "Work folder: $WorkFolder"
+
+if (Test-Path $WorkFolder) {
+    Remove-Item -Path $WorkFolder -Recurse -Force
+}
+
+$baseFolder = Join-Path $WorkFolder "base"
+New-Item -ItemType Directory -Path $baseFolder | Out-Null
+
+Write-Host "Generating base model..." -ForegroundColor Yellow
+for ($i = 0; $i -lt $FileCount; $i++) {
+    New-WeightFile -Path (Join-Path $baseFolder "model-$i.bin") -SizeMB $FileSizeMB
+}
+Set-Content -Path (Join-Path $baseFolder "config.json") -Value '{ "model_type": "synthetic" }'
+
+$baseOutput = Join-Path $WorkFolder "base-package"
+New-Item -ItemType Directory -Path $baseOutput | Out-Null
+$basePackTime = Invoke-Tool @("/pack", $baseFolder, "/name", "DeltaBenchmark", "/publisher", "Benchmark", "/o", $baseOutput)
+$basePackage = Get-ChildItem -Path $baseOutput -Filter *.msix | Select-Object -First 1
+Write-Host ("Base package: {0:N1} MB in {1:N2} s" -f ($basePackage.Length / 1MB), $basePackTime)
+
+$results = @()
+
+foreach ($rate in $ChangeRates) {
+    Write-Host "Change rate $rate%..." -ForegroundColor Yellow
+    
+    $runFolder = Join-Path $WorkFolder "rate-$rate"
+    $newFolder = Join-Path $runFolder "model"
+    $fullOutput = Join-Path $runFolder "full"
+    $deltaPath = Join-Path $runFolder "model.msixdelta"
+    $rebuiltPath = Join-Path $runFolder "rebuilt.msix"
+    
+    New-Item -ItemType Directory -Path $fullOutput -Force | Out-Null
+    Copy-Item -Path $baseFolder -Destination $newFolder -Recurse
+    
+    for ($i = 0; $i -lt $FileCount; $i++) {
+        Set-ChangedBlocks -Path (Join-Path $newFolder "model-$i.bin") -Percent $rate
+    }
+    
+    $packTime = Invoke-Tool @("/pack", $newFolder, "/name", "DeltaBenchmark", "/publisher", "Benchmark", "/o", $fullOutput)
+    $diffTime = Invoke-Tool @("/diff", $basePackage.FullName, $newFolder, "/o", $deltaPath)
+    $applyTime = Invoke-Tool @("/applyDelta", $basePackage.FullName, $deltaPath, "/o", $rebuiltPath)
+    
+    $fullPackage = Get-ChildItem -Path $fullOutput -Filter *.msix | Select-Object -First 1
+    $deltaSize = (Get-Item $deltaPath).Length
+    $identical = (Get-FileHash $fullPackage.FullName).Hash -eq (Get-FileHash $rebuiltPath).Hash
+    
+    $results += [PSCustomObject]@{
+        "Changed %"     = $rate
+        "Package MB"    = [Math]::Round($fullPackage.Length / 1MB, 1)
+        "Delta MB"      = [Math]::Round($deltaSize / 1MB, 2)
+        "Delta %"       = [Math]::Round(100 * $deltaSize / $fullPackage.Length, 2)
+        "Full pack s"   = [Math]::Round($packTime, 2)
+        "Diff s"        = [Math]::Round($diffTime, 2)
+        "Apply s"       = [Math]::Round($applyTime, 2)
+        "Identical"     = $identical
+    }
+    
+    if (-not $identical) {
+        Write-Host "The rebuilt package differs from the fully built package" -ForegroundColor Red
+    }
+}
+
+$results | Format-Table -AutoSize
@@ -0,0 +1,186 @@
+# Measure-PackageIo.ps1
+# Benchmarks the I/O engines of the package writer on a tree of large files and a tree of many small ones
+#
+# Usage:
+#   .\Measure-PackageIo.ps1 -ToolPath "C:\path\to\ModelPackagingTool.exe" [-WorkFolder "C:\Temp\IoBench"] [-LargeFileCount 4] [-LargeFileSizeMB 1024]
+#
+# Parameters:
+#   -ToolPath:          Path to ModelPackagingTool.exe
+#   -WorkFolder:        Folder for the generated trees, packages and run reports (default is .\IoBenchmark; it is deleted first)
+#   -LargeFileCount:    Number of files in the large-file tree
+#   -LargeFileSizeMB:   Size of each of them in MB
+#   -SmallFileCount:    Number of files in the small-file tree
+#   -SmallFileSizeKB:   Largest size of each of them in KB; sizes are spread evenly up to it
+#   -Engines:           /io-engine values to compare
+#   -Repeats:           Runs per tree and engine; the table shows the median
+#   -Compress:          Deflate the files; by default they are stored, so the runs measure reading,
+#                       hashing and writing rather than compression
+#   -Seed:              Random seed, so runs with the same parameters use the same data
+#   -BlockClone:        Pack with /block-clone, which on ReFS clones stored files into the package;
+#                       put -WorkFolder on the ReFS volume or Dev Drive to measure it
+#
+# Each run packs one tree with /pack and /io-engine set to one engine, and takes the package phase
+# time from the /report file; throughput is the size of the tree over that time. Both trees are
+# checked against the package with /verify once.
+#
+# The first run of each tree reads it from disk and later runs mostly from the file system cache,
+# so the first run is left out as a warm-up and the engines are compared on cached reads and on
+# writes. Make the large-file tree bigger than memory to compare them on reads from disk as well.
+
+param(
+    [Parameter(Mandatory=$true)]
+    [string]$ToolPath,
+    
+    [Parameter(Mandatory=$false)]
+    [string]$WorkFolder = (Join-Path -Path (Get-Location) -ChildPath "IoBenchmark"),
+    
+    [Parameter(Mandatory=$false)]
+    [int]$LargeFileCount = 4,
+    
+    [Parameter(Mandatory=$false)]
+    [int]$LargeFileSizeMB = 1024,
+    
+    [Parameter(Mandatory=$false)]
+    [int]$SmallFileCount = 20000,
+    
+    [Parameter(Mandatory=$false)]
+    [int]$SmallFileSizeKB = 64,
+    
+    [Parameter(Mandatory=$false)]
+    [string[]]$Engines = @("threadpool", "ioring"),
+    
+    [Parameter(Mandatory=$false)]
+    [int]$Repeats = 3,
+    
+    [Parameter(Mandatory=$false)]
+    [switch]$Compress,
+    
+    [Parameter(Mandatory=$false)]
+    [int]$Seed = 1234,
+    
+    [Parameter(Mandatory=$false)]
+    [switch]$BlockClone
+)
+
+$ErrorActionPreference = "Stop"
+$random = [System.Random]::new($Seed)
+
+# .gz is on the writer's list of formats it stores
+$extension = if ($Compress) { ".bin" } else { ".gz" }
+
+# Write a file of random bytes in chunks of up to 1 MB
+function New-RandomFile {
+    param([string]$Path, [long]$Size)
+    
+    $buffer = New-Object byte[] ([Math]::Min($Size, 1MB))
+    $stream = [System.IO.File]::Create($Path)
+    try {
+        $written = 0
+        while ($written -lt $Size) {
+            $random.NextBytes($buffer)
+            $chunk = [int][Math]::Min($buffer.Length, $Size - $written)
+            $stream.Write($buffer, 0, $chunk)
+            $written += $chunk
+        }
+    }
+    finally {
+        $stream.Dispose()
+    }
+}
+
+# Pack a tree and return the package phase seconds from the run report
+function Invoke-Pack {
+    param([string]$Tree, [string]$Engine, [string]$Name)
+    
+    $outputFolder = Join-Path $WorkFolder "out-$Name"
+    $reportPath = Join-Path $WorkFolder "$Name.json"
+    if (Test-Path $outputFolder) {
+        Remove-Item -Path $outputFolder -Recurse -Force
+    }
+    New-Item -ItemType Directory -Path $outputFolder | Out-Null
+    
+    $packArgs = @("/pack", $Tree, "/name", "IoBenchmark", "/publisher", "Benchmark", "/o", $outputFolder, "/io-engine", $Engine, "/report", $reportPath)
+    if ($BlockClone) {
+        $packArgs += "/block-clone"
+    }
+    
+    & $ToolPath @packArgs | Out-Null
+    if ($LASTEXITCODE -ne 0) {
+        throw "/pack of $Tree with /io-engine $Engine failed with exit code $LASTEXITCODE"
+    }
+    
+    $report = Get-Content -Path $reportPath -Raw | ConvertFrom-Json
+    $package = $report.phases | Where-Object { $_.name -eq "package" }
+    return [PSCustomObject]@{
+        Seconds = $package.seconds
+        Package = Get-ChildItem -Path $outputFolder -Filter *.msix | Select-Object -First 1
+    }
+}
+
+Write-Host "Package I/O Benchmark" -ForegroundColor Cyan
+Write-Host "---------------------" -ForegroundColor Cyan
+Write-Host "Large files: $LargeFileCount x $LargeFileSizeMB MB"
+Write-Host "Small files: $SmallFileCount of up to $SmallFileSizeKB KB"
+Write-Host "Engines: $($Engines -join ', '), $Repeats runs each after a warm-up"
+
+if (Test-Path $WorkFolder) {
+    Remove-Item -Path $WorkFolder -Recurse -Force
+}
+
+$trees = [ordered]@{
+    "large" = Join-Path $WorkFolder "large"
+    "small" = Join-Path $WorkFolder "small"
+}
+
+Write-Host "Generating trees..." -ForegroundColor Yellow
+New-Item -ItemType Directory -Path $trees["large"] | Out-Null
+for ($i = 0; $i -lt $LargeFileCount; $i++) {
+    New-RandomFile -Path (Join-Path $trees["large"] "model-$i$extension") -Size ([long]$LargeFileSizeMB * 1MB)
+}
+
+# A hundred files per folder, as in tokenizer and checkpoint folders
+for ($i = 0; $i -lt $SmallFileCount; $i++) {
+    $folder = Join-Path $trees["small"] ("part-{0:D4}" -f [Math]::Floor($i / 100))
+    if ($i % 100 -eq 0) {
+        New-Item -ItemType Directory -Path $folder -Force | Out-Null
+    }
+    $size = [long](($i % $SmallFileSizeKB) + 1) * 1KB
+    New-RandomFile -Path (Join-Path $folder "shard-$i$extension") -Size $size
+}
+
+$results = @()
+
+foreach ($tree in $trees.GetEnumerator()) {
+    $treeBytes = (Get-ChildItem -Path $tree.Value -Recurse -File | Measure-Object -Property Length -Sum).Sum
+    
+    # The warm-up run also checks that the package holds the tree
+    Write-Host "$($tree.Key) tree, warm-up..." -ForegroundColor Yellow
+    $warmUp = Invoke-Pack -Tree $tree.Value -Engine $Engines[0] -Name "$($tree.Key)-warmup"
+    & $ToolPath /verify $warmUp.Package.FullName | Out-Null
+    if ($LASTEXITCODE -ne 0) {
+        throw "The package of the $($tree.Key) tree failed /verify"
+    }
+    
+    foreach ($engine in $Engines) {
+        $runs = @()
+        for ($run = 1; $run -le $Repeats; $run++) {
+            Write-Host "$($tree.Key) tree, $engine, run $run..." -ForegroundColor Yellow
+            $runs += (Invoke-Pack -Tree $tree.Value -Engine $engine -Name "$($tree.Key)-$engine-$run").Seconds
+        }
+        
+        $median = $runs | Sort-Object | Select-Object -Index ([Math]::Floor(($runs.Count - 1) / 2))
+        $results += [PSCustomObject]@{
+            "Tree"      = $tree.Key
+            "Engine"    = $engine
+            "Files"     = @(Get-ChildItem -Path $tree.Value -Recurse -File).Count
+            "MB"        = [Math]::Round($treeBytes / 1MB, 1)
+            "Seconds"   = [Math]::Round($median, 2)
+            "MB/s"      = $(if ($median -gt 0) { [Math]::Round($treeBytes / 1MB / $median, 1) } else { "n/a" })
+        }
+    }
+}
+
+$results | Format-Table -AutoSize
+
+# The tool warns when it can't use the engine it was given
+Write-Host "ioring needs Windows 11 22H2 or later; elsewhere the tool warns and uses the thread pool."
@@ -0,0 +1,442 @@
+# Test-DownloadController.ps1
+# Runs /downloadAndPack against a local stand-in for the Hugging Face hub that caps bandwidth,
+# rate limits and fails requests, to check how the download concurrency controller reacts, and
+# against a stand-in mirror that drops transfers, to check the failover between endpoints
+#
+# Usage:
+#   .\Test-DownloadController.ps1 -ToolPath "C:\path\to\ModelPackagingTool.exe" [-WorkFolder "C:\Temp\ControllerTest"] [-FileCount 8] [-FileSizeMB 64]
+#
+# Parameters:
+#   -ToolPath:           Path to ModelPackagingTool.exe
+#   -WorkFolder:         Folder for the packages (default is .\ControllerTest; it is deleted first)
+#   -Port:               Port the stand-in server listens on
+#   -FileCount:          Number of weight files in the stand-in repository, besides a config and a tokenizer
+#   -FileSizeMB:         Size of each weight file in MB
+#   -BandwidthMBps:      Total bandwidth of the stand-in server
+#   -ConnectionMBps:     Bandwidth of a single connection, so that more connections help up to the total
+#   -MaxConcurrent:      Concurrent file requests above which the server answers 429 in the rate limited runs
+#   -ErrorRate:          Share of file requests answered with 503 in the last run
+#   -RetryAfterSeconds:  Retry-After sent with 429 and 503 responses
+#   -HubLatencyMs:       Delay before the hub answers each request in the mirror run
+#   -DropAfterMB:        Bytes of each weight file the mirror sends before dropping the connection
+#
+# The stand-in serves /api/models/{owner}/{repo}/revision/{branch}, /api/models/{owner}/{repo}/tree/{revision}
+# and /{owner}/{repo}/resolve/{revision}/{file}
+# on 127.0.0.1, and the tool is pointed at it with HF_ENDPOINT. Each run reports the server's view
+# (requests, 429 and 503 answers, highest concurrency) next to the tool's (concurrency raised and
+# lowered, retries), and checks that every file arrived with the right size and contents.
+#
+# The mirror run adds a second stand-in on the next port that answers sooner but drops every weight
+# file partway. HF_ENDPOINT lists the hub first, so only the latency probe makes the mirror the
+# first choice; each dropped file should continue at the hub with a Range request for the rest.
+
+param(
+    [Parameter(Mandatory=$true)]
+    [string]$ToolPath,
+    
+    [Parameter(Mandatory=$false)]
+    [string]$WorkFolder = (Join-Path -Path (Get-Location) -ChildPath "ControllerTest"),
+    
+    [Parameter(Mandatory=$false)]
+    [int]$Port = 8089,
+    
+    [Parameter(Mandatory=$false)]
+    [int]$FileCount = 8,
+    
+    [Parameter(Mandatory=$false)]
+    [int]$FileSizeMB = 64,
+    
+    [Parameter(Mandatory=$false)]
+    [double]$BandwidthMBps = 80,
+    
+    [Parameter(Mandatory=$false)]
+    [double]$ConnectionMBps = 10,
+    
+    [Parameter(Mandatory=$false)]
+    [int]$MaxConcurrent = 6,
+    
+    [Parameter(Mandatory=$false)]
+    [double]$ErrorRate = 0.05,
+    
+    [Parameter(Mandatory=$false)]
+    [int]$RetryAfterSeconds = 2,
+    
+    [Parameter(Mandatory=$false)]
+    [int]$HubLatencyMs = 200,
+    
+    [Parameter(Mandatory=$false)]
+    [int]$DropAfterMB = 16
+)
+
+$ErrorActionPreference = "Stop"
+
+# The stand-in server. HttpListener hands each request to the thread pool, so transfers overlap as
+# they would against the real hub.
+Add-Type -Language CSharp -TypeDefinition @'
+using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Linq;
+using System.Net;
+using System.Security.Cryptography;
+using System.Text;
+using System.Threading;
+
+public class HubStandIn : IDisposable
+{
+    readonly HttpListener listener = new HttpListener();
+    readonly Dictionary<string, long> files;
+    readonly string listing;
+    readonly string commit;
+    readonly int maxConcurrent;
+    readonly double errorRate;
+    readonly int retryAfterSeconds;
+    readonly double bytesPerSecond;
+    readonly double connectionBytesPerSecond;
+    readonly int latencyMs;
+    readonly long dropAfterBytes;
+    readonly Random random = new Random(1234);
+    readonly object sync = new object();
+    double tokens;
+    DateTime lastRefill = DateTime.UtcNow;
+    int active;
+    
+    public int Requests, Throttled, Failed, PeakActive, Dropped, RangeRequests;
+    public long BytesSent;
+    
+    public HubStandIn(int port, Dictionary<string, long> files, int maxConcurrent, double errorRate,
+                      int retryAfterSeconds, double bandwidthMBps, double connectionMBps,
+                      int latencyMs, long dropAfterBytes)
+    {
+        this.files = files;
+        listing = "[" + string.Join(",", files.Select(file =>
+            "{\"type\":\"file\",\"oid\":\"0\",\"size\":" + file.Value + ",\"path\":\"" + file.Key + "\"}")) + "]";
+        
+        // The commit follows the file set, so listings the tool cached for other parameters don't match
+        using (var sha1 = SHA1.Create()) {
+            commit = BitConverter.ToString(sha1.ComputeHash(Encoding.UTF8.GetBytes(listing))).Replace("-", "").ToLowerInvariant();
+        }
+        this.maxConcurrent = maxConcurrent;
+        this.errorRate = errorRate;
+        this.retryAfterSeconds = retryAfterSeconds;
+        bytesPerSecond = bandwidthMBps * 1024 * 1024;
+        connectionBytesPerSecond = connectionMBps * 1024 * 1024;
+        this.latencyMs = latencyMs;
+        this.dropAfterBytes = dropAfterBytes;
+        listener.Prefixes.Add("http://127.0.0.1:" + port + "/");
+    }
+    
+    public void Start()
+    {
+        listener.Start();
+        new Thread(Listen) { IsBackground = true }.Start();
+    }
+    
+    public void Dispose()
+    {
+        listener.Close();
+    }
+    
+    // The contents of a file: a 64 KB pattern that depends on the name, repeated
+    public static byte[] Pattern(string name)
+    {
+        byte[] pattern = new byte[65536];
+        for (int i = 0; i < pattern.Length; i++) {
+            pattern[i] = (byte)(i * 31 + name.Length);
+        }
+        return pattern;
+    }
+    
+    // Whether a downloaded file holds what the stand-in served, so a resumed file that was joined at
+    // the wrong offset is caught
+    public static bool Matches(string path, string name)
+    {
+        byte[] pattern = Pattern(name);
+        byte[] block = new byte[pattern.Length];
+        long position = 0;
+        using (FileStream stream = File.OpenRead(path)) {
+            int read;
+            while ((read = stream.Read(block, 0, block.Length)) > 0) {
+                for (int i = 0; i < read; i++) {
+                    if (block[i] != pattern[(position + i) % pattern.Length]) {
+                        return false;
+                    }
+                }
+                position += read;
+            }
+        }
+        return true;
+    }
+    
+    void Listen()
+    {
+        while (true) {
+            HttpListenerContext context;
+            try {
+                context = listener.GetContext();
+            }
+            catch (Exception) {
+                return;
+            }
+            ThreadPool.QueueUserWorkItem(_ => Handle(context));
+        }
+    }
+    
+    void Handle(HttpListenerContext context)
+    {
+        Interlocked.Increment(ref Requests);
+        string path = Uri.UnescapeDataString(context.Request.Url.AbsolutePath);
+        try {
+            if (latencyMs > 0) {
+                Thread.Sleep(latencyMs);
+            }
+            if (path.StartsWith("/api/models/") && path.Contains("/revision/")) {
+                ServeRevision(context);
+            }
+            else if (path.StartsWith("/api/models/")) {
+                ServeListing(context);
+            }
+            else if (path.Contains("/resolve/")) {
+                ServeFile(context, path.Substring(path.LastIndexOf('/') + 1));
+            }
+            else {
+                context.Response.StatusCode = 404;
+            }
+        }
+        catch (Exception) {
+            // The client went away, for example after a timeout
+        }
+        finally {
+            try { context.Response.Close(); } catch (Exception) { }
+        }
+    }
+    
+    // The branch never moves, so a client that sends the ETag back gets 304
+    void ServeRevision(HttpListenerContext context)
+    {
+        string etag = "\"" + commit + "\"";
+        context.Response.AddHeader("ETag", etag);
+        if (context.Request.Headers["If-None-Match"] == etag) {
+            context.Response.StatusCode = 304;
+            return;
+        }
+        
+        byte[] body = Encoding.UTF8.GetBytes("{\"id\":\"standin/model\",\"sha\":\"" + commit + "\"}");
+        context.Response.ContentType = "application/json";
+        context.Response.ContentLength64 = body.Length;
+        context.Response.OutputStream.Write(body, 0, body.Length);
+    }
+    
+    void ServeListing(HttpListenerContext context)
+    {
+        byte[] body = Encoding.UTF8.GetBytes(listing);
+        context.Response.ContentType = "application/json";
+        context.Response.ContentLength64 = body.Length;
+        context.Response.OutputStream.Write(body, 0, body.Length);
+    }
+    
+    void ServeFile(HttpListenerContext context, string name)
+    {
+        long size;
+        if (!files.TryGetValue(name, out size)) {
+            context.Response.StatusCode = 404;
+            return;
+        }
+        
+        int now = Interlocked.Increment(ref active);
+        try {
+            lock (sync) {
+                PeakActive = Math.Max(PeakActive, now);
+            }
+            
+            if (maxConcurrent > 0 && now > maxConcurrent) {
+                Interlocked.Increment(ref Throttled);
+                context.Response.StatusCode = 429;
+                context.Response.AddHeader("Retry-After", retryAfterSeconds.ToString());
+                return;
+            }
+            
+            bool fail;
+            lock (sync) {
+                fail = random.NextDouble() < errorRate;
+            }
+            if (fail) {
+                Interlocked.Increment(ref Failed);
+                context.Response.StatusCode = 503;
+                context.Response.AddHeader("Retry-After", retryAfterSeconds.ToString());
+                return;
+            }
+            
+            // Only the open-ended ranges the tool sends to continue a file
+            long start = 0;
+            string range = context.Request.Headers["Range"];
+            if (range != null && range.StartsWith("bytes=") && range.EndsWith("-") &&
+                long.TryParse(range.Substring(6, range.Length - 7), out start) && start > 0 && start < size) {
+                Interlocked.Increment(ref RangeRequests);
+                context.Response.StatusCode = 206;
+                context.Response.AddHeader("Content-Range", "bytes " + start + "-" + (size - 1) + "/" + size);
+            }
+            else {
+                start = 0;
+            }
+            
+            context.Response.ContentLength64 = size - start;
+            if (context.Request.HttpMethod == "HEAD") {
+                return;
+            }
+            
+            byte[] buffer = Pattern(name);
+            DateTime started = DateTime.UtcNow;
+            long position = start;
+            while (position < size) {
+                if (dropAfterBytes > 0 && position - start >= dropAfterBytes) {
+                    Interlocked.Increment(ref Dropped);
+                    context.Response.Abort();
+                    return;
+                }
+                
+                int offset = (int)(position % buffer.Length);
+                int chunk = (int)Math.Min(buffer.Length - offset, size - position);
+                Throttle(chunk, started, position - start);
+                context.Response.OutputStream.Write(buffer, offset, chunk);
+                position += chunk;
+                Interlocked.Add(ref BytesSent, chunk);
+            }
+        }
+        finally {
+            Interlocked.Decrement(ref active);
+        }
+    }
+    
+    // Sleep until both the connection's own cap and the server's token bucket allow the chunk
+    void Throttle(int chunk, DateTime started, long sent)
+    {
+        double connectionWait = (sent + chunk) / connectionBytesPerSecond - (DateTime.UtcNow - started).TotalSeconds;
+        
+        double bucketWait;
+        lock (sync) {
+            DateTime now = DateTime.UtcNow;
+            tokens = Math.Min(bytesPerSecond / 4, tokens + (now - lastRefill).TotalSeconds * bytesPerSecond);
+            lastRefill = now;
+            tokens -= chunk;
+            bucketWait = tokens < 0 ? -tokens / bytesPerSecond : 0;
+        }
+        
+        double wait = Math.Max(connectionWait, bucketWait);
+        if (wait > 0) {
+            Thread.Sleep(TimeSpan.FromSeconds(wait));
+        }
+    }
+}
+'@
+
+$files = New-Object 'System.Collections.Generic.Dictionary[string,long]'
+$files["config.json"] = 700
+$files["tokenizer.json"] = 2MB
+for ($i = 0; $i -lt $FileCount; $i++) {
+    $files["model-$i.onnx.data"] = [long]$FileSizeMB * 1MB
+}
+$totalBytes = ($files.Values | Measure-Object -Sum).Sum
+
+$scenarios = @(
+    @{ Name = "Bandwidth cap";         MaxConcurrent = 0;              ErrorRate = 0;          Mirror = $false },
+    @{ Name = "Rate limit";            MaxConcurrent = $MaxConcurrent; ErrorRate = 0;          Mirror = $false },
+    @{ Name = "Rate limit and errors"; MaxConcurrent = $MaxConcurrent; ErrorRate = $ErrorRate; Mirror = $false },
+    @{ Name = "Mirror failover";       MaxConcurrent = 0;              ErrorRate = 0;          Mirror = $true }
+)
+
+Write-Host "Download Controller Test" -ForegroundColor Cyan
+Write-Host "------------------------" -ForegroundColor Cyan
+Write-Host ("Repository: {0} files, {1:N0} MB" -f $files.Count, ($totalBytes / 1MB))
+Write-Host "Server: $BandwidthMBps MB/s in total, $ConnectionMBps MB/s per connection"
+
+if (Test-Path $WorkFolder) {
+    Remove-Item -Path $WorkFolder -Recurse -Force
+}
+New-Item -ItemType Directory -Path $WorkFolder | Out-Null
+
+$downloadFolder = Join-Path ([System.IO.Path]::GetTempPath()) "ModelPackagingTool_Download\model"
+$results = @()
+
+foreach ($scenario in $scenarios) {
+    Write-Host "$($scenario.Name)..." -ForegroundColor Yellow
+    
+    $latencyMs = if ($scenario.Mirror) { $HubLatencyMs } else { 0 }
+    $server = New-Object HubStandIn($Port, $files, $scenario.MaxConcurrent, $scenario.ErrorRate,
+                                    $RetryAfterSeconds, $BandwidthMBps, $ConnectionMBps, $latencyMs, 0)
+    $server.Start()
+    $env:HF_ENDPOINT = "http://127.0.0.1:$Port"
+    
+    # The mirror is listed after the hub, so the tool only prefers it for answering sooner
+    $mirror = $null
+    if ($scenario.Mirror) {
+        $mirror = New-Object HubStandIn(($Port + 1), $files, 0, 0, $RetryAfterSeconds, $BandwidthMBps,
+                                        $ConnectionMBps, 0, ([long]$DropAfterMB * 1MB))
+        $mirror.Start()
+        $env:HF_ENDPOINT += ";http://127.0.0.1:$($Port + 1)"
+    }
+    
+    try {
+        $outputFolder = Join-Path $WorkFolder ($scenario.Name -replace '\W', '')
+        New-Item -ItemType Directory -Path $outputFolder | Out-Null
+        
+        # /verbose logs every controller decision and keeps the downloaded files for the size check
+        $output = $null
+        $elapsed = Measure-Command {
+            $output = & $ToolPath /downloadAndPack "https://huggingface.co/standin/model" /o $outputFolder /verbose 2>&1 | ForEach-Object { "$_" }
+        }
+        $exitCode = $LASTEXITCODE
+    }
+    finally {
+        $server.Dispose()
+        if ($mirror) {
+            $mirror.Dispose()
+        }
+        Remove-Item Env:\HF_ENDPOINT -ErrorAction SilentlyContinue
+    }
+    
+    $complete = $true
+    foreach ($file in $files.GetEnumerator()) {
+        $path = Join-Path $downloadFolder $file.Key
+        if (-not (Test-Path $path) -or (Get-Item $path).Length -ne $file.Value) {
+            Write-Host "Missing or incomplete: $($file.Key)" -ForegroundColor Red
+            $complete = $false
+        }
+        elseif (-not [HubStandIn]::Matches($path, $file.Key)) {
+            Write-Host "Wrong contents: $($file.Key)" -ForegroundColor Red
+            $complete = $false
+        }
+    }
+    
+    # Every dropped transfer should have continued elsewhere rather than starting over
+    $failovers = @($output | Select-String "continuing at").Count
+    if ($mirror -and ($mirror.Dropped -eq 0 -or $server.RangeRequests -eq 0)) {
+        Write-Host "The mirror wasn't chosen, or no dropped file was continued at the hub" -ForegroundColor Red
+        $complete = $false
+    }
+    
+    $results += [PSCustomObject]@{
+        "Scenario"   = $scenario.Name
+        "Seconds"    = [Math]::Round($elapsed.TotalSeconds, 1)
+        "MB/s"       = [Math]::Round($totalBytes / 1MB / $elapsed.TotalSeconds, 1)
+        "Requests"   = $server.Requests + $(if ($mirror) { $mirror.Requests } else { 0 })
+        "429"        = $server.Throttled
+        "503"        = $server.Failed
+        "Peak"       = $server.PeakActive
+        "Raised"     = @($output | Select-String "Raising concurrent downloads").Count
+        "Lowered"    = @($output | Select-String "lowering concurrent downloads").Count
+        "Retries"    = @($output | Select-String "retrying in").Count
+        "Dropped"    = $(if ($mirror) { $mirror.Dropped } else { 0 })
+        "Failovers"  = $failovers
+        "Resumed"    = $server.RangeRequests
+        "Exit"       = $exitCode
+        "Complete"   = $complete
+    }
+}
+
+$results | Format-Table -AutoSize
+
+if ($results | Where-Object { -not $_.Complete -or $_.Exit -ne 0 }) {
+    Write-Host "Some runs didn't download every file" -ForegroundColor Red
+    exit 1
+}
@@ -0,0 +1,258 @@
+# Test-StoreWeights.ps1
+# Checks that /store-weights stores model weights in the package, that stored weights are cloned into
+# it with /block-clone, and that /downloadAndPack hashes them while they download
+#
+# Usage:
+#   .\Test-StoreWeights.ps1 -ToolPath "C:\path\to\ModelPackagingTool.exe" [-WorkFolder "D:\StoreTest"] [-Port 8091] [-FileSizeMB 64]
+#
+# Parameters:
+#   -ToolPath:     Path to ModelPackagingTool.exe
+#   -WorkFolder:   Folder for the model, the packages and the logs (default is .\StoreTest; it is deleted first).
+#                  Put it on a ReFS volume or Dev Drive to check cloning; elsewhere that check is skipped
+#   -Port:         Port the stand-in hub listens on
+#   -FileSizeMB:   Size of each weight file in MB
+#
+# Three runs, each checked with /verify:
+#   /pack /store-weights /block-clone   The weights are stored, and on ReFS their clusters are cloned
+#   /pack                               The weights are deflated, as without the option
+#   /downloadAndPack /store-weights     From a stand-in hub on 127.0.0.1 named by HF_ENDPOINT; the writer
+#                                       uses the checksums taken during the download instead of hashing
+#                                       the weights again
+#
+# The entries are read back with System.IO.Compression: a stored entry's compressed size equals its
+# size, and the weights are written with a repeating pattern that deflates to a fraction of it. Cloning
+# and the use of download checksums are found in the /verbose output.
+
+param(
+    [Parameter(Mandatory=$true)]
+    [string]$ToolPath,
+    
+    [Parameter(Mandatory=$false)]
+    [string]$WorkFolder = (Join-Path -Path (Get-Location) -ChildPath "StoreTest"),
+    
+    [Parameter(Mandatory=$false)]
+    [int]$Port = 8091,
+    
+    [Parameter(Mandatory=$false)]
+    [int]$FileSizeMB = 64
+)
+
+$ErrorActionPreference = "Stop"
+Add-Type -AssemblyName System.IO.Compression.FileSystem
+
+# The stand-in hub: a branch resolving to a fixed commit, a listing and the files, for GET and HEAD
+Add-Type -Language CSharp -TypeDefinition @'
+using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Net;
+using System.Security.Cryptography;
+using System.Text;
+using System.Threading;
+
+public class StoreHubStandIn : IDisposable
+{
+    readonly HttpListener listener = new HttpListener();
+    readonly Dictionary<string, byte[]> files;
+    readonly string listing;
+    readonly string commit;
+    
+    public StoreHubStandIn(int port, Dictionary<string, byte[]> files)
+    {
+        this.files = files;
+        listing = "[" + string.Join(",", files.Select(file =>
+            "{\"type\":\"file\",\"oid\":\"0\",\"size\":" + file.Value.Length + ",\"path\":\"" + file.Key + "\"}")) + "]";
+        
+        // The commit follows the file set, so listings the tool cached for other sizes don't match
+        using (var sha1 = SHA1.Create()) {
+            commit = BitConverter.ToString(sha1.ComputeHash(Encoding.UTF8.GetBytes(listing))).Replace("-", "").ToLowerInvariant();
+        }
+        listener.Prefixes.Add("http://127.0.0.1:" + port + "/");
+    }
+    
+    public void Start()
+    {
+        listener.Start();
+        new Thread(Listen) { IsBackground = true }.Start();
+    }
+    
+    public void Dispose()
+    {
+        listener.Close();
+    }
+    
+    void Listen()
+    {
+        while (true) {
+            HttpListenerContext context;
+            try {
+                context = listener.GetContext();
+            }
+            catch (Exception) {
+                return;
+            }
+            ThreadPool.QueueUserWorkItem(_ => Handle(context));
+        }
+    }
+    
+    void Handle(HttpListenerContext context)
+    {
+        string path = Uri.UnescapeDataString(context.Request.Url.AbsolutePath);
+        try {
+            byte[] body;
+            if (path.StartsWith("/api/models/") && path.Contains("/revision/")) {
+                body = Encoding.UTF8.GetBytes("{\"id\":\"standin/model\",\"sha\":\"" + commit + "\"}");
+            }
+            else if (path.StartsWith("/api/models/")) {
+                body = Encoding.UTF8.GetBytes(listing);
+            }
+            else if (!path.Contains("/resolve/") || !files.TryGetValue(path.Substring(path.LastIndexOf('/') + 1), out body)) {
+                context.Response.StatusCode = 404;
+                return;
+            }
+            
+            context.Response.ContentLength64 = body.Length;
+            if (context.Request.HttpMethod != "HEAD") {
+                context.Response.OutputStream.Write(body, 0, body.Length);
+            }
+        }
+        catch (Exception) {
+            // The client went away
+        }
+        finally {
+            try { context.Response.Close(); } catch (Exception) { }
+        }
+    }
+}
+'@
+
+# Contents that deflate well, so a deflated weight is told from a stored one by its size alone
+function New-PatternBytes {
+    param([string]$Name, [long]$Size)
+    
+    $bytes = New-Object byte[] $Size
+    for ($i = 0; $i -lt [Math]::Min($Size, 4096); $i++) {
+        $bytes[$i] = [byte](($i * 31 + $Name.Length) % 251)
+    }
+    for ($i = 4096; $i -lt $Size; $i += 4096) {
+        [Array]::Copy($bytes, 0, $bytes, $i, [Math]::Min(4096, $Size - $i))
+    }
+    return ,$bytes
+}
+
+# Run the tool with /verbose and return its output, failing on a nonzero exit code
+function Invoke-Tool {
+    param([string[]]$Arguments, [string]$Name)
+    
+    $output = & $ToolPath @Arguments /verbose 2>&1 | ForEach-Object { "$_" }
+    $output | Set-Content -Path (Join-Path $WorkFolder "$Name.log")
+    if ($LASTEXITCODE -ne 0) {
+        throw "$Name failed with exit code $LASTEXITCODE; see $Name.log"
+    }
+    return $output
+}
+
+# Check a package with /verify and return its entries by name
+function Get-PackageEntries {
+    param([string]$OutputFolder)
+    
+    $package = Get-ChildItem -Path $OutputFolder -Filter *.msix | Select-Object -First 1
+    & $ToolPath /verify $package.FullName | Out-Null
+    if ($LASTEXITCODE -ne 0) {
+        throw "$($package.Name) failed /verify"
+    }
+    
+    $entries = @{}
+    $zip = [System.IO.Compression.ZipFile]::OpenRead($package.FullName)
+    try {
+        foreach ($entry in $zip.Entries) {
+            $entries[$entry.FullName] = [PSCustomObject]@{ Length = $entry.Length; CompressedLength = $entry.CompressedLength }
+        }
+    }
+    finally {
+        $zip.Dispose()
+    }
+    return $entries
+}
+
+$weights = @("model.onnx", "model.onnx.data", "model.safetensors")
+$files = New-Object 'System.Collections.Generic.Dictionary[string,byte[]]'
+$files["config.json"] = [System.Text.Encoding]::UTF8.GetBytes('{"model_type":"standin"}')
+$files["model.onnx"] = New-PatternBytes -Name "model.onnx" -Size 1MB
+$files["model.onnx.data"] = New-PatternBytes -Name "model.onnx.data" -Size ([long]$FileSizeMB * 1MB)
+$files["model.safetensors"] = New-PatternBytes -Name "model.safetensors" -Size ([long]$FileSizeMB * 1MB)
+
+Write-Host "Store Weights Test" -ForegroundColor Cyan
+Write-Host "------------------" -ForegroundColor Cyan
+
+if (Test-Path $WorkFolder) {
+    Remove-Item -Path $WorkFolder -Recurse -Force
+}
+$modelFolder = Join-Path $WorkFolder "model"
+New-Item -ItemType Directory -Path $modelFolder | Out-Null
+foreach ($file in $files.GetEnumerator()) {
+    [System.IO.File]::WriteAllBytes((Join-Path $modelFolder $file.Key), $file.Value)
+}
+
+# Blocks can only be cloned on ReFS, which Dev Drives use too
+$fileSystem = try { (Get-Volume -FilePath $WorkFolder).FileSystemType } catch { "unknown" }
+$canClone = "$fileSystem" -eq "ReFS"
+
+$results = @()
+function Add-Result {
+    param([string]$Check, [bool]$Passed, [string]$Detail = "")
+    $script:results += [PSCustomObject]@{ "Check" = $Check; "Passed" = $Passed; "Detail" = $Detail }
+}
+
+Write-Host "/pack /store-weights /block-clone..." -ForegroundColor Yellow
+$storedFolder = Join-Path $WorkFolder "out-stored"
+New-Item -ItemType Directory -Path $storedFolder | Out-Null
+$output = Invoke-Tool -Name "pack-stored" -Arguments @("/pack", $modelFolder, "/name", "StoreTest", "/publisher", "Test", "/o", $storedFolder, "/store-weights", "/block-clone")
+$entries = Get-PackageEntries -OutputFolder $storedFolder
+foreach ($weight in $weights) {
+    Add-Result "Stored with /store-weights: $weight" ($entries[$weight].CompressedLength -eq $entries[$weight].Length) "$($entries[$weight].CompressedLength) of $($entries[$weight].Length) bytes"
+}
+Add-Result "config.json still deflated" ($entries["config.json"].CompressedLength -ne $entries["config.json"].Length)
+if ($canClone) {
+    foreach ($weight in @("model.onnx.data", "model.safetensors")) {
+        Add-Result "Cloned with /block-clone: $weight" ([bool]($output | Select-String -SimpleMatch "bytes of: $weight")) "ReFS"
+    }
+}
+else {
+    Write-Host "$WorkFolder is on $fileSystem, not ReFS; the clone check is skipped" -ForegroundColor Yellow
+}
+
+Write-Host "/pack..." -ForegroundColor Yellow
+$deflatedFolder = Join-Path $WorkFolder "out-deflated"
+New-Item -ItemType Directory -Path $deflatedFolder | Out-Null
+Invoke-Tool -Name "pack-deflated" -Arguments @("/pack", $modelFolder, "/name", "StoreTest", "/publisher", "Test", "/o", $deflatedFolder) | Out-Null
+$entries = Get-PackageEntries -OutputFolder $deflatedFolder
+foreach ($weight in $weights) {
+    Add-Result "Deflated without /store-weights: $weight" ($entries[$weight].CompressedLength -lt $entries[$weight].Length / 2) "$($entries[$weight].CompressedLength) of $($entries[$weight].Length) bytes"
+}
+
+Write-Host "/downloadAndPack /store-weights..." -ForegroundColor Yellow
+$server = New-Object StoreHubStandIn($Port, $files)
+$server.Start()
+$env:HF_ENDPOINT = "http://127.0.0.1:$Port"
+try {
+    $downloadedFolder = Join-Path $WorkFolder "out-downloaded"
+    New-Item -ItemType Directory -Path $downloadedFolder | Out-Null
+    $output = Invoke-Tool -Name "download-stored" -Arguments @("/downloadAndPack", "https://huggingface.co/standin/model", "/o", $downloadedFolder, "/store-weights")
+}
+finally {
+    $server.Dispose()
+    Remove-Item Env:\HF_ENDPOINT -ErrorAction SilentlyContinue
+}
+$entries = Get-PackageEntries -OutputFolder $downloadedFolder
+foreach ($weight in $weights) {
+    Add-Result "Stored after download: $weight" ($entries[$weight].CompressedLength -eq $entries[$weight].Length)
+    Add-Result "Download checksums used: $weight" ([bool]($output | Select-String -SimpleMatch "checksums taken during the download of: $weight"))
+}
+
+$results | Format-Table -AutoSize
+
+if ($results | Where-Object { -not $_.Passed }) {
+    Write-Host "Some checks failed; the tool's output is in the .log files in $WorkFolder" -ForegroundColor Red
+    exit 1
+}